@@ -42,6 +42,9 @@ static const unsigned int DEFAULT_BLOCK_SIZE_PO2 = 4;
 
 static const float DEFAULT_COLLISION_MARGIN = 0.04f;
 
+// Viewer velocity is averaged over about this time, in seconds. Used to predict where blocks should be prefetched.
+static const float VIEWER_VELOCITY_SMOOTHING_TIME = 0.25f;
+
 // By default, tasks are sorted first by the value of band2.
 // When equal, they are sorted by band1, which usually depends on LOD.
 // When equal, they are sorted by band0, which depends on distance from viewer (when relevant).
@@ -51,6 +54,7 @@ static const uint8_t TASK_PRIORITY_GENERATE_BAND2 = 10;
 static const uint8_t TASK_PRIORITY_LOAD_BAND2 = 10;
 static const uint8_t TASK_PRIORITY_SAVE_BAND2 = 9;
 static const uint8_t TASK_PRIORITY_VIRTUAL_TEXTURES_BAND2 = 8; // After meshes
+static const uint8_t TASK_PRIORITY_PREFETCH_BAND2 = 7; // After everything viewers need now
 
 static const uint8_t TASK_PRIORITY_BAND3_DEFAULT = 10;
 
@@ -50,6 +50,14 @@ void GenerateBlockTask::run(zylann::ThreadedTaskContext ctx) {
 				query_data.voxel_buffer, AABB(query_data.origin_in_voxels, query_data.voxel_buffer.get_size() << lod));
 	}
 
+	// The block will stay in memory for a while, reduce its footprint
+	if (lod > 0) {
+		// Distant blocks are not edited directly, so they can afford to lose some precision
+		voxels->quantize_sdf_channel();
+	}
+	voxels->compress_palette_channels();
+	voxels->compress_brick_channels();
+
 	if (stream_dependency->valid) {
 		Ref<VoxelStream> stream = stream_dependency->stream;
 
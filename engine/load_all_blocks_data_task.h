@@ -14,6 +14,10 @@ public:
 		return "LoadAllBlocksData";
 	}
 
+	uint64_t get_serial_lane() const override {
+		return stream_dependency->get_serial_lane();
+	}
+
 	void run(ThreadedTaskContext ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
@@ -63,6 +63,15 @@ void LoadBlockDataTask::run(zylann::ThreadedTaskContext ctx) {
 	if (voxel_query_data.result == VoxelStream::RESULT_ERROR) {
 		ERR_PRINT("Error loading voxel block");
 
+	} else if (voxel_query_data.result == VoxelStream::RESULT_BLOCK_FOUND) {
+		// The block will stay in memory for a while, reduce its footprint
+		if (_lod > 0) {
+			// Distant blocks are not edited directly, so they can afford to lose some precision
+			_voxels->quantize_sdf_channel();
+		}
+		_voxels->compress_palette_channels();
+		_voxels->compress_brick_channels();
+
 	} else if (voxel_query_data.result == VoxelStream::RESULT_BLOCK_NOT_FOUND) {
 		if (_generate_cache_data) {
 			Ref<VoxelGenerator> generator = _stream_dependency->generator;
@@ -114,8 +123,9 @@ void LoadBlockDataTask::run(zylann::ThreadedTaskContext ctx) {
 
 TaskPriority LoadBlockDataTask::get_priority() {
 	float closest_viewer_distance_sq;
-	const TaskPriority p =
-			_priority_dependency.evaluate(_lod, constants::TASK_PRIORITY_LOAD_BAND2, &closest_viewer_distance_sq);
+	const TaskPriority p = _priority_dependency.evaluate(_lod,
+			_prefetch ? constants::TASK_PRIORITY_PREFETCH_BAND2 : constants::TASK_PRIORITY_LOAD_BAND2,
+			&closest_viewer_distance_sq);
 	_too_far = closest_viewer_distance_sq > _priority_dependency.drop_distance_squared;
 	return p;
 }
@@ -138,7 +148,8 @@ void LoadBlockDataTask::apply_result() {
 			o.dropped = !_has_run;
 			o.max_lod_hint = _max_lod_hint;
 			o.initial_load = false;
-			o.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+			o.type = _prefetch ? VoxelEngine::BlockDataOutput::TYPE_PREFETCHED
+							   : VoxelEngine::BlockDataOutput::TYPE_LOADED;
 
 			VoxelEngine::VolumeCallbacks callbacks = VoxelEngine::get_singleton().get_volume_callbacks(_volume_id);
 			CRASH_COND(callbacks.data_output_callback == nullptr);
@@ -21,6 +21,10 @@ public:
 		return "LoadBlockData";
 	}
 
+	uint64_t get_serial_lane() const override {
+		return _stream_dependency->get_serial_lane();
+	}
+
 	void run(ThreadedTaskContext ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
@@ -28,6 +32,12 @@ public:
 
 	static int debug_get_running_count();
 
+	// Prefetch requests run after other loads, and their result is returned as `TYPE_PREFETCHED`.
+	// They should not request generation of blocks that are not found.
+	inline void set_prefetch(bool prefetch) {
+		_prefetch = prefetch;
+	}
+
 private:
 	PriorityDependency _priority_dependency;
 	std::shared_ptr<VoxelBufferInternal> _voxels;
@@ -43,6 +53,7 @@ private:
 	bool _max_lod_hint = false;
 	bool _generate_cache_data = true;
 	bool _requested_generator_task = false;
+	bool _prefetch = false;
 	std::shared_ptr<StreamingDependency> _stream_dependency;
 };
 
@@ -30,6 +30,10 @@ public:
 		return "SaveBlockData";
 	}
 
+	uint64_t get_serial_lane() const override {
+		return _stream_dependency->get_serial_lane();
+	}
+
 	void run(ThreadedTaskContext ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
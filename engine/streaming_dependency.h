@@ -15,6 +15,12 @@ struct StreamingDependency {
 	Ref<VoxelGenerator> generator;
 	bool valid = true;
 
+	// I/O tasks accessing the same stream run serially in the same lane, but different streams can be accessed in
+	// parallel.
+	uint64_t get_serial_lane() const {
+		return reinterpret_cast<uintptr_t>(stream.ptr());
+	}
+
 	static void reset(
 			std::shared_ptr<StreamingDependency> &ref, Ref<VoxelStream> stream, Ref<VoxelGenerator> generator) {
 		if (ref != nullptr) {
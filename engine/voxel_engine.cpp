@@ -60,6 +60,7 @@ VoxelEngine::VoxelEngine(ThreadsConfig threads_config) {
 	}
 
 	_general_thread_pool.set_name("Voxel general");
+	_general_thread_pool.set_work_stealing_enabled(threads_config.work_stealing_enabled);
 	_general_thread_pool.set_thread_count(thread_count);
 	_general_thread_pool.set_priority_update_period(200);
 
@@ -313,6 +314,9 @@ void VoxelEngine::process() {
 
 	_progressive_task_runner.process();
 
+	// Give back memory if the voxel memory pool went over budget
+	VoxelMemoryPool::get_singleton().trim();
+
 	// Update viewer dependencies
 	{
 		const size_t viewer_count = _world.viewers.count();
@@ -369,6 +373,8 @@ VoxelEngine::Stats VoxelEngine::get_stats() const {
 	s.meshing_tasks = MeshBlockTask::debug_get_running_count();
 	s.streaming_tasks = LoadBlockDataTask::debug_get_running_count() + SaveBlockDataTask::debug_get_running_count();
 	s.main_thread_tasks = _time_spread_task_runner.get_pending_count() + _progressive_task_runner.get_pending_count();
+	s.memory_pool = VoxelMemoryPool::get_singleton().get_stats();
+	s.graph_column_cache = pg::ColumnCache::get_singleton().get_stats();
 	return s;
 }
 
@@ -1,7 +1,9 @@
 #ifndef VOXEL_ENGINE_H
 #define VOXEL_ENGINE_H
 
+#include "../generators/graph/voxel_graph_column_cache.h"
 #include "../meshers/voxel_mesher.h"
+#include "../storage/voxel_memory_pool.h"
 #include "../streams/instance_data.h"
 #include "../util/file_locker.h"
 #include "../util/memory.h"
@@ -60,7 +62,9 @@ public:
 		enum Type { //
 			TYPE_LOADED,
 			TYPE_GENERATED,
-			TYPE_SAVED
+			TYPE_SAVED,
+			// Loaded ahead of time, before a viewer needed it. Voxels are null if the block was not found.
+			TYPE_PREFETCHED
 		};
 
 		Type type;
@@ -120,6 +124,9 @@ public:
 		int thread_count_margin_below_max = 1;
 		// Portion of available CPU threads to attempt using
 		float thread_count_ratio_over_max = 0.5;
+		// If enabled, threads of the general pool own a local task queue and can steal tasks from each other.
+		// Reduces contention when using many threads.
+		bool work_stealing_enabled = false;
 	};
 
 	static VoxelEngine &get_singleton();
@@ -207,6 +214,8 @@ public:
 		int streaming_tasks;
 		int meshing_tasks;
 		int main_thread_tasks;
+		VoxelMemoryPool::Stats memory_pool;
+		pg::ColumnCache::Stats graph_column_cache;
 	};
 
 	Stats get_stats() const;
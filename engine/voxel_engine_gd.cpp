@@ -1,5 +1,6 @@
 #include "voxel_engine_gd.h"
 #include "../constants/voxel_string_names.h"
+#include "../generators/graph/voxel_graph_column_cache.h"
 #include "../storage/voxel_memory_pool.h"
 #include "../util/godot/classes/project_settings.h"
 #include "../util/godot/classes/rendering_server.h"
@@ -44,6 +45,7 @@ zylann::voxel::VoxelEngine::ThreadsConfig VoxelEngine::get_config_from_godot(
 			Variant::FLOAT, "voxel/threads/count/ratio_over_max", PROPERTY_HINT_RANGE, "0,1,0.1", 0.5f, true);
 	add_custom_godot_project_setting(
 			Variant::INT, "voxel/threads/main/time_budget_ms", PROPERTY_HINT_RANGE, "0,1000", 8, true);
+	add_custom_godot_project_setting(Variant::BOOL, "voxel/threads/work_stealing", PROPERTY_HINT_NONE, "", false, true);
 
 	out_main_thread_time_budget_usec = 1000 * int(ps.get("voxel/threads/main/time_budget_ms"));
 
@@ -55,9 +57,27 @@ zylann::voxel::VoxelEngine::ThreadsConfig VoxelEngine::get_config_from_godot(
 	// Portion of available CPU threads to attempt using
 	config.thread_count_ratio_over_max = math::clamp(float(ps.get("voxel/threads/count/ratio_over_max")), 0.f, 1.f);
 
+	config.work_stealing_enabled = ps.get("voxel/threads/work_stealing");
+
 	return config;
 }
 
+void VoxelEngine::apply_memory_config_from_godot() {
+	ZN_ASSERT(ProjectSettings::get_singleton() != nullptr);
+	ProjectSettings &ps = *ProjectSettings::get_singleton();
+
+	add_custom_godot_project_setting(
+			Variant::INT, "voxel/memory/pool_budget_mb", PROPERTY_HINT_RANGE, "0,65536", 0, true);
+	add_custom_godot_project_setting(Variant::INT, "voxel/memory/graph_column_cache_budget_mb", PROPERTY_HINT_RANGE,
+			"0,4096", int(pg::ColumnCache::DEFAULT_MEMORY_BUDGET / (1024 * 1024)), true);
+
+	const size_t pool_budget_mb = math::max(0, int(ps.get("voxel/memory/pool_budget_mb")));
+	VoxelMemoryPool::get_singleton().set_memory_budget(pool_budget_mb * 1024 * 1024);
+
+	const size_t column_cache_budget_mb = math::max(0, int(ps.get("voxel/memory/graph_column_cache_budget_mb")));
+	pg::ColumnCache::get_singleton().set_memory_budget(column_cache_budget_mb * 1024 * 1024);
+}
+
 VoxelEngine::VoxelEngine() {
 #ifdef ZN_PROFILER_ENABLED
 	CRASH_COND(RenderingServer::get_singleton() == nullptr);
@@ -96,16 +116,25 @@ Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats &stats) {
 	tasks["meshing"] = stats.meshing_tasks;
 	tasks["main_thread"] = stats.main_thread_tasks;
 
-	// This part is additional for scripts because VoxelMemoryPool is not exposed
 	Dictionary mem;
-	mem["voxel_total"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_total_memory());
-	mem["voxel_used"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_used_memory());
-	mem["block_count"] = VoxelMemoryPool::get_singleton().debug_get_used_blocks();
+	mem["voxel_total"] = ZN_SIZE_T_TO_VARIANT(stats.memory_pool.total_memory);
+	mem["voxel_used"] = ZN_SIZE_T_TO_VARIANT(stats.memory_pool.used_memory);
+	mem["voxel_budget"] = ZN_SIZE_T_TO_VARIANT(stats.memory_pool.memory_budget);
+	mem["voxel_trimmed"] = ZN_SIZE_T_TO_VARIANT(stats.memory_pool.trimmed_memory);
+	mem["block_count"] = stats.memory_pool.used_blocks;
+
+	Dictionary column_cache;
+	column_cache["hits"] = int64_t(stats.graph_column_cache.hits);
+	column_cache["misses"] = int64_t(stats.graph_column_cache.misses);
+	column_cache["column_count"] = stats.graph_column_cache.column_count;
+	column_cache["memory_usage"] = ZN_SIZE_T_TO_VARIANT(stats.graph_column_cache.memory_usage);
+	column_cache["memory_budget"] = ZN_SIZE_T_TO_VARIANT(stats.graph_column_cache.memory_budget);
 
 	Dictionary d;
 	d["thread_pools"] = pools;
 	d["tasks"] = tasks;
 	d["memory_pools"] = mem;
+	d["graph_column_cache"] = column_cache;
 	return d;
 }
 
@@ -21,6 +21,9 @@ public:
 	static zylann::voxel::VoxelEngine::ThreadsConfig get_config_from_godot(
 			unsigned int &out_main_thread_time_budget_usec);
 
+	// Applies project settings of memory pools and caches. They must have been created before.
+	static void apply_memory_config_from_godot();
+
 	VoxelEngine();
 
 	Dictionary get_stats() const;
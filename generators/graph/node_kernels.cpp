@@ -0,0 +1,212 @@
+#include "node_kernels_impl.h"
+
+#if defined(ZN_GRAPH_KERNELS_SSE2)
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(ZN_GRAPH_KERNELS_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace zylann::voxel::pg {
+namespace {
+
+#ifdef ZN_GRAPH_KERNELS_SSE2
+
+struct LanesSSE2 {
+	typedef __m128 Type;
+	static const uint32_t WIDTH = 4;
+
+	static inline Type load(const float *p) {
+		return _mm_loadu_ps(p);
+	}
+	static inline void store(float *p, Type v) {
+		_mm_storeu_ps(p, v);
+	}
+	static inline Type set(float v) {
+		return _mm_set1_ps(v);
+	}
+	static inline Type add(Type a, Type b) {
+		return _mm_add_ps(a, b);
+	}
+	static inline Type sub(Type a, Type b) {
+		return _mm_sub_ps(a, b);
+	}
+	static inline Type mul(Type a, Type b) {
+		return _mm_mul_ps(a, b);
+	}
+	static inline Type div(Type a, Type b) {
+		return _mm_div_ps(a, b);
+	}
+	// Same as `a < b ? a : b`
+	static inline Type min(Type a, Type b) {
+		return _mm_min_ps(a, b);
+	}
+	// Same as `a > b ? a : b`
+	static inline Type max(Type a, Type b) {
+		return _mm_max_ps(a, b);
+	}
+	static inline Type abs(Type v) {
+		return _mm_andnot_ps(_mm_set1_ps(-0.f), v);
+	}
+	static inline Type sqrt(Type v) {
+		return _mm_sqrt_ps(v);
+	}
+	static inline Type select_lt(Type x, Type y, Type a, Type b) {
+		const Type mask = _mm_cmplt_ps(x, y);
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	static inline Type select_eq(Type x, Type y, Type a, Type b) {
+		const Type mask = _mm_cmpeq_ps(x, y);
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+};
+
+#endif // ZN_GRAPH_KERNELS_SSE2
+
+#ifdef ZN_GRAPH_KERNELS_NEON
+
+struct LanesNEON {
+	typedef float32x4_t Type;
+	static const uint32_t WIDTH = 4;
+
+	static inline Type load(const float *p) {
+		return vld1q_f32(p);
+	}
+	static inline void store(float *p, Type v) {
+		vst1q_f32(p, v);
+	}
+	static inline Type set(float v) {
+		return vdupq_n_f32(v);
+	}
+	static inline Type add(Type a, Type b) {
+		return vaddq_f32(a, b);
+	}
+	static inline Type sub(Type a, Type b) {
+		return vsubq_f32(a, b);
+	}
+	static inline Type mul(Type a, Type b) {
+		return vmulq_f32(a, b);
+	}
+	static inline Type div(Type a, Type b) {
+		return vdivq_f32(a, b);
+	}
+	// `vminq_f32` and `vmaxq_f32` propagate NaNs, which is different from the scalar version
+	static inline Type min(Type a, Type b) {
+		return vbslq_f32(vcltq_f32(a, b), a, b);
+	}
+	static inline Type max(Type a, Type b) {
+		return vbslq_f32(vcgtq_f32(a, b), a, b);
+	}
+	static inline Type abs(Type v) {
+		return vabsq_f32(v);
+	}
+	static inline Type sqrt(Type v) {
+		return vsqrtq_f32(v);
+	}
+	static inline Type select_lt(Type x, Type y, Type a, Type b) {
+		return vbslq_f32(vcltq_f32(x, y), a, b);
+	}
+	static inline Type select_eq(Type x, Type y, Type a, Type b) {
+		return vbslq_f32(vceqq_f32(x, y), a, b);
+	}
+};
+
+#endif // ZN_GRAPH_KERNELS_NEON
+
+#ifdef ZN_GRAPH_KERNELS_AVX2
+
+bool is_avx2_supported() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	const bool has_osxsave = (info[2] & (1 << 27)) != 0;
+	const bool has_avx = (info[2] & (1 << 28)) != 0;
+	// The OS must also save AVX registers when switching threads
+	if (!has_osxsave || !has_avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // ZN_GRAPH_KERNELS_AVX2
+
+struct NodeKernelsRegistry {
+	NodeKernels kernels[SIMD_LEVEL_COUNT];
+	bool supported[SIMD_LEVEL_COUNT] = { false };
+	SimdLevel best_level = SIMD_NONE;
+
+	NodeKernelsRegistry() {
+		make_node_kernels<LanesScalar>(kernels[SIMD_NONE]);
+		supported[SIMD_NONE] = true;
+
+#ifdef ZN_GRAPH_KERNELS_SSE2
+		make_node_kernels<LanesSSE2>(kernels[SIMD_SSE2]);
+		supported[SIMD_SSE2] = true;
+		best_level = SIMD_SSE2;
+#endif
+#ifdef ZN_GRAPH_KERNELS_AVX2
+		if (is_avx2_supported()) {
+			make_node_kernels_avx2(kernels[SIMD_AVX2]);
+			supported[SIMD_AVX2] = true;
+			best_level = SIMD_AVX2;
+		}
+#endif
+#ifdef ZN_GRAPH_KERNELS_NEON
+		make_node_kernels<LanesNEON>(kernels[SIMD_NEON]);
+		supported[SIMD_NEON] = true;
+		best_level = SIMD_NEON;
+#endif
+	}
+};
+
+const NodeKernelsRegistry &get_registry() {
+	static const NodeKernelsRegistry s_registry;
+	return s_registry;
+}
+
+} // namespace
+
+const NodeKernels &get_node_kernels() {
+	const NodeKernelsRegistry &registry = get_registry();
+	return registry.kernels[registry.best_level];
+}
+
+const NodeKernels *get_node_kernels(SimdLevel level) {
+	const NodeKernelsRegistry &registry = get_registry();
+	if (level < 0 || level >= SIMD_LEVEL_COUNT || !registry.supported[level]) {
+		return nullptr;
+	}
+	return &registry.kernels[level];
+}
+
+SimdLevel get_node_kernels_simd_level() {
+	return get_registry().best_level;
+}
+
+const char *get_simd_level_name(SimdLevel level) {
+	switch (level) {
+		case SIMD_NONE:
+			return "None";
+		case SIMD_SSE2:
+			return "SSE2";
+		case SIMD_AVX2:
+			return "AVX2";
+		case SIMD_NEON:
+			return "NEON";
+		default:
+			return "Unknown";
+	}
+}
+
+} // namespace zylann::voxel::pg
@@ -0,0 +1,83 @@
+#ifndef VOXEL_GRAPH_NODE_KERNELS_H
+#define VOXEL_GRAPH_NODE_KERNELS_H
+
+#include <cstdint>
+
+// Instruction sets node kernels can be compiled for. SSE2 and NEON are always available on the architectures that
+// have them. AVX2 is compiled in a separate file and only used if the CPU running the program supports it.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZN_GRAPH_KERNELS_SSE2
+#define ZN_GRAPH_KERNELS_AVX2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+// Only 64-bit ARM has vector division and square root
+#define ZN_GRAPH_KERNELS_NEON
+#endif
+
+namespace zylann::voxel::pg {
+
+enum SimdLevel {
+	SIMD_NONE,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_NEON,
+	SIMD_LEVEL_COUNT
+};
+
+// Loops used by nodes of the graph runtime to process buffers, using vector instructions when available.
+// They give the same results as the scalar versions, so generated terrain doesn't depend on the CPU.
+// Inputs and outputs don't need to be aligned and can have any number of values, because bindings are buffers
+// provided by the caller.
+struct NodeKernels {
+	struct Binary {
+		void (*buffer_buffer)(const float *a, const float *b, float *out, uint32_t count);
+		void (*buffer_constant)(const float *a, float b, float *out, uint32_t count);
+		void (*constant_buffer)(float a, const float *b, float *out, uint32_t count);
+	};
+
+	Binary add;
+	Binary subtract;
+	Binary multiply;
+	// Returns 0 where `b` is 0
+	Binary divide;
+	Binary min;
+	Binary max;
+
+	void (*clamp)(const float *x, const float *min, const float *max, float *out, uint32_t count);
+	void (*clamp_constant)(const float *x, float min, float max, float *out, uint32_t count);
+	void (*mix)(const float *a, const float *b, const float *ratio, float *out, uint32_t count);
+	// a * x + b
+	void (*linear)(const float *x, float a, float b, float *out, uint32_t count);
+	// `edge0` and `edge1` must not be approximately equal
+	void (*smoothstep)(const float *x, float edge0, float edge1, float *out, uint32_t count);
+	// t < threshold ? a : b
+	void (*select)(const float *a, const float *b, const float *t, float threshold, float *out, uint32_t count);
+
+	void (*distance_2d)(const float *x0, const float *y0, const float *x1, const float *y1, float *out,
+			uint32_t count);
+	void (*distance_3d)(const float *x0, const float *y0, const float *z0, const float *x1, const float *y1,
+			const float *z1, float *out, uint32_t count);
+
+	void (*sdf_box)(const float *x, const float *y, const float *z, float size_x, float size_y, float size_z,
+			float *out, uint32_t count);
+	void (*sdf_sphere)(const float *x, const float *y, const float *z, float radius, float *out, uint32_t count);
+	void (*sdf_torus)(const float *x, const float *y, const float *z, float r1, float r2, float *out, uint32_t count);
+};
+
+// Gets kernels using the fastest instruction set supported by the CPU. It is detected on the first call.
+const NodeKernels &get_node_kernels();
+
+// Gets kernels using a specific instruction set. Returns null if it wasn't compiled, or if the CPU doesn't support it.
+// Mostly useful to compare them.
+const NodeKernels *get_node_kernels(SimdLevel level);
+
+SimdLevel get_node_kernels_simd_level();
+const char *get_simd_level_name(SimdLevel level);
+
+#ifdef ZN_GRAPH_KERNELS_AVX2
+// Implemented in `node_kernels_avx2.cpp`. Must only be used if the CPU supports AVX2.
+void make_node_kernels_avx2(NodeKernels &kernels);
+#endif
+
+} // namespace zylann::voxel::pg
+
+#endif // VOXEL_GRAPH_NODE_KERNELS_H
@@ -0,0 +1,90 @@
+// Node kernels using AVX2. This file is compiled with AVX2 enabled using pragmas instead of build options, so the rest
+// of the module can still run on CPUs without it. It must only be used after checking the CPU supports it.
+
+#include "node_kernels.h"
+
+#ifdef ZN_GRAPH_KERNELS_AVX2
+
+// Included before changing target options, see `node_kernels_impl.h`
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+// MSVC doesn't need an option to use AVX2 intrinsics.
+
+// Note: FMA is not enabled on purpose. The compiler could fuse multiplications and additions, which would round
+// differently from other instruction sets.
+
+#include "node_kernels_impl.h"
+
+namespace zylann::voxel::pg {
+namespace {
+
+struct LanesAVX2 {
+	typedef __m256 Type;
+	static const uint32_t WIDTH = 8;
+
+	static inline Type load(const float *p) {
+		return _mm256_loadu_ps(p);
+	}
+	static inline void store(float *p, Type v) {
+		_mm256_storeu_ps(p, v);
+	}
+	static inline Type set(float v) {
+		return _mm256_set1_ps(v);
+	}
+	static inline Type add(Type a, Type b) {
+		return _mm256_add_ps(a, b);
+	}
+	static inline Type sub(Type a, Type b) {
+		return _mm256_sub_ps(a, b);
+	}
+	static inline Type mul(Type a, Type b) {
+		return _mm256_mul_ps(a, b);
+	}
+	static inline Type div(Type a, Type b) {
+		return _mm256_div_ps(a, b);
+	}
+	// Same as `a < b ? a : b`
+	static inline Type min(Type a, Type b) {
+		return _mm256_min_ps(a, b);
+	}
+	// Same as `a > b ? a : b`
+	static inline Type max(Type a, Type b) {
+		return _mm256_max_ps(a, b);
+	}
+	static inline Type abs(Type v) {
+		return _mm256_andnot_ps(_mm256_set1_ps(-0.f), v);
+	}
+	static inline Type sqrt(Type v) {
+		return _mm256_sqrt_ps(v);
+	}
+	static inline Type select_lt(Type x, Type y, Type a, Type b) {
+		return _mm256_blendv_ps(b, a, _mm256_cmp_ps(x, y, _CMP_LT_OQ));
+	}
+	static inline Type select_eq(Type x, Type y, Type a, Type b) {
+		return _mm256_blendv_ps(b, a, _mm256_cmp_ps(x, y, _CMP_EQ_OQ));
+	}
+};
+
+} // namespace
+
+void make_node_kernels_avx2(NodeKernels &kernels) {
+	make_node_kernels<LanesAVX2>(kernels);
+}
+
+} // namespace zylann::voxel::pg
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif // ZN_GRAPH_KERNELS_AVX2
@@ -0,0 +1,320 @@
+#ifndef VOXEL_GRAPH_NODE_KERNELS_IMPL_H
+#define VOXEL_GRAPH_NODE_KERNELS_IMPL_H
+
+// Kernels are written once as templates, and instantiated for each instruction set. This header must only be included
+// by files implementing `NodeKernels`.
+// Everything here has internal linkage: the same templates are compiled with different target options in
+// `node_kernels_avx2.cpp`, and the linker must not pick those instantiations for the rest of the program.
+// For the same reason, headers included here must be included before changing target options.
+
+#include "node_kernels.h"
+#include <cmath>
+#include <cstdint>
+
+namespace zylann::voxel::pg {
+namespace {
+
+// Operations on a group of values. Each instruction set has its own version, and kernels use them through templates.
+// They must give the same results as this scalar version, including when inputs are NaN.
+struct LanesScalar {
+	typedef float Type;
+	static const uint32_t WIDTH = 1;
+
+	static inline Type load(const float *p) {
+		return *p;
+	}
+	static inline void store(float *p, Type v) {
+		*p = v;
+	}
+	static inline Type set(float v) {
+		return v;
+	}
+	static inline Type add(Type a, Type b) {
+		return a + b;
+	}
+	static inline Type sub(Type a, Type b) {
+		return a - b;
+	}
+	static inline Type mul(Type a, Type b) {
+		return a * b;
+	}
+	static inline Type div(Type a, Type b) {
+		return a / b;
+	}
+	static inline Type min(Type a, Type b) {
+		return a < b ? a : b;
+	}
+	static inline Type max(Type a, Type b) {
+		return a > b ? a : b;
+	}
+	static inline Type abs(Type v) {
+		return std::fabs(v);
+	}
+	static inline Type sqrt(Type v) {
+		return std::sqrt(v);
+	}
+	// x < y ? a : b
+	static inline Type select_lt(Type x, Type y, Type a, Type b) {
+		return x < y ? a : b;
+	}
+	// x == y ? a : b
+	static inline Type select_eq(Type x, Type y, Type a, Type b) {
+		return x == y ? a : b;
+	}
+};
+
+// Runs `f` on full vectors, then on remaining values one by one.
+template <typename V, typename F>
+inline void process_lanes(uint32_t count, F f) {
+	uint32_t i = 0;
+	for (; i + V::WIDTH <= count; i += V::WIDTH) {
+		f(V(), i);
+	}
+	for (; i < count; ++i) {
+		f(LanesScalar(), i);
+	}
+}
+
+struct OpAdd {
+	template <typename L>
+	static inline typename L::Type apply(typename L::Type a, typename L::Type b) {
+		return L::add(a, b);
+	}
+};
+
+struct OpSubtract {
+	template <typename L>
+	static inline typename L::Type apply(typename L::Type a, typename L::Type b) {
+		return L::sub(a, b);
+	}
+};
+
+struct OpMultiply {
+	template <typename L>
+	static inline typename L::Type apply(typename L::Type a, typename L::Type b) {
+		return L::mul(a, b);
+	}
+};
+
+struct OpDivide {
+	// Avoids NaNs caused by zeros
+	template <typename L>
+	static inline typename L::Type apply(typename L::Type a, typename L::Type b) {
+		const typename L::Type zero = L::set(0.f);
+		return L::select_eq(b, zero, zero, L::div(a, b));
+	}
+};
+
+struct OpMin {
+	template <typename L>
+	static inline typename L::Type apply(typename L::Type a, typename L::Type b) {
+		return L::min(a, b);
+	}
+};
+
+struct OpMax {
+	template <typename L>
+	static inline typename L::Type apply(typename L::Type a, typename L::Type b) {
+		return L::max(a, b);
+	}
+};
+
+template <typename V, typename Op>
+void binary_buffer_buffer(const float *a, const float *b, float *out, uint32_t count) {
+	process_lanes<V>(count, [a, b, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, Op::template apply<L>(L::load(a + i), L::load(b + i)));
+	});
+}
+
+template <typename V, typename Op>
+void binary_buffer_constant(const float *a, float b, float *out, uint32_t count) {
+	process_lanes<V>(count, [a, b, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, Op::template apply<L>(L::load(a + i), L::set(b)));
+	});
+}
+
+template <typename V, typename Op>
+void binary_constant_buffer(float a, const float *b, float *out, uint32_t count) {
+	process_lanes<V>(count, [a, b, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, Op::template apply<L>(L::set(a), L::load(b + i)));
+	});
+}
+
+// Dividing by a constant multiplies by its inverse instead
+template <typename V>
+void divide_buffer_constant(const float *a, float b, float *out, uint32_t count) {
+	if (b == 0.f) {
+		process_lanes<V>(count, [out](auto lanes, uint32_t i) {
+			typedef decltype(lanes) L;
+			L::store(out + i, L::set(0.f));
+		});
+	} else {
+		binary_buffer_constant<V, OpMultiply>(a, 1.f / b, out, count);
+	}
+}
+
+template <typename V, typename Op>
+NodeKernels::Binary make_binary_kernels() {
+	NodeKernels::Binary k;
+	k.buffer_buffer = binary_buffer_buffer<V, Op>;
+	k.buffer_constant = binary_buffer_constant<V, Op>;
+	k.constant_buffer = binary_constant_buffer<V, Op>;
+	return k;
+}
+
+template <typename L>
+inline typename L::Type clamp_lanes(typename L::Type x, typename L::Type min, typename L::Type max) {
+	return L::select_lt(x, min, min, L::select_lt(max, x, max, x));
+}
+
+template <typename L>
+inline typename L::Type squared_lanes(typename L::Type x) {
+	return L::mul(x, x);
+}
+
+template <typename V>
+void clamp(const float *x, const float *min, const float *max, float *out, uint32_t count) {
+	process_lanes<V>(count, [x, min, max, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, clamp_lanes<L>(L::load(x + i), L::load(min + i), L::load(max + i)));
+	});
+}
+
+template <typename V>
+void clamp_constant(const float *x, float min, float max, float *out, uint32_t count) {
+	process_lanes<V>(count, [x, min, max, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, clamp_lanes<L>(L::load(x + i), L::set(min), L::set(max)));
+	});
+}
+
+template <typename V>
+void mix(const float *a, const float *b, const float *ratio, float *out, uint32_t count) {
+	process_lanes<V>(count, [a, b, ratio, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type va = L::load(a + i);
+		L::store(out + i, L::add(va, L::mul(L::sub(L::load(b + i), va), L::load(ratio + i))));
+	});
+}
+
+template <typename V>
+void linear(const float *x, float a, float b, float *out, uint32_t count) {
+	process_lanes<V>(count, [x, a, b, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, L::add(L::mul(L::set(a), L::load(x + i)), L::set(b)));
+	});
+}
+
+template <typename V>
+void smoothstep(const float *x, float edge0, float edge1, float *out, uint32_t count) {
+	const float range = edge1 - edge0;
+	process_lanes<V>(count, [x, edge0, range, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type t = clamp_lanes<L>(
+				L::div(L::sub(L::load(x + i), L::set(edge0)), L::set(range)), L::set(0.f), L::set(1.f));
+		L::store(out + i, L::mul(L::mul(t, t), L::sub(L::set(3.f), L::mul(L::set(2.f), t))));
+	});
+}
+
+template <typename V>
+void select(const float *a, const float *b, const float *t, float threshold, float *out, uint32_t count) {
+	process_lanes<V>(count, [a, b, t, threshold, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		L::store(out + i, L::select_lt(L::load(t + i), L::set(threshold), L::load(a + i), L::load(b + i)));
+	});
+}
+
+template <typename V>
+void distance_2d(const float *x0, const float *y0, const float *x1, const float *y1, float *out, uint32_t count) {
+	process_lanes<V>(count, [x0, y0, x1, y1, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type dx = L::sub(L::load(x1 + i), L::load(x0 + i));
+		const typename L::Type dy = L::sub(L::load(y1 + i), L::load(y0 + i));
+		L::store(out + i, L::sqrt(L::add(squared_lanes<L>(dx), squared_lanes<L>(dy))));
+	});
+}
+
+template <typename V>
+void distance_3d(const float *x0, const float *y0, const float *z0, const float *x1, const float *y1, const float *z1,
+		float *out, uint32_t count) {
+	process_lanes<V>(count, [x0, y0, z0, x1, y1, z1, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type dx = L::sub(L::load(x1 + i), L::load(x0 + i));
+		const typename L::Type dy = L::sub(L::load(y1 + i), L::load(y0 + i));
+		const typename L::Type dz = L::sub(L::load(z1 + i), L::load(z0 + i));
+		L::store(out + i,
+				L::sqrt(L::add(L::add(squared_lanes<L>(dx), squared_lanes<L>(dy)), squared_lanes<L>(dz))));
+	});
+}
+
+template <typename V>
+void sdf_box(const float *x, const float *y, const float *z, float size_x, float size_y, float size_z, float *out,
+		uint32_t count) {
+	process_lanes<V>(count, [x, y, z, size_x, size_y, size_z, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type zero = L::set(0.f);
+		const typename L::Type dx = L::sub(L::abs(L::load(x + i)), L::set(size_x));
+		const typename L::Type dy = L::sub(L::abs(L::load(y + i)), L::set(size_y));
+		const typename L::Type dz = L::sub(L::abs(L::load(z + i)), L::set(size_z));
+		const typename L::Type inside = L::min(L::max(dx, L::max(dy, dz)), zero);
+		const typename L::Type outside = L::sqrt(L::add(L::add(squared_lanes<L>(L::max(dx, zero)),
+															   squared_lanes<L>(L::max(dy, zero))),
+				squared_lanes<L>(L::max(dz, zero))));
+		L::store(out + i, L::add(inside, outside));
+	});
+}
+
+template <typename V>
+void sdf_sphere(const float *x, const float *y, const float *z, float radius, float *out, uint32_t count) {
+	process_lanes<V>(count, [x, y, z, radius, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type d = L::sqrt(L::add(
+				L::add(squared_lanes<L>(L::load(x + i)), squared_lanes<L>(L::load(y + i))),
+				squared_lanes<L>(L::load(z + i))));
+		L::store(out + i, L::sub(d, L::set(radius)));
+	});
+}
+
+template <typename V>
+void sdf_torus(const float *x, const float *y, const float *z, float r1, float r2, float *out, uint32_t count) {
+	process_lanes<V>(count, [x, y, z, r1, r2, out](auto lanes, uint32_t i) {
+		typedef decltype(lanes) L;
+		const typename L::Type qx = L::sub(
+				L::sqrt(L::add(squared_lanes<L>(L::load(x + i)), squared_lanes<L>(L::load(z + i)))), L::set(r1));
+		const typename L::Type d = L::sqrt(L::add(squared_lanes<L>(qx), squared_lanes<L>(L::load(y + i))));
+		L::store(out + i, L::sub(d, L::set(r2)));
+	});
+}
+
+template <typename V>
+void make_node_kernels(NodeKernels &k) {
+	k.add = make_binary_kernels<V, OpAdd>();
+	k.subtract = make_binary_kernels<V, OpSubtract>();
+	k.multiply = make_binary_kernels<V, OpMultiply>();
+	k.divide = make_binary_kernels<V, OpDivide>();
+	k.divide.buffer_constant = divide_buffer_constant<V>;
+	k.min = make_binary_kernels<V, OpMin>();
+	k.max = make_binary_kernels<V, OpMax>();
+
+	k.clamp = clamp<V>;
+	k.clamp_constant = clamp_constant<V>;
+	k.mix = mix<V>;
+	k.linear = linear<V>;
+	k.smoothstep = smoothstep<V>;
+	k.select = select<V>;
+
+	k.distance_2d = distance_2d<V>;
+	k.distance_3d = distance_3d<V>;
+
+	k.sdf_box = sdf_box<V>;
+	k.sdf_sphere = sdf_sphere<V>;
+	k.sdf_torus = sdf_torus<V>;
+}
+
+} // namespace
+} // namespace zylann::voxel::pg
+
+#endif // VOXEL_GRAPH_NODE_KERNELS_IMPL_H
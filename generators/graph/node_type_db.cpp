@@ -15,6 +15,7 @@
 #include "../../util/string_funcs.h"
 #include "fast_noise_lite_gdshader.h"
 #include "image_range_grid.h"
+#include "node_kernels.h"
 #include "range_utility.h"
 
 #ifdef VOXEL_ENABLE_FAST_NOISE_2
@@ -29,6 +30,14 @@ NodeTypeDB *g_node_type_db = nullptr;
 
 using namespace math;
 
+// Elementwise nodes may write their output in the same data as one of their inputs
+// (see `Runtime::compile_preprocessed_graph`)
+inline void copy_values(const float *src, float *dst, uint32_t count) {
+	if (src != dst) {
+		memcpy(dst, src, count * sizeof(float));
+	}
+}
+
 template <typename F>
 inline void do_monop(pg::Runtime::ProcessBufferContext &ctx, F f) {
 	const Runtime::Buffer &a = ctx.get_input(0);
@@ -83,8 +92,8 @@ inline void do_binop(pg::Runtime::ProcessBufferContext &ctx, F f) {
 	}
 }
 
-// Special case for division because we want to avoid NaNs caused by zeros
-void do_division(Runtime::ProcessBufferContext &ctx) {
+// Same as above, using vectorized kernels
+inline void do_binop(pg::Runtime::ProcessBufferContext &ctx, const NodeKernels::Binary &kernels) {
 	const Runtime::Buffer &a = ctx.get_input(0);
 	const Runtime::Buffer &b = ctx.get_input(1);
 	Runtime::Buffer &out = ctx.get_output(0);
@@ -92,40 +101,22 @@ void do_division(Runtime::ProcessBufferContext &ctx) {
 
 	if (a.is_constant || b.is_constant) {
 		if (!b.is_constant) {
-			const float c = a.constant_value;
-			const float *v = b.data;
-			for (uint32_t i = 0; i < buffer_size; ++i) {
-				out.data[i] = v[i] == 0.f ? 0.f : c / v[i];
-			}
+			kernels.constant_buffer(a.constant_value, b.data, out.data, buffer_size);
 
 		} else if (!a.is_constant) {
-			if (b.constant_value == 0.f) {
-				for (uint32_t i = 0; i < buffer_size; ++i) {
-					out.data[i] = 0.f;
-				}
-			} else {
-				const float c = 1.f / b.constant_value;
-				const float *v = a.data;
-				for (uint32_t i = 0; i < buffer_size; ++i) {
-					out.data[i] = v[i] * c;
-				}
-			}
+			kernels.buffer_constant(a.data, b.constant_value, out.data, buffer_size);
+
 		} else {
 			// Normally this case should have been optimized out at compile-time
-			const float v = b.constant_value == 0.f ? 0.f : a.constant_value / b.constant_value;
+			float c;
+			kernels.buffer_buffer(&a.constant_value, &b.constant_value, &c, 1);
 			for (uint32_t i = 0; i < buffer_size; ++i) {
-				out.data[i] = v;
+				out.data[i] = c;
 			}
 		}
 
 	} else {
-		for (uint32_t i = 0; i < buffer_size; ++i) {
-			if (b.data[i] == 0.f) {
-				out.data[i] = 0.f;
-			} else {
-				out.data[i] = a.data[i] / b.data[i];
-			}
-		}
+		kernels.buffer_buffer(a.data, b.data, out.data, buffer_size);
 	}
 }
 
@@ -151,10 +142,6 @@ inline float get_pixel_repeat_linear(const Image &im, float x, float y) {
 	return h;
 }
 
-inline float select(float a, float b, float threshold, float t) {
-	return t < threshold ? a : b;
-}
-
 // inline Interval select(const Interval &a, const Interval &b, const Interval &threshold, const Interval &t) {
 // 	if (t.max < threshold.min) {
 // 		return a;
@@ -310,7 +297,7 @@ NodeTypeDB::NodeTypeDB() {
 
 	FixedArray<NodeType, VoxelGraphFunction::NODE_TYPE_COUNT> &types = _types;
 
-	// TODO Most operations need SIMD support
+	// Frequently used operations are vectorized with `NodeKernels`. Other operations are still scalar loops.
 
 	// SUGG the program could be a list of pointers to polymorphic heap-allocated classes...
 	// but I find that the data struct approach is kinda convenient too?
@@ -350,13 +337,14 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_OUTPUT_SDF];
 		t.name = "OutputSDF";
 		t.category = CATEGORY_OUTPUT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("sdf", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.outputs.push_back(NodeType::Port("_out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
 			const Runtime::Buffer &input = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			ZN_ASSERT(out.data != nullptr);
-			memcpy(out.data, input.data, input.size * sizeof(float));
+			copy_values(input.data, out.data, input.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -367,6 +355,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_OUTPUT_WEIGHT];
 		t.name = "OutputWeight";
 		t.category = CATEGORY_OUTPUT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("weight"));
 		t.outputs.push_back(NodeType::Port("_out"));
 		NodeType::Param layer_param("layer", Variant::INT, 0);
@@ -377,9 +366,7 @@ NodeTypeDB::NodeTypeDB() {
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
 			const Runtime::Buffer &input = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (unsigned int i = 0; i < out.size; ++i) {
-				out.data[i] = clamp(input.data[i], 0.f, 1.f);
-			}
+			get_node_kernels().clamp_constant(input.data, 0.f, 1.f, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -390,12 +377,13 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_OUTPUT_TYPE];
 		t.name = "OutputType";
 		t.category = CATEGORY_OUTPUT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("type"));
 		t.outputs.push_back(NodeType::Port("_out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
 			const Runtime::Buffer &input = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
-			memcpy(out.data, input.data, input.size * sizeof(float));
+			copy_values(input.data, out.data, input.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -406,12 +394,13 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_OUTPUT_SINGLE_TEXTURE];
 		t.name = "OutputSingleTexture";
 		t.category = CATEGORY_OUTPUT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("index"));
 		t.outputs.push_back(NodeType::Port("_out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
 			const Runtime::Buffer &input = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
-			memcpy(out.data, input.data, input.size * sizeof(float));
+			copy_values(input.data, out.data, input.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -429,13 +418,14 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_CUSTOM_OUTPUT];
 		t.name = "CustomOutput";
 		t.category = CATEGORY_OUTPUT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("value"));
 		t.outputs.push_back(NodeType::Port("_out"));
 		// t.params.push_back(NodeType::Param("binding", Variant::INT, 0));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
 			const Runtime::Buffer &input = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
-			memcpy(out.data, input.data, input.size * sizeof(float));
+			copy_values(input.data, out.data, input.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -454,12 +444,13 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_ADD];
 		t.name = "Add";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.compile_func = nullptr;
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return a + b; });
+			do_binop(ctx, get_node_kernels().add);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -474,11 +465,12 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SUBTRACT];
 		t.name = "Subtract";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return a - b; });
+			do_binop(ctx, get_node_kernels().subtract);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -493,11 +485,12 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_MULTIPLY];
 		t.name = "Multiply";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return a * b; });
+			do_binop(ctx, get_node_kernels().multiply);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -517,10 +510,13 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_DIVIDE];
 		t.name = "Divide";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 1.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
-		t.process_buffer_func = do_division;
+		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
+			do_binop(ctx, get_node_kernels().divide);
+		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
 			const Interval b = ctx.get_input(1);
@@ -534,6 +530,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SIN];
 		t.name = "Sin";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
@@ -555,6 +552,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_FLOOR];
 		t.name = "Floor";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
@@ -576,6 +574,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_ABS];
 		t.name = "Abs";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
@@ -597,6 +596,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SQRT];
 		t.name = "Sqrt";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
@@ -618,6 +618,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_FRACT];
 		t.name = "Fract";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
@@ -639,6 +640,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_STEPIFY];
 		t.name = "Stepify";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("step", 1.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -667,6 +669,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_WRAP];
 		t.name = "Wrap";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("length", 1.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -695,11 +698,12 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_MIN];
 		t.name = "Min";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return min(a, b); });
+			do_binop(ctx, get_node_kernels().min);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -718,11 +722,12 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_MAX];
 		t.name = "Max";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return max(a, b); });
+			do_binop(ctx, get_node_kernels().max);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -741,6 +746,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_DISTANCE_2D];
 		t.name = "Distance2D";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x0"));
 		t.inputs.push_back(NodeType::Port("y0"));
 		t.inputs.push_back(NodeType::Port("x1", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
@@ -752,9 +758,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &x1 = ctx.get_input(2);
 			const Runtime::Buffer &y1 = ctx.get_input(3);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = Math::sqrt(squared(x1.data[i] - x0.data[i]) + squared(y1.data[i] - y0.data[i]));
-			}
+			get_node_kernels().distance_2d(x0.data, y0.data, x1.data, y1.data, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval x0 = ctx.get_input(0);
@@ -775,6 +779,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_DISTANCE_3D];
 		t.name = "Distance3D";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x0"));
 		t.inputs.push_back(NodeType::Port("y0"));
 		t.inputs.push_back(NodeType::Port("z0"));
@@ -790,10 +795,8 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &y1 = ctx.get_input(4);
 			const Runtime::Buffer &z1 = ctx.get_input(5);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = Math::sqrt(squared(x1.data[i] - x0.data[i]) + squared(y1.data[i] - y0.data[i]) +
-						squared(z1.data[i] - z0.data[i]));
-			}
+			get_node_kernels().distance_3d(
+					x0.data, y0.data, z0.data, x1.data, y1.data, z1.data, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval x0 = ctx.get_input(0);
@@ -818,6 +821,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_CLAMP];
 		t.name = "Clamp";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.inputs.push_back(NodeType::Port("min", -1.f));
 		t.inputs.push_back(NodeType::Port("max", 1.f));
@@ -827,9 +831,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &minv = ctx.get_input(1);
 			const Runtime::Buffer &maxv = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = clamp(a.data[i], minv.data[i], maxv.data[i]);
-			}
+			get_node_kernels().clamp(a.data, minv.data, maxv.data, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -854,6 +856,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_CLAMP_C];
 		t.name = "ClampC";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.params.push_back(NodeType::Param("min", Variant::FLOAT, -1.f));
@@ -868,9 +871,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &a = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = clamp(a.data[i], p.min, p.max);
-			}
+			get_node_kernels().clamp_constant(a.data, p.min, p.max, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -888,6 +889,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_MIX];
 		t.name = "Mix";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.inputs.push_back(NodeType::Port("ratio"));
@@ -901,49 +903,13 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &r = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const uint32_t buffer_size = out.size;
-			if (a.is_constant) {
-				const float ca = a.constant_value;
-				if (b.is_constant) {
-					const float cb = b.constant_value;
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = Math::lerp(ca, cb, r.data[i]);
-					}
-				} else {
-					if (b_ignored) {
-						for (uint32_t i = 0; i < buffer_size; ++i) {
-							out.data[i] = ca;
-						}
-					} else {
-						for (uint32_t i = 0; i < buffer_size; ++i) {
-							out.data[i] = Math::lerp(ca, b.data[i], r.data[i]);
-						}
-					}
-				}
-			} else if (b.is_constant) {
-				const float cb = b.constant_value;
-				if (a_ignored) {
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = cb;
-					}
-				} else {
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = Math::lerp(a.data[i], cb, r.data[i]);
-					}
-				}
+			// Constant inputs are provided as buffers too
+			if (a_ignored) {
+				copy_values(b.data, out.data, buffer_size);
+			} else if (b_ignored) {
+				copy_values(a.data, out.data, buffer_size);
 			} else {
-				if (a_ignored) {
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = b.data[i];
-					}
-				} else if (b_ignored) {
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = a.data[i];
-					}
-				} else {
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = Math::lerp(a.data[i], b.data[i], r.data[i]);
-					}
-				}
+				get_node_kernels().mix(a.data, b.data, r.data, out.data, buffer_size);
 			}
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
@@ -988,6 +954,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_REMAP];
 		t.name = "Remap";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.params.push_back(NodeType::Param("min0", Variant::FLOAT, -1.f));
@@ -1005,9 +972,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &x = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = p.a * x.data[i] + p.b;
-			}
+			get_node_kernels().linear(x.data, p.a, p.b, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -1028,6 +993,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SMOOTHSTEP];
 		t.name = "Smoothstep";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.params.push_back(NodeType::Param("edge0", Variant::FLOAT, 0.f));
@@ -1042,8 +1008,12 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &a = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = smoothstep(p.edge0, p.edge1, a.data[i]);
+			if (Math::is_equal_approx(p.edge0, p.edge1)) {
+				for (uint32_t i = 0; i < out.size; ++i) {
+					out.data[i] = p.edge0;
+				}
+			} else {
+				get_node_kernels().smoothstep(a.data, p.edge0, p.edge1, out.data, out.size);
 			}
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
@@ -1314,11 +1284,12 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_PLANE];
 		t.name = "SdfPlane";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("height"));
 		t.outputs.push_back(NodeType::Port("sdf"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return a - b; });
+			do_binop(ctx, get_node_kernels().subtract);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -1338,6 +1309,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_BOX];
 		t.name = "SdfBox";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("z", 0.f, VoxelGraphFunction::AUTO_CONNECT_Z));
@@ -1358,10 +1330,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			const Params p = ctx.get_params<Params>();
 			Runtime::Buffer &out = ctx.get_output(0);
-			const Vector3 size(p.size_x, p.size_y, p.size_z);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = math::sdf_box(Vector3(x.data[i], y.data[i], z.data[i]), size);
-			}
+			get_node_kernels().sdf_box(x.data, y.data, z.data, p.size_x, p.size_y, p.size_z, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -1391,6 +1360,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_SPHERE];
 		t.name = "SdfSphere";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("z", 0.f, VoxelGraphFunction::AUTO_CONNECT_Z));
@@ -1407,9 +1377,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = Math::sqrt(squared(x.data[i]) + squared(y.data[i]) + squared(z.data[i])) - p.radius;
-			}
+			get_node_kernels().sdf_sphere(x.data, y.data, z.data, p.radius, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -1432,6 +1400,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_TORUS];
 		t.name = "SdfTorus";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("z", 0.f, VoxelGraphFunction::AUTO_CONNECT_Z));
@@ -1450,9 +1419,7 @@ NodeTypeDB::NodeTypeDB() {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			const Params p = ctx.get_params<Params>();
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = math::sdf_torus(x.data[i], y.data[i], z.data[i], p.r1, p.r2);
-			}
+			get_node_kernels().sdf_torus(x.data, y.data, z.data, p.r1, p.r2, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -1481,6 +1448,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_SMOOTH_UNION];
 		t.name = "SdfSmoothUnion";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.outputs.push_back(NodeType::Port("sdf"));
@@ -1575,6 +1543,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_SMOOTH_SUBTRACT];
 		t.name = "SdfSmoothSubtract";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.outputs.push_back(NodeType::Port("sdf"));
@@ -1711,6 +1680,7 @@ NodeTypeDB::NodeTypeDB() {
 		// t < threshold ? a : b
 		t.name = "Select";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.inputs.push_back(NodeType::Port("t"));
@@ -1736,22 +1706,20 @@ NodeTypeDB::NodeTypeDB() {
 			const uint32_t buffer_size = out.size;
 
 			if (a_ignored) {
-				memcpy(out.data, b.data, buffer_size * sizeof(float));
+				copy_values(b.data, out.data, buffer_size);
 
 			} else if (b_ignored) {
-				memcpy(out.data, a.data, buffer_size * sizeof(float));
+				copy_values(a.data, out.data, buffer_size);
 
 			} else if (tested_value.is_constant) {
 				const float *src = tested_value.constant_value < threshold ? a.data : b.data;
-				memcpy(out.data, src, buffer_size * sizeof(float));
+				copy_values(src, out.data, buffer_size);
 
 			} else if (a.is_constant && b.is_constant && a.constant_value == b.constant_value) {
-				memcpy(out.data, a.data, buffer_size * sizeof(float));
+				copy_values(a.data, out.data, buffer_size);
 
 			} else {
-				for (uint32_t i = 0; i < buffer_size; ++i) {
-					out.data[i] = select(a.data[i], b.data[i], threshold, tested_value.data[i]);
-				}
+				get_node_kernels().select(a.data, b.data, tested_value.data, threshold, out.data, buffer_size);
 			}
 		};
 
@@ -2268,6 +2236,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_POWI];
 		t.name = "Powi";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.params.push_back(NodeType::Param("power", Variant::INT, 2));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -2331,6 +2300,7 @@ NodeTypeDB::NodeTypeDB() {
 		NodeType &t = types[VoxelGraphFunction::NODE_POW];
 		t.name = "Pow";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.inputs.push_back(NodeType::Port("p", 2.f));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -77,6 +77,10 @@ struct NodeType {
 	bool debug_only = false;
 	// Pseudo nodes are replaced during compilation with one or multiple real nodes, they have no logic on their own
 	bool is_pseudo_node = false;
+	// Elementwise nodes compute each output value only from input values at the same index. The compiler can fuse
+	// chains of them, so they process buffers in smaller parts. If they have a single output, it may share its data
+	// with one of their inputs.
+	bool is_elementwise = false;
 	Category category;
 	std::vector<Port> inputs;
 	std::vector<Port> outputs;
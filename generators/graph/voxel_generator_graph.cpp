@@ -17,6 +17,7 @@
 #include "../../util/profiling_clock.h"
 #include "../../util/string_funcs.h"
 #include "node_type_db.h"
+#include "voxel_graph_column_cache.h"
 #include "voxel_graph_function.h"
 
 namespace zylann::voxel {
@@ -434,6 +435,13 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 	Span<float> y_cache = to_span(cache.y_cache);
 	Span<float> z_cache = to_span(cache.z_cache);
 
+	pg::ColumnCache &column_cache = pg::ColumnCache::get_singleton();
+	const bool use_column_cache =
+			_use_xz_caching && column_cache.get_memory_budget() > 0 && runtime.get_outer_group_result_count() > 0;
+	if (use_column_cache) {
+		cache.column_results.resize(runtime.get_outer_group_result_count() * slice_buffer_size);
+	}
+
 	const float air_sdf = _debug_clipped_blocks ? -1.f : 1.f;
 	const float matter_sdf = _debug_clipped_blocks ? 1.f : -1.f;
 
@@ -587,6 +595,24 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 					}
 				}
 
+				// Results of operations not depending on Y can be shared with other blocks of the same column
+				bool outer_group_done = false;
+				if (use_column_cache) {
+					const pg::ColumnCache::Key column_key{ runtime.get_program_hash(), Vector2i(gmin.x, gmin.z),
+						Vector2i(section_size.x, section_size.z), uint8_t(input.lod) };
+					Span<float> column_results = to_span(cache.column_results);
+
+					if (column_cache.load(column_key, column_results)) {
+						runtime.set_outer_group_results(cache.state, column_results);
+					} else {
+						QueryInputs query_inputs(*runtime_ptr, x_cache, y_cache, z_cache, input_sdf_slice_cache);
+						runtime.generate_outer_group(cache.state, query_inputs.get());
+						runtime.get_outer_group_results(cache.state, column_results);
+						column_cache.store(column_key, column_results);
+					}
+					outer_group_done = true;
+				}
+
 				for (int ry = rmin.y, gy = gmin.y; ry < rmax.y; ++ry, gy += stride) {
 					ZN_PROFILE_SCOPE_NAMED("Full slice");
 
@@ -608,7 +634,8 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 					// Full query (unless using execution map)
 					{
 						QueryInputs query_inputs(*runtime_ptr, x_cache, y_cache, z_cache, input_sdf_slice_cache);
-						runtime.generate_set(cache.state, query_inputs.get(), _use_xz_caching && ry != rmin.y,
+						runtime.generate_set(cache.state, query_inputs.get(),
+								outer_group_done || (_use_xz_caching && ry != rmin.y),
 								_use_optimized_execution_map ? &cache.optimized_execution_map : nullptr);
 					}
 
@@ -225,6 +225,8 @@ private:
 		std::vector<float> input_sdf_full_cache;
 		pg::Runtime::State state;
 		pg::Runtime::ExecutionMap optimized_execution_map;
+		// Results of operations not depending on Y, for one section
+		std::vector<float> column_results;
 	};
 
 	static Cache &get_tls_cache();
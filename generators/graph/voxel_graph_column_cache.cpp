@@ -0,0 +1,118 @@
+#include "voxel_graph_column_cache.h"
+#include "../../util/errors.h"
+#include "../../util/memory.h"
+#include "../../util/profiling.h"
+
+#include <cstring>
+
+namespace zylann::voxel::pg {
+
+namespace {
+ColumnCache *g_column_cache = nullptr;
+}
+
+void ColumnCache::create_singleton() {
+	ZN_ASSERT(g_column_cache == nullptr);
+	g_column_cache = ZN_NEW(ColumnCache);
+}
+
+void ColumnCache::destroy_singleton() {
+	ZN_ASSERT(g_column_cache != nullptr);
+	ColumnCache *cache = g_column_cache;
+	g_column_cache = nullptr;
+	ZN_DELETE(cache);
+}
+
+ColumnCache &ColumnCache::get_singleton() {
+	ZN_ASSERT(g_column_cache != nullptr);
+	return *g_column_cache;
+}
+
+void ColumnCache::set_memory_budget(size_t bytes) {
+	_memory_budget = bytes;
+	MutexLock lock(_mutex);
+	remove_least_recently_used_columns(bytes);
+}
+
+bool ColumnCache::load(const Key &key, Span<float> dst) {
+	ZN_PROFILE_SCOPE();
+	{
+		MutexLock lock(_mutex);
+		auto it = _columns.find(key);
+		if (it != _columns.end() && it->second->data.size() == dst.size()) {
+			// Move to the front of the LRU list
+			_columns_lru.splice(_columns_lru.begin(), _columns_lru, it->second);
+			memcpy(dst.data(), it->second->data.data(), dst.size() * sizeof(float));
+			++_hits;
+			return true;
+		}
+	}
+	++_misses;
+	return false;
+}
+
+void ColumnCache::store(const Key &key, Span<const float> src) {
+	ZN_PROFILE_SCOPE();
+	const size_t memory_budget = _memory_budget;
+
+	// Allocate and copy before locking
+	Column column;
+	column.key = key;
+	column.data.resize(src.size());
+	memcpy(column.data.data(), src.data(), src.size() * sizeof(float));
+	const size_t column_memory_usage = get_column_memory_usage(column);
+
+	if (column_memory_usage > memory_budget) {
+		return;
+	}
+
+	MutexLock lock(_mutex);
+
+	auto it = _columns.find(key);
+	if (it != _columns.end()) {
+		// Another thread computed the same column in the meantime
+		Column &existing_column = *it->second;
+		_memory_usage -= get_column_memory_usage(existing_column);
+		existing_column.data = std::move(column.data);
+		_memory_usage += column_memory_usage;
+		_columns_lru.splice(_columns_lru.begin(), _columns_lru, it->second);
+	} else {
+		_columns_lru.push_front(std::move(column));
+		_columns.insert({ key, _columns_lru.begin() });
+		_memory_usage += column_memory_usage;
+	}
+
+	remove_least_recently_used_columns(memory_budget);
+}
+
+void ColumnCache::remove_least_recently_used_columns(size_t memory_budget) {
+	// The mutex must be locked
+	while (_memory_usage > memory_budget && _columns_lru.size() > 0) {
+		const Column &column = _columns_lru.back();
+		_memory_usage -= get_column_memory_usage(column);
+		_columns.erase(column.key);
+		_columns_lru.pop_back();
+	}
+}
+
+void ColumnCache::clear() {
+	MutexLock lock(_mutex);
+	_columns.clear();
+	_columns_lru.clear();
+	_memory_usage = 0;
+}
+
+ColumnCache::Stats ColumnCache::get_stats() const {
+	Stats stats;
+	stats.hits = _hits;
+	stats.misses = _misses;
+	stats.memory_budget = _memory_budget;
+	{
+		MutexLock lock(_mutex);
+		stats.column_count = _columns.size();
+		stats.memory_usage = _memory_usage;
+	}
+	return stats;
+}
+
+} // namespace zylann::voxel::pg
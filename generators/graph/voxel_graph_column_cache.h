@@ -0,0 +1,107 @@
+#ifndef VOXEL_GRAPH_COLUMN_CACHE_H
+#define VOXEL_GRAPH_COLUMN_CACHE_H
+
+#include "../../util/hash_funcs.h"
+#include "../../util/math/vector2i.h"
+#include "../../util/span.h"
+#include "../../util/thread/mutex.h"
+
+#include <atomic>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace zylann::voxel::pg {
+
+// Keeps results of the parts of graphs that don't depend on Y (see `Runtime::get_outer_group_results`), for columns of
+// voxels generated recently. Blocks stacked along Y cover the same columns, so they can re-use these results instead of
+// computing them again.
+// It is shared by all generators and threads. When it takes more memory than its budget, least recently used columns
+// are removed.
+class ColumnCache {
+public:
+	static const size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+
+	struct Key {
+		// See `Runtime::get_program_hash`
+		uint64_t program_hash;
+		// Position of the first voxel of the column, in voxels of LOD 0
+		Vector2i origin;
+		// How many voxels the column has along X and Z
+		Vector2i size;
+		uint8_t lod_index;
+
+		inline bool operator==(const Key &other) const {
+			return program_hash == other.program_hash && origin == other.origin && size == other.size &&
+					lod_index == other.lod_index;
+		}
+	};
+
+	struct Stats {
+		// Since the cache was created
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		unsigned int column_count = 0;
+		size_t memory_usage = 0;
+		size_t memory_budget = 0;
+	};
+
+	static void create_singleton();
+	static void destroy_singleton();
+	static ColumnCache &get_singleton();
+
+	// 0 disables the cache.
+	void set_memory_budget(size_t bytes);
+
+	inline size_t get_memory_budget() const {
+		return _memory_budget;
+	}
+
+	// Copies results of a column into `dst` if they are found, and returns `true`. `dst` must have the same size as
+	// when they were stored.
+	bool load(const Key &key, Span<float> dst);
+
+	// Stores a copy of results of a column, replacing the previous ones if any.
+	void store(const Key &key, Span<const float> src);
+
+	void clear();
+
+	Stats get_stats() const;
+
+private:
+	struct KeyHasher {
+		inline size_t operator()(const Key &key) const {
+			uint64_t hash = hash_djb2_one_64(key.program_hash);
+			hash = hash_djb2_one_64(key.origin.x, hash);
+			hash = hash_djb2_one_64(key.origin.y, hash);
+			hash = hash_djb2_one_64(key.size.x, hash);
+			hash = hash_djb2_one_64(key.size.y, hash);
+			return hash_djb2_one_64(key.lod_index, hash);
+		}
+	};
+
+	struct Column {
+		Key key;
+		std::vector<float> data;
+	};
+
+	static inline size_t get_column_memory_usage(const Column &column) {
+		return sizeof(Column) + column.data.size() * sizeof(float);
+	}
+
+	void remove_least_recently_used_columns(size_t memory_budget);
+
+	BinaryMutex _mutex;
+	// Columns ordered from most to least recently used
+	std::list<Column> _columns_lru;
+	std::unordered_map<Key, std::list<Column>::iterator, KeyHasher> _columns;
+	size_t _memory_usage = 0;
+
+	std::atomic<size_t> _memory_budget = { DEFAULT_MEMORY_BUDGET };
+	std::atomic_uint64_t _hits = { 0 };
+	std::atomic_uint64_t _misses = { 0 };
+};
+
+} // namespace zylann::voxel::pg
+
+#endif // VOXEL_GRAPH_COLUMN_CACHE_H
@@ -2,12 +2,15 @@
 #include "../../util/container_funcs.h"
 #include "../../util/expression_parser.h"
 #include "../../util/godot/core/array.h" // for `varray` in GDExtension builds
+#include "../../util/hash_funcs.h"
 #include "../../util/macros.h"
 #include "../../util/profiling.h"
 #include "../../util/string_funcs.h"
 #include "node_type_db.h"
 #include "voxel_graph_function.h"
 
+#include <atomic>
+#include <cstring>
 #include <limits>
 #include <unordered_set>
 
@@ -1176,43 +1179,54 @@ CompilationResult Runtime::compile(const VoxelGraphFunction &function, bool debu
 	return result;
 }
 
-// Optimize parts of the graph that only depend on inputs tagged as "outer group",
-// so they can be moved in the outer loop when blocks are generated, running less times.
+// Inputs that can change between two executions of the inner loop when blocks are generated. Blocks are generated
+// slice by slice along Y, so this is Y, and inputs we know nothing about.
+static bool is_inner_group_input(uint32_t node_type_id) {
+	switch (node_type_id) {
+		case VoxelGraphFunction::NODE_INPUT_Y:
+		case VoxelGraphFunction::NODE_INPUT_SDF:
+		case VoxelGraphFunction::NODE_CUSTOM_INPUT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// Optimize parts of the graph that don't depend on Y (only on X, Z or constants), so they can be moved in the outer
+// loop when blocks are generated, running less times. Heightmaps are a common example.
 // Moves them all at the beginning.
 // `order` is a previously computed order of execution of each node.
 static uint32_t move_outer_group_operations_up(std::vector<uint32_t> &order, const ProgramGraph &graph) {
 	ZN_PROFILE_SCOPE();
 	std::vector<uint32_t> immediate_deps;
-	std::unordered_set<uint32_t> outer_group_node_ids;
+	std::unordered_set<uint32_t> inner_group_node_ids;
 	std::vector<uint32_t> order_outer_group;
 	std::vector<uint32_t> order_inner_group;
 
 	for (const uint32_t node_id : order) {
 		const ProgramGraph::Node &node = graph.get_node(node_id);
 
-		// We consider X and Z as the beginning of the outer group.
-		bool is_outer_group =
-				node.type_id == VoxelGraphFunction::NODE_INPUT_X || node.type_id == VoxelGraphFunction::NODE_INPUT_Z;
+		// Nodes are in the inner group if they depend on an input varying along Y, directly or not. Everything else
+		// gives the same results for every slice, including nodes without inputs.
+		bool is_inner_group = is_inner_group_input(node.type_id);
 
-		if (!is_outer_group) {
+		if (!is_inner_group) {
 			immediate_deps.clear();
 			graph.find_immediate_dependencies(node_id, immediate_deps);
 
-			// Assume outer group, unless a dependency is not in the outer group
-			is_outer_group = true;
 			for (const uint32_t dep_node_id : immediate_deps) {
-				if (outer_group_node_ids.find(dep_node_id) == outer_group_node_ids.end()) {
-					is_outer_group = false;
+				if (inner_group_node_ids.find(dep_node_id) != inner_group_node_ids.end()) {
+					is_inner_group = true;
 					break;
 				}
 			}
 		}
 
-		if (is_outer_group) {
-			order_outer_group.push_back(node_id);
-			outer_group_node_ids.insert(node_id);
-		} else {
+		if (is_inner_group) {
 			order_inner_group.push_back(node_id);
+			inner_group_node_ids.insert(node_id);
+		} else {
+			order_outer_group.push_back(node_id);
 		}
 	}
 
@@ -1230,6 +1244,155 @@ static uint32_t move_outer_group_operations_up(std::vector<uint32_t> &order, con
 	return inner_group_start_index;
 }
 
+// Finds chains of elementwise operations in which every intermediate result is only used by a later operation of the
+// same chain. They can then run fused together, one tile at a time (see `Runtime::run_fused_operation`).
+// Operations of a chain must follow each other in the program, so buffers they read are still valid when the chain
+// runs. Fused operations stay in the program as they are, because optimized execution maps can skip some of them. In
+// that case the remaining ones run separately, so intermediate results keep their buffer data.
+void Runtime::fuse_operations(Program &program, const NodeTypeDB &type_db) {
+	ZN_PROFILE_SCOPE();
+
+	struct OperationInfo {
+		uint16_t address;
+		Span<const uint16_t> inputs;
+		Span<const uint16_t> outputs;
+		bool is_elementwise;
+		bool is_inner_group;
+	};
+
+	const Span<const uint16_t> operations = to_span_const(program.operations);
+	const std::vector<ExecutionMap::OperationInfo> &default_op_infos = program.default_execution_map.operations;
+
+	std::vector<OperationInfo> op_infos;
+	op_infos.reserve(default_op_infos.size());
+	// Index of the operation writing each buffer, and index of the last operation reading it
+	std::vector<int> producers;
+	std::vector<int> consumers;
+	producers.resize(program.buffer_count, -1);
+	consumers.resize(program.buffer_count, -1);
+
+	for (const ExecutionMap::OperationInfo &default_op_info : default_op_infos) {
+		const uint16_t opid = operations[default_op_info.address];
+		const NodeType &type = type_db.get_type(opid);
+
+		OperationInfo op_info;
+		op_info.address = default_op_info.address;
+		op_info.inputs = operations.sub(op_info.address + 1, type.inputs.size());
+		op_info.outputs = operations.sub(op_info.address + 1 + type.inputs.size(), type.outputs.size());
+		op_info.is_elementwise =
+				type.is_elementwise && type.outputs.size() == 1 && type.inputs.size() <= Runtime::MAX_INPUTS;
+		op_info.is_inner_group = op_info.address >= program.inner_group_start_op_index;
+
+		const int op_index = op_infos.size();
+		for (unsigned int i = 0; i < op_info.inputs.size(); ++i) {
+			consumers[op_info.inputs[i]] = op_index;
+		}
+		for (unsigned int i = 0; i < op_info.outputs.size(); ++i) {
+			producers[op_info.outputs[i]] = op_index;
+		}
+
+		op_infos.push_back(op_info);
+	}
+
+	// Chains are found starting from their last operation, going backwards
+	int end_index = int(op_infos.size()) - 1;
+
+	while (end_index >= 0) {
+		const OperationInfo &end_op_info = op_infos[end_index];
+		if (!end_op_info.is_elementwise) {
+			--end_index;
+			continue;
+		}
+
+		int begin_index = end_index;
+
+		while (begin_index > 0 && end_index - begin_index + 1 < int(FusedOperation::MAX_STEPS)) {
+			const OperationInfo &op_info = op_infos[begin_index - 1];
+			if (!op_info.is_elementwise || op_info.is_inner_group != end_op_info.is_inner_group) {
+				break;
+			}
+			const uint16_t output_address = op_info.outputs[0];
+			const BufferSpec &bs = program.buffer_specs[output_address];
+			if (bs.users_count != 1 || bs.is_pinned) {
+				break;
+			}
+			// The result must be used within the chain
+			const int consumer_index = consumers[output_address];
+			if (consumer_index < begin_index || consumer_index > end_index) {
+				break;
+			}
+			--begin_index;
+		}
+
+		if (begin_index < end_index) {
+			FusedOperation fused_op;
+			fused_op.steps_count = end_index - begin_index + 1;
+
+			for (int op_index = begin_index; op_index <= end_index; ++op_index) {
+				const OperationInfo &op_info = op_infos[op_index];
+				FusedOperation::Step &step = fused_op.steps[op_index - begin_index];
+				step.op_address = op_info.address;
+
+				for (unsigned int i = 0; i < op_info.inputs.size(); ++i) {
+					const int producer_index = producers[op_info.inputs[i]];
+					if (producer_index >= begin_index && producer_index < op_index) {
+						step.input_steps[i] = producer_index - begin_index;
+					} else {
+						step.input_steps[i] = FusedOperation::NO_STEP;
+					}
+				}
+			}
+
+			const uint16_t fused_op_index = program.fused_operations.size();
+			program.fused_operations.push_back(fused_op);
+
+			program.default_execution_map.operations[begin_index].fused_operation_index = fused_op_index;
+
+			const uint16_t begin_address = op_infos[begin_index].address;
+			for (DependencyGraph::Node &dg_node : program.dependency_graph.nodes) {
+				if (!dg_node.is_input && dg_node.op_address == begin_address) {
+					dg_node.fused_operation_index = fused_op_index;
+					break;
+				}
+			}
+		}
+
+		end_index = begin_index - 1;
+	}
+}
+
+uint64_t Runtime::compute_program_hash(const Program &program) {
+	uint64_t hash = hash_djb2_one_64(program.inputs.size());
+
+	for (const uint16_t w : program.operations) {
+		hash = hash_djb2_one_64(w, hash);
+	}
+
+	for (const BufferSpec &buffer_spec : program.buffer_specs) {
+		if (buffer_spec.is_constant) {
+			uint32_t bits;
+			memcpy(&bits, &buffer_spec.constant_value, sizeof(bits));
+			hash = hash_djb2_one_64(buffer_spec.address, hash);
+			hash = hash_djb2_one_64(bits, hash);
+		}
+	}
+
+	// Results that can be saved and restored depend on compilation options
+	for (const uint16_t address : program.outer_group_result_addresses) {
+		hash = hash_djb2_one_64(address, hash);
+	}
+
+	if (program.heap_resources.size() > 0 || program.ref_resources.size() > 0) {
+		// Parameters of operations using resources contain pointers, which tell nothing about what resources contain.
+		// Once a program is cleared, a different resource could also end up at the same address. So such programs
+		// are considered unique.
+		static std::atomic_uint64_t s_next_compilation_id(0);
+		hash = hash_djb2_one_64(++s_next_compilation_id, hash);
+	}
+
+	return hash;
+}
+
 static void compute_node_execution_order(
 		std::vector<uint32_t> &order, const ProgramGraph &graph, bool debug, const NodeTypeDB &type_db) {
 	std::vector<uint32_t> terminal_nodes;
@@ -1340,6 +1503,7 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 		dg_node.op_address = 0;
 		dg_node.first_dependency = 0;
 		dg_node.end_dependency = 0;
+		dg_node.fused_operation_index = ExecutionMap::OperationInfo::NO_FUSED_OPERATION;
 		dg_node.debug_node_id = node_id;
 		node_id_to_dependency_graph.insert(std::make_pair(node_id, dg_node_index));
 	}
@@ -1364,6 +1528,7 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 		dg_node.op_address = operations.size();
 		dg_node.first_dependency = program.dependency_graph.dependencies.size();
 		dg_node.end_dependency = dg_node.first_dependency;
+		dg_node.fused_operation_index = ExecutionMap::OperationInfo::NO_FUSED_OPERATION;
 		dg_node.debug_node_id = node_id;
 		node_id_to_dependency_graph.insert(std::make_pair(node_id, dg_node_index));
 
@@ -1411,9 +1576,6 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 
 		ZN_ASSERT(node.type_id <= std::numeric_limits<uint16_t>::max());
 
-		if (order_index == inner_group_start_index) {
-			program.default_execution_map.inner_group_start_index = program.default_execution_map.operations.size();
-		}
 		program.default_execution_map.operations.push_back(
 				ExecutionMap::OperationInfo{ uint16_t(operations.size()), 0 });
 		if (debug) {
@@ -1567,6 +1729,19 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 
 	program.buffer_count = mem.next_address;
 
+	// The inner group can start with nodes that don't produce operations (like inputs), or be empty
+	if (inner_group_start_index >= order.size()) {
+		program.inner_group_start_op_index = operations.size();
+	}
+	{
+		const std::vector<ExecutionMap::OperationInfo> &op_infos = program.default_execution_map.operations;
+		unsigned int i = 0;
+		while (i < op_infos.size() && op_infos[i].address < program.inner_group_start_op_index) {
+			++i;
+		}
+		program.default_execution_map.inner_group_start_index = i;
+	}
+
 	// Pin buffers from the outer group that are read by operations of the inner group.
 	// Buffer data coming from the outer group must be pinned if it is read by the inner group,
 	// because it is re-used across multiple executions.
@@ -1606,6 +1781,26 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 		}
 	}
 
+	// Results of the outer group needed after it ran: buffers read by the inner group (they were just pinned), and
+	// outputs that don't depend on Y
+	for (const BufferSpec &buffer_spec : program.buffer_specs) {
+		if (buffer_spec.is_pinned && !buffer_spec.is_binding && !buffer_spec.is_constant) {
+			program.outer_group_result_addresses.push_back(buffer_spec.address);
+		}
+	}
+	for (unsigned int output_index = 0; output_index < program.outputs_count; ++output_index) {
+		const OutputInfo &output_info = program.outputs[output_index];
+		const DependencyGraph::Node &dg_node = program.dependency_graph.nodes[output_info.dependency_graph_node_index];
+		if (dg_node.op_address < program.inner_group_start_op_index) {
+			program.outer_group_result_addresses.push_back(output_info.buffer_address);
+		}
+	}
+
+	if (!debug) {
+		// In debug, every intermediate result must be available so it can be previewed
+		fuse_operations(program, type_db);
+	}
+
 	// Assign buffer datas
 	{
 		struct DataHelper {
@@ -1615,9 +1810,16 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 				bool pinned;
 			};
 			std::vector<Data> datas;
+			// How many datas are in use at the same time, which is how much memory a run of the program needs
+			unsigned int live_count = 0;
+			unsigned int peak_live_count = 0;
 
 			uint16_t allocate(uint16_t users, bool pinned) {
 				ZN_ASSERT(users > 0);
+				++live_count;
+				if (live_count > peak_live_count) {
+					peak_live_count = live_count;
+				}
 				// Note, pinned buffers must have unique data, so we may not re-use a previous buffer for them
 				if (free_indices.size() == 0 || pinned) {
 					const uint16_t i = datas.size();
@@ -1643,6 +1845,7 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 				--d.usages;
 				if (d.usages == 0) {
 					free_indices.push_back(i);
+					--live_count;
 				}
 			}
 		};
@@ -1660,60 +1863,9 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 			}
 
 		} else {
-			Span<BufferSpec> buffer_specs = to_span(program.buffer_specs);
-
-			// Allocate unique buffers (this is used notably for compile-time constants requiring a buffer)
-			for (BufferSpec &buffer_spec : program.buffer_specs) {
-				if (!buffer_spec.is_binding && buffer_spec.is_pinned) {
-					buffer_spec.data_index = data_helper.allocate(1, true);
-					buffer_spec.has_data = true;
-				}
-			}
-
-			// Allocate re-usable buffers.
-			// Run through every node in execution order, allocating buffers when they are needed using pooling logic,
-			// so we can precompute which buffers will actually be needed in total, ahead of running the generator.
-			// This results in less memory usage than giving every buffer unique data.
-			for (unsigned int order_index = 0; order_index < order.size(); ++order_index) {
-				const uint32_t node_id = order[order_index];
-				const ProgramGraph::Node &node = graph.get_node(node_id);
-				const NodeType &type = type_db.get_type(node.type_id);
-
-				uint16_t throwaway_data_index = 0;
-				bool has_throwaway_data = false;
-
-				// Allocate data to store outputs.
-				// Note, we don't allocate for inputs. The only way to allocate them is to pin them.
-				for (unsigned int output_index = 0; output_index < type.outputs.size(); ++output_index) {
-					const ProgramGraph::PortLocation dst_port{ node_id, output_index };
-					auto address_it = program.output_port_addresses.find(dst_port);
-					ZN_ASSERT(address_it != program.output_port_addresses.end());
-					BufferSpec &buffer_spec = buffer_specs[address_it->second];
-
-					if (buffer_spec.is_binding || buffer_spec.is_pinned) {
-						continue;
-					}
-					if (buffer_spec.users_count > 0) {
-						buffer_spec.data_index = data_helper.allocate(buffer_spec.users_count, false);
-					} else {
-						// The node will be run, but has an unused output. We'll have to allocate a throw-away buffer.
-						// We should be able to use the same buffer if more outputs are unused on the same node, but not
-						// the same as buffers that are used.
-						if (!has_throwaway_data) {
-							has_throwaway_data = true;
-							throwaway_data_index = data_helper.allocate(1, false);
-						}
-						buffer_spec.data_index = throwaway_data_index;
-					}
-					buffer_spec.has_data = true;
-				}
-
-				if (has_throwaway_data) {
-					// Make this buffer available again once this node has run
-					data_helper.unref(throwaway_data_index);
-				}
-
-				// Release references on input datas, so they can be re-used by later operations
+			// Releases references on input datas of a node, so they can be re-used by later operations
+			auto unref_input_datas = [&program](const ProgramGraph::Node &node, Span<const BufferSpec> buffer_specs,
+											 DataHelper &data_helper) {
 				for (const ProgramGraph::Port &input : node.inputs) {
 					if (input.connections.size() == 0) {
 						continue;
@@ -1731,14 +1883,113 @@ CompilationResult Runtime::compile_preprocessed_graph(Program &program, const Pr
 
 					data_helper.unref(buffer_spec.data_index);
 				}
+			};
+
+			// Allocate re-usable buffers.
+			// Run through every node in execution order, allocating buffers when they are needed using pooling logic,
+			// so we can precompute which buffers will actually be needed in total, ahead of running the generator.
+			// This results in less memory usage than giving every buffer unique data.
+			auto assign_datas = [&order, &graph, &type_db, &program, &unref_input_datas](
+										Span<BufferSpec> buffer_specs, DataHelper &data_helper, bool allow_in_place) {
+				// Allocate unique buffers (this is used notably for compile-time constants requiring a buffer)
+				for (BufferSpec &buffer_spec : buffer_specs) {
+					if (!buffer_spec.is_binding && buffer_spec.is_pinned) {
+						buffer_spec.data_index = data_helper.allocate(1, true);
+						buffer_spec.has_data = true;
+					}
+				}
+
+				for (unsigned int order_index = 0; order_index < order.size(); ++order_index) {
+					const uint32_t node_id = order[order_index];
+					const ProgramGraph::Node &node = graph.get_node(node_id);
+					const NodeType &type = type_db.get_type(node.type_id);
+
+					// Elementwise nodes with a single output can write it in the data of an input they are the last
+					// to read, because each value of that input is read before the value at the same index is
+					// written. So we release inputs before allocating the output, which then re-uses the last data
+					// released. Other nodes can't, because they may read input values after writing outputs at a
+					// different index, or write several outputs from the same input values. They still release
+					// their inputs right after running, so later nodes re-use them.
+					const bool in_place = allow_in_place && type.is_elementwise && type.outputs.size() == 1;
+
+					if (in_place) {
+						unref_input_datas(node, buffer_specs, data_helper);
+					}
+
+					uint16_t throwaway_data_index = 0;
+					bool has_throwaway_data = false;
+
+					// Allocate data to store outputs.
+					// Note, we don't allocate for inputs. The only way to allocate them is to pin them.
+					for (unsigned int output_index = 0; output_index < type.outputs.size(); ++output_index) {
+						const ProgramGraph::PortLocation dst_port{ node_id, output_index };
+						auto address_it = program.output_port_addresses.find(dst_port);
+						ZN_ASSERT(address_it != program.output_port_addresses.end());
+						BufferSpec &buffer_spec = buffer_specs[address_it->second];
+
+						if (buffer_spec.is_binding || buffer_spec.is_pinned) {
+							continue;
+						}
+						if (buffer_spec.users_count > 0) {
+							buffer_spec.data_index = data_helper.allocate(buffer_spec.users_count, false);
+						} else {
+							// The node will be run, but has an unused output. We'll have to allocate a throw-away
+							// buffer. We should be able to use the same buffer if more outputs are unused on the same
+							// node, but not the same as buffers that are used.
+							if (!has_throwaway_data) {
+								has_throwaway_data = true;
+								throwaway_data_index = data_helper.allocate(1, false);
+							}
+							buffer_spec.data_index = throwaway_data_index;
+						}
+						buffer_spec.has_data = true;
+					}
+
+					if (has_throwaway_data) {
+						// Make this buffer available again once this node has run
+						data_helper.unref(throwaway_data_index);
+					}
+
+					if (!in_place) {
+						// Release references on input datas, so they can be re-used by later operations
+						unref_input_datas(node, buffer_specs, data_helper);
+					}
+				}
+			};
+
+			// Only to measure how much in-place outputs save
+			{
+				std::vector<BufferSpec> buffer_specs_copy = program.buffer_specs;
+				DataHelper data_helper_without_in_place;
+				assign_datas(to_span(buffer_specs_copy), data_helper_without_in_place, false);
+				program.peak_buffer_data_count_without_in_place = data_helper_without_in_place.peak_live_count;
 			}
+
+			assign_datas(to_span(program.buffer_specs), data_helper, true);
 		}
 
 		program.buffer_data_count = data_helper.datas.size();
+		program.peak_buffer_data_count = data_helper.peak_live_count;
+		if (debug) {
+			program.peak_buffer_data_count_without_in_place = data_helper.peak_live_count;
+		}
+
+		program.unshared_buffer_data_count = 0;
+		for (const BufferSpec &buffer_spec : program.buffer_specs) {
+			if (!buffer_spec.is_binding && buffer_spec.has_data) {
+				++program.unshared_buffer_data_count;
+			}
+		}
 	}
 
-	ZN_PRINT_VERBOSE(format("Compiled voxel graph. Program size: {}b, ports: {}, buffers: {}",
-			program.operations.size() * sizeof(uint16_t), program.buffer_count, program.buffer_data_count));
+	program.hash = compute_program_hash(program);
+
+	ZN_PRINT_VERBOSE(format("Compiled voxel graph. Program size: {}b, ports: {}, buffers: {} (unshared: {}, peak "
+							"without in-place outputs: {}), outer group operations: {}/{}, fused chains: {}",
+			program.operations.size() * sizeof(uint16_t), program.buffer_count, program.buffer_data_count,
+			program.unshared_buffer_data_count, program.peak_buffer_data_count_without_in_place,
+			program.default_execution_map.inner_group_start_index, program.default_execution_map.operations.size(),
+			program.fused_operations.size()));
 
 	CompilationResult result;
 	result.success = true;
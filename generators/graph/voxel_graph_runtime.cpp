@@ -229,8 +229,8 @@ void Runtime::generate_optimized_execution_map(
 					inner_group_start_not_assigned = false;
 				}
 
-				execution_map.operations.push_back(
-						ExecutionMap::OperationInfo{ node.op_address, uint16_t(tls_constant_fills.size()) });
+				execution_map.operations.push_back(ExecutionMap::OperationInfo{
+						node.op_address, uint16_t(tls_constant_fills.size()), node.fused_operation_index });
 
 				// TODO Only do constant fills that actually get used
 				// The following approach isn't optimal. If 50% of a graph gets skipped and the remaining nodes don't
@@ -251,6 +251,11 @@ void Runtime::generate_optimized_execution_map(
 				break;
 		}
 	}
+
+	if (inner_group_start_not_assigned) {
+		// None of the remaining operations depend on Y
+		execution_map.inner_group_start_index = execution_map.operations.size();
+	}
 }
 
 void Runtime::generate_single(State &state, Span<float> inputs, const ExecutionMap *execution_map) const {
@@ -262,6 +267,23 @@ void Runtime::generate_single(State &state, Span<float> inputs, const ExecutionM
 	generate_set(state, to_span(input_bindings, inputs.size()), false, execution_map);
 }
 
+// Allocates buffer data so it starts at an aligned address, and its capacity is a whole number of vectors.
+// Previous contents are not kept.
+static void allocate_buffer_data(Runtime::BufferData &bd, unsigned int buffer_size) {
+	const unsigned int values_per_vector = Runtime::BUFFER_DATA_ALIGNMENT / sizeof(float);
+	const unsigned int capacity = ((buffer_size + values_per_vector - 1) / values_per_vector) * values_per_vector;
+	if (bd.allocation != nullptr) {
+		memfree(bd.allocation);
+	}
+	// Godot's allocator doesn't support alignment, so we allocate a bit more and align inside
+	bd.allocation = memalloc(capacity * sizeof(float) + Runtime::BUFFER_DATA_ALIGNMENT - 1);
+	const uintptr_t address = reinterpret_cast<uintptr_t>(bd.allocation);
+	const uintptr_t aligned_address =
+			(address + Runtime::BUFFER_DATA_ALIGNMENT - 1) & ~uintptr_t(Runtime::BUFFER_DATA_ALIGNMENT - 1);
+	bd.data = reinterpret_cast<float *>(aligned_address);
+	bd.capacity = capacity;
+}
+
 void Runtime::prepare_state(State &state, unsigned int buffer_size, bool with_profiling) const {
 	// Allocate memory
 
@@ -273,8 +295,7 @@ void Runtime::prepare_state(State &state, unsigned int buffer_size, bool with_pr
 			BufferData &bd = state.buffer_datas[i];
 			ZN_ASSERT(bd.data == nullptr);
 			// These are new items, we always allocate.
-			bd.data = reinterpret_cast<float *>(memalloc(buffer_size * sizeof(float)));
-			bd.capacity = buffer_size;
+			allocate_buffer_data(bd, buffer_size);
 		}
 	}
 
@@ -284,9 +305,8 @@ void Runtime::prepare_state(State &state, unsigned int buffer_size, bool with_pr
 			BufferData &bd = state.buffer_datas[i];
 			ZN_ASSERT(bd.data != nullptr);
 			if (bd.capacity < buffer_size) {
-				// These are existing items, we always realloc.
-				bd.data = reinterpret_cast<float *>(memrealloc(bd.data, buffer_size * sizeof(float)));
-				bd.capacity = buffer_size;
+				// These are existing items, we always reallocate. Their contents will be overwritten.
+				allocate_buffer_data(bd, buffer_size);
 			}
 		}
 		// TODO Not sure if worth keeping capacity at state level. Buffer datas can have varying capacities depending on
@@ -395,6 +415,69 @@ static inline Span<const uint8_t> read_params(Span<const uint16_t> operations, u
 
 void Runtime::generate_set(
 		State &state, Span<Span<float>> p_inputs, bool skip_outer_group, const ExecutionMap *p_execution_map) const {
+	const ExecutionMap &execution_map = p_execution_map != nullptr ? *p_execution_map : _program.default_execution_map;
+	Span<const ExecutionMap::OperationInfo> operation_infos = to_span(execution_map.operations);
+	const Span<const ExecutionMap::ConstantFill> constant_fills = to_span(execution_map.constant_fills);
+
+	unsigned int constant_fill_index = 0;
+
+	if (skip_outer_group && operation_infos.size() > 0) {
+		const unsigned int offset = execution_map.inner_group_start_index;
+		// Constant fills of skipped operations were done in a previous run. Buffers they fill are either pinned
+		// because the inner group reads them, or not used anymore.
+		for (unsigned int i = 0; i < offset; ++i) {
+			constant_fill_index += operation_infos[i].constant_fill_count;
+		}
+		// The inner group can be empty
+		operation_infos = operation_infos.sub(offset, operation_infos.size() - offset);
+	}
+
+	run_operations(
+			state, p_inputs, operation_infos, constant_fills, constant_fill_index, p_execution_map != nullptr);
+}
+
+void Runtime::generate_outer_group(State &state, Span<Span<float>> p_inputs) const {
+	const ExecutionMap &execution_map = _program.default_execution_map;
+	const Span<const ExecutionMap::OperationInfo> operation_infos =
+			to_span(execution_map.operations).sub(0, execution_map.inner_group_start_index);
+	// The default execution map has no constant fills
+	run_operations(state, p_inputs, operation_infos, Span<const ExecutionMap::ConstantFill>(), 0, false);
+}
+
+void Runtime::get_outer_group_results(const State &state, Span<float> dst) const {
+	ZN_PROFILE_SCOPE();
+	const unsigned int buffer_size = state.buffer_size;
+	ZN_ASSERT_RETURN(dst.size() == _program.outer_group_result_addresses.size() * buffer_size);
+
+	for (unsigned int i = 0; i < _program.outer_group_result_addresses.size(); ++i) {
+		const Buffer &buffer = state.get_buffer(_program.outer_group_result_addresses[i]);
+		ZN_ASSERT(buffer.data != nullptr);
+		memcpy(dst.data() + i * buffer_size, buffer.data, buffer_size * sizeof(float));
+	}
+}
+
+void Runtime::set_outer_group_results(State &state, Span<const float> src) const {
+	ZN_PROFILE_SCOPE();
+	const unsigned int buffer_size = state.buffer_size;
+	ZN_ASSERT_RETURN(src.size() == _program.outer_group_result_addresses.size() * buffer_size);
+
+	for (unsigned int i = 0; i < _program.outer_group_result_addresses.size(); ++i) {
+		const uint16_t address = _program.outer_group_result_addresses[i];
+		ZN_ASSERT(address < state.buffers.size());
+		Buffer &buffer = state.buffers[address];
+		ZN_ASSERT(buffer.data != nullptr);
+		memcpy(buffer.data, src.data() + i * buffer_size, buffer_size * sizeof(float));
+	}
+}
+
+uint64_t Runtime::get_program_hash() const {
+	return _program.hash;
+}
+
+void Runtime::run_operations(State &state, Span<Span<float>> p_inputs,
+		Span<const ExecutionMap::OperationInfo> operation_infos,
+		Span<const ExecutionMap::ConstantFill> constant_fills, unsigned int constant_fill_index,
+		bool using_execution_map) const {
 	// I don't like putting private helper functions in headers.
 	struct L {
 		static inline void bind_buffer(Span<Buffer> buffers, int a, Span<float> d) {
@@ -452,22 +535,11 @@ void Runtime::generate_set(
 
 	const Span<const uint16_t> operations(_program.operations.data(), 0, _program.operations.size());
 
-	const ExecutionMap &execution_map = p_execution_map != nullptr ? *p_execution_map : _program.default_execution_map;
-	Span<const ExecutionMap::OperationInfo> operation_infos = to_span(execution_map.operations);
-	const Span<const ExecutionMap::ConstantFill> constant_fills = to_span(execution_map.constant_fills);
-
-	if (skip_outer_group && operation_infos.size() > 0) {
-		const unsigned int offset = execution_map.inner_group_start_index;
-		operation_infos = operation_infos.sub(offset);
-	}
-
 #ifdef TOOLS_ENABLED
 	ProfilingClock profiling_clock;
 	const bool profile = state.debug_profiler_times.size() > 0;
 #endif
 
-	unsigned int constant_fill_index = 0;
-
 	for (unsigned int execution_map_index = 0; execution_map_index < operation_infos.size(); ++execution_map_index) {
 		const ExecutionMap::OperationInfo op_info = operation_infos[execution_map_index];
 
@@ -480,6 +552,40 @@ void Runtime::generate_set(
 			++constant_fill_index;
 		}
 
+		if (op_info.fused_operation_index != ExecutionMap::OperationInfo::NO_FUSED_OPERATION) {
+			const FusedOperation &fused_op = _program.fused_operations[op_info.fused_operation_index];
+			const unsigned int end_index = execution_map_index + fused_op.steps_count;
+
+			// The chain can only run fused if the execution map didn't skip any of its operations. They follow each
+			// other in the program, so it is enough to check the last one.
+			if (end_index <= operation_infos.size() &&
+					operation_infos[end_index - 1].address == fused_op.steps[fused_op.steps_count - 1].op_address) {
+				// Fills attached to the next operations of the chain must run before the whole chain
+				for (unsigned int op_index = execution_map_index + 1; op_index < end_index; ++op_index) {
+					for (unsigned int i = 0; i < operation_infos[op_index].constant_fill_count; ++i) {
+						const ExecutionMap::ConstantFill &cf = constant_fills[constant_fill_index];
+						ZN_ASSERT(cf.data != nullptr);
+						for (unsigned int j = 0; j < state.buffer_size; ++j) {
+							cf.data[j] = cf.value;
+						}
+						++constant_fill_index;
+					}
+				}
+
+				run_fused_operation(fused_op, buffers, state.buffer_size, using_execution_map);
+
+#ifdef TOOLS_ENABLED
+				if (profile) {
+					const uint32_t elapsed_microseconds = profiling_clock.get_elapsed_microseconds();
+					state.add_execution_time(execution_map_index, elapsed_microseconds);
+					profiling_clock.restart();
+				}
+#endif
+				execution_map_index = end_index - 1;
+				continue;
+			}
+		}
+
 		unsigned int pc = op_info.address;
 
 		const uint16_t opid = operations[pc++];
@@ -497,7 +603,7 @@ void Runtime::generate_set(
 
 		// TODO Buffers will stay bound if this error occurs!
 		ZN_ASSERT_RETURN(node_type.process_buffer_func != nullptr);
-		ProcessBufferContext ctx(op_inputs, op_outputs, op_params, buffers, p_execution_map != nullptr);
+		ProcessBufferContext ctx(op_inputs, op_outputs, op_params, buffers, using_execution_map);
 		node_type.process_buffer_func(ctx);
 
 #ifdef TOOLS_ENABLED
@@ -515,6 +621,85 @@ void Runtime::generate_set(
 	}
 }
 
+// Runs operations of the chain one after the other on a small part of the buffers, then moves on to the next part.
+// Each operation runs its usual processing function, seeing buffers as if they only contained that part. Intermediate
+// results are written to tiles that remain in CPU cache, instead of buffers holding the whole query.
+void Runtime::run_fused_operation(const FusedOperation &fused_op, Span<Buffer> buffers, unsigned int buffer_size,
+		bool using_execution_map) const {
+	ZN_PROFILE_SCOPE();
+
+	struct StepInfo {
+		const NodeType *type;
+		Span<const uint16_t> inputs;
+		uint16_t output;
+		Span<const uint8_t> params;
+	};
+
+	const Span<const uint16_t> operations(_program.operations.data(), 0, _program.operations.size());
+
+	FixedArray<StepInfo, FusedOperation::MAX_STEPS> step_infos;
+
+	for (unsigned int step_index = 0; step_index < fused_op.steps_count; ++step_index) {
+		unsigned int pc = fused_op.steps[step_index].op_address;
+
+		const uint16_t opid = operations[pc++];
+		const NodeType &node_type = NodeTypeDB::get_singleton().get_type(opid);
+
+		StepInfo &info = step_infos[step_index];
+		info.type = &node_type;
+		info.inputs = operations.sub(pc, node_type.inputs.size());
+		pc += node_type.inputs.size();
+		info.output = operations[pc];
+		pc += node_type.outputs.size();
+		info.params = read_params(operations, pc);
+	}
+
+	// Each operation sees its inputs as buffers at addresses 0 to N-1, and its output at address N
+	static const uint16_t s_local_addresses[MAX_INPUTS + 1] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	FixedArray<Buffer, MAX_INPUTS + 1> local_buffers;
+
+	alignas(BUFFER_DATA_ALIGNMENT) float tiles[FusedOperation::MAX_STEPS][FusedOperation::TILE_SIZE];
+
+	const unsigned int last_step_index = fused_op.steps_count - 1;
+
+	for (unsigned int tile_begin = 0; tile_begin < buffer_size; tile_begin += FusedOperation::TILE_SIZE) {
+		const unsigned int tile_size = math::min(FusedOperation::TILE_SIZE, buffer_size - tile_begin);
+
+		for (unsigned int step_index = 0; step_index < fused_op.steps_count; ++step_index) {
+			const FusedOperation::Step &step = fused_op.steps[step_index];
+			const StepInfo &info = step_infos[step_index];
+			const unsigned int inputs_count = info.inputs.size();
+
+			for (unsigned int i = 0; i < inputs_count; ++i) {
+				Buffer &local_buffer = local_buffers[i];
+				// Copy everything else, such as whether it is constant or ignored
+				local_buffer = buffers[info.inputs[i]];
+				local_buffer.size = tile_size;
+				const uint8_t src_step_index = step.input_steps[i];
+				if (src_step_index != FusedOperation::NO_STEP) {
+					local_buffer.data = tiles[src_step_index];
+				} else if (local_buffer.data != nullptr) {
+					local_buffer.data += tile_begin;
+				}
+			}
+
+			Buffer &local_output = local_buffers[inputs_count];
+			local_output = buffers[info.output];
+			local_output.size = tile_size;
+			if (step_index == last_step_index) {
+				local_output.data += tile_begin;
+			} else {
+				local_output.data = tiles[step_index];
+			}
+
+			ProcessBufferContext ctx(Span<const uint16_t>(s_local_addresses, inputs_count),
+					Span<const uint16_t>(s_local_addresses + inputs_count, 1), info.params, to_span(local_buffers),
+					using_execution_map);
+			info.type->process_buffer_func(ctx);
+		}
+	}
+}
+
 void Runtime::analyze_range(State &state, Span<math::Interval> p_inputs) const {
 	ZN_PROFILE_SCOPE();
 
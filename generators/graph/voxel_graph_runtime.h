@@ -42,9 +42,15 @@ public:
 	static const unsigned int MAX_INPUTS = 8;
 	static const unsigned int MAX_OUTPUTS = 24;
 
+	// Buffer datas are aligned and their capacity is rounded up to this amount of bytes, which is the size of the
+	// largest vectors used by node kernels.
+	static const unsigned int BUFFER_DATA_ALIGNMENT = 32;
+
 	struct BufferData {
-		// Owns the data.
+		// Points inside `allocation`, at an aligned position.
 		float *data = nullptr;
+		// Owns the data.
+		void *allocation = nullptr;
 		unsigned int capacity = 0;
 	};
 
@@ -77,9 +83,14 @@ public:
 	// If local optimization is used, it may be recomputed before each query.
 	struct ExecutionMap {
 		struct OperationInfo {
+			static const uint16_t NO_FUSED_OPERATION = 0xffff;
+
 			uint16_t address = 0;
 			// How many constant fills to execute before this operation.
 			uint16_t constant_fill_count = 0;
+			// If this operation starts a chain of operations that can run fused together, index of that chain in the
+			// program.
+			uint16_t fused_operation_index = NO_FUSED_OPERATION;
 		};
 
 		std::vector<OperationInfo> operations;
@@ -90,8 +101,8 @@ public:
 		// It can also include some nodes not explicitely present in the user graph (like auto-inputs).
 		std::vector<uint32_t> debug_nodes;
 
-		// Every operation before this index in the `operations` list will only depend on inputs tagged as "outer
-		// group". This is the index from which operations won't only depend on the outer group.
+		// Every operation before this index in the `operations` list doesn't depend on Y (the "outer group"). This is
+		// the index from which operations depend on Y, or on inputs that may vary with it.
 		unsigned int inner_group_start_index = 0;
 
 		struct ConstantFill {
@@ -137,8 +148,8 @@ public:
 			buffer_size = 0;
 			// buffer_capacity = 0;
 			for (BufferData &bd : buffer_datas) {
-				ZN_ASSERT(bd.data != nullptr);
-				memfree(bd.data);
+				ZN_ASSERT(bd.allocation != nullptr);
+				memfree(bd.allocation);
 			}
 			buffer_datas.clear();
 			buffers.clear();
@@ -203,9 +214,31 @@ public:
 	// TODO Evaluate needs for double-precision in pg::Runtime
 	void generate_single(State &state, Span<float> inputs, const ExecutionMap *execution_map) const;
 
+	// Runs the program on every set of inputs.
+	// If `skip_outer_group` is true, operations not depending on Y are not run, and their results from the previous
+	// call are used instead. This can only be done if X and Z inputs are the same as in that call, with the same
+	// execution map.
 	void generate_set(
 			State &state, Span<Span<float>> p_inputs, bool skip_outer_group, const ExecutionMap *p_execution_map) const;
 
+	// Runs only operations that don't depend on Y, all of them, regardless of execution maps. Inputs depending on Y
+	// don't need to contain meaningful values. Results can then be used with `generate_set` and `skip_outer_group`,
+	// with any execution map made for the same X and Z inputs.
+	void generate_outer_group(State &state, Span<Span<float>> p_inputs) const;
+
+	// Gets how many buffers hold results of operations not depending on Y that are needed after they run, either by
+	// other operations or as outputs.
+	inline unsigned int get_outer_group_result_count() const {
+		return _program.outer_group_result_addresses.size();
+	}
+
+	// Copies results of operations not depending on Y into `dst`, one buffer after the other. `dst` must have a size of
+	// `get_outer_group_result_count()` times the buffer size the state was prepared with. Results can be restored into
+	// another state prepared with the same buffer size using `set_outer_group_results`, which allows to skip the outer
+	// group when generating the same columns again.
+	void get_outer_group_results(const State &state, Span<float> dst) const;
+	void set_outer_group_results(State &state, Span<const float> src) const;
+
 #ifdef DEBUG_ENABLED
 	void debug_print_operations();
 #endif
@@ -224,6 +257,35 @@ public:
 		return _program.outputs[i];
 	}
 
+	// Gets how many operations don't depend on Y, and so can be skipped when only Y changes between two runs. For
+	// testing and debugging.
+	inline unsigned int get_outer_group_operation_count() const {
+		return _program.default_execution_map.inner_group_start_index;
+	}
+
+	// Gets how many chains of operations were fused together during compilation. For testing and debugging.
+	inline unsigned int get_fused_operation_count() const {
+		return _program.fused_operations.size();
+	}
+
+	struct BufferDataStats {
+		// How many buffer datas would be allocated if every buffer had its own
+		unsigned int unshared_count;
+		// How many buffer datas are allocated, given that buffers not used at the same time can share them. Each
+		// `State` holds that many, of the size of the sets being generated.
+		unsigned int count;
+		// Maximum amount of buffer datas in use at the same time during a run
+		unsigned int peak_live_count;
+		// Same, if nodes never wrote their output in the data of their last-read input
+		unsigned int peak_live_count_without_in_place;
+	};
+
+	// Gets how much buffer datas are saved by sharing them between buffers. For testing and debugging.
+	inline BufferDataStats get_buffer_data_stats() const {
+		return BufferDataStats{ _program.unshared_buffer_data_count, _program.buffer_data_count,
+			_program.peak_buffer_data_count, _program.peak_buffer_data_count_without_in_place };
+	}
+
 	// Analyzes a specific region of inputs to find out what ranges of outputs we can expect.
 	// It can be used to speed up calls to `generate_set` thanks to execution mapping,
 	// so that operations can be optimized out if they don't contribute to the result.
@@ -243,6 +305,8 @@ public:
 	// Gets the buffer address of a specific output port
 	bool try_get_output_port_address(ProgramGraph::PortLocation port, uint16_t &out_address) const;
 
+	// Gets a hash identifying what the program computes. Two programs with the same hash give the same results.
+	// Programs using resources (like noise or images) get a different hash every time they are compiled.
 	uint64_t get_program_hash() const;
 
 	struct HeapResource {
@@ -359,6 +423,19 @@ private:
 
 	bool is_operation_constant(const State &state, uint16_t op_address) const;
 
+	struct FusedOperation;
+
+	static void fuse_operations(Program &program, const NodeTypeDB &type_db);
+	static uint64_t compute_program_hash(const Program &program);
+
+	void run_operations(State &state, Span<Span<float>> p_inputs,
+			Span<const ExecutionMap::OperationInfo> operation_infos,
+			Span<const ExecutionMap::ConstantFill> constant_fills, unsigned int constant_fill_index,
+			bool using_execution_map) const;
+
+	void run_fused_operation(const FusedOperation &fused_op, Span<Buffer> buffers, unsigned int buffer_size,
+			bool using_execution_map) const;
+
 	struct BufferSpec {
 		// Index the buffer should be stored at
 		uint16_t address = 0;
@@ -389,6 +466,8 @@ private:
 			uint16_t end_dependency;
 			uint16_t op_address;
 			bool is_input;
+			// Same as `ExecutionMap::OperationInfo::fused_operation_index`
+			uint16_t fused_operation_index;
 			// Node ID from the expanded ProgramGraph (non user-provided, so may need remap)
 			uint32_t debug_node_id;
 		};
@@ -404,6 +483,26 @@ private:
 		}
 	};
 
+	// Chain of elementwise operations running in a single pass over buffers. Intermediate results are kept in small
+	// tiles instead of being written to buffers holding the whole query, which saves memory bandwidth.
+	// Each operation of the chain except the last has a single output, only used by a later operation of the chain.
+	struct FusedOperation {
+		static const unsigned int MAX_STEPS = 16;
+		// Amount of values processed by each operation of the chain before moving on to the next operation.
+		static const unsigned int TILE_SIZE = 128;
+		static const uint8_t NO_STEP = 0xff;
+
+		struct Step {
+			// Address of the operation in `Program::operations`
+			uint16_t op_address;
+			// For each input, index of the step computing it, or `NO_STEP` if it is read from a buffer
+			FixedArray<uint8_t, MAX_INPUTS> input_steps;
+		};
+
+		FixedArray<Step, MAX_STEPS> steps;
+		uint8_t steps_count = 0;
+	};
+
 	// Compiled program data.
 	// Remains constant and read-only after compilation.
 	struct Program {
@@ -432,6 +531,10 @@ private:
 		// When we don't, we use the default one so the code doesn't have to change.
 		ExecutionMap default_execution_map;
 
+		// Chains of operations that can run fused together. Operations they contain are still present in
+		// `operations`, and run separately when an execution map skips some of them.
+		std::vector<FusedOperation> fused_operations;
+
 		// Heap-allocated parameters data, when too large to fit in `operations`.
 		// We keep a reference to them so they can be freed when the program is cleared.
 		std::vector<HeapResource> heap_resources;
@@ -448,6 +551,13 @@ private:
 		// cases.
 		uint32_t inner_group_start_op_index;
 
+		// Buffers written by the outer group and still needed after it ran, so its results can be saved and
+		// restored. Bindings and compile-time constants are not included.
+		std::vector<uint16_t> outer_group_result_addresses;
+
+		// See `get_program_hash`
+		uint64_t hash = 0;
+
 		std::vector<InputInfo> inputs;
 
 		FixedArray<OutputInfo, MAX_OUTPUTS> outputs;
@@ -458,6 +568,12 @@ private:
 		unsigned int buffer_count = 0;
 		// Maximum amount of buffer datas this program will need to do a full run.
 		unsigned int buffer_data_count = 0;
+		// Amount of buffer datas this program would need if buffers never shared them.
+		unsigned int unshared_buffer_data_count = 0;
+		// Maximum amount of buffer datas in use at the same time during a run, with and without elementwise nodes
+		// writing their output over their last-read input.
+		unsigned int peak_buffer_data_count = 0;
+		unsigned int peak_buffer_data_count_without_in_place = 0;
 
 		// Associates a port from the expanded graph to its corresponding address within the compiled program.
 		// This is used for debugging intermediate values.
@@ -477,7 +593,10 @@ private:
 			operations.clear();
 			buffer_specs.clear();
 			inner_group_start_op_index = 0;
+			outer_group_result_addresses.clear();
+			hash = 0;
 			default_execution_map.clear();
+			fused_operations.clear();
 			output_port_addresses.clear();
 			user_port_to_expanded_port.clear();
 			expanded_node_id_to_user_node_id.clear();
@@ -495,6 +614,9 @@ private:
 			ref_resources.clear();
 			buffer_count = 0;
 			buffer_data_count = 0;
+			unshared_buffer_data_count = 0;
+			peak_buffer_data_count = 0;
+			peak_buffer_data_count_without_in_place = 0;
 		}
 	};
 
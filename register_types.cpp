@@ -11,6 +11,7 @@
 #include "edition/voxel_tool_terrain.h"
 #include "engine/voxel_engine_gd.h"
 #include "generators/graph/node_type_db.h"
+#include "generators/graph/voxel_graph_column_cache.h"
 #include "generators/graph/voxel_generator_graph.h"
 #include "generators/simple/voxel_generator_flat.h"
 #include "generators/simple/voxel_generator_heightmap.h"
@@ -170,6 +171,8 @@ void initialize_voxel_module(ModuleInitializationLevel p_level) {
 		VoxelMemoryPool::create_singleton();
 		VoxelStringNames::create_singleton();
 		pg::NodeTypeDB::create_singleton();
+		pg::ColumnCache::create_singleton();
+		gd::VoxelEngine::apply_memory_config_from_godot();
 
 		unsigned int main_thread_budget_usec;
 		const VoxelEngine::ThreadsConfig threads_config =
@@ -393,6 +396,8 @@ void uninitialize_voxel_module(ModuleInitializationLevel p_level) {
 		pg::NodeTypeDB::destroy_singleton();
 		gd::VoxelEngine::destroy_singleton();
 		VoxelEngine::destroy_singleton();
+		// After the engine, since generation tasks use it
+		pg::ColumnCache::destroy_singleton();
 
 		// Do this last as VoxelEngine might still be holding some refs to voxel blocks
 		VoxelMemoryPool::destroy_singleton();
@@ -80,6 +80,18 @@ void VoxelBuffer::compress_uniform_channels() {
 	_buffer->compress_uniform_channels();
 }
 
+void VoxelBuffer::compress_palette_channels() {
+	_buffer->compress_palette_channels();
+}
+
+void VoxelBuffer::compress_brick_channels() {
+	_buffer->compress_brick_channels();
+}
+
+void VoxelBuffer::quantize_sdf_channel() {
+	_buffer->quantize_sdf_channel();
+}
+
 VoxelBuffer::Compression VoxelBuffer::get_channel_compression(unsigned int channel_index) const {
 	ERR_FAIL_INDEX_V(channel_index, MAX_CHANNELS, VoxelBuffer::COMPRESSION_NONE);
 	return VoxelBuffer::Compression(_buffer->get_channel_compression(channel_index));
@@ -119,6 +131,14 @@ void VoxelBuffer::remap_values(unsigned int channel_index, PackedInt32Array map)
 	Span<const int> map_r(map.ptr(), map.size());
 	const VoxelBufferInternal::Depth depth = _buffer->get_channel_depth(channel_index);
 
+	const VoxelBufferInternal::Compression compression = _buffer->get_channel_compression(channel_index);
+	if (compression == VoxelBufferInternal::COMPRESSION_PALETTE ||
+			compression == VoxelBufferInternal::COMPRESSION_BRICKS ||
+			compression == VoxelBufferInternal::COMPRESSION_QUANTIZED) {
+		// Remapping could produce duplicate palette entries or uniform bricks, simpler to work on raw values
+		_buffer->decompress_channel(channel_index);
+	}
+
 	// TODO If `get_channel_data` could return a span of size 1 for this case, we wouldn't need this code
 	if (_buffer->get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_UNIFORM) {
 		uint64_t v = _buffer->get_voxel(Vector3i(), channel_index);
@@ -376,6 +396,9 @@ void VoxelBuffer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_uniform", "channel"), &VoxelBuffer::is_uniform);
 	ClassDB::bind_method(D_METHOD("optimize"), &VoxelBuffer::_b_deprecated_optimize);
 	ClassDB::bind_method(D_METHOD("compress_uniform_channels"), &VoxelBuffer::compress_uniform_channels);
+	ClassDB::bind_method(D_METHOD("compress_palette_channels"), &VoxelBuffer::compress_palette_channels);
+	ClassDB::bind_method(D_METHOD("compress_brick_channels"), &VoxelBuffer::compress_brick_channels);
+	ClassDB::bind_method(D_METHOD("quantize_sdf_channel"), &VoxelBuffer::quantize_sdf_channel);
 	ClassDB::bind_method(D_METHOD("get_channel_compression", "channel"), &VoxelBuffer::get_channel_compression);
 	ClassDB::bind_method(D_METHOD("remap_values", "channel"), &VoxelBuffer::remap_values);
 
@@ -412,6 +435,9 @@ void VoxelBuffer::_bind_methods() {
 
 	BIND_ENUM_CONSTANT(COMPRESSION_NONE);
 	BIND_ENUM_CONSTANT(COMPRESSION_UNIFORM);
+	BIND_ENUM_CONSTANT(COMPRESSION_PALETTE);
+	BIND_ENUM_CONSTANT(COMPRESSION_BRICKS);
+	BIND_ENUM_CONSTANT(COMPRESSION_QUANTIZED);
 	BIND_ENUM_CONSTANT(COMPRESSION_COUNT);
 
 	BIND_CONSTANT(MAX_SIZE);
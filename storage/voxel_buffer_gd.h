@@ -39,6 +39,9 @@ public:
 	enum Compression {
 		COMPRESSION_NONE = VoxelBufferInternal::COMPRESSION_NONE,
 		COMPRESSION_UNIFORM = VoxelBufferInternal::COMPRESSION_UNIFORM,
+		COMPRESSION_PALETTE = VoxelBufferInternal::COMPRESSION_PALETTE,
+		COMPRESSION_BRICKS = VoxelBufferInternal::COMPRESSION_BRICKS,
+		COMPRESSION_QUANTIZED = VoxelBufferInternal::COMPRESSION_QUANTIZED,
 		// COMPRESSION_RLE,
 		COMPRESSION_COUNT = VoxelBufferInternal::COMPRESSION_COUNT
 	};
@@ -122,6 +125,9 @@ public:
 	bool is_uniform(unsigned int channel_index) const;
 
 	void compress_uniform_channels();
+	void compress_palette_channels();
+	void compress_brick_channels();
+	void quantize_sdf_channel();
 	Compression get_channel_compression(unsigned int channel_index) const;
 
 	void downscale_to(Ref<VoxelBuffer> dst, Vector3i src_min, Vector3i src_max, Vector3i dst_min) const;
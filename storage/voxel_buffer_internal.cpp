@@ -9,7 +9,9 @@
 #include "../util/profiling.h"
 #include "../util/string_funcs.h"
 #include "voxel_buffer_internal.h"
+#include <cstdlib>
 #include <cstring>
+#include <vector>
 
 namespace zylann::voxel {
 
@@ -30,6 +32,334 @@ inline void free_channel_data(uint8_t *data, uint32_t size) {
 #endif
 }
 
+// Palette compression helpers
+
+namespace {
+
+inline size_t get_palette_size_in_bytes(unsigned int palette_bits) {
+	return (size_t(1) << palette_bits) * sizeof(uint64_t);
+}
+
+inline size_t get_palette_indices_size_in_bytes(size_t volume, unsigned int palette_bits) {
+	return (volume * palette_bits + 7) >> 3;
+}
+
+// Indices don't straddle bytes, so only powers of two are used
+inline unsigned int get_palette_bits_for_size(unsigned int palette_size) {
+	if (palette_size <= 2) {
+		return 1;
+	}
+	if (palette_size <= 4) {
+		return 2;
+	}
+	if (palette_size <= 16) {
+		return 4;
+	}
+	return 8;
+}
+
+inline uint64_t *allocate_palette(unsigned int palette_bits) {
+	return reinterpret_cast<uint64_t *>(allocate_channel_data(get_palette_size_in_bytes(palette_bits)));
+}
+
+inline void free_palette(uint64_t *palette, unsigned int palette_bits) {
+	free_channel_data(reinterpret_cast<uint8_t *>(palette), get_palette_size_in_bytes(palette_bits));
+}
+
+inline unsigned int get_palette_index(const uint8_t *indices, unsigned int palette_bits, size_t i) {
+	const size_t bit_index = i * palette_bits;
+	return (indices[bit_index >> 3] >> (bit_index & 7)) & ((1u << palette_bits) - 1);
+}
+
+inline void set_palette_index(uint8_t *indices, unsigned int palette_bits, size_t i, unsigned int palette_index) {
+	const size_t bit_index = i * palette_bits;
+	const unsigned int shift = bit_index & 7;
+	const unsigned int mask = ((1u << palette_bits) - 1) << shift;
+	uint8_t &b = indices[bit_index >> 3];
+	b = (b & ~mask) | (palette_index << shift);
+}
+
+template <typename T>
+inline void decode_palette_t(const VoxelBufferInternal::Channel &channel, size_t src_index, T *dst, size_t count) {
+	const uint8_t *indices = channel.data;
+	const uint64_t *palette = channel.palette;
+	const unsigned int palette_bits = channel.palette_bits;
+	for (size_t i = 0; i < count; ++i) {
+		dst[i] = palette[get_palette_index(indices, palette_bits, src_index + i)];
+	}
+}
+
+// Writes `count` consecutive voxels of a palette-compressed channel as raw values into `dst`
+void decode_palette(const VoxelBufferInternal::Channel &channel, size_t src_index, uint8_t *dst, size_t count) {
+	switch (channel.depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			decode_palette_t(channel, src_index, dst, count);
+			break;
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			decode_palette_t(channel, src_index, reinterpret_cast<uint16_t *>(dst), count);
+			break;
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			decode_palette_t(channel, src_index, reinterpret_cast<uint32_t *>(dst), count);
+			break;
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			decode_palette_t(channel, src_index, reinterpret_cast<uint64_t *>(dst), count);
+			break;
+		default:
+			ZN_CRASH();
+	}
+}
+
+// Maps values to their index in a palette being built
+struct PaletteIndexMap {
+	// Power of two, large enough to never be full, and to keep collisions low
+	static const unsigned int CAPACITY = 2 * VoxelBufferInternal::MAX_PALETTE_SIZE;
+
+	FixedArray<uint64_t, CAPACITY> keys;
+	FixedArray<int16_t, CAPACITY> indices;
+
+	PaletteIndexMap() {
+		fill(indices, int16_t(-1));
+	}
+
+	// Returns the slot where the key is, or where it should be inserted
+	inline unsigned int find_slot(uint64_t key) const {
+		// Fibonacci hashing
+		unsigned int i = static_cast<unsigned int>((key * 0x9E3779B97F4A7C15ull) >> 55) & (CAPACITY - 1);
+		while (indices[i] != -1 && keys[i] != key) {
+			i = (i + 1) & (CAPACITY - 1);
+		}
+		return i;
+	}
+};
+
+// Finds distinct values of a raw channel, and writes the palette index of each voxel in `out_indices`.
+// Returns false if there are too many distinct values.
+template <typename T>
+bool build_palette(const T *src, size_t volume, FixedArray<uint64_t, VoxelBufferInternal::MAX_PALETTE_SIZE> &palette,
+		unsigned int &palette_size, uint8_t *out_indices) {
+	PaletteIndexMap map;
+	// Consecutive voxels often have the same value
+	uint64_t prev_value = src[0];
+	unsigned int prev_index = 0;
+	const unsigned int first_slot = map.find_slot(prev_value);
+	map.keys[first_slot] = prev_value;
+	map.indices[first_slot] = 0;
+	palette[0] = prev_value;
+	palette_size = 1;
+
+	for (size_t i = 0; i < volume; ++i) {
+		const uint64_t v = src[i];
+		if (v != prev_value) {
+			const unsigned int slot = map.find_slot(v);
+			if (map.indices[slot] == -1) {
+				if (palette_size == VoxelBufferInternal::MAX_PALETTE_SIZE) {
+					return false;
+				}
+				map.keys[slot] = v;
+				map.indices[slot] = palette_size;
+				palette[palette_size] = v;
+				++palette_size;
+			}
+			prev_value = v;
+			prev_index = map.indices[slot];
+		}
+		out_indices[i] = prev_index;
+	}
+	return true;
+}
+
+std::vector<uint8_t> &get_tls_palette_indices() {
+	static thread_local std::vector<uint8_t> tls_palette_indices;
+	return tls_palette_indices;
+}
+
+// Brick compression helpers
+
+inline uint64_t get_raw_voxel(const uint8_t *data, size_t i, VoxelBufferInternal::Depth depth) {
+	switch (depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			return data[i];
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			return reinterpret_cast<const uint16_t *>(data)[i];
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			return reinterpret_cast<const uint32_t *>(data)[i];
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			return reinterpret_cast<const uint64_t *>(data)[i];
+		default:
+			ZN_CRASH();
+			return 0;
+	}
+}
+
+inline void set_raw_voxel(uint8_t *data, size_t i, uint64_t value, VoxelBufferInternal::Depth depth) {
+	switch (depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			data[i] = value;
+			break;
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			reinterpret_cast<uint16_t *>(data)[i] = value;
+			break;
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			reinterpret_cast<uint32_t *>(data)[i] = value;
+			break;
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			reinterpret_cast<uint64_t *>(data)[i] = value;
+			break;
+		default:
+			ZN_CRASH();
+	}
+}
+
+template <typename T>
+inline void fill_raw(uint8_t *dst, size_t count, uint64_t value) {
+	T *dst_t = reinterpret_cast<T *>(dst);
+	for (size_t i = 0; i < count; ++i) {
+		dst_t[i] = value;
+	}
+}
+
+// Fills `count` consecutive raw voxels
+void fill_raw(uint8_t *dst, size_t count, uint64_t value, VoxelBufferInternal::Depth depth) {
+	switch (depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			memset(dst, value, count);
+			break;
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			fill_raw<uint16_t>(dst, count, value);
+			break;
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			fill_raw<uint32_t>(dst, count, value);
+			break;
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			fill_raw<uint64_t>(dst, count, value);
+			break;
+		default:
+			ZN_CRASH();
+	}
+}
+
+inline size_t get_brick_size_in_bytes(VoxelBufferInternal::Depth depth) {
+	return VoxelBufferInternal::BRICK_VOLUME * VoxelBufferInternal::get_depth_byte_count(depth);
+}
+
+inline bool is_brick_data_uniform(const uint8_t *data, VoxelBufferInternal::Depth depth) {
+	switch (depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			return is_uniform(data, VoxelBufferInternal::BRICK_VOLUME);
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			return is_uniform(reinterpret_cast<const uint16_t *>(data), VoxelBufferInternal::BRICK_VOLUME);
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			return is_uniform(reinterpret_cast<const uint32_t *>(data), VoxelBufferInternal::BRICK_VOLUME);
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			return is_uniform(reinterpret_cast<const uint64_t *>(data), VoxelBufferInternal::BRICK_VOLUME);
+		default:
+			ZN_CRASH();
+			return false;
+	}
+}
+
+// Position of a voxel inside the brick it belongs to, in order [z][x][y]
+inline size_t get_index_in_brick(int x, int y, int z) {
+	const unsigned int mask = VoxelBufferInternal::BRICK_SIZE - 1;
+	const unsigned int po2 = VoxelBufferInternal::BRICK_SIZE_PO2;
+	return (y & mask) | ((x & mask) << po2) | ((z & mask) << (2 * po2));
+}
+
+// Quantized SDF helpers
+
+const int QUANTIZED_MAX_LEVEL = 127;
+const int QUANTIZED_MAX_VALUE = std::numeric_limits<int16_t>::max();
+
+// Distance between values represented by levels above the fine ones
+inline float get_quantization_coarse_step(uint16_t step) {
+	const int fine_limit = step * VoxelBufferInternal::QUANTIZED_FINE_LEVELS;
+	const int coarse_levels = QUANTIZED_MAX_LEVEL - VoxelBufferInternal::QUANTIZED_FINE_LEVELS;
+	return math::max(QUANTIZED_MAX_VALUE - fine_limit, 0) / float(coarse_levels);
+}
+
+inline int16_t decode_quantized_sdf(int8_t q, uint16_t step, float coarse_step) {
+	const int level = math::min(q < 0 ? -q : q, QUANTIZED_MAX_LEVEL);
+	const int fine_levels = VoxelBufferInternal::QUANTIZED_FINE_LEVELS;
+	int v;
+	if (level <= fine_levels) {
+		v = level * step;
+	} else {
+		v = fine_levels * step + static_cast<int>((level - fine_levels) * coarse_step + 0.5f);
+	}
+	v = math::min(v, QUANTIZED_MAX_VALUE);
+	return q < 0 ? -v : v;
+}
+
+inline int8_t encode_quantized_sdf(int16_t s, uint16_t step, float coarse_step) {
+	const int a = s < 0 ? -int(s) : s;
+	const int fine_levels = VoxelBufferInternal::QUANTIZED_FINE_LEVELS;
+	const int fine_limit = fine_levels * step;
+	int level;
+	if (a <= fine_limit) {
+		level = (a + step / 2) / step;
+	} else if (coarse_step > 0.f) {
+		level = fine_levels + static_cast<int>((a - fine_limit) / coarse_step + 0.5f);
+	} else {
+		level = fine_levels;
+	}
+	level = math::min(level, QUANTIZED_MAX_LEVEL);
+	if (s < 0) {
+		// Keep the sign, it tells which side of the surface the voxel is
+		return -math::max(level, 1);
+	}
+	return level;
+}
+
+// Writes `count` consecutive voxels of a quantized channel as raw 16-bit values into `dst`
+void decode_quantized(const VoxelBufferInternal::Channel &channel, size_t src_index, uint8_t *dst, size_t count) {
+	const int8_t *src = reinterpret_cast<const int8_t *>(channel.data) + src_index;
+	int16_t *dst16 = reinterpret_cast<int16_t *>(dst);
+	const uint16_t step = channel.quantization_step;
+	const float coarse_step = get_quantization_coarse_step(step);
+	for (size_t i = 0; i < count; ++i) {
+		dst16[i] = decode_quantized_sdf(src[i], step, coarse_step);
+	}
+}
+
+// Finds a quantization step that keeps values around the surface precise
+uint16_t find_quantization_step(const int16_t *values, Vector3i size) {
+	int max_abs = 0;
+	int surface_band = 0;
+
+	const size_t y_stride = 1;
+	const size_t x_stride = size.y;
+	const size_t z_stride = size.y * size.x;
+
+	Vector3i pos;
+	for (pos.z = 0; pos.z < size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < size.x; ++pos.x) {
+			size_t i = Vector3iUtil::get_zxy_index(Vector3i(pos.x, 0, pos.z), size);
+			for (pos.y = 0; pos.y < size.y; ++pos.y, ++i) {
+				const int v = values[i];
+				const int a = std::abs(v);
+				max_abs = math::max(a, max_abs);
+				// Look at neighbors in positive directions, so each pair is visited once
+				if (pos.y + 1 < size.y && (v < 0) != (values[i + y_stride] < 0)) {
+					surface_band = math::max(surface_band, math::max(a, std::abs(int(values[i + y_stride]))));
+				}
+				if (pos.x + 1 < size.x && (v < 0) != (values[i + x_stride] < 0)) {
+					surface_band = math::max(surface_band, math::max(a, std::abs(int(values[i + x_stride]))));
+				}
+				if (pos.z + 1 < size.z && (v < 0) != (values[i + z_stride] < 0)) {
+					surface_band = math::max(surface_band, math::max(a, std::abs(int(values[i + z_stride]))));
+				}
+			}
+		}
+	}
+
+	const int fine_levels = VoxelBufferInternal::QUANTIZED_FINE_LEVELS;
+	// Twice the band, because normals are computed from neighbors on each side of the surface
+	const int fine_range = surface_band > 0 ? math::min(2 * surface_band, max_abs) : max_abs;
+	return math::clamp((fine_range + fine_levels - 1) / fine_levels, 1, int(std::numeric_limits<uint16_t>::max()));
+}
+
+} // namespace
+
 // uint64_t g_depth_max_values[] = {
 // 	0xff, // 8
 // 	0xffff, // 16
@@ -242,6 +572,24 @@ uint64_t VoxelBufferInternal::get_voxel(int x, int y, int z, unsigned int channe
 	if (channel.data != nullptr) {
 		const uint32_t i = get_index(x, y, z);
 
+		if (channel.palette != nullptr) {
+			return channel.palette[get_palette_index(channel.data, channel.palette_bits, i)];
+		}
+
+		if (channel.bricked) {
+			const Brick &brick = get_bricks(channel)[get_brick_index(x, y, z)];
+			if (brick.data == nullptr) {
+				return brick.value;
+			}
+			return get_raw_voxel(brick.data, get_index_in_brick(x, y, z), channel.depth);
+		}
+
+		if (channel.quantized) {
+			const int8_t q = reinterpret_cast<const int8_t *>(channel.data)[i];
+			const uint16_t step = channel.quantization_step;
+			return uint16_t(decode_quantized_sdf(q, step, get_quantization_coarse_step(step)));
+		}
+
 		switch (channel.depth) {
 			case DEPTH_8_BIT:
 				return channel.data[i];
@@ -286,6 +634,30 @@ void VoxelBufferInternal::set_voxel(uint64_t value, int x, int y, int z, unsigne
 	if (do_set) {
 		const uint32_t i = get_index(x, y, z);
 
+		if (channel.quantized) {
+			// Edits must be exact
+			decompress_quantized(channel);
+		}
+
+		if (channel.palette != nullptr) {
+			const int palette_index = get_or_add_palette_index(channel, value);
+			if (palette_index != -1) {
+				set_palette_index(channel.data, channel.palette_bits, i, palette_index);
+				return;
+			}
+			// The palette was full, the channel has been decompressed
+		}
+
+		if (channel.bricked) {
+			Brick &brick = get_bricks(channel)[get_brick_index(x, y, z)];
+			if (brick.data == nullptr && brick.value == value) {
+				return;
+			}
+			uint8_t *brick_data = get_or_allocate_brick_data(channel, brick);
+			set_raw_voxel(brick_data, get_index_in_brick(x, y, z), value, channel.depth);
+			return;
+		}
+
 		switch (channel.depth) {
 			case DEPTH_8_BIT:
 				// Note, if the value is negative, it may be in the range supported by int8_t.
@@ -340,6 +712,12 @@ void VoxelBufferInternal::fill(uint64_t defval, unsigned int channel_index) {
 		}
 	}
 
+	if (channel.palette != nullptr || channel.bricked || channel.quantized) {
+		// The whole channel becomes uniform
+		clear_channel(channel, defval);
+		return;
+	}
+
 	const size_t volume = get_volume();
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT(channel.size_in_bytes == get_size_in_bytes_for_volume(_size, channel.depth));
@@ -399,6 +777,60 @@ void VoxelBufferInternal::fill_area(uint64_t defval, Vector3i min, Vector3i max,
 	Vector3i pos;
 	const size_t volume = get_volume();
 
+	if (channel.quantized) {
+		decompress_quantized(channel);
+	}
+
+	if (channel.palette != nullptr) {
+		const int palette_index = get_or_add_palette_index(channel, defval);
+		if (palette_index != -1) {
+			for (pos.z = min.z; pos.z < max.z; ++pos.z) {
+				for (pos.x = min.x; pos.x < max.x; ++pos.x) {
+					const size_t dst_ri = get_index(pos.x, min.y, pos.z);
+					for (int i = 0; i < area_size.y; ++i) {
+						set_palette_index(channel.data, channel.palette_bits, dst_ri + i, palette_index);
+					}
+				}
+			}
+			return;
+		}
+		// The palette was full, the channel has been decompressed
+	}
+
+	if (channel.bricked) {
+		Brick *bricks = get_bricks(channel);
+		const Vector3i brick_grid_size = get_brick_grid_size();
+		const Box3i area(min, area_size);
+		area.downscaled(BRICK_SIZE).for_each_cell_zxy([&](Vector3i brick_pos) {
+			Brick &brick = bricks[Vector3iUtil::get_zxy_index(brick_pos, brick_grid_size)];
+			const Box3i brick_box(brick_pos << BRICK_SIZE_PO2, Vector3iUtil::create(BRICK_SIZE));
+			const Box3i local_area = area.clipped(brick_box);
+			if (local_area.size == brick_box.size) {
+				// The whole brick is covered
+				if (brick.data != nullptr) {
+					free_channel_data(brick.data, get_brick_size_in_bytes(channel.depth));
+					brick.data = nullptr;
+				}
+				brick.value = defval;
+				return;
+			}
+			if (brick.data == nullptr && brick.value == defval) {
+				return;
+			}
+			uint8_t *brick_data = get_or_allocate_brick_data(channel, brick);
+			const Vector3i local_min = local_area.pos - brick_box.pos;
+			Vector3i rpos;
+			for (rpos.z = local_min.z; rpos.z < local_min.z + local_area.size.z; ++rpos.z) {
+				for (rpos.x = local_min.x; rpos.x < local_min.x + local_area.size.x; ++rpos.x) {
+					const size_t dst_ri = get_index_in_brick(rpos.x, local_min.y, rpos.z);
+					fill_raw(brick_data + dst_ri * get_depth_byte_count(channel.depth), local_area.size.y, defval,
+							channel.depth);
+				}
+			}
+		});
+		return;
+	}
+
 	for (pos.z = min.z; pos.z < max.z; ++pos.z) {
 		for (pos.x = min.x; pos.x < max.x; ++pos.x) {
 			const size_t dst_ri = get_index(pos.x, pos.y + min.y, pos.z);
@@ -447,6 +879,43 @@ void VoxelBufferInternal::fill_f(real_t value, unsigned int channel) {
 	fill(real_to_raw_voxel(value, _channels[channel].depth), channel);
 }
 
+uint64_t get_first_voxel(const VoxelBufferInternal::Channel &channel) {
+	ZN_ASSERT(channel.data != nullptr);
+
+	if (channel.palette != nullptr) {
+		return channel.palette[get_palette_index(channel.data, channel.palette_bits, 0)];
+	}
+
+	if (channel.bricked) {
+		const VoxelBufferInternal::Brick &brick = VoxelBufferInternal::get_bricks(channel)[0];
+		return brick.data == nullptr ? brick.value : get_raw_voxel(brick.data, 0, channel.depth);
+	}
+
+	if (channel.quantized) {
+		const int8_t q = reinterpret_cast<const int8_t *>(channel.data)[0];
+		const uint16_t step = channel.quantization_step;
+		return uint16_t(decode_quantized_sdf(q, step, get_quantization_coarse_step(step)));
+	}
+
+	switch (channel.depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			return channel.data[0];
+
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			return reinterpret_cast<uint16_t *>(channel.data)[0];
+
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			return reinterpret_cast<uint32_t *>(channel.data)[0];
+
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			return reinterpret_cast<uint64_t *>(channel.data)[0];
+
+		default:
+			ZN_CRASH();
+			return 0;
+	}
+}
+
 template <typename T>
 inline bool is_uniform_b(const uint8_t *data, size_t item_count) {
 	return is_uniform<T>(reinterpret_cast<const T *>(data), item_count);
@@ -458,12 +927,47 @@ bool VoxelBufferInternal::is_uniform(unsigned int channel_index) const {
 	return is_uniform(channel);
 }
 
-bool VoxelBufferInternal::is_uniform(const Channel &channel) {
+bool VoxelBufferInternal::is_uniform(const Channel &channel) const {
 	if (channel.data == nullptr) {
 		// Channel has been optimized
 		return true;
 	}
 
+	if (channel.palette != nullptr) {
+		// Palette entries can be unused, so indices have to be checked
+		const size_t volume = get_volume();
+		const unsigned int first = get_palette_index(channel.data, channel.palette_bits, 0);
+		for (size_t i = 1; i < volume; ++i) {
+			if (get_palette_index(channel.data, channel.palette_bits, i) != first) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (channel.bricked) {
+		const Brick *bricks = get_bricks(channel);
+		const unsigned int brick_count = Vector3iUtil::get_volume(get_brick_grid_size());
+		const uint64_t first = get_first_voxel(channel);
+		for (unsigned int i = 0; i < brick_count; ++i) {
+			const Brick &brick = bricks[i];
+			if (brick.data == nullptr) {
+				if (brick.value != first) {
+					return false;
+				}
+			} else if (!is_brick_data_uniform(brick.data, channel.depth) ||
+					get_raw_voxel(brick.data, 0, channel.depth) != first) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (channel.quantized) {
+		// Different levels always decode to different values
+		return is_uniform_b<uint8_t>(channel.data, channel.size_in_bytes);
+	}
+
 	// Channel isn't optimized, so must look at each voxel
 	switch (channel.depth) {
 		case DEPTH_8_BIT:
@@ -482,28 +986,6 @@ bool VoxelBufferInternal::is_uniform(const Channel &channel) {
 	return true;
 }
 
-uint64_t get_first_voxel(const VoxelBufferInternal::Channel &channel) {
-	ZN_ASSERT(channel.data != nullptr);
-
-	switch (channel.depth) {
-		case VoxelBufferInternal::DEPTH_8_BIT:
-			return channel.data[0];
-
-		case VoxelBufferInternal::DEPTH_16_BIT:
-			return reinterpret_cast<uint16_t *>(channel.data)[0];
-
-		case VoxelBufferInternal::DEPTH_32_BIT:
-			return reinterpret_cast<uint32_t *>(channel.data)[0];
-
-		case VoxelBufferInternal::DEPTH_64_BIT:
-			return reinterpret_cast<uint64_t *>(channel.data)[0];
-
-		default:
-			ZN_CRASH();
-			return 0;
-	}
-}
-
 void VoxelBufferInternal::compress_uniform_channels() {
 	for (unsigned int i = 0; i < MAX_CHANNELS; ++i) {
 		Channel &channel = _channels[i];
@@ -525,6 +1007,12 @@ void VoxelBufferInternal::decompress_channel(unsigned int channel_index) {
 	Channel &channel = _channels[channel_index];
 	if (channel.data == nullptr) {
 		ZN_ASSERT_RETURN(create_channel(channel_index, channel.defval));
+	} else if (channel.palette != nullptr) {
+		decompress_palette(channel);
+	} else if (channel.bricked) {
+		decompress_bricks(channel);
+	} else if (channel.quantized) {
+		decompress_quantized(channel);
 	}
 }
 
@@ -534,9 +1022,494 @@ VoxelBufferInternal::Compression VoxelBufferInternal::get_channel_compression(un
 	if (channel.data == nullptr) {
 		return COMPRESSION_UNIFORM;
 	}
+	if (channel.palette != nullptr) {
+		return COMPRESSION_PALETTE;
+	}
+	if (channel.bricked) {
+		return COMPRESSION_BRICKS;
+	}
+	if (channel.quantized) {
+		return COMPRESSION_QUANTIZED;
+	}
 	return COMPRESSION_NONE;
 }
 
+bool VoxelBufferInternal::compress_channel_with_palette(unsigned int channel_index) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	// SDF needs a wide range of values, and code reading it expects raw data
+	ZN_ASSERT_RETURN_V_MSG(channel_index != CHANNEL_SDF, false, "Palette compression is not supported on SDF");
+
+	Channel &channel = _channels[channel_index];
+	if (channel.data == nullptr || channel.palette != nullptr || channel.bricked || channel.quantized) {
+		// Already compressed
+		return true;
+	}
+
+	const size_t volume = get_volume();
+	std::vector<uint8_t> &tmp_indices = get_tls_palette_indices();
+	tmp_indices.resize(volume);
+
+	FixedArray<uint64_t, MAX_PALETTE_SIZE> tmp_palette;
+	unsigned int palette_size = 0;
+	bool found_palette = false;
+
+	switch (channel.depth) {
+		case DEPTH_8_BIT:
+			found_palette = build_palette(channel.data, volume, tmp_palette, palette_size, tmp_indices.data());
+			break;
+		case DEPTH_16_BIT:
+			found_palette = build_palette(reinterpret_cast<const uint16_t *>(channel.data), volume, tmp_palette,
+					palette_size, tmp_indices.data());
+			break;
+		case DEPTH_32_BIT:
+			found_palette = build_palette(reinterpret_cast<const uint32_t *>(channel.data), volume, tmp_palette,
+					palette_size, tmp_indices.data());
+			break;
+		case DEPTH_64_BIT:
+			found_palette = build_palette(reinterpret_cast<const uint64_t *>(channel.data), volume, tmp_palette,
+					palette_size, tmp_indices.data());
+			break;
+		default:
+			ZN_CRASH();
+	}
+
+	if (!found_palette) {
+		return false;
+	}
+
+	if (palette_size == 1) {
+		clear_channel(channel, tmp_palette[0]);
+		return true;
+	}
+
+	const unsigned int palette_bits = get_palette_bits_for_size(palette_size);
+	const size_t indices_size_in_bytes = get_palette_indices_size_in_bytes(volume, palette_bits);
+	if (indices_size_in_bytes + get_palette_size_in_bytes(palette_bits) >= channel.size_in_bytes) {
+		// Not worth it
+		return false;
+	}
+
+	uint8_t *indices = allocate_channel_data(indices_size_in_bytes);
+	ZN_ASSERT_RETURN_V(indices != nullptr, false);
+	uint64_t *palette = allocate_palette(palette_bits);
+	ZN_ASSERT_RETURN_V(palette != nullptr, false);
+
+	memset(indices, 0, indices_size_in_bytes);
+	for (size_t i = 0; i < volume; ++i) {
+		set_palette_index(indices, palette_bits, i, tmp_indices[i]);
+	}
+	for (unsigned int i = 0; i < palette_size; ++i) {
+		palette[i] = tmp_palette[i];
+	}
+
+	delete_channel(channel);
+	channel.data = indices;
+	channel.size_in_bytes = indices_size_in_bytes;
+	channel.palette = palette;
+	channel.palette_size = palette_size;
+	channel.palette_bits = palette_bits;
+	return true;
+}
+
+void VoxelBufferInternal::compress_palette_channels() {
+	compress_channel_with_palette(CHANNEL_TYPE);
+	compress_channel_with_palette(CHANNEL_INDICES);
+}
+
+// Returns the palette index of a value, adding it to the palette if needed.
+// Returns -1 if the palette could not hold more values, in which case the channel gets decompressed.
+int VoxelBufferInternal::get_or_add_palette_index(Channel &channel, uint64_t value) {
+	for (unsigned int i = 0; i < channel.palette_size; ++i) {
+		if (channel.palette[i] == value) {
+			return i;
+		}
+	}
+	if (channel.palette_size == (1u << channel.palette_bits)) {
+		if (!repack_palette(channel, 1)) {
+			decompress_palette(channel);
+			return -1;
+		}
+	}
+	const unsigned int palette_index = channel.palette_size;
+	channel.palette[palette_index] = value;
+	++channel.palette_size;
+	return palette_index;
+}
+
+// Removes palette entries no longer used by any voxel, and makes sure the palette can hold `extra_entries` more.
+// Returns false if that would require more than the maximum palette size.
+bool VoxelBufferInternal::repack_palette(Channel &channel, unsigned int extra_entries) {
+	ZN_PROFILE_SCOPE();
+	const size_t volume = get_volume();
+
+	FixedArray<int16_t, MAX_PALETTE_SIZE> remap;
+	zylann::fill(remap, int16_t(-1));
+	for (size_t i = 0; i < volume; ++i) {
+		remap[get_palette_index(channel.data, channel.palette_bits, i)] = 0;
+	}
+	unsigned int used_count = 0;
+	for (unsigned int i = 0; i < channel.palette_size; ++i) {
+		if (remap[i] != -1) {
+			remap[i] = used_count;
+			++used_count;
+		}
+	}
+
+	if (used_count + extra_entries > MAX_PALETTE_SIZE) {
+		return false;
+	}
+
+	const unsigned int palette_bits = get_palette_bits_for_size(used_count + extra_entries);
+	const size_t indices_size_in_bytes = get_palette_indices_size_in_bytes(volume, palette_bits);
+
+	uint8_t *indices = allocate_channel_data(indices_size_in_bytes);
+	ZN_ASSERT_RETURN_V(indices != nullptr, false);
+	uint64_t *palette = allocate_palette(palette_bits);
+	ZN_ASSERT_RETURN_V(palette != nullptr, false);
+
+	memset(indices, 0, indices_size_in_bytes);
+	for (size_t i = 0; i < volume; ++i) {
+		const unsigned int old_index = get_palette_index(channel.data, channel.palette_bits, i);
+		set_palette_index(indices, palette_bits, i, remap[old_index]);
+	}
+	for (unsigned int i = 0; i < channel.palette_size; ++i) {
+		if (remap[i] != -1) {
+			palette[remap[i]] = channel.palette[i];
+		}
+	}
+
+	delete_channel(channel);
+	channel.data = indices;
+	channel.size_in_bytes = indices_size_in_bytes;
+	channel.palette = palette;
+	channel.palette_size = used_count;
+	channel.palette_bits = palette_bits;
+	return true;
+}
+
+void VoxelBufferInternal::decompress_palette(Channel &channel) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(channel.palette != nullptr);
+	const size_t size_in_bytes = get_size_in_bytes_for_volume(_size, channel.depth);
+	uint8_t *data = allocate_channel_data(size_in_bytes);
+	ZN_ASSERT_RETURN(data != nullptr);
+	decode_palette(channel, 0, data, get_volume());
+	delete_channel(channel);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+}
+
+void VoxelBufferInternal::copy_palette_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size,
+		Vector3i dst_min, Vector3i src_min, Vector3i src_max, unsigned int item_size) const {
+	ZN_ASSERT_RETURN(channel.palette != nullptr);
+	ZN_ASSERT_RETURN(item_size == get_depth_byte_count(channel.depth));
+
+	Vector3iUtil::sort_min_max(src_min, src_max);
+	clip_copy_region(src_min, src_max, _size, dst_min, dst_size);
+	const Vector3i area_size = src_max - src_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		// Degenerate area, we'll not copy anything.
+		return;
+	}
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(dst_size) * item_size <= dst.size());
+
+	// Decode row by row
+	Vector3i pos;
+	for (pos.z = 0; pos.z < area_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < area_size.x; ++pos.x) {
+			const size_t src_ri = get_index(src_min.x + pos.x, src_min.y, src_min.z + pos.z);
+			const size_t dst_ri = Vector3iUtil::get_zxy_index(dst_min + Vector3i(pos.x, 0, pos.z), dst_size);
+			decode_palette(channel, src_ri, dst.data() + dst_ri * item_size, area_size.y);
+		}
+	}
+}
+
+bool VoxelBufferInternal::compress_channel_with_bricks(unsigned int channel_index) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+
+	Channel &channel = _channels[channel_index];
+	if (channel.data == nullptr || channel.palette != nullptr || channel.bricked || channel.quantized) {
+		// Already compressed
+		return true;
+	}
+
+	if (_size.x % BRICK_SIZE != 0 || _size.y % BRICK_SIZE != 0 || _size.z % BRICK_SIZE != 0) {
+		return false;
+	}
+
+	const Vector3i brick_grid_size = get_brick_grid_size();
+	const unsigned int brick_count = Vector3iUtil::get_volume(brick_grid_size);
+	const unsigned int item_size = get_depth_byte_count(channel.depth);
+	const size_t brick_size_in_bytes = get_brick_size_in_bytes(channel.depth);
+	const size_t table_size_in_bytes = brick_count * sizeof(Brick);
+
+	Brick *bricks = reinterpret_cast<Brick *>(allocate_channel_data(table_size_in_bytes));
+	ZN_ASSERT_RETURN_V(bricks != nullptr, false);
+	unsigned int allocated_brick_count = 0;
+
+	Vector3i brick_pos;
+	for (brick_pos.z = 0; brick_pos.z < brick_grid_size.z; ++brick_pos.z) {
+		for (brick_pos.x = 0; brick_pos.x < brick_grid_size.x; ++brick_pos.x) {
+			for (brick_pos.y = 0; brick_pos.y < brick_grid_size.y; ++brick_pos.y) {
+				const Vector3i origin = brick_pos << BRICK_SIZE_PO2;
+				Brick &brick = bricks[Vector3iUtil::get_zxy_index(brick_pos, brick_grid_size)];
+				brick.data = allocate_channel_data(brick_size_in_bytes);
+				ZN_ASSERT(brick.data != nullptr);
+				copy_3d_region_zxy(Span<uint8_t>(brick.data, brick_size_in_bytes), Vector3iUtil::create(BRICK_SIZE),
+						Vector3i(), Span<const uint8_t>(channel.data, channel.size_in_bytes), _size, origin,
+						origin + Vector3iUtil::create(BRICK_SIZE), item_size);
+				compress_brick_if_uniform(channel, brick);
+				if (brick.data != nullptr) {
+					++allocated_brick_count;
+				}
+			}
+		}
+	}
+
+	if (table_size_in_bytes + allocated_brick_count * brick_size_in_bytes >= channel.size_in_bytes) {
+		// Not worth it
+		for (unsigned int i = 0; i < brick_count; ++i) {
+			if (bricks[i].data != nullptr) {
+				free_channel_data(bricks[i].data, brick_size_in_bytes);
+			}
+		}
+		free_channel_data(reinterpret_cast<uint8_t *>(bricks), table_size_in_bytes);
+		return false;
+	}
+
+	delete_channel(channel);
+	channel.data = reinterpret_cast<uint8_t *>(bricks);
+	channel.size_in_bytes = table_size_in_bytes;
+	channel.bricked = true;
+
+	compress_if_uniform(channel);
+	return true;
+}
+
+void VoxelBufferInternal::compress_brick_channels() {
+	compress_channel_with_bricks(CHANNEL_TYPE);
+	compress_channel_with_bricks(CHANNEL_SDF);
+}
+
+// Allocates the values of a uniform brick. Does nothing if they are already allocated.
+uint8_t *VoxelBufferInternal::get_or_allocate_brick_data(const Channel &channel, Brick &brick) {
+	if (brick.data == nullptr) {
+		brick.data = allocate_channel_data(get_brick_size_in_bytes(channel.depth));
+		ZN_ASSERT(brick.data != nullptr);
+		fill_raw(brick.data, BRICK_VOLUME, brick.value, channel.depth);
+	}
+	return brick.data;
+}
+
+void VoxelBufferInternal::compress_brick_if_uniform(const Channel &channel, Brick &brick) {
+	if (brick.data != nullptr && is_brick_data_uniform(brick.data, channel.depth)) {
+		brick.value = get_raw_voxel(brick.data, 0, channel.depth);
+		free_channel_data(brick.data, get_brick_size_in_bytes(channel.depth));
+		brick.data = nullptr;
+	}
+}
+
+void VoxelBufferInternal::decompress_bricks(Channel &channel) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(channel.bricked);
+	const size_t size_in_bytes = get_size_in_bytes_for_volume(_size, channel.depth);
+	uint8_t *data = allocate_channel_data(size_in_bytes);
+	ZN_ASSERT_RETURN(data != nullptr);
+	copy_bricks_region_to(channel, Span<uint8_t>(data, size_in_bytes), _size, Vector3i(), Vector3i(), _size,
+			get_depth_byte_count(channel.depth));
+	delete_channel(channel);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+}
+
+void VoxelBufferInternal::copy_bricks_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size,
+		Vector3i dst_min, Vector3i src_min, Vector3i src_max, unsigned int item_size) const {
+	ZN_ASSERT_RETURN(channel.bricked);
+	ZN_ASSERT_RETURN(item_size == get_depth_byte_count(channel.depth));
+
+	Vector3iUtil::sort_min_max(src_min, src_max);
+	clip_copy_region(src_min, src_max, _size, dst_min, dst_size);
+	const Vector3i area_size = src_max - src_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		// Degenerate area, we'll not copy anything.
+		return;
+	}
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(dst_size) * item_size <= dst.size());
+
+	const Brick *bricks = get_bricks(channel);
+	const Vector3i brick_grid_size = get_brick_grid_size();
+	const Box3i src_box(src_min, area_size);
+
+	src_box.downscaled(BRICK_SIZE).for_each_cell_zxy([&](Vector3i brick_pos) {
+		const Brick &brick = bricks[Vector3iUtil::get_zxy_index(brick_pos, brick_grid_size)];
+		const Box3i local_box = src_box.clipped(Box3i(brick_pos << BRICK_SIZE_PO2, Vector3iUtil::create(BRICK_SIZE)));
+		// Copy row by row
+		Vector3i pos;
+		for (pos.z = local_box.pos.z; pos.z < local_box.pos.z + local_box.size.z; ++pos.z) {
+			for (pos.x = local_box.pos.x; pos.x < local_box.pos.x + local_box.size.x; ++pos.x) {
+				const Vector3i dst_pos = dst_min + Vector3i(pos.x, local_box.pos.y, pos.z) - src_min;
+				const size_t dst_ri = Vector3iUtil::get_zxy_index(dst_pos, dst_size);
+				uint8_t *dst_row = dst.data() + dst_ri * item_size;
+				if (brick.data == nullptr) {
+					fill_raw(dst_row, local_box.size.y, brick.value, channel.depth);
+				} else {
+					const size_t src_ri = get_index_in_brick(pos.x, local_box.pos.y, pos.z);
+					memcpy(dst_row, brick.data + src_ri * item_size, local_box.size.y * item_size);
+				}
+			}
+		}
+	});
+}
+
+// Copies a region of any non-uniform channel of another buffer into the bricks of a channel of this buffer
+void VoxelBufferInternal::copy_region_to_bricks(const VoxelBufferInternal &other, const Channel &other_channel,
+		Vector3i src_min, Vector3i src_max, Vector3i dst_min, Channel &channel) {
+	ZN_ASSERT_RETURN(channel.bricked);
+
+	Vector3iUtil::sort_min_max(src_min, src_max);
+	clip_copy_region(src_min, src_max, other._size, dst_min, _size);
+	const Vector3i area_size = src_max - src_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		// Degenerate area, we'll not copy anything.
+		return;
+	}
+
+	Brick *bricks = get_bricks(channel);
+	const Vector3i brick_grid_size = get_brick_grid_size();
+	const unsigned int item_size = get_depth_byte_count(channel.depth);
+	const Box3i dst_box(dst_min, area_size);
+
+	dst_box.downscaled(BRICK_SIZE).for_each_cell_zxy([&](Vector3i brick_pos) {
+		Brick &brick = bricks[Vector3iUtil::get_zxy_index(brick_pos, brick_grid_size)];
+		const Vector3i brick_origin = brick_pos << BRICK_SIZE_PO2;
+		const Box3i local_box = dst_box.clipped(Box3i(brick_origin, Vector3iUtil::create(BRICK_SIZE)));
+		const Vector3i local_src_min = local_box.pos - dst_min + src_min;
+		Span<uint8_t> brick_data(get_or_allocate_brick_data(channel, brick), get_brick_size_in_bytes(channel.depth));
+		other.copy_channel_region_to(other_channel, brick_data, Vector3iUtil::create(BRICK_SIZE),
+				local_box.pos - brick_origin, local_src_min, local_src_min + local_box.size, item_size);
+		compress_brick_if_uniform(channel, brick);
+	});
+}
+
+bool VoxelBufferInternal::quantize_sdf_channel() {
+	ZN_PROFILE_SCOPE();
+	Channel &channel = _channels[CHANNEL_SDF];
+	if (channel.data == nullptr || channel.palette != nullptr || channel.bricked || channel.quantized) {
+		// Already compressed
+		return true;
+	}
+	if (channel.depth != DEPTH_16_BIT) {
+		// 8-bit is already small, and 32/64-bit SDF have no fixed range
+		return false;
+	}
+
+	const size_t volume = get_volume();
+	const int16_t *values = reinterpret_cast<const int16_t *>(channel.data);
+	const uint16_t step = find_quantization_step(values, _size);
+	const float coarse_step = get_quantization_coarse_step(step);
+
+	uint8_t *data = allocate_channel_data(volume);
+	ZN_ASSERT_RETURN_V(data != nullptr, false);
+	int8_t *levels = reinterpret_cast<int8_t *>(data);
+	for (size_t i = 0; i < volume; ++i) {
+		levels[i] = encode_quantized_sdf(values[i], step, coarse_step);
+	}
+
+	delete_channel(channel);
+	channel.data = data;
+	channel.size_in_bytes = volume;
+	channel.quantized = true;
+	channel.quantization_step = step;
+	return true;
+}
+
+bool VoxelBufferInternal::get_channel_quantized_raw(
+		unsigned int channel_index, Span<uint8_t> &slice, uint16_t &step) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	const Channel &channel = _channels[channel_index];
+	if (channel.data != nullptr && channel.quantized) {
+		slice = Span<uint8_t>(channel.data, 0, channel.size_in_bytes);
+		step = channel.quantization_step;
+		return true;
+	}
+	slice = Span<uint8_t>();
+	return false;
+}
+
+bool VoxelBufferInternal::create_quantized_channel(
+		unsigned int channel_index, uint16_t step, Span<uint8_t> &out_slice) {
+	ZN_ASSERT_RETURN_V(channel_index == CHANNEL_SDF, false);
+	ZN_ASSERT_RETURN_V(step > 0, false);
+	Channel &channel = _channels[channel_index];
+	ZN_ASSERT_RETURN_V(channel.depth == DEPTH_16_BIT, false);
+	if (channel.data != nullptr) {
+		delete_channel(channel);
+	}
+	const size_t volume = get_volume();
+	channel.data = allocate_channel_data(volume);
+	ZN_ASSERT_RETURN_V(channel.data != nullptr, false);
+	channel.size_in_bytes = volume;
+	channel.quantized = true;
+	channel.quantization_step = step;
+	out_slice = Span<uint8_t>(channel.data, 0, volume);
+	return true;
+}
+
+void VoxelBufferInternal::decompress_quantized(Channel &channel) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(channel.quantized);
+	const size_t size_in_bytes = get_size_in_bytes_for_volume(_size, channel.depth);
+	uint8_t *data = allocate_channel_data(size_in_bytes);
+	ZN_ASSERT_RETURN(data != nullptr);
+	decode_quantized(channel, 0, data, get_volume());
+	delete_channel(channel);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+}
+
+void VoxelBufferInternal::copy_quantized_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size,
+		Vector3i dst_min, Vector3i src_min, Vector3i src_max, unsigned int item_size) const {
+	ZN_ASSERT_RETURN(channel.quantized);
+	ZN_ASSERT_RETURN(item_size == get_depth_byte_count(channel.depth));
+
+	Vector3iUtil::sort_min_max(src_min, src_max);
+	clip_copy_region(src_min, src_max, _size, dst_min, dst_size);
+	const Vector3i area_size = src_max - src_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		// Degenerate area, we'll not copy anything.
+		return;
+	}
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(dst_size) * item_size <= dst.size());
+
+	// Decode row by row
+	Vector3i pos;
+	for (pos.z = 0; pos.z < area_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < area_size.x; ++pos.x) {
+			const size_t src_ri = get_index(src_min.x + pos.x, src_min.y, src_min.z + pos.z);
+			const size_t dst_ri = Vector3iUtil::get_zxy_index(dst_min + Vector3i(pos.x, 0, pos.z), dst_size);
+			decode_quantized(channel, src_ri, dst.data() + dst_ri * item_size, area_size.y);
+		}
+	}
+}
+
+// Copies a region of a non-uniform channel into a dense array, whatever its layout is
+void VoxelBufferInternal::copy_channel_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size,
+		Vector3i dst_min, Vector3i src_min, Vector3i src_max, unsigned int item_size) const {
+	ZN_ASSERT_RETURN(channel.data != nullptr);
+	if (channel.palette != nullptr) {
+		copy_palette_region_to(channel, dst, dst_size, dst_min, src_min, src_max, item_size);
+	} else if (channel.bricked) {
+		copy_bricks_region_to(channel, dst, dst_size, dst_min, src_min, src_max, item_size);
+	} else if (channel.quantized) {
+		copy_quantized_region_to(channel, dst, dst_size, dst_min, src_min, src_max, item_size);
+	} else {
+		Span<const uint8_t> src(channel.data, channel.size_in_bytes);
+		copy_3d_region_zxy(dst, dst_size, dst_min, src, _size, src_min, src_max, item_size);
+	}
+}
+
 void VoxelBufferInternal::copy_format(const VoxelBufferInternal &other) {
 	for (unsigned int i = 0; i < MAX_CHANNELS; ++i) {
 		set_channel_depth(i, other.get_channel_depth(i));
@@ -561,11 +1534,62 @@ void VoxelBufferInternal::copy_from(const VoxelBufferInternal &other, unsigned i
 	ZN_ASSERT_RETURN(other_channel.depth == channel.depth);
 
 	if (other_channel.data != nullptr) {
-		if (channel.data == nullptr) {
-			ZN_ASSERT_RETURN(create_channel_noinit(channel_index, _size));
+		if (channel.data != nullptr &&
+				(channel.palette != nullptr || other_channel.palette != nullptr || channel.bricked ||
+						other_channel.bricked || channel.quantized || other_channel.quantized)) {
+			// Allocations don't have the same layout
+			delete_channel(channel_index);
+		}
+		if (other_channel.bricked) {
+			const size_t brick_size_in_bytes = get_brick_size_in_bytes(other_channel.depth);
+			const unsigned int brick_count = other_channel.size_in_bytes / sizeof(Brick);
+			channel.data = allocate_channel_data(other_channel.size_in_bytes);
+			ZN_ASSERT_RETURN(channel.data != nullptr);
+			channel.size_in_bytes = other_channel.size_in_bytes;
+			channel.bricked = true;
+
+			Brick *bricks = get_bricks(channel);
+			const Brick *other_bricks = get_bricks(other_channel);
+			for (unsigned int i = 0; i < brick_count; ++i) {
+				const Brick &other_brick = other_bricks[i];
+				Brick &brick = bricks[i];
+				brick.value = other_brick.value;
+				if (other_brick.data != nullptr) {
+					brick.data = allocate_channel_data(brick_size_in_bytes);
+					ZN_ASSERT(brick.data != nullptr);
+					memcpy(brick.data, other_brick.data, brick_size_in_bytes);
+				} else {
+					brick.data = nullptr;
+				}
+			}
+
+		} else if (other_channel.palette != nullptr) {
+			channel.data = allocate_channel_data(other_channel.size_in_bytes);
+			ZN_ASSERT_RETURN(channel.data != nullptr);
+			channel.size_in_bytes = other_channel.size_in_bytes;
+			memcpy(channel.data, other_channel.data, channel.size_in_bytes);
+
+			channel.palette = allocate_palette(other_channel.palette_bits);
+			ZN_ASSERT_RETURN(channel.palette != nullptr);
+			channel.palette_bits = other_channel.palette_bits;
+			channel.palette_size = other_channel.palette_size;
+			memcpy(channel.palette, other_channel.palette, channel.palette_size * sizeof(uint64_t));
+
+		} else if (other_channel.quantized) {
+			channel.data = allocate_channel_data(other_channel.size_in_bytes);
+			ZN_ASSERT_RETURN(channel.data != nullptr);
+			channel.size_in_bytes = other_channel.size_in_bytes;
+			memcpy(channel.data, other_channel.data, channel.size_in_bytes);
+			channel.quantized = true;
+			channel.quantization_step = other_channel.quantization_step;
+
+		} else {
+			if (channel.data == nullptr) {
+				ZN_ASSERT_RETURN(create_channel_noinit(channel_index, _size));
+			}
+			ZN_ASSERT(channel.size_in_bytes == other_channel.size_in_bytes);
+			memcpy(channel.data, other_channel.data, channel.size_in_bytes);
 		}
-		ZN_ASSERT(channel.size_in_bytes == other_channel.size_in_bytes);
-		memcpy(channel.data, other_channel.data, channel.size_in_bytes);
 
 	} else if (channel.data != nullptr) {
 		delete_channel(channel_index);
@@ -597,11 +1621,19 @@ void VoxelBufferInternal::copy_from(const VoxelBufferInternal &other, Vector3i s
 			// Note, we do this even if the pasted data happens to be all the same value as our current channel.
 			// We assume that this case is not frequent enough to bother, and compression can happen later
 			ZN_ASSERT_RETURN(create_channel(channel_index, channel.defval));
+		} else if (channel.palette != nullptr) {
+			decompress_palette(channel);
+		} else if (channel.quantized) {
+			decompress_quantized(channel);
+		}
+		if (channel.bricked) {
+			// Only bricks touched by the region get allocated
+			copy_region_to_bricks(other, other_channel, src_min, src_max, dst_min, channel);
+		} else {
+			Span<uint8_t> dst(channel.data, channel.size_in_bytes);
+			other.copy_channel_region_to(
+					other_channel, dst, _size, dst_min, src_min, src_max, get_depth_byte_count(channel.depth));
 		}
-		const unsigned int item_size = get_depth_byte_count(channel.depth);
-		Span<const uint8_t> src(other_channel.data, other_channel.size_in_bytes);
-		Span<uint8_t> dst(channel.data, channel.size_in_bytes);
-		copy_3d_region_zxy(dst, _size, dst_min, src, other._size, src_min, src_max, item_size);
 
 	} else if (channel.defval != other_channel.defval) {
 		// This logic is still required due to how source and destination regions can be specified.
@@ -647,12 +1679,18 @@ void VoxelBufferInternal::move_to(VoxelBufferInternal &dst) {
 		Channel &channel = _channels[i];
 		channel.data = nullptr;
 		channel.size_in_bytes = 0;
+		channel.palette = nullptr;
+		channel.palette_size = 0;
+		channel.palette_bits = 0;
+		channel.bricked = false;
+		channel.quantized = false;
+		channel.quantization_step = 0;
 	}
 }
 
 bool VoxelBufferInternal::get_channel_raw(unsigned int channel_index, Span<uint8_t> &slice) const {
 	const Channel &channel = _channels[channel_index];
-	if (channel.data != nullptr) {
+	if (channel.data != nullptr && channel.palette == nullptr && !channel.bricked && !channel.quantized) {
 		slice = Span<uint8_t>(channel.data, 0, channel.size_in_bytes);
 		return true;
 	}
@@ -661,6 +1699,29 @@ bool VoxelBufferInternal::get_channel_raw(unsigned int channel_index, Span<uint8
 	return false;
 }
 
+void VoxelBufferInternal::copy_channel_raw_to(unsigned int channel_index, Span<uint8_t> dst) const {
+	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
+	const Channel &channel = _channels[channel_index];
+	ZN_ASSERT_RETURN(dst.size() == get_size_in_bytes_for_volume(_size, channel.depth));
+	const size_t volume = get_volume();
+
+	if (channel.data == nullptr) {
+		fill_raw(dst.data(), volume, channel.defval, channel.depth);
+
+	} else if (channel.palette != nullptr) {
+		decode_palette(channel, 0, dst.data(), volume);
+
+	} else if (channel.bricked) {
+		copy_bricks_region_to(channel, dst, _size, Vector3i(), Vector3i(), _size, get_depth_byte_count(channel.depth));
+
+	} else if (channel.quantized) {
+		decode_quantized(channel, 0, dst.data(), volume);
+
+	} else {
+		memcpy(dst.data(), channel.data, dst.size());
+	}
+}
+
 bool VoxelBufferInternal::create_channel(int i, uint64_t defval) {
 	ZN_DSTACK();
 	if (!create_channel_noinit(i, _size)) {
@@ -697,11 +1758,30 @@ void VoxelBufferInternal::delete_channel(int i) {
 
 void VoxelBufferInternal::delete_channel(Channel &channel) {
 	ZN_ASSERT_RETURN(channel.data != nullptr);
+	if (channel.bricked) {
+		const Brick *bricks = get_bricks(channel);
+		const unsigned int brick_count = channel.size_in_bytes / sizeof(Brick);
+		const size_t brick_size_in_bytes = get_brick_size_in_bytes(channel.depth);
+		for (unsigned int i = 0; i < brick_count; ++i) {
+			if (bricks[i].data != nullptr) {
+				free_channel_data(bricks[i].data, brick_size_in_bytes);
+			}
+		}
+		channel.bricked = false;
+	}
 	// Don't use `_size` to obtain `data` byte count, since we could have changed `_size` up-front during a create().
 	// `size_in_bytes` reflects what is currently allocated inside `data`, regardless of anything else.
 	free_channel_data(channel.data, channel.size_in_bytes);
 	channel.data = nullptr;
 	channel.size_in_bytes = 0;
+	channel.quantized = false;
+	channel.quantization_step = 0;
+	if (channel.palette != nullptr) {
+		free_palette(channel.palette, channel.palette_bits);
+		channel.palette = nullptr;
+		channel.palette_size = 0;
+		channel.palette_bits = 0;
+	}
 }
 
 void VoxelBufferInternal::downscale_to(
@@ -775,6 +1855,20 @@ bool VoxelBufferInternal::equals(const VoxelBufferInternal &p_other) const {
 				return false;
 			}
 
+		} else if (channel.palette != nullptr || other_channel.palette != nullptr || channel.bricked ||
+				other_channel.bricked || channel.quantized || other_channel.quantized) {
+			// Layouts can differ while voxels are the same
+			Vector3i pos;
+			for (pos.z = 0; pos.z < _size.z; ++pos.z) {
+				for (pos.x = 0; pos.x < _size.x; ++pos.x) {
+					for (pos.y = 0; pos.y < _size.y; ++pos.y) {
+						if (get_voxel(pos, channel_index) != p_other.get_voxel(pos, channel_index)) {
+							return false;
+						}
+					}
+				}
+			}
+
 		} else {
 			ZN_ASSERT_RETURN_V(channel.size_in_bytes == other_channel.size_in_bytes, false);
 			for (size_t i = 0; i < channel.size_in_bytes; ++i) {
@@ -832,6 +1926,57 @@ void VoxelBufferInternal::get_range_f(float &out_min, float &out_max, ChannelId
 		return;
 	}
 
+	if (channel.palette != nullptr) {
+		// Unused palette entries can make the range larger than it actually is
+		for (unsigned int i = 0; i < channel.palette_size; ++i) {
+			const float v = raw_voxel_to_real(channel.palette[i], channel.depth);
+			min_value = math::min(v, min_value);
+			max_value = math::max(v, max_value);
+		}
+		out_min = min_value;
+		out_max = max_value;
+		return;
+	}
+
+	if (channel.bricked) {
+		const Brick *bricks = get_bricks(channel);
+		const unsigned int brick_count = Vector3iUtil::get_volume(get_brick_grid_size());
+		for (unsigned int brick_index = 0; brick_index < brick_count; ++brick_index) {
+			const Brick &brick = bricks[brick_index];
+			if (brick.data == nullptr) {
+				const float v = raw_voxel_to_real(brick.value, channel.depth);
+				min_value = math::min(v, min_value);
+				max_value = math::max(v, max_value);
+				continue;
+			}
+			for (unsigned int i = 0; i < BRICK_VOLUME; ++i) {
+				const float v = raw_voxel_to_real(get_raw_voxel(brick.data, i, channel.depth), channel.depth);
+				min_value = math::min(v, min_value);
+				max_value = math::max(v, max_value);
+			}
+		}
+		out_min = min_value;
+		out_max = max_value;
+		return;
+	}
+
+	if (channel.quantized) {
+		// Levels are sorted like the values they represent
+		const int8_t *data = reinterpret_cast<const int8_t *>(channel.data);
+		int8_t min_level = data[0];
+		int8_t max_level = data[0];
+		const size_t volume = get_volume();
+		for (size_t i = 1; i < volume; ++i) {
+			min_level = math::min(data[i], min_level);
+			max_level = math::max(data[i], max_level);
+		}
+		const uint16_t step = channel.quantization_step;
+		const float coarse_step = get_quantization_coarse_step(step);
+		out_min = s16_to_snorm(decode_quantized_sdf(min_level, step, coarse_step));
+		out_max = s16_to_snorm(decode_quantized_sdf(max_level, step, coarse_step));
+		return;
+	}
+
 	const uint64_t volume = get_volume();
 
 	switch (channel.depth) {
@@ -42,6 +42,12 @@ public:
 	enum Compression {
 		COMPRESSION_NONE = 0,
 		COMPRESSION_UNIFORM,
+		// Values are stored as bit-packed indices into a small palette of distinct values
+		COMPRESSION_PALETTE,
+		// The buffer is split in bricks of 8x8x8 voxels, each of which is either uniform or stores its own values
+		COMPRESSION_BRICKS,
+		// 16-bit SDF stored with 8 bits per voxel, precise near the surface and coarse far from it. Lossy.
+		COMPRESSION_QUANTIZED,
 		//COMPRESSION_RLE,
 		COMPRESSION_COUNT
 	};
@@ -89,6 +95,23 @@ public:
 	// Limit was made explicit for serialization reasons, and also because there must be a reasonable one
 	static const uint32_t MAX_SIZE = 65535;
 
+	// Channels needing more distinct values than this cannot use palette compression
+	static const unsigned int MAX_PALETTE_SIZE = 256;
+
+	// Size of bricks used by brick compression. Only buffers with sizes multiple of it can use them.
+	static const unsigned int BRICK_SIZE_PO2 = 3;
+	static const unsigned int BRICK_SIZE = 1 << BRICK_SIZE_PO2;
+	static const unsigned int BRICK_VOLUME = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+	// How many of the 127 positive levels of a quantized SDF channel are spent on precise values around the surface
+	static const unsigned int QUANTIZED_FINE_LEVELS = 96;
+
+	struct Brick {
+		// Values in order [z][x][y], or null if all voxels of the brick have the same value
+		uint8_t *data = nullptr;
+		uint64_t value = 0;
+	};
+
 	struct Channel {
 		// Allocated when the channel is populated.
 		// Flat array, in order [z][x][y] because it allows faster vertical-wise access (the engine is Y-up).
@@ -103,6 +126,21 @@ public:
 		// Storing gigabytes in a single buffer is neither supported nor practical.
 		uint32_t size_in_bytes = 0;
 
+		// Allocated when the channel is palette-compressed. In that case, `data` contains indices into this array,
+		// packed with `palette_bits` bits each. Entries may no longer be referenced by any voxel after edits.
+		uint64_t *palette = nullptr;
+		uint16_t palette_size = 0;
+		// 1, 2, 4 or 8
+		uint8_t palette_bits = 0;
+
+		// When true, `data` contains one `Brick` for each area of `BRICK_SIZE` voxels, in order [z][x][y].
+		bool bricked = false;
+
+		// When true, `data` contains one signed byte per voxel. Values up to `QUANTIZED_FINE_LEVELS` are multiples of
+		// `quantization_step`, higher values are spread evenly up to the largest value of the depth.
+		bool quantized = false;
+		uint16_t quantization_step = 0;
+
 		static const size_t MAX_SIZE_IN_BYTES = std::numeric_limits<uint32_t>::max();
 	};
 
@@ -157,6 +195,33 @@ public:
 	void decompress_channel(unsigned int channel_index);
 	Compression get_channel_compression(unsigned int channel_index) const;
 
+	// Stores the channel as bit-packed indices into a palette, if it has few enough distinct values for it to use less
+	// memory. Voxels can still be accessed and modified as usual: the palette grows as new values are set, and the
+	// channel goes back to uncompressed if it runs out of room. Not supported on the SDF channel.
+	// Returns true if the channel ends up compressed in any way.
+	bool compress_channel_with_palette(unsigned int channel_index);
+	// Applies palette compression to channels that usually contain a small set of values (types and indices)
+	void compress_palette_channels();
+
+	// Splits the channel into bricks, so that areas with a single value no longer take memory, if enough of them are
+	// like that. Voxels can still be accessed and modified as usual. Only buffers with sizes multiple of `BRICK_SIZE`
+	// support it.
+	// Returns true if the channel ends up compressed in any way.
+	bool compress_channel_with_bricks(unsigned int channel_index);
+	// Applies brick compression to uncompressed channels that are often uniform in large areas (types and SDF)
+	void compress_brick_channels();
+
+	// Stores a 16-bit SDF channel with 8 bits per voxel. The quantization step is chosen from the values found where
+	// the sign changes, so the surface stays precise while values far from it lose precision. This is lossy, so it is
+	// meant for data that isn't edited directly, like distant LODs. Setting voxels turns the channel back to 16 bits.
+	// Returns true if the channel ends up compressed in any way.
+	bool quantize_sdf_channel();
+
+	// Gets direct access to the bytes of a quantized channel. Returns false if the channel is not quantized.
+	bool get_channel_quantized_raw(unsigned int channel_index, Span<uint8_t> &slice, uint16_t &step) const;
+	// Replaces the channel with quantized values, which must be written in the returned bytes.
+	bool create_quantized_channel(unsigned int channel_index, uint16_t step, Span<uint8_t> &out_slice);
+
 	static size_t get_size_in_bytes_for_volume(Vector3i size, Depth depth);
 
 	void copy_format(const VoxelBufferInternal &other);
@@ -212,8 +277,11 @@ public:
 
 		if (channel.data == nullptr) {
 			fill_3d_region_zxy<T>(dst, dst_size, dst_min, dst_min + (src_max - src_min), channel.defval);
+		} else if (channel.palette != nullptr || channel.bricked || channel.quantized) {
+			copy_channel_region_to(channel, dst.template reinterpret_cast_to<uint8_t>(), dst_size, dst_min, src_min,
+					src_max, sizeof(T));
 		} else {
-			Span<const T> src(static_cast<const T *>(channel.data), channel.size_in_bytes / sizeof(T));
+			Span<const T> src(reinterpret_cast<const T *>(channel.data), channel.size_in_bytes / sizeof(T));
 			copy_3d_region_zxy<T>(dst, dst_size, dst_min, src, _size, src_min, src_max);
 		}
 	}
@@ -270,15 +338,64 @@ public:
 		}
 	}
 
+	inline Vector3i get_brick_grid_size() const {
+		return _size >> BRICK_SIZE_PO2;
+	}
+
+	inline size_t get_brick_index(unsigned int x, unsigned int y, unsigned int z) const {
+		const Vector3i brick_grid_size = get_brick_grid_size();
+		const Vector3i brick_pos(x >> BRICK_SIZE_PO2, y >> BRICK_SIZE_PO2, z >> BRICK_SIZE_PO2);
+		return Vector3iUtil::get_zxy_index(brick_pos, brick_grid_size);
+	}
+
+	static inline Brick *get_bricks(const Channel &channel) {
+		return reinterpret_cast<Brick *>(channel.data);
+	}
+
+	// Data_T action_func(Vector3i pos, Data_T in_v)
+	template <typename F, typename Data_T>
+	void write_box_bricks_template(const Box3i &box, Channel &channel, F action_func, Vector3i offset) {
+		Brick *bricks = get_bricks(channel);
+		const Vector3i brick_grid_size = get_brick_grid_size();
+		const Vector3i brick_size = Vector3iUtil::create(BRICK_SIZE);
+		// Only bricks touched by the box can get allocated
+		box.downscaled(BRICK_SIZE).for_each_cell_zxy([&](Vector3i brick_pos) {
+			Brick &brick = bricks[Vector3iUtil::get_zxy_index(brick_pos, brick_grid_size)];
+			const Vector3i brick_origin = brick_pos << BRICK_SIZE_PO2;
+			const Box3i local_box = box.clipped(Box3i(brick_origin, brick_size));
+			const Vector3i min_pos = local_box.pos - brick_origin;
+			const Vector3i max_pos = min_pos + local_box.size;
+			Span<Data_T> data = Span<uint8_t>(get_or_allocate_brick_data(channel, brick), BRICK_VOLUME * sizeof(Data_T))
+										.reinterpret_cast_to<Data_T>();
+			Vector3i pos;
+			for (pos.z = min_pos.z; pos.z < max_pos.z; ++pos.z) {
+				for (pos.x = min_pos.x; pos.x < max_pos.x; ++pos.x) {
+					pos.y = min_pos.y;
+					size_t i = Vector3iUtil::get_zxy_index(pos, brick_size);
+					for (; pos.y < max_pos.y; ++pos.y) {
+						data.set(i, action_func(pos + brick_origin + offset, data[i]));
+						++i;
+					}
+				}
+			}
+			compress_brick_if_uniform(channel, brick);
+		});
+	}
+
 	// Data_T action_func(Vector3i pos, Data_T in_v)
 	template <typename F, typename Data_T>
 	void write_box_template(const Box3i &box, unsigned int channel_index, F action_func, Vector3i offset) {
-		decompress_channel(channel_index);
 		Channel &channel = _channels[channel_index];
 #ifdef DEBUG_ENABLED
 		ZN_ASSERT_RETURN(Box3i(Vector3i(), _size).contains(box));
 		ZN_ASSERT_RETURN(get_depth_byte_count(channel.depth) == sizeof(Data_T));
 #endif
+		if (channel.bricked) {
+			write_box_bricks_template<F, Data_T>(box, channel, action_func, offset);
+			compress_if_uniform(channel);
+			return;
+		}
+		decompress_channel(channel_index);
 		Span<Data_T> data = Span<uint8_t>(channel.data, channel.size_in_bytes).reinterpret_cast_to<Data_T>();
 		// `&` is required because lambda captures are `const` by default and `mutable` can be used only from C++23
 		for_each_index_and_pos(box, [&data, action_func, offset](size_t i, Vector3i pos) {
@@ -403,8 +520,13 @@ public:
 		return Vector3iUtil::get_volume(_size);
 	}
 
+	// Gets direct access to the values of an uncompressed channel. Returns false if the channel is compressed.
 	bool get_channel_raw(unsigned int channel_index, Span<uint8_t> &slice) const;
 
+	// Copies all values of a channel into a dense array, whatever its compression is.
+	// `dst` must be the size an uncompressed channel would have.
+	void copy_channel_raw_to(unsigned int channel_index, Span<uint8_t> dst) const;
+
 	template <typename T>
 	bool get_channel_data(unsigned int channel_index, Span<T> &dst) const {
 		Span<uint8_t> dst8;
@@ -489,7 +611,26 @@ private:
 	void compress_if_uniform(Channel &channel);
 	static void delete_channel(Channel &channel);
 	static void clear_channel(Channel &channel, uint64_t clear_value);
-	static bool is_uniform(const Channel &channel);
+	bool is_uniform(const Channel &channel) const;
+
+	int get_or_add_palette_index(Channel &channel, uint64_t value);
+	bool repack_palette(Channel &channel, unsigned int extra_entries);
+	void decompress_palette(Channel &channel);
+	void copy_palette_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size, Vector3i dst_min,
+			Vector3i src_min, Vector3i src_max, unsigned int item_size) const;
+
+	uint8_t *get_or_allocate_brick_data(const Channel &channel, Brick &brick);
+	void compress_brick_if_uniform(const Channel &channel, Brick &brick);
+	void decompress_bricks(Channel &channel);
+	void copy_bricks_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size, Vector3i dst_min,
+			Vector3i src_min, Vector3i src_max, unsigned int item_size) const;
+	void copy_region_to_bricks(const VoxelBufferInternal &other, const Channel &other_channel, Vector3i src_min,
+			Vector3i src_max, Vector3i dst_min, Channel &channel);
+	void decompress_quantized(Channel &channel);
+	void copy_quantized_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size, Vector3i dst_min,
+			Vector3i src_min, Vector3i src_max, unsigned int item_size) const;
+	void copy_channel_region_to(const Channel &channel, Span<uint8_t> dst, Vector3i dst_size, Vector3i dst_min,
+			Vector3i src_min, Vector3i src_max, unsigned int item_size) const;
 
 private:
 	// Each channel can store arbitary data.
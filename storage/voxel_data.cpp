@@ -674,6 +674,13 @@ void VoxelData::unload_blocks(Span<const Vector3i> positions, std::vector<BlockT
 	}
 }
 
+void VoxelData::set_block_window(unsigned int lod_index, Box3i blocks_box) {
+	ZN_ASSERT_RETURN(lod_index < _lods.size());
+	Lod &lod = _lods[lod_index];
+	RWLockWrite wlock(lod.map_lock);
+	lod.map.set_window(blocks_box);
+}
+
 bool VoxelData::consume_block_modifications(Vector3i bpos, VoxelData::BlockToSave &out_to_save) {
 	Lod &lod = _lods[0];
 	RWLockRead rlock(lod.map_lock);
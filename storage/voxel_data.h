@@ -210,6 +210,10 @@ public:
 	// their data will be returned for the caller to save.
 	void unload_blocks(Span<const Vector3i> positions, std::vector<BlockToSave> *to_save);
 
+	// Sets the area of blocks most likely to be accessed in the given LOD, typically around the viewer, so they can be
+	// looked up faster. See `VoxelDataMap::set_window`.
+	void set_block_window(unsigned int lod_index, Box3i blocks_box);
+
 	// If the block at the specified LOD0 position exists and is modified, marks it as non-modified and returns a copy
 	// of its data to save. Returns true if there is something to save.
 	bool consume_block_modifications(Vector3i bpos, BlockToSave &out_to_save);
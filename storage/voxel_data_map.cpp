@@ -62,7 +62,7 @@ VoxelDataBlock *VoxelDataMap::create_default_block(Vector3i bpos) {
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT_RETURN_V(!has_block(bpos), nullptr);
 #endif
-	VoxelDataBlock &map_block = _blocks_map[bpos];
+	VoxelDataBlock &map_block = get_or_insert_block(bpos);
 	// TODO Clang complains the `move` prevents copy elision.
 	// But I dont want `VoxelDataBlock` to have copy... so what, should I add [expensive] copy construction just so
 	// clang is able to elide it?
@@ -111,19 +111,26 @@ void VoxelDataMap::set_voxel_f(real_t value, Vector3i pos, unsigned int c) {
 }
 
 VoxelDataBlock *VoxelDataMap::get_block(Vector3i bpos) {
-	auto it = _blocks_map.find(bpos);
-	if (it != _blocks_map.end()) {
-		return &it->second;
+	if (_window_box.contains(bpos)) {
+		return _window_blocks[get_window_index(bpos)];
 	}
-	return nullptr;
+	return _blocks_map.find(bpos);
 }
 
 const VoxelDataBlock *VoxelDataMap::get_block(Vector3i bpos) const {
-	auto it = _blocks_map.find(bpos);
-	if (it != _blocks_map.end()) {
-		return &it->second;
+	if (_window_box.contains(bpos)) {
+		return _window_blocks[get_window_index(bpos)];
 	}
-	return nullptr;
+	return _blocks_map.find(bpos);
+}
+
+VoxelDataBlock &VoxelDataMap::get_or_insert_block(Vector3i bpos) {
+	VoxelDataBlock &block = _blocks_map.get_or_insert(bpos);
+	if (_window_box.contains(bpos)) {
+		// Blocks don't move in memory, so they can be referenced until removed
+		_window_blocks[get_window_index(bpos)] = &block;
+	}
+	return block;
 }
 
 VoxelDataBlock *VoxelDataMap::set_block_buffer(
@@ -133,7 +140,7 @@ VoxelDataBlock *VoxelDataMap::set_block_buffer(
 	VoxelDataBlock *block = get_block(bpos);
 
 	if (block == nullptr) {
-		VoxelDataBlock &map_block = _blocks_map[bpos];
+		VoxelDataBlock &map_block = get_or_insert_block(bpos);
 		map_block = std::move(VoxelDataBlock(buffer, _lod_index));
 		block = &map_block;
 
@@ -153,14 +160,14 @@ void VoxelDataMap::set_block(Vector3i bpos, const VoxelDataBlock &block) {
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT(block.get_lod_index() == _lod_index);
 #endif
-	_blocks_map[bpos] = block;
+	get_or_insert_block(bpos) = block;
 }
 
 VoxelDataBlock *VoxelDataMap::set_empty_block(Vector3i bpos, bool overwrite) {
 	VoxelDataBlock *block = get_block(bpos);
 
 	if (block == nullptr) {
-		VoxelDataBlock &map_block = _blocks_map[bpos];
+		VoxelDataBlock &map_block = get_or_insert_block(bpos);
 		map_block = std::move(VoxelDataBlock(_lod_index));
 		block = &map_block;
 
@@ -177,7 +184,7 @@ VoxelDataBlock *VoxelDataMap::set_empty_block(Vector3i bpos, bool overwrite) {
 }
 
 bool VoxelDataMap::has_block(Vector3i pos) const {
-	return _blocks_map.find(pos) != _blocks_map.end();
+	return get_block(pos) != nullptr;
 }
 
 bool VoxelDataMap::is_block_surrounded(Vector3i pos) const {
@@ -325,6 +332,9 @@ void VoxelDataMap::paste(Vector3i min_pos, const VoxelBufferInternal &src_buffer
 
 void VoxelDataMap::clear() {
 	_blocks_map.clear();
+	for (VoxelDataBlock *&block : _window_blocks) {
+		block = nullptr;
+	}
 }
 
 int VoxelDataMap::get_block_count() const {
@@ -338,4 +348,54 @@ bool VoxelDataMap::is_area_fully_loaded(const Box3i voxels_box) const {
 	});
 }
 
+void VoxelDataMap::set_window(Box3i blocks_box) {
+	ZN_PROFILE_SCOPE();
+	if (blocks_box == _window_box) {
+		return;
+	}
+
+	// Beyond this, the grid would take a lot of memory and updating it would take longer than what it saves
+	static const unsigned int MAX_WINDOW_VOLUME = 1 << 18;
+
+	const Vector3i grid_po2(math::get_next_power_of_two_32_shift(blocks_box.size.x),
+			math::get_next_power_of_two_32_shift(blocks_box.size.y),
+			math::get_next_power_of_two_32_shift(blocks_box.size.z));
+	const unsigned int grid_volume = 1 << (grid_po2.x + grid_po2.y + grid_po2.z);
+
+	if (Vector3iUtil::is_empty_size(blocks_box.size) || grid_volume > MAX_WINDOW_VOLUME) {
+		clear_window();
+		return;
+	}
+
+	if (grid_po2 != _window_grid_po2 || Vector3iUtil::is_empty_size(_window_box.size)) {
+		// The layout of the grid changes, all cells have to be found again
+		_window_grid_po2 = grid_po2;
+		_window_grid_mask = Vector3i((1 << grid_po2.x) - 1, (1 << grid_po2.y) - 1, (1 << grid_po2.z) - 1);
+		_window_blocks.clear();
+		_window_blocks.resize(grid_volume, nullptr);
+		_window_box = blocks_box;
+		blocks_box.for_each_cell_zxy([this](Vector3i bpos) { //
+			_window_blocks[get_window_index(bpos)] = _blocks_map.find(bpos);
+		});
+		return;
+	}
+
+	// Cells of positions that were already in the window are still valid. The others may contain blocks of positions
+	// that left the window.
+	const Box3i prev_box = _window_box;
+	_window_box = blocks_box;
+	blocks_box.difference(prev_box, [this](Box3i entering_box) {
+		entering_box.for_each_cell_zxy([this](Vector3i bpos) { //
+			_window_blocks[get_window_index(bpos)] = _blocks_map.find(bpos);
+		});
+	});
+}
+
+void VoxelDataMap::clear_window() {
+	_window_box = Box3i();
+	_window_blocks.clear();
+	_window_grid_mask = Vector3i();
+	_window_grid_po2 = Vector3i();
+}
+
 } // namespace zylann::voxel
@@ -1,12 +1,11 @@
 #ifndef VOXEL_DATA_MAP_H
 #define VOXEL_DATA_MAP_H
 
+#include "../util/block_hash_map.h"
 #include "../util/fixed_array.h"
 #include "../util/profiling.h"
 #include "voxel_data_block.h"
 
-#include <unordered_map>
-
 namespace zylann::voxel {
 
 class VoxelGenerator;
@@ -94,10 +93,13 @@ public:
 
 	template <typename Action_T>
 	void remove_block(Vector3i bpos, Action_T pre_delete) {
-		auto it = _blocks_map.find(bpos);
-		if (it != _blocks_map.end()) {
-			pre_delete(it->second);
-			_blocks_map.erase(it);
+		VoxelDataBlock *block = _blocks_map.find(bpos);
+		if (block != nullptr) {
+			pre_delete(*block);
+			_blocks_map.erase(bpos);
+			if (_window_box.contains(bpos)) {
+				_window_blocks[get_window_index(bpos)] = nullptr;
+			}
 		}
 	}
 
@@ -114,21 +116,28 @@ public:
 	// op(Vector3i bpos, VoxelDataBlock &block)
 	template <typename Op_T>
 	inline void for_each_block(Op_T op) {
-		for (auto it = _blocks_map.begin(); it != _blocks_map.end(); ++it) {
-			op(it->first, it->second);
-		}
+		_blocks_map.for_each(op);
 	}
 
 	// void op(Vector3i bpos, const VoxelDataBlock &block)
 	template <typename Op_T>
 	inline void for_each_block(Op_T op) const {
-		for (auto it = _blocks_map.begin(); it != _blocks_map.end(); ++it) {
-			op(it->first, it->second);
-		}
+		_blocks_map.for_each(op);
 	}
 
 	bool is_area_fully_loaded(const Box3i voxels_box) const;
 
+	// Indexes blocks within an area (in block coordinates) with a dense grid, so looking them up doesn't need hashing.
+	// This is meant for the area around a viewer, where most accesses happen. The grid wraps around, so moving the
+	// area only updates the cells that enter it. Blocks outside of it are still found, only slower.
+	// If the area is too large, no grid is used.
+	void set_window(Box3i blocks_box);
+	void clear_window();
+
+	inline Box3i get_window() const {
+		return _window_box;
+	}
+
 	template <typename F>
 	inline void write_box(const Box3i &voxel_box, unsigned int channel, F action) {
 		write_box(voxel_box, channel, action, [](const VoxelBufferInternal &, const Vector3i &) {});
@@ -184,16 +193,31 @@ private:
 	// void set_block(Vector3i bpos, VoxelDataBlock *block);
 	VoxelDataBlock *get_or_create_block_at_voxel_pos(Vector3i pos);
 	VoxelDataBlock *create_default_block(Vector3i bpos);
+	VoxelDataBlock &get_or_insert_block(Vector3i bpos);
+
+	// Cells are found with masks, so the grid has power-of-two sizes. It can be larger than the window.
+	inline unsigned int get_window_index(Vector3i bpos) const {
+		const unsigned int x = bpos.x & _window_grid_mask.x;
+		const unsigned int y = bpos.y & _window_grid_mask.y;
+		const unsigned int z = bpos.z & _window_grid_mask.z;
+		return y | (x << _window_grid_po2.y) | (z << (_window_grid_po2.y + _window_grid_po2.x));
+	}
 
 	// void set_block_size_pow2(unsigned int p);
 
 private:
 	// Blocks stored with a spatial hash in all 3D directions.
-	// Before I used Godot 3's HashMap with RELATIONSHIP = 2 because that delivers better performance compared to
-	// defaults, but it sometimes has very long stalls on removal, which std::unordered_map doesn't seem to have
-	// (not as badly). Also overall performance is slightly better.
-	// Note: pointers to elements remain valid when inserting or removing others (only iterators may be invalidated)
-	std::unordered_map<Vector3i, VoxelDataBlock> _blocks_map;
+	// Before I used Godot 3's HashMap with RELATIONSHIP = 2, then std::unordered_map, which allocates a node per block
+	// and has to follow pointers on every lookup. The flat map avoids both, and removal doesn't stall.
+	// Note: pointers to elements remain valid when inserting or removing others
+	BlockHashMap<VoxelDataBlock> _blocks_map;
+
+	// Blocks in the window, pointing inside `_blocks_map`. Null cells mean there is no block at that position.
+	// Only cells of positions inside `_window_box` are valid. If the box is empty, there is no window.
+	std::vector<VoxelDataBlock *> _window_blocks;
+	Box3i _window_box;
+	Vector3i _window_grid_mask;
+	Vector3i _window_grid_po2;
 
 	// This was a possible optimization in a single-threaded scenario, but it's not in multithread.
 	// We want to be able to do shared read-accesses but this is a mutable variable.
@@ -4,10 +4,14 @@
 #include "../util/profiling.h"
 #include "../util/string_funcs.h"
 
+#include <algorithm>
+
 namespace zylann::voxel {
 
 namespace {
 VoxelMemoryPool *g_memory_pool = nullptr;
+// Guards registration of thread caches, which can outlive or be outlived by the pool they are registered to
+BinaryMutex g_thread_caches_mutex;
 } // namespace
 
 void VoxelMemoryPool::create_singleton() {
@@ -62,8 +66,8 @@ void VoxelMemoryPool::debug_print_used_blocks(unsigned int max_count) {
 	};
 
 	unsigned int count = 0;
-	for (unsigned int pool_index = 0; pool_index < _pot_pools.size(); ++pool_index) {
-		const Pool &pool = _pot_pools[pool_index];
+	for (unsigned int pool_index = 0; pool_index < _pools.size(); ++pool_index) {
+		const Pool &pool = _pools[pool_index];
 		L::debug_print_used_blocks(pool.debug_used_blocks, count, max_count, get_size_from_pool_index(pool_index));
 	}
 	L::debug_print_used_blocks(_debug_nonpooled_used_blocks, count, max_count, 0);
@@ -78,7 +82,31 @@ VoxelMemoryPool &VoxelMemoryPool::get_singleton() {
 	return *g_memory_pool;
 }
 
-VoxelMemoryPool::VoxelMemoryPool() {}
+VoxelMemoryPool::VoxelMemoryPool() {
+	for (unsigned int pot = 0; pot < POT_POOL_COUNT; ++pot) {
+		_pools[pot].block_size = size_t(1) << pot;
+	}
+
+	unsigned int exact_index = 0;
+	for (const unsigned int block_size : { 16, 32 }) {
+		for (const unsigned int padding : { 2, 3 }) {
+			const size_t volume = math::cubed(size_t(block_size + padding));
+			for (const unsigned int bytes_per_voxel : { 1, 2 }) {
+				const size_t size = volume * bytes_per_voxel;
+				ZN_ASSERT(!math::is_power_of_two(size));
+				_exact_sizes[exact_index] = size;
+				_pools[POT_POOL_COUNT + exact_index].block_size = size;
+				++exact_index;
+			}
+		}
+	}
+	ZN_ASSERT(exact_index == EXACT_POOL_COUNT);
+
+	for (unsigned int pool_index = 0; pool_index < _pools.size(); ++pool_index) {
+		Pool &pool = _pools[pool_index];
+		pool.magazine_capacity = math::min(size_t(MAGAZINE_MAX_BLOCKS), MAGAZINE_MAX_BYTES / pool.block_size);
+	}
+}
 
 VoxelMemoryPool::~VoxelMemoryPool() {
 #ifdef TOOLS_ENABLED
@@ -89,6 +117,65 @@ VoxelMemoryPool::~VoxelMemoryPool() {
 	clear();
 }
 
+VoxelMemoryPool::ThreadCache::~ThreadCache() {
+	MutexLock lock(g_thread_caches_mutex);
+	if (pool != nullptr) {
+		pool->release_thread_cache(*this);
+	}
+}
+
+VoxelMemoryPool::ThreadCache &VoxelMemoryPool::get_thread_cache() {
+	static thread_local ThreadCache tls_cache;
+	if (tls_cache.pool != this) {
+		// First use in this thread
+		MutexLock lock(g_thread_caches_mutex);
+		ZN_ASSERT(tls_cache.pool == nullptr);
+		tls_cache.pool = this;
+		_thread_caches.push_back(&tls_cache);
+	}
+	return tls_cache;
+}
+
+// Must be called with `g_thread_caches_mutex` locked
+void VoxelMemoryPool::release_thread_cache(ThreadCache &cache) {
+	ZN_ASSERT(cache.pool == this);
+	for (unsigned int pool_index = 0; pool_index < cache.magazines.size(); ++pool_index) {
+		Magazine &mag = cache.magazines[pool_index];
+		release_blocks(pool_index, to_span(mag.blocks, mag.count));
+		mag.count = 0;
+	}
+	for (size_t i = 0; i < _thread_caches.size(); ++i) {
+		if (_thread_caches[i] == &cache) {
+			_thread_caches[i] = _thread_caches.back();
+			_thread_caches.pop_back();
+			break;
+		}
+	}
+	cache.pool = nullptr;
+}
+
+// Gives free blocks back to the shared pool, or to the OS if memory is above limits
+void VoxelMemoryPool::release_blocks(unsigned int pool_index, Span<uint8_t *> blocks) {
+	if (blocks.size() == 0) {
+		return;
+	}
+	if (is_over_memory_limits()) {
+		free_blocks(pool_index, blocks);
+	} else {
+		Pool &pool = _pools[pool_index];
+		MutexLock lock(pool.mutex);
+		pool.blocks.insert(pool.blocks.end(), blocks.data(), blocks.data() + blocks.size());
+	}
+}
+
+// Frees unused blocks
+void VoxelMemoryPool::free_blocks(unsigned int pool_index, Span<uint8_t *> blocks) {
+	for (uint8_t *block : blocks) {
+		ZN_FREE(block);
+	}
+	_total_memory -= get_size_from_pool_index(pool_index) * blocks.size();
+}
+
 uint8_t *VoxelMemoryPool::allocate(size_t size) {
 	ZN_DSTACK();
 	ZN_PROFILE_SCOPE();
@@ -99,36 +186,63 @@ uint8_t *VoxelMemoryPool::allocate(size_t size) {
 	ZN_ASSERT_RETURN_V(size != 0, nullptr);
 
 	uint8_t *block = nullptr;
+	size_t capacity = size;
 	// Not calculating `pot` immediately because the function we use to calculate it uses 32 bits,
 	// while `size_t` can be larger than that.
 	if (size > get_highest_supported_size()) {
 		// Sorry, memory is not pooled past this size
 		block = (uint8_t *)ZN_ALLOC(size * sizeof(uint8_t));
-		_total_memory += size;
-#ifdef DEBUG_ENABLED
 		if (block != nullptr) {
+			_total_memory += size;
+#ifdef DEBUG_ENABLED
 			_debug_nonpooled_used_blocks.add(block);
-		}
 #endif
+		}
 	} else {
-		const unsigned int pot = get_pool_index_from_size(size);
-		Pool &pool = _pot_pools[pot];
-		pool.mutex.lock();
-		if (pool.blocks.size() > 0) {
-			block = pool.blocks.back();
-			pool.blocks.pop_back();
-			pool.mutex.unlock();
-		} else {
-			pool.mutex.unlock();
-			ZN_PROFILE_SCOPE_NAMED("new alloc");
-			// All allocations done in this pool have the same size,
-			// which must be greater or equal to `size`
-			const size_t capacity = get_size_from_pool_index(pot);
+		const unsigned int pool_index = get_pool_index_from_size(size);
+		Pool &pool = _pools[pool_index];
+		// All allocations done in this pool have the same size,
+		// which must be greater or equal to `size`
+		capacity = pool.block_size;
 #ifdef DEBUG_ENABLED
-			ZN_ASSERT(capacity >= size);
+		ZN_ASSERT(capacity >= size);
 #endif
+		const unsigned int magazine_capacity = pool.magazine_capacity;
+
+		if (magazine_capacity > 0) {
+			Magazine &mag = get_thread_cache().magazines[pool_index];
+			if (mag.count == 0) {
+				// Refill half of the magazine at once, so the next allocations don't have to lock
+				pool.last_use_tick.store(_trim_tick, std::memory_order_relaxed);
+				MutexLock lock(pool.mutex);
+				const unsigned int refill_count =
+						math::min(static_cast<unsigned int>(pool.blocks.size()), math::max(magazine_capacity / 2, 1u));
+				for (unsigned int i = 0; i < refill_count; ++i) {
+					mag.blocks[mag.count] = pool.blocks.back();
+					++mag.count;
+					pool.blocks.pop_back();
+				}
+			}
+			if (mag.count > 0) {
+				--mag.count;
+				block = mag.blocks[mag.count];
+			}
+
+		} else {
+			pool.last_use_tick.store(_trim_tick, std::memory_order_relaxed);
+			MutexLock lock(pool.mutex);
+			if (pool.blocks.size() > 0) {
+				block = pool.blocks.back();
+				pool.blocks.pop_back();
+			}
+		}
+
+		if (block == nullptr) {
+			ZN_PROFILE_SCOPE_NAMED("new alloc");
 			block = (uint8_t *)ZN_ALLOC(capacity * sizeof(uint8_t));
-			_total_memory += size;
+			if (block != nullptr) {
+				_total_memory += capacity;
+			}
 		}
 #ifdef DEBUG_ENABLED
 		if (block != nullptr) {
@@ -140,7 +254,7 @@ uint8_t *VoxelMemoryPool::allocate(size_t size) {
 		ZN_PRINT_ERROR("Out of memory");
 	} else {
 		++_used_blocks;
-		_used_memory += size;
+		_used_memory += capacity;
 	}
 	return block;
 }
@@ -160,37 +274,143 @@ void VoxelMemoryPool::recycle(uint8_t *block, size_t size) {
 		_debug_nonpooled_used_blocks.remove(block);
 #endif
 		ZN_FREE(block);
+		--_used_blocks;
+		_used_memory -= size;
 		_total_memory -= size;
 	} else {
-		const unsigned int pot = get_pool_index_from_size(size);
-		Pool &pool = _pot_pools[pot];
+		const unsigned int pool_index = get_pool_index_from_size(size);
+		Pool &pool = _pools[pool_index];
 #ifdef DEBUG_ENABLED
 		// Make sure this allocation was done by this pool in this scenario
 		pool.debug_used_blocks.remove(block);
 #endif
-		MutexLock lock(pool.mutex);
-		pool.blocks.push_back(block);
+		// Update counts first, so the block is accounted as unused when deciding whether to keep it
+		--_used_blocks;
+		_used_memory -= pool.block_size;
+
+		const unsigned int magazine_capacity = pool.magazine_capacity;
+
+		if (magazine_capacity > 0) {
+			Magazine &mag = get_thread_cache().magazines[pool_index];
+			if (mag.count == magazine_capacity) {
+				// Move the oldest half of the magazine to the shared pool at once
+				const unsigned int flush_count = math::max(magazine_capacity / 2, 1u);
+				release_blocks(pool_index, to_span(mag.blocks, flush_count));
+				for (unsigned int i = flush_count; i < mag.count; ++i) {
+					mag.blocks[i - flush_count] = mag.blocks[i];
+				}
+				mag.count -= flush_count;
+			}
+			mag.blocks[mag.count] = block;
+			++mag.count;
+
+		} else {
+			release_blocks(pool_index, Span<uint8_t *>(&block, 1));
+		}
 	}
-	--_used_blocks;
-	_used_memory -= size;
 }
 
 void VoxelMemoryPool::clear_unused_blocks() {
-	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
-		Pool &pool = _pot_pools[pot];
+	// Other threads' caches can't be touched safely, but the caller's can
+	ThreadCache &cache = get_thread_cache();
+	for (unsigned int pool_index = 0; pool_index < cache.magazines.size(); ++pool_index) {
+		Magazine &mag = cache.magazines[pool_index];
+		free_blocks(pool_index, to_span(mag.blocks, mag.count));
+		mag.count = 0;
+	}
+
+	for (unsigned int pool_index = 0; pool_index < _pools.size(); ++pool_index) {
+		Pool &pool = _pools[pool_index];
 		MutexLock lock(pool.mutex);
-		for (unsigned int i = 0; i < pool.blocks.size(); ++i) {
-			void *block = pool.blocks[i];
-			ZN_FREE(block);
-		}
-		_total_memory -= get_size_from_pool_index(pot) * pool.blocks.size();
+		free_blocks(pool_index, to_span(pool.blocks));
 		pool.blocks.clear();
 	}
 }
 
+void VoxelMemoryPool::set_unused_memory_high_water_mark(size_t bytes) {
+	_unused_memory_high_water_mark = bytes;
+}
+
+size_t VoxelMemoryPool::get_unused_memory_high_water_mark() const {
+	return _unused_memory_high_water_mark;
+}
+
+void VoxelMemoryPool::set_memory_budget(size_t bytes) {
+	_memory_budget = bytes;
+}
+
+size_t VoxelMemoryPool::get_memory_budget() const {
+	return _memory_budget;
+}
+
+void VoxelMemoryPool::trim() {
+	ZN_PROFILE_SCOPE();
+	++_trim_tick;
+
+	const size_t budget = _memory_budget;
+	if (budget == 0 || _total_memory <= budget) {
+		return;
+	}
+
+	// Visit pools from the least recently used
+	FixedArray<unsigned int, POOL_COUNT> pool_indices;
+	FixedArray<uint32_t, POOL_COUNT> last_use_ticks;
+	for (unsigned int i = 0; i < _pools.size(); ++i) {
+		pool_indices[i] = i;
+		last_use_ticks[i] = _pools[i].last_use_tick.load(std::memory_order_relaxed);
+	}
+	std::sort(pool_indices.data(), pool_indices.data() + pool_indices.size(),
+			[&last_use_ticks](unsigned int a, unsigned int b) { return last_use_ticks[a] < last_use_ticks[b]; });
+
+	for (const unsigned int pool_index : pool_indices) {
+		const size_t total_memory = _total_memory;
+		if (total_memory <= budget) {
+			break;
+		}
+		const size_t excess = total_memory - budget;
+
+		Pool &pool = _pools[pool_index];
+		MutexLock lock(pool.mutex);
+		// Blocks at the front are those that have been unused for the longest time
+		const size_t count = math::min(pool.blocks.size(), (excess + pool.block_size - 1) / pool.block_size);
+		if (count == 0) {
+			continue;
+		}
+		free_blocks(pool_index, to_span_from_position_and_size(pool.blocks, 0, count));
+		pool.blocks.erase(pool.blocks.begin(), pool.blocks.begin() + count);
+		_trimmed_memory += count * pool.block_size;
+	}
+}
+
+VoxelMemoryPool::Stats VoxelMemoryPool::get_stats() const {
+	Stats stats;
+	stats.used_memory = _used_memory;
+	stats.total_memory = _total_memory;
+	stats.memory_budget = _memory_budget;
+	stats.trimmed_memory = _trimmed_memory;
+	stats.used_blocks = _used_blocks;
+	return stats;
+}
+
 void VoxelMemoryPool::clear() {
-	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
-		Pool &pool = _pot_pools[pot];
+	{
+		// Threads are not supposed to use the pool anymore at this point, so it is safe to access their caches
+		MutexLock lock(g_thread_caches_mutex);
+		for (ThreadCache *cache : _thread_caches) {
+			for (unsigned int pool_index = 0; pool_index < cache->magazines.size(); ++pool_index) {
+				Magazine &mag = cache->magazines[pool_index];
+				for (unsigned int i = 0; i < mag.count; ++i) {
+					ZN_FREE(mag.blocks[i]);
+				}
+				mag.count = 0;
+			}
+			// If the thread exits later, its cache won't try to access this pool
+			cache->pool = nullptr;
+		}
+		_thread_caches.clear();
+	}
+	for (unsigned int pool_index = 0; pool_index < _pools.size(); ++pool_index) {
+		Pool &pool = _pools[pool_index];
 		MutexLock lock(pool.mutex);
 		for (unsigned int i = 0; i < pool.blocks.size(); ++i) {
 			void *block = pool.blocks[i];
@@ -205,10 +425,11 @@ void VoxelMemoryPool::clear() {
 
 void VoxelMemoryPool::debug_print() {
 	println("-------- VoxelMemoryPool ----------");
-	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
-		Pool &pool = _pot_pools[pot];
+	for (unsigned int pool_index = 0; pool_index < _pools.size(); ++pool_index) {
+		Pool &pool = _pools[pool_index];
 		MutexLock lock(pool.mutex);
-		println(format("Pool {}: {} blocks (capacity {})", pot, pool.blocks.size(), pool.blocks.capacity()));
+		println(format("Pool {} ({} bytes): {} blocks (capacity {})", pool_index, pool.block_size, pool.blocks.size(),
+				pool.blocks.capacity()));
 	}
 }
 
@@ -4,6 +4,7 @@
 #include "../util/dstack.h"
 #include "../util/fixed_array.h"
 #include "../util/math/funcs.h"
+#include "../util/span.h"
 #include "../util/thread/mutex.h"
 
 #include <atomic>
@@ -18,8 +19,25 @@ namespace zylann::voxel {
 // The majority of VoxelBuffers use powers of two so most of the time
 // we won't waste memory. Sometimes non-power-of-two buffers are created,
 // but they are often temporary and less numerous.
+// A few non-power-of-two sizes are common enough to get their own "exact" pool, such as padded buffers sent to
+// meshers, which would otherwise waste up to half of their memory.
+// Each thread also has a small cache of free blocks in front of each pool, so most allocations and recycles don't need
+// to lock anything.
+// Unused blocks can be kept within a memory budget. When total memory goes above it, unused blocks are freed, starting
+// with pools that were used the least recently.
 class VoxelMemoryPool {
 private:
+	// We handle allocations with up to 2^20 = 1,048,576 bytes.
+	// This is chosen based on practical needs.
+	static const unsigned int POT_POOL_COUNT = 21;
+	// Block sizes 16 and 32, with paddings of 2 (blocky mesher) and 3 (transvoxel), with 8-bit and 16-bit channels
+	static const unsigned int EXACT_POOL_COUNT = 8;
+	static const unsigned int POOL_COUNT = POT_POOL_COUNT + EXACT_POOL_COUNT;
+
+	// Bounds how many free blocks each thread can hoard, per pool
+	static const unsigned int MAGAZINE_MAX_BLOCKS = 16;
+	static const unsigned int MAGAZINE_MAX_BYTES = 256 * 1024;
+
 #ifdef DEBUG_ENABLED
 	struct DebugUsedBlocks {
 		Mutex mutex;
@@ -43,16 +61,48 @@ private:
 	};
 #endif
 
+	// Shared pool of free blocks, also called "depot"
 	struct Pool {
 		Mutex mutex;
 		// Would a linked list be better?
+		// Blocks are appended when recycled, so the front contains those that have been unused for the longest time.
 		std::vector<uint8_t *> blocks;
+		// Size of every block allocated from this pool
+		size_t block_size = 0;
+		unsigned int magazine_capacity = 0;
+		// Value of the trimming clock when blocks were last taken from this pool
+		std::atomic_uint32_t last_use_tick = { 0 };
 #ifdef DEBUG_ENABLED
 		DebugUsedBlocks debug_used_blocks;
 #endif
 	};
 
+	// Per-thread stack of free blocks of one size, only accessed by its thread.
+	// When it runs empty it gets refilled from the shared pool, and when it is full, half of it goes back to the shared
+	// pool, so locking happens once per batch of blocks.
+	struct Magazine {
+		FixedArray<uint8_t *, MAGAZINE_MAX_BLOCKS> blocks;
+		unsigned int count = 0;
+	};
+
+	struct ThreadCache {
+		FixedArray<Magazine, POOL_COUNT> magazines;
+		// Pool this cache is registered to. Guarded by a global mutex.
+		VoxelMemoryPool *pool = nullptr;
+
+		~ThreadCache();
+	};
+
 public:
+	struct Stats {
+		size_t used_memory = 0;
+		size_t total_memory = 0;
+		size_t memory_budget = 0;
+		// Total amount of memory freed because of the budget since the pool was created
+		size_t trimmed_memory = 0;
+		unsigned int used_blocks = 0;
+	};
+
 	static void create_singleton();
 	static void destroy_singleton();
 	static VoxelMemoryPool &get_singleton();
@@ -63,8 +113,26 @@ public:
 	uint8_t *allocate(size_t size);
 	void recycle(uint8_t *block, size_t size);
 
+	// Frees blocks that are not in use, except those cached by threads other than the caller.
 	void clear_unused_blocks();
 
+	// When the amount of memory held by unused blocks goes above this limit, recycled blocks are freed instead of being
+	// kept for later use. 0 means no limit.
+	void set_unused_memory_high_water_mark(size_t bytes);
+	size_t get_unused_memory_high_water_mark() const;
+
+	// When total memory goes above this budget, unused blocks get freed instead of being kept, and `trim()` frees
+	// unused blocks of the least recently used pools. Memory in use is never affected, so the budget can still be
+	// exceeded. 0 means no limit.
+	void set_memory_budget(size_t bytes);
+	size_t get_memory_budget() const;
+
+	// Frees unused blocks until total memory is back within budget, if possible. Blocks cached by threads are not
+	// affected. Meant to be called periodically, also serves as the clock for finding least recently used pools.
+	void trim();
+
+	Stats get_stats() const;
+
 	void debug_print();
 	unsigned int debug_get_used_blocks() const;
 	size_t debug_get_used_memory() const;
@@ -73,11 +141,31 @@ public:
 private:
 	void clear();
 
-	inline size_t get_highest_supported_size() const {
-		return size_t(1) << (_pot_pools.size() - 1);
+	ThreadCache &get_thread_cache();
+	void release_thread_cache(ThreadCache &cache);
+	void release_blocks(unsigned int pool_index, Span<uint8_t *> blocks);
+	void free_blocks(unsigned int pool_index, Span<uint8_t *> blocks);
+
+	inline bool is_over_memory_limits() const {
+		const size_t total_memory = _total_memory;
+		const size_t memory_budget = _memory_budget;
+		const size_t used_memory = _used_memory;
+		const size_t high_water_mark = _unused_memory_high_water_mark;
+		// Counters are not updated together, so the used memory can briefly appear larger than the total
+		return (memory_budget != 0 && total_memory > memory_budget) ||
+				(high_water_mark != 0 && total_memory > used_memory && total_memory - used_memory > high_water_mark);
+	}
+
+	static inline size_t get_highest_supported_size() {
+		return size_t(1) << (POT_POOL_COUNT - 1);
 	}
 
 	inline unsigned int get_pool_index_from_size(size_t size) const {
+		for (unsigned int i = 0; i < _exact_sizes.size(); ++i) {
+			if (_exact_sizes[i] == size) {
+				return POT_POOL_COUNT + i;
+			}
+		}
 #ifdef DEBUG_ENABLED
 		// `get_next_power_of_two_32` takes unsigned int
 		ZN_ASSERT(size <= std::numeric_limits<unsigned int>::max());
@@ -85,26 +173,35 @@ private:
 		return math::get_shift_from_power_of_two_32(math::get_next_power_of_two_32(size));
 	}
 
-	static inline size_t get_size_from_pool_index(unsigned int i) {
-		return size_t(1) << i;
+	inline size_t get_size_from_pool_index(unsigned int i) const {
+		return _pools[i].block_size;
 	}
 
 #ifdef DEBUG_ENABLED
 	void debug_print_used_blocks(unsigned int max_amount);
 #endif
 
-	// We handle allocations with up to 2^20 = 1,048,576 bytes.
-	// This is chosen based on practical needs.
-	// Each slot in this array corresponds to allocations
-	// that contain 2^index bytes in them.
-	FixedArray<Pool, 21> _pot_pools;
+	// The first slots in this array correspond to allocations that contain 2^index bytes in them.
+	// The last slots correspond to allocations with sizes found in `_exact_sizes`.
+	FixedArray<Pool, POOL_COUNT> _pools;
+	FixedArray<size_t, EXACT_POOL_COUNT> _exact_sizes;
 #ifdef DEBUG_ENABLED
 	DebugUsedBlocks _debug_nonpooled_used_blocks;
 #endif
 
+	// Thread caches registered to this pool, guarded by a global mutex
+	std::vector<ThreadCache *> _thread_caches;
+
+	// Memory is accounted with the actual capacity of blocks, so `_total_memory - _used_memory` is exactly what is
+	// held by unused blocks.
 	std::atomic_uint32_t _used_blocks = { 0 };
-	size_t _used_memory = 0;
-	size_t _total_memory = 0;
+	std::atomic<size_t> _used_memory = { 0 };
+	std::atomic<size_t> _total_memory = { 0 };
+	std::atomic<size_t> _unused_memory_high_water_mark = { 0 };
+	std::atomic<size_t> _memory_budget = { 0 };
+	std::atomic<size_t> _trimmed_memory = { 0 };
+	// Incremented each time `trim()` is called
+	std::atomic_uint32_t _trim_tick = { 0 };
 };
 
 } // namespace zylann::voxel
@@ -1,10 +1,16 @@
 #include "compressed_data.h"
 #include "../thirdparty/lz4/lz4.h"
+#include "../util/math/funcs.h"
 #include "../util/profiling.h"
 #include "../util/serialization.h"
 #include "../util/string_funcs.h"
 
+// When building as a module, this is the copy that comes with Godot. Otherwise it is the one in `thirdparty/zstd`.
+#include <zstd.h>
+
+#include <algorithm>
 #include <limits>
+#include <unordered_map>
 
 namespace zylann::voxel::CompressedData {
 
@@ -28,7 +34,104 @@ bool decompress_lz4(MemoryReader &f, Span<const uint8_t> src, std::vector<uint8_
 	return true;
 }
 
-bool decompress(Span<const uint8_t> src, std::vector<uint8_t> &dst) {
+namespace {
+
+// Zstandard contexts hold temporary memory that can be reused between calls, but can't be used by multiple threads
+struct ZstdContexts {
+	ZSTD_CCtx *cctx = nullptr;
+	ZSTD_DCtx *dctx = nullptr;
+
+	~ZstdContexts() {
+		ZSTD_freeCCtx(cctx);
+		ZSTD_freeDCtx(dctx);
+	}
+};
+
+ZstdContexts &get_tls_zstd_contexts() {
+	thread_local ZstdContexts tls_contexts;
+	return tls_contexts;
+}
+
+ZSTD_CCtx *get_tls_zstd_cctx() {
+	ZstdContexts &contexts = get_tls_zstd_contexts();
+	if (contexts.cctx == nullptr) {
+		contexts.cctx = ZSTD_createCCtx();
+	}
+	return contexts.cctx;
+}
+
+ZSTD_DCtx *get_tls_zstd_dctx() {
+	ZstdContexts &contexts = get_tls_zstd_contexts();
+	if (contexts.dctx == nullptr) {
+		contexts.dctx = ZSTD_createDCtx();
+	}
+	return contexts.dctx;
+}
+
+} // namespace
+
+ZstdDictionary::ZstdDictionary(Span<const uint8_t> data, int compression_level) {
+	ZN_ASSERT(data.size() > 0);
+	_data.resize(data.size());
+	memcpy(_data.data(), data.data(), data.size());
+
+	_compression_level = math::clamp(compression_level, ZSTD_MIN_LEVEL, ZSTD_MAX_LEVEL);
+
+	// FNV-1a. Dictionaries made by `train_zstd_dictionary` are raw content, so Zstandard doesn't give them an ID.
+	uint32_t h = 2166136261u;
+	for (const uint8_t b : _data) {
+		h = (h ^ b) * 16777619u;
+	}
+	_id = (h == 0 ? 1 : h);
+
+	_cdict = ZSTD_createCDict(_data.data(), _data.size(), _compression_level);
+	_ddict = ZSTD_createDDict(_data.data(), _data.size());
+	ZN_ASSERT(_cdict != nullptr);
+	ZN_ASSERT(_ddict != nullptr);
+}
+
+ZstdDictionary::~ZstdDictionary() {
+	ZSTD_freeCDict(static_cast<ZSTD_CDict *>(_cdict));
+	ZSTD_freeDDict(static_cast<ZSTD_DDict *>(_ddict));
+}
+
+bool decompress_zstd(MemoryReader &f, Span<const uint8_t> src, std::vector<uint8_t> &dst,
+		const ZstdDictionary *zstd_dictionary) {
+	const uint32_t header_size = sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t);
+	ZN_ASSERT_RETURN_V(src.size() >= header_size, false);
+
+	const uint32_t decompressed_size = f.get_32();
+	const uint32_t dictionary_id = f.get_32();
+
+	const ZSTD_DDict *ddict = nullptr;
+	if (dictionary_id != 0) {
+		ZN_ASSERT_RETURN_V_MSG(zstd_dictionary != nullptr, false, "Data was compressed with a dictionary");
+		ZN_ASSERT_RETURN_V_MSG(zstd_dictionary->get_id() == dictionary_id, false,
+				format("Data was compressed with dictionary {}, got dictionary {}", dictionary_id,
+						zstd_dictionary->get_id()));
+		ddict = static_cast<const ZSTD_DDict *>(zstd_dictionary->get_ddict());
+	}
+
+	dst.resize(decompressed_size);
+
+	ZSTD_DCtx *dctx = get_tls_zstd_dctx();
+	ZN_ASSERT_RETURN_V(dctx != nullptr, false);
+
+	const size_t actually_decompressed_size = ddict != nullptr
+			? ZSTD_decompress_usingDDict(
+					  dctx, dst.data(), dst.size(), src.data() + header_size, src.size() - header_size, ddict)
+			: ZSTD_decompressDCtx(dctx, dst.data(), dst.size(), src.data() + header_size, src.size() - header_size);
+
+	ZN_ASSERT_RETURN_V_MSG(!ZSTD_isError(actually_decompressed_size), false,
+			format("Zstandard decompression error: {}", ZSTD_getErrorName(actually_decompressed_size)));
+
+	ZN_ASSERT_RETURN_V_MSG(actually_decompressed_size == decompressed_size, false,
+			format("Expected {} bytes, obtained {}", decompressed_size, actually_decompressed_size));
+
+	return true;
+}
+
+bool decompress(Span<const uint8_t> src, std::vector<uint8_t> &dst, const ZstdDictionary *zstd_dictionary) {
 	ZN_PROFILE_SCOPE();
 
 	MemoryReader f(src, ENDIANESS_LITTLE_ENDIAN);
@@ -54,6 +157,10 @@ bool decompress(Span<const uint8_t> src, std::vector<uint8_t> &dst) {
 			ZN_ASSERT_RETURN_V(decompress_lz4(f, src, dst), false);
 			break;
 
+		case COMPRESSION_ZSTD:
+			ZN_ASSERT_RETURN_V(decompress_zstd(f, src, dst, zstd_dictionary), false);
+			break;
+
 		default:
 			ZN_PRINT_ERROR("Invalid compression header");
 			return false;
@@ -81,9 +188,44 @@ bool compress_lz4(MemoryWriter &f, Span<const uint8_t> src, std::vector<uint8_t>
 	return true;
 }
 
+bool compress_zstd(MemoryWriter &f, Span<const uint8_t> src, std::vector<uint8_t> &dst, int level,
+		const ZstdDictionary *zstd_dictionary) {
+	ZN_ASSERT_RETURN_V(src.size() <= std::numeric_limits<uint32_t>::max(), false);
+
+	f.store_32(src.size());
+	f.store_32(zstd_dictionary != nullptr ? zstd_dictionary->get_id() : 0);
+
+	const uint32_t header_size = sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t);
+	dst.resize(header_size + ZSTD_compressBound(src.size()));
+
+	ZSTD_CCtx *cctx = get_tls_zstd_cctx();
+	ZN_ASSERT_RETURN_V(cctx != nullptr, false);
+
+	const size_t compressed_size = zstd_dictionary != nullptr
+			? ZSTD_compress_usingCDict(cctx, dst.data() + header_size, dst.size() - header_size, src.data(),
+					  src.size(), static_cast<const ZSTD_CDict *>(zstd_dictionary->get_cdict()))
+			: ZSTD_compressCCtx(
+					  cctx, dst.data() + header_size, dst.size() - header_size, src.data(), src.size(), level);
+
+	ZN_ASSERT_RETURN_V_MSG(!ZSTD_isError(compressed_size), false,
+			format("Zstandard compression error: {}", ZSTD_getErrorName(compressed_size)));
+
+	dst.resize(header_size + compressed_size);
+
+	return true;
+}
+
 bool compress(Span<const uint8_t> src, std::vector<uint8_t> &dst, Compression comp) {
+	Settings settings;
+	settings.compression = comp;
+	return compress(src, dst, settings);
+}
+
+bool compress(Span<const uint8_t> src, std::vector<uint8_t> &dst, const Settings &settings) {
 	ZN_PROFILE_SCOPE();
 
+	const Compression comp = settings.compression;
+
 	switch (comp) {
 		case COMPRESSION_NONE: {
 			dst.resize(src.size() + 1);
@@ -108,6 +250,14 @@ bool compress(Span<const uint8_t> src, std::vector<uint8_t> &dst, Compression co
 			compress_lz4(f, src, dst);
 		} break;
 
+		case COMPRESSION_ZSTD: {
+			dst.clear();
+			MemoryWriter f(dst, ENDIANESS_LITTLE_ENDIAN);
+			f.store_8(comp);
+			const int level = math::clamp(settings.zstd_level, ZSTD_MIN_LEVEL, ZSTD_MAX_LEVEL);
+			ZN_ASSERT_RETURN_V(compress_zstd(f, src, dst, level, settings.zstd_dictionary.get()), false);
+		} break;
+
 		default:
 			ZN_PRINT_ERROR("Invalid compression header");
 			return false;
@@ -116,4 +266,137 @@ bool compress(Span<const uint8_t> src, std::vector<uint8_t> &dst, Compression co
 	return true;
 }
 
+// Simplified version of the COVER algorithm used by Zstandard's dictionary builder, which isn't available in the copy
+// of Zstandard that comes with Godot. It picks segments of the samples containing the most common sequences of bytes.
+// The result is a "raw content" dictionary, Zstandard uses it as if it was data preceding what gets compressed.
+bool train_zstd_dictionary(
+		Span<const Span<const uint8_t>> samples, unsigned int max_size, std::vector<uint8_t> &out_dictionary) {
+	ZN_PROFILE_SCOPE();
+
+	// Sequences of bytes are compared by groups of that size. Shorter matches are not worth it for the compressor.
+	static const unsigned int DMER_SIZE = 8;
+	// Size of each segment copied to the dictionary
+	static const unsigned int SEGMENT_SIZE = 64;
+	// Distance between candidate segments
+	static const unsigned int SEGMENT_STEP = SEGMENT_SIZE / 2;
+
+	struct L {
+		static inline uint64_t read_dmer(const uint8_t *p) {
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+	};
+
+	out_dictionary.clear();
+
+	// Count in how many samples each d-mer appears. Repetitions within one sample don't count, the compressor already
+	// finds them without a dictionary.
+	std::unordered_map<uint64_t, uint32_t> frequencies;
+	{
+		std::vector<uint64_t> sample_dmers;
+		for (const Span<const uint8_t> sample : samples) {
+			if (sample.size() < DMER_SIZE) {
+				continue;
+			}
+			sample_dmers.clear();
+			for (unsigned int i = 0; i + DMER_SIZE <= sample.size(); ++i) {
+				sample_dmers.push_back(L::read_dmer(sample.data() + i));
+			}
+			std::sort(sample_dmers.begin(), sample_dmers.end());
+			auto end_it = std::unique(sample_dmers.begin(), sample_dmers.end());
+			for (auto it = sample_dmers.begin(); it != end_it; ++it) {
+				++frequencies[*it];
+			}
+		}
+	}
+
+	struct Segment {
+		uint32_t sample_index;
+		uint32_t offset;
+		uint64_t score;
+	};
+
+	std::vector<Segment> candidates;
+	for (unsigned int sample_index = 0; sample_index < samples.size(); ++sample_index) {
+		const Span<const uint8_t> sample = samples[sample_index];
+		for (unsigned int offset = 0; offset + SEGMENT_SIZE <= sample.size(); offset += SEGMENT_STEP) {
+			candidates.push_back(Segment{ sample_index, offset, 0 });
+		}
+	}
+
+	const unsigned int candidate_count = candidates.size();
+	const unsigned int segment_count = math::min(max_size / SEGMENT_SIZE, candidate_count);
+	if (segment_count == 0) {
+		return false;
+	}
+
+	// Candidates are split into as many epochs as there are segments to pick, and the best segment of each epoch is
+	// picked. This covers all the samples in linear time, instead of searching the best segment every time.
+	const unsigned int epoch_size = (candidate_count + segment_count - 1) / segment_count;
+
+	std::vector<Segment> picked_segments;
+	std::vector<uint64_t> segment_dmers;
+
+	for (unsigned int epoch_begin = 0; epoch_begin < candidate_count; epoch_begin += epoch_size) {
+		const unsigned int epoch_end = math::min(epoch_begin + epoch_size, candidate_count);
+
+		Segment best_segment{ 0, 0, 0 };
+
+		for (unsigned int candidate_index = epoch_begin; candidate_index < epoch_end; ++candidate_index) {
+			Segment &candidate = candidates[candidate_index];
+			const uint8_t *segment_data = samples[candidate.sample_index].data() + candidate.offset;
+
+			segment_dmers.clear();
+			for (unsigned int i = 0; i + DMER_SIZE <= SEGMENT_SIZE; ++i) {
+				segment_dmers.push_back(L::read_dmer(segment_data + i));
+			}
+			std::sort(segment_dmers.begin(), segment_dmers.end());
+			auto end_it = std::unique(segment_dmers.begin(), segment_dmers.end());
+
+			candidate.score = 0;
+			for (auto it = segment_dmers.begin(); it != end_it; ++it) {
+				auto freq_it = frequencies.find(*it);
+				// A d-mer found in only one sample is not useful to others
+				if (freq_it != frequencies.end() && freq_it->second > 1) {
+					candidate.score += freq_it->second - 1;
+				}
+			}
+
+			if (candidate.score > best_segment.score) {
+				best_segment = candidate;
+			}
+		}
+
+		if (best_segment.score == 0) {
+			continue;
+		}
+
+		// The content of the picked segment is now covered, other segments containing it become less useful
+		const uint8_t *segment_data = samples[best_segment.sample_index].data() + best_segment.offset;
+		for (unsigned int i = 0; i + DMER_SIZE <= SEGMENT_SIZE; ++i) {
+			frequencies.erase(L::read_dmer(segment_data + i));
+		}
+
+		picked_segments.push_back(best_segment);
+	}
+
+	if (picked_segments.size() == 0) {
+		return false;
+	}
+
+	// Put the most useful segments at the end. They are closer to the data being compressed, so references to them are
+	// cheaper.
+	std::sort(picked_segments.begin(), picked_segments.end(),
+			[](const Segment &a, const Segment &b) { return a.score < b.score; });
+
+	out_dictionary.reserve(picked_segments.size() * SEGMENT_SIZE);
+	for (const Segment &segment : picked_segments) {
+		const uint8_t *segment_data = samples[segment.sample_index].data() + segment.offset;
+		out_dictionary.insert(out_dictionary.end(), segment_data, segment_data + SEGMENT_SIZE);
+	}
+
+	return true;
+}
+
 } // namespace zylann::voxel::CompressedData
@@ -1,18 +1,24 @@
 #include "region_file.h"
 #include "../../streams/voxel_block_serializer.h"
+#include "../../util/godot/classes/directory.h"
+#include "../../util/godot/classes/project_settings.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/log.h"
 #include "../../util/profiling.h"
+#include "../../util/serialization.h"
 #include "../../util/string_funcs.h"
 #include "../file_utils.h"
 #include <algorithm>
+#include <cstring>
 
 namespace zylann::voxel {
 
 namespace {
-const uint8_t FORMAT_VERSION = 3;
+const uint8_t FORMAT_VERSION = 4;
 
+// Version 3 is like 4, but does not store free sectors
+const uint8_t FORMAT_VERSION_LEGACY_3 = 3;
 // Version 2 is like 3, but does not include any format information
 const uint8_t FORMAT_VERSION_LEGACY_2 = 2;
 // const uint8_t FORMAT_VERSION_LEGACY_1 = 1;
@@ -21,6 +27,8 @@ const char *FORMAT_REGION_MAGIC = "VXR_";
 const uint32_t MAGIC_AND_VERSION_SIZE = 4 + 1;
 const uint32_t FIXED_HEADER_DATA_SIZE = 7 + RegionFormat::CHANNEL_COUNT;
 const uint32_t PALETTE_SIZE_IN_BYTES = 256 * 4;
+// Sector count and free extent count
+const uint32_t FREE_SECTORS_HEADER_SIZE = 4 + 4;
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -62,8 +70,13 @@ static uint32_t get_header_size_v3(const RegionFormat &format) {
 			Vector3iUtil::get_volume(format.region_size) * sizeof(RegionBlockInfo);
 }
 
-static bool save_header(
-		FileAccess &f, uint8_t version, const RegionFormat &format, const std::vector<RegionBlockInfo> &block_infos) {
+static uint32_t get_header_size_v4(const RegionFormat &format) {
+	return get_header_size_v3(format) + FREE_SECTORS_HEADER_SIZE;
+}
+
+// Free extents are not part of the header, they are stored after the last sector.
+static bool save_header(FileAccess &f, uint8_t version, const RegionFormat &format,
+		const std::vector<RegionBlockInfo> &block_infos, uint32_t sector_count, uint32_t free_extent_count) {
 	f.seek(0);
 
 	store_buffer(f, Span<const uint8_t>(reinterpret_cast<const uint8_t *>(FORMAT_REGION_MAGIC), 4));
@@ -99,16 +112,22 @@ static bool save_header(
 			Span<const uint8_t>(reinterpret_cast<const uint8_t *>(block_infos.data()),
 					block_infos.size() * sizeof(RegionBlockInfo)));
 
+	if (version >= FORMAT_VERSION) {
+		f.store_32(sector_count);
+		f.store_32(free_extent_count);
+	}
+
 #ifdef DEBUG_ENABLED
 	const size_t blocks_begin_offset = f.get_position();
-	CRASH_COND(blocks_begin_offset != get_header_size_v3(format));
+	CRASH_COND(blocks_begin_offset !=
+			(version >= FORMAT_VERSION ? get_header_size_v4(format) : get_header_size_v3(format)));
 #endif
 
 	return true;
 }
 
-static bool load_header(
-		FileAccess &f, uint8_t &out_version, RegionFormat &out_format, std::vector<RegionBlockInfo> &out_block_infos) {
+static bool load_header(FileAccess &f, uint8_t &out_version, RegionFormat &out_format,
+		std::vector<RegionBlockInfo> &out_block_infos, uint32_t &out_sector_count, uint32_t &out_free_extent_count) {
 	ERR_FAIL_COND_V(f.get_position() != 0, false);
 	ERR_FAIL_COND_V(f.get_length() < MAGIC_AND_VERSION_SIZE, false);
 
@@ -119,7 +138,7 @@ static bool load_header(
 
 	const uint8_t version = f.get_8();
 
-	if (version == FORMAT_VERSION) {
+	if (version == FORMAT_VERSION || version == FORMAT_VERSION_LEGACY_3) {
 		out_format.block_size_po2 = f.get_8();
 
 		out_format.region_size.x = f.get_8();
@@ -163,6 +182,15 @@ static bool load_header(
 	const size_t read_size = get_buffer(f, Span<uint8_t>((uint8_t *)out_block_infos.data(), blocks_len));
 	ERR_FAIL_COND_V(read_size != blocks_len, false);
 
+	if (version == FORMAT_VERSION) {
+		out_sector_count = f.get_32();
+		out_free_extent_count = f.get_32();
+	} else {
+		// Older versions don't store this, it has to be computed from blocks
+		out_sector_count = 0;
+		out_free_extent_count = 0;
+	}
+
 	return true;
 }
 
@@ -208,6 +236,8 @@ Error RegionFile::open(const String &fpath, bool create_if_not_found) {
 			}
 
 			_header.version = FORMAT_VERSION;
+			_sector_count = 0;
+			_free_extents.clear();
 			ERR_FAIL_COND_V(save_header(**f) == false, ERR_FILE_CANT_WRITE);
 
 		} else {
@@ -223,43 +253,41 @@ Error RegionFile::open(const String &fpath, bool create_if_not_found) {
 
 	_file_access = f;
 
-	// Precalculate location of sectors and which block they contain.
-	// This will be useful to know when sectors get moved on insertion and removal
+#ifdef DEBUG_ENABLED
+	debug_check();
+#endif
 
-	struct BlockInfoAndIndex {
-		RegionBlockInfo b;
-		unsigned int i;
-	};
+	return OK;
+}
 
-	// Filter only present blocks and keep the index around because it represents the 3D position of the block
-	std::vector<BlockInfoAndIndex> blocks_sorted_by_offset;
-	for (unsigned int i = 0; i < _header.blocks.size(); ++i) {
-		const RegionBlockInfo b = _header.blocks[i];
-		if (b.data != 0) {
-			BlockInfoAndIndex p;
-			p.b = b;
-			p.i = i;
-			blocks_sorted_by_offset.push_back(p);
-		}
+Error RegionFile::open_mapped(const String &fpath) {
+	ZN_PROFILE_SCOPE();
+	close();
+
+	if (!MemoryMappedFile::is_supported()) {
+		return ERR_UNAVAILABLE;
 	}
 
-	std::sort(blocks_sorted_by_offset.begin(), blocks_sorted_by_offset.end(),
-			[](const BlockInfoAndIndex &a, const BlockInfoAndIndex &b) {
-				return a.b.get_sector_index() < b.b.get_sector_index();
-			});
+	_file_path = fpath;
 
-	CRASH_COND(_sectors.size() != 0);
-	for (unsigned int i = 0; i < blocks_sorted_by_offset.size(); ++i) {
-		const BlockInfoAndIndex b = blocks_sorted_by_offset[i];
-		Vector3i bpos = get_block_position_from_index(b.i);
-		for (unsigned int j = 0; j < b.b.get_sector_count(); ++j) {
-			_sectors.push_back(bpos);
+	{
+		// The header is read with regular file access, it is only done once
+		Error file_error;
+		Ref<FileAccess> f = open_file(fpath, FileAccess::READ, file_error);
+		if (file_error != OK) {
+			return file_error;
+		}
+		const Error header_error = load_header(**f);
+		if (header_error != OK) {
+			return header_error;
 		}
 	}
 
-#ifdef DEBUG_ENABLED
-	debug_check();
-#endif
+	// Godot paths such as `user://` have to be converted. Files inside packs can't be mapped.
+	const CharString os_path = ProjectSettings::get_singleton()->globalize_path(fpath).utf8();
+	if (!_mapping.open(os_path.get_data())) {
+		return ERR_CANT_OPEN;
+	}
 
 	return OK;
 }
@@ -278,16 +306,22 @@ Error RegionFile::close() {
 		}
 		_file_access.unref();
 	}
-	_sectors.clear();
+	_mapping.close();
+	_sector_count = 0;
+	_free_extents.clear();
 	return err;
 }
 
 bool RegionFile::is_open() const {
-	return _file_access != nullptr;
+	return _file_access != nullptr || _mapping.is_open();
+}
+
+bool RegionFile::is_mapped() const {
+	return _mapping.is_open();
 }
 
 bool RegionFile::set_format(const RegionFormat &format) {
-	ERR_FAIL_COND_V_MSG(_file_access != nullptr, false, "Can't set format when the file already exists");
+	ERR_FAIL_COND_V_MSG(is_open(), false, "Can't set format when the file already exists");
 	ERR_FAIL_COND_V(!format.validate(), false);
 
 	// This will be the format used to create the next file if not found on open()
@@ -310,9 +344,12 @@ bool RegionFile::is_valid_block_position(const Vector3 position) const {
 			position.z < _header.format.region_size.z;
 }
 
+void RegionFile::set_compression_settings(const CompressedData::Settings &settings) {
+	_compression_settings = settings;
+}
+
 Error RegionFile::load_block(Vector3i position, VoxelBufferInternal &out_block) {
-	ERR_FAIL_COND_V(_file_access.is_null(), ERR_FILE_CANT_READ);
-	FileAccess &f = **_file_access;
+	ERR_FAIL_COND_V(!is_open(), ERR_FILE_CANT_READ);
 
 	ERR_FAIL_COND_V(!is_valid_block_position(position), ERR_INVALID_PARAMETER);
 	const unsigned int lut_index = get_block_index_in_header(position);
@@ -332,13 +369,33 @@ Error RegionFile::load_block(Vector3i position, VoxelBufferInternal &out_block)
 	const unsigned int sector_index = block_info.get_sector_index();
 	const unsigned int block_begin = _blocks_begin_offset + sector_index * _header.format.sector_size;
 
+	if (_mapping.is_open()) {
+		// Decompress directly from the mapping. This must not modify the region, other threads can be reading it.
+		const Span<const uint8_t> file_data = _mapping.get_data();
+		ERR_FAIL_COND_V(block_begin + sizeof(uint32_t) > file_data.size(), ERR_FILE_CORRUPT);
+		// The size is written with `FileAccess::store_32`, which is little-endian regardless of the host
+		MemoryReader block_header_reader(file_data.sub(block_begin, sizeof(uint32_t)), ENDIANESS_LITTLE_ENDIAN);
+		const uint32_t block_data_size = block_header_reader.get_32();
+		const size_t block_data_begin = block_begin + sizeof(uint32_t);
+		ERR_FAIL_COND_V(block_data_size > file_data.size() - block_data_begin, ERR_FILE_CORRUPT);
+
+		ERR_FAIL_COND_V_MSG(
+				!BlockSerializer::decompress_and_deserialize(file_data.sub(block_data_begin, block_data_size),
+						out_block, _compression_settings.zstd_dictionary.get()),
+				ERR_PARSE_ERROR, String("Failed to read block {0}").format(varray(position)));
+
+		return OK;
+	}
+
+	FileAccess &f = **_file_access;
 	f.seek(block_begin);
 
 	unsigned int block_data_size = f.get_32();
 	CRASH_COND(f.eof_reached());
 
-	ERR_FAIL_COND_V_MSG(!BlockSerializer::decompress_and_deserialize(f, block_data_size, out_block), ERR_PARSE_ERROR,
-			String("Failed to read block {0}").format(varray(position)));
+	ERR_FAIL_COND_V_MSG(!BlockSerializer::decompress_and_deserialize(
+								f, block_data_size, out_block, _compression_settings.zstd_dictionary.get()),
+			ERR_PARSE_ERROR, String("Failed to read block {0}").format(varray(position)));
 
 	return OK;
 }
@@ -359,103 +416,69 @@ Error RegionFile::save_block(Vector3i position, VoxelBufferInternal &block) {
 	ERR_FAIL_COND_V(lut_index >= _header.blocks.size(), ERR_INVALID_PARAMETER);
 	RegionBlockInfo &block_info = _header.blocks[lut_index];
 
-	if (block_info.data == 0) {
-		// The block isn't in the file yet, append at the end
-
-		const unsigned int end_offset = _blocks_begin_offset + _sectors.size() * _header.format.sector_size;
-		f.seek(end_offset);
-		const unsigned int block_offset = f.get_position();
-		// Check position matches the sectors rule
-		CRASH_COND((block_offset - _blocks_begin_offset) % _header.format.sector_size != 0);
-
-		BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block);
-		ERR_FAIL_COND_V(!res.success, ERR_INVALID_PARAMETER);
-		f.store_32(res.data.size());
-		const unsigned int written_size = sizeof(uint32_t) + res.data.size();
-		store_buffer(f, to_span(res.data));
-
-		const unsigned int end_pos = f.get_position();
-		CRASH_COND_MSG(written_size != (end_pos - block_offset),
-				String("written_size: {0}, block_offset: {1}, end_pos: {2}")
-						.format(varray(written_size, block_offset, end_pos)));
-		pad_to_sector_size(f);
-
-		block_info.set_sector_index((block_offset - _blocks_begin_offset) / _header.format.sector_size);
-		block_info.set_sector_count(get_sector_count_from_bytes(written_size));
-
-		for (unsigned int i = 0; i < block_info.get_sector_count(); ++i) {
-			_sectors.push_back(position);
-		}
+	BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block, _compression_settings);
+	ERR_FAIL_COND_V(!res.success, ERR_INVALID_PARAMETER);
+	const std::vector<uint8_t> &data = res.data;
+	const size_t written_size = sizeof(uint32_t) + data.size();
+
+	const uint32_t new_sector_count = get_sector_count_from_bytes(written_size);
+	CRASH_COND(new_sector_count < 1);
 
+	if (block_info.data == 0) {
+		// The block isn't in the file yet
+		const uint32_t sector_index = allocate_sectors(new_sector_count);
+		store_block_data(f, sector_index, data);
+		block_info.set_sector_index(sector_index);
 		_header_modified = true;
 
 	} else {
 		// The block is already in the file
 
-		CRASH_COND(_sectors.size() == 0);
-
-		const int old_sector_index = block_info.get_sector_index();
-		const int old_sector_count = block_info.get_sector_count();
+		const uint32_t old_sector_index = block_info.get_sector_index();
+		const uint32_t old_sector_count = block_info.get_sector_count();
 		CRASH_COND(old_sector_count < 1);
 
-		BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block);
-		ERR_FAIL_COND_V(!res.success, ERR_INVALID_PARAMETER);
-		const std::vector<uint8_t> &data = res.data;
-		const size_t written_size = sizeof(uint32_t) + data.size();
-
-		const int new_sector_count = get_sector_count_from_bytes(written_size);
-		CRASH_COND(new_sector_count < 1);
-
 		if (new_sector_count <= old_sector_count) {
 			// We can write the block at the same spot
 
 			if (new_sector_count < old_sector_count) {
-				// The block now uses less sectors, we can compact others.
-				remove_sectors_from_block(position, old_sector_count - new_sector_count);
+				// The block now uses less sectors, the remaining ones can be used by other blocks
+				free_sectors(old_sector_index + new_sector_count, old_sector_count - new_sector_count);
 				_header_modified = true;
 			}
 
-			const size_t block_offset = _blocks_begin_offset + old_sector_index * _header.format.sector_size;
-			f.seek(block_offset);
-
-			f.store_32(data.size());
-			store_buffer(f, to_span(data));
-
-			const size_t end_pos = f.get_position();
-			CRASH_COND(written_size != (end_pos - block_offset));
+			store_block_data(f, old_sector_index, data);
 
 		} else {
-			// The block now uses more sectors, we have to move others.
-			// Note: we could shift blocks forward, but we can also remove the block entirely and rewrite it at the end.
-			// Need to investigate if it's worth implementing forward shift instead.
-			// TODO Prefer doing an end swap kind of thing?
-
-			// This also shifts the rest of the file so the freed sectors may get re-occupied.
-			remove_sectors_from_block(position, old_sector_count);
+			// The block now uses more sectors, move it where there is enough space.
+			// Its current sectors are freed first, so it can grow in place if they are followed by free ones.
+			free_sectors(old_sector_index, old_sector_count);
+			const uint32_t sector_index = allocate_sectors(new_sector_count);
+			store_block_data(f, sector_index, data);
+			block_info.set_sector_index(sector_index);
+			_header_modified = true;
+		}
+	}
 
-			const size_t block_offset = _blocks_begin_offset + _sectors.size() * _header.format.sector_size;
-			f.seek(block_offset);
+	block_info.set_sector_count(new_sector_count);
 
-			f.store_32(data.size());
-			store_buffer(f, to_span(data));
+	return OK;
+}
 
-			const size_t end_pos = f.get_position();
-			CRASH_COND(written_size != (end_pos - block_offset));
+void RegionFile::store_block_data(FileAccess &f, uint32_t sector_index, const std::vector<uint8_t> &data) {
+	const uint64_t block_offset = _blocks_begin_offset + uint64_t(sector_index) * _header.format.sector_size;
+	f.seek(block_offset);
 
-			pad_to_sector_size(f);
+	f.store_32(data.size());
+	store_buffer(f, to_span(data));
 
-			block_info.set_sector_index(_sectors.size());
-			for (int i = 0; i < new_sector_count; ++i) {
-				_sectors.push_back(Vector3u16(position));
-			}
+	const uint64_t end_pos = f.get_position();
+	CRASH_COND_MSG(sizeof(uint32_t) + data.size() != (end_pos - block_offset),
+			String("data size: {0}, block_offset: {1}, end_pos: {2}")
+					.format(varray(uint64_t(data.size()), block_offset, end_pos)));
 
-			_header_modified = true;
-		}
-
-		block_info.set_sector_count(new_sector_count);
-	}
-
-	return OK;
+	// Needed when the block is the last in the file, so the next one starts at the right offset
+	pad_to_sector_size(f);
 }
 
 void RegionFile::pad_to_sector_size(FileAccess &f) {
@@ -472,78 +495,218 @@ void RegionFile::pad_to_sector_size(FileAccess &f) {
 	}
 }
 
-void RegionFile::remove_sectors_from_block(Vector3i block_pos, unsigned int p_sector_count) {
-	ZN_PROFILE_SCOPE();
+uint32_t RegionFile::allocate_sectors(uint32_t sector_count) {
+	// First fit. Blocks have similar sizes, so it leaves few small holes, and it's cheap.
+	for (auto it = _free_extents.begin(); it != _free_extents.end(); ++it) {
+		FreeExtent &extent = *it;
+		if (extent.sector_count >= sector_count) {
+			const uint32_t sector_index = extent.sector_index;
+			extent.sector_index += sector_count;
+			extent.sector_count -= sector_count;
+			if (extent.sector_count == 0) {
+				_free_extents.erase(it);
+			}
+			return sector_index;
+		}
+	}
+	// No hole is large enough, append
+	const uint32_t sector_index = _sector_count;
+	_sector_count += sector_count;
+	return sector_index;
+}
 
-	// Removes sectors from a block, starting from the last ones.
-	// So if a block has 5 sectors and we remove 2, the first 3 will be preserved.
-	// Then all following sectors are moved earlier in the file to fill the gap.
+void RegionFile::free_sectors(uint32_t sector_index, uint32_t sector_count) {
+	CRASH_COND(sector_count == 0);
+	CRASH_COND(sector_index + sector_count > _sector_count);
+
+	if (sector_index + sector_count == _sector_count) {
+		// Sectors at the end are not tracked as free, the end moves back instead
+		_sector_count = sector_index;
+		if (_free_extents.size() > 0) {
+			const FreeExtent &last = _free_extents.back();
+			if (last.sector_index + last.sector_count == _sector_count) {
+				_sector_count = last.sector_index;
+				_free_extents.pop_back();
+			}
+		}
+		return;
+	}
 
-	CRASH_COND(_file_access == nullptr);
-	CRASH_COND(p_sector_count <= 0);
+	auto next_it = std::lower_bound(_free_extents.begin(), _free_extents.end(), sector_index,
+			[](const FreeExtent &extent, uint32_t i) { return extent.sector_index < i; });
 
-	FileAccess &f = **_file_access;
-	const unsigned int sector_size = _header.format.sector_size;
-	const unsigned int old_end_offset = _blocks_begin_offset + _sectors.size() * sector_size;
+	// Merge with neighbor extents if they are adjacent
+
+	if (next_it != _free_extents.begin()) {
+		FreeExtent &prev = *(next_it - 1);
+		CRASH_COND(prev.sector_index + prev.sector_count > sector_index);
+		if (prev.sector_index + prev.sector_count == sector_index) {
+			prev.sector_count += sector_count;
+			if (next_it != _free_extents.end() && prev.sector_index + prev.sector_count == next_it->sector_index) {
+				prev.sector_count += next_it->sector_count;
+				_free_extents.erase(next_it);
+			}
+			return;
+		}
+	}
 
-	const unsigned int block_index = get_block_index_in_header(block_pos);
-	CRASH_COND(block_index >= _header.blocks.size());
-	RegionBlockInfo &block_info = _header.blocks[block_index];
+	if (next_it != _free_extents.end()) {
+		CRASH_COND(sector_index + sector_count > next_it->sector_index);
+		if (sector_index + sector_count == next_it->sector_index) {
+			next_it->sector_index = sector_index;
+			next_it->sector_count += sector_count;
+			return;
+		}
+	}
 
-	unsigned int src_offset =
-			_blocks_begin_offset + (block_info.get_sector_index() + block_info.get_sector_count()) * sector_size;
+	_free_extents.insert(next_it, FreeExtent{ sector_index, sector_count });
+}
 
-	unsigned int dst_offset = src_offset - p_sector_count * sector_size;
+void RegionFile::rebuild_free_extents() {
+	std::vector<RegionBlockInfo> blocks_sorted_by_offset;
+	for (const RegionBlockInfo b : _header.blocks) {
+		if (b.data != 0) {
+			blocks_sorted_by_offset.push_back(b);
+		}
+	}
 
-	CRASH_COND(_sectors.size() < p_sector_count);
-	CRASH_COND(src_offset - sector_size < dst_offset);
-	CRASH_COND(block_info.get_sector_index() + p_sector_count > _sectors.size());
-	CRASH_COND(p_sector_count > block_info.get_sector_count());
-	CRASH_COND(dst_offset < _blocks_begin_offset);
+	std::sort(blocks_sorted_by_offset.begin(), blocks_sorted_by_offset.end(),
+			[](const RegionBlockInfo &a, const RegionBlockInfo &b) {
+				return a.get_sector_index() < b.get_sector_index();
+			});
 
-	std::vector<uint8_t> temp;
-	temp.resize(sector_size);
+	_free_extents.clear();
+	uint32_t end = 0;
+	for (const RegionBlockInfo b : blocks_sorted_by_offset) {
+		if (b.get_sector_index() > end) {
+			_free_extents.push_back(FreeExtent{ end, b.get_sector_index() - end });
+		}
+		end = math::max(end, b.get_sector_index() + b.get_sector_count());
+	}
+	_sector_count = end;
+}
+
+// Checks if free extents are well-formed and account for all sectors not used by blocks.
+bool RegionFile::check_free_extents() const {
+	uint64_t used_sector_count = 0;
+	for (const RegionBlockInfo b : _header.blocks) {
+		if (b.data != 0) {
+			if (b.get_sector_index() + b.get_sector_count() > _sector_count) {
+				return false;
+			}
+			used_sector_count += b.get_sector_count();
+		}
+	}
 
-	// TODO There might be a faster way to shrink a file
-	// Erase sectors from file
-	while (src_offset < old_end_offset) {
-		f.seek(src_offset);
-		const size_t read_bytes = get_buffer(f, to_span(temp));
-		CRASH_COND(read_bytes != sector_size); // Corrupted file
+	uint64_t free_sector_count = 0;
+	uint64_t prev_end = 0;
+	for (unsigned int i = 0; i < _free_extents.size(); ++i) {
+		const FreeExtent &extent = _free_extents[i];
+		const uint64_t end = uint64_t(extent.sector_index) + extent.sector_count;
+		if (extent.sector_count == 0 || end >= _sector_count) {
+			return false;
+		}
+		// Extents must be sorted and not adjacent
+		if (i > 0 && extent.sector_index <= prev_end) {
+			return false;
+		}
+		free_sector_count += extent.sector_count;
+		prev_end = end;
+	}
 
-		f.seek(dst_offset);
-		store_buffer(f, to_span(temp));
+	return used_sector_count + free_sector_count == _sector_count;
+}
+
+unsigned int RegionFile::get_sector_count() const {
+	return _sector_count;
+}
 
-		src_offset += sector_size;
-		dst_offset += sector_size;
+unsigned int RegionFile::get_free_sector_count() const {
+	unsigned int count = 0;
+	for (const FreeExtent &extent : _free_extents) {
+		count += extent.sector_count;
 	}
+	return count;
+}
 
-	// TODO We need to truncate the end of the file since we effectively shortened it,
-	// but FileAccess doesn't have any function to do that... so can't rely on EOF either
+Error RegionFile::compact() {
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_COND_V(_file_access.is_null(), ERR_FILE_CANT_WRITE);
+	FileAccess &f = **_file_access;
 
-	// Erase sectors from cache
-	_sectors.erase(_sectors.begin() + (block_info.get_sector_index() + block_info.get_sector_count() - p_sector_count),
-			_sectors.begin() + (block_info.get_sector_index() + block_info.get_sector_count()));
+	if (_header.version != FORMAT_VERSION) {
+		ERR_FAIL_COND_V(migrate_to_latest(f) == false, ERR_UNAVAILABLE);
+	}
 
-	const unsigned int old_sector_index = block_info.get_sector_index();
+	const unsigned int sector_size = _header.format.sector_size;
 
-	// Reduce sectors of current block in header.
-	if (block_info.get_sector_count() > p_sector_count) {
-		block_info.set_sector_count(block_info.get_sector_count() - p_sector_count);
-	} else {
-		// Block removed
-		block_info.data = 0;
+	if (_free_extents.size() == 0 && f.get_length() == _blocks_begin_offset + uint64_t(_sector_count) * sector_size) {
+		// Already compact
+		return OK;
 	}
 
-	// Shift sector index of following blocks
-	if (old_sector_index < _sectors.size()) {
-		for (unsigned int i = 0; i < _header.blocks.size(); ++i) {
-			RegionBlockInfo &b = _header.blocks[i];
-			if (b.data != 0 && b.get_sector_index() > old_sector_index) {
-				b.set_sector_index(b.get_sector_index() - p_sector_count);
-			}
+	// Copy blocks in the order they appear in the file, so reads are sequential
+	std::vector<unsigned int> block_indices_sorted_by_offset;
+	for (unsigned int i = 0; i < _header.blocks.size(); ++i) {
+		if (_header.blocks[i].data != 0) {
+			block_indices_sorted_by_offset.push_back(i);
 		}
 	}
+	std::sort(block_indices_sorted_by_offset.begin(), block_indices_sorted_by_offset.end(),
+			[this](unsigned int a, unsigned int b) {
+				return _header.blocks[a].get_sector_index() < _header.blocks[b].get_sector_index();
+			});
+
+	std::vector<RegionBlockInfo> new_blocks = _header.blocks;
+	uint32_t new_sector_count = 0;
+	for (const unsigned int i : block_indices_sorted_by_offset) {
+		new_blocks[i].set_sector_index(new_sector_count);
+		new_sector_count += new_blocks[i].get_sector_count();
+	}
+
+	// FileAccess can't truncate files, so the compacted file is written next to the original, and replaces it when
+	// complete. If something fails before that, the original file remains untouched.
+	const String temp_path = _file_path + ".tmp";
+	Error temp_error;
+	Ref<FileAccess> temp_f = open_file(temp_path, FileAccess::WRITE, temp_error);
+	ERR_FAIL_COND_V_MSG(temp_error != OK, temp_error, String("Failed to create file {0}").format(varray(temp_path)));
+
+	ERR_FAIL_COND_V(
+			!zylann::voxel::save_header(**temp_f, FORMAT_VERSION, _header.format, new_blocks, new_sector_count, 0),
+			ERR_FILE_CANT_WRITE);
+
+	std::vector<uint8_t> temp;
+	for (const unsigned int i : block_indices_sorted_by_offset) {
+		const RegionBlockInfo &block_info = _header.blocks[i];
+		temp.resize(block_info.get_sector_count() * sector_size);
+		f.seek(_blocks_begin_offset + uint64_t(block_info.get_sector_index()) * sector_size);
+		const size_t read_size = get_buffer(f, to_span(temp));
+		// Files of older versions may not be padded after their last block
+		ERR_FAIL_COND_V(read_size < sizeof(uint32_t), ERR_FILE_CORRUPT);
+		for (size_t j = read_size; j < temp.size(); ++j) {
+			temp[j] = 0;
+		}
+		store_buffer(**temp_f, to_span(temp));
+	}
+
+	temp_f.unref();
+
+	// Header and free sectors are already up to date in the new file
+	_header_modified = false;
+	const String file_path = _file_path;
+	close();
+
+	Ref<DirAccess> da = open_directory(file_path.get_base_dir());
+	ERR_FAIL_COND_V(da.is_null(), ERR_FILE_CANT_WRITE);
+	const Error rename_error = da->rename(temp_path, file_path);
+	if (rename_error != OK) {
+		ERR_PRINT(String("Failed to rename {0} to {1}").format(varray(temp_path, file_path)));
+		// Keep using the original file
+		open(file_path, false);
+		return rename_error;
+	}
+
+	return open(file_path, false);
 }
 
 bool RegionFile::save_header(FileAccess &f) {
@@ -551,8 +714,19 @@ bool RegionFile::save_header(FileAccess &f) {
 	if (_header.version != FORMAT_VERSION) {
 		ERR_FAIL_COND_V(migrate_to_latest(f) == false, false);
 	}
-	ERR_FAIL_COND_V(!zylann::voxel::save_header(f, _header.version, _header.format, _header.blocks), false);
+	ERR_FAIL_COND_V(!zylann::voxel::save_header(
+							f, _header.version, _header.format, _header.blocks, _sector_count, _free_extents.size()),
+			false);
 	_blocks_begin_offset = f.get_position();
+
+	// Free extents are stored after the last sector. Their count can change, so they can't be in the header without
+	// having to move all sectors.
+	f.seek(_blocks_begin_offset + uint64_t(_sector_count) * _header.format.sector_size);
+	for (const FreeExtent &extent : _free_extents) {
+		f.store_32(extent.sector_index);
+		f.store_32(extent.sector_count);
+	}
+
 	_header_modified = false;
 	return true;
 }
@@ -575,7 +749,22 @@ bool RegionFile::migrate_from_v2_to_v3(FileAccess &f, RegionFormat &format) {
 	f.seek(MAGIC_AND_VERSION_SIZE);
 	insert_bytes(f, extra_bytes_needed);
 
-	f.seek(0);
+	_header.version = FORMAT_VERSION_LEGACY_3;
+	ERR_FAIL_COND_V(!zylann::voxel::save_header(f, _header.version, format, _header.blocks, 0, 0), false);
+	_blocks_begin_offset = f.get_position();
+	return true;
+}
+
+bool RegionFile::migrate_from_v3_to_v4(FileAccess &f) {
+	ZN_PRINT_VERBOSE(zylann::format("Migrating region file {} from v3 to v4", _file_path));
+
+	// Free sectors were not stored in v3, they are computed when the file is opened.
+	// The header gets larger, so sectors have to move.
+	const unsigned int extra_bytes_needed = get_header_size_v4(_header.format) - get_header_size_v3(_header.format);
+	ERR_FAIL_COND_V(_blocks_begin_offset != get_header_size_v3(_header.format), false);
+
+	f.seek(_blocks_begin_offset);
+	insert_bytes(f, extra_bytes_needed);
 
 	// Set version because otherwise `save_header` will attempt to migrate again causing stack-overflow
 	_header.version = FORMAT_VERSION;
@@ -597,6 +786,11 @@ bool RegionFile::migrate_to_latest(FileAccess &f) {
 
 	if (version == FORMAT_VERSION_LEGACY_2) {
 		ERR_FAIL_COND_V(!migrate_from_v2_to_v3(f, _header.format), false);
+		version = FORMAT_VERSION_LEGACY_3;
+	}
+
+	if (version == FORMAT_VERSION_LEGACY_3) {
+		ERR_FAIL_COND_V(!migrate_from_v3_to_v4(f), false);
 		version = FORMAT_VERSION;
 	}
 
@@ -610,8 +804,35 @@ bool RegionFile::migrate_to_latest(FileAccess &f) {
 }
 
 Error RegionFile::load_header(FileAccess &f) {
-	ERR_FAIL_COND_V(!zylann::voxel::load_header(f, _header.version, _header.format, _header.blocks), ERR_PARSE_ERROR);
+	uint32_t free_extent_count;
+	ERR_FAIL_COND_V(!zylann::voxel::load_header(
+							f, _header.version, _header.format, _header.blocks, _sector_count, free_extent_count),
+			ERR_PARSE_ERROR);
 	_blocks_begin_offset = f.get_position();
+
+	_free_extents.clear();
+
+	if (_header.version == FORMAT_VERSION) {
+		bool valid = false;
+		// Each free extent is at least one sector
+		if (free_extent_count <= _sector_count) {
+			f.seek(_blocks_begin_offset + uint64_t(_sector_count) * _header.format.sector_size);
+			_free_extents.resize(free_extent_count);
+			for (FreeExtent &extent : _free_extents) {
+				extent.sector_index = f.get_32();
+				extent.sector_count = f.get_32();
+			}
+			valid = !f.eof_reached() && check_free_extents();
+		}
+		if (!valid) {
+			// Can happen if the file was not closed properly
+			ZN_PRINT_WARNING(format("Free sectors of region file {} are invalid, recomputing them", _file_path));
+			rebuild_free_extents();
+		}
+	} else {
+		rebuild_free_extents();
+	}
+
 	return OK;
 }
 
@@ -652,6 +873,10 @@ void RegionFile::debug_check() {
 	FileAccess &f = **_file_access;
 	const size_t file_len = f.get_length();
 
+	if (!check_free_extents()) {
+		ZN_PRINT_ERROR("ERROR: free sectors don't match blocks");
+	}
+
 	for (unsigned int lut_index = 0; lut_index < _header.blocks.size(); ++lut_index) {
 		const RegionBlockInfo &block_info = _header.blocks[lut_index];
 		const Vector3i position = get_block_position_from_index(lut_index);
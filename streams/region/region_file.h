@@ -6,6 +6,8 @@
 #include "../../util/godot/classes/file.h"
 #include "../../util/math/color8.h"
 #include "../../util/math/vector3i.h"
+#include "../../util/memory_mapped_file.h"
+#include "../compressed_data.h"
 
 #include <vector>
 
@@ -78,15 +80,32 @@ public:
 	~RegionFile();
 
 	Error open(const String &fpath, bool create_if_not_found);
+	// Opens an existing file for reading only, by mapping it in memory. Blocks can then be loaded from multiple threads
+	// at once. Fails if memory mapping is not supported.
+	Error open_mapped(const String &fpath);
 	Error close();
 	bool is_open() const;
+	bool is_mapped() const;
 
 	bool set_format(const RegionFormat &format);
 	const RegionFormat &get_format() const;
 
+	// Used when saving blocks. Blocks saved with a different compression can still be loaded, as long as they don't use
+	// a different dictionary.
+	void set_compression_settings(const CompressedData::Settings &settings);
+
 	Error load_block(Vector3i position, VoxelBufferInternal &out_block);
 	Error save_block(Vector3i position, VoxelBufferInternal &block);
 
+	// Rewrites the file so blocks are contiguous, removing free sectors left by blocks that were resized.
+	// This can take a while, so it is better done while the file is not in use by a game (offline or in background).
+	// The file must be open, and remains open afterward.
+	Error compact();
+
+	// How many sectors are between the header and the end of the last block, including free ones.
+	unsigned int get_sector_count() const;
+	unsigned int get_free_sector_count() const;
+
 	unsigned int get_header_block_count() const;
 	bool has_block(Vector3i position) const;
 	bool has_block(unsigned int index) const;
@@ -104,10 +123,16 @@ private:
 	uint32_t get_sector_count_from_bytes(uint32_t size_in_bytes) const;
 
 	void pad_to_sector_size(FileAccess &f);
-	void remove_sectors_from_block(Vector3i block_pos, unsigned int p_sector_count);
+	void store_block_data(FileAccess &f, uint32_t sector_index, const std::vector<uint8_t> &data);
+
+	uint32_t allocate_sectors(uint32_t sector_count);
+	void free_sectors(uint32_t sector_index, uint32_t sector_count);
+	void rebuild_free_extents();
+	bool check_free_extents() const;
 
 	bool migrate_to_latest(FileAccess &f);
 	bool migrate_from_v2_to_v3(FileAccess &f, RegionFormat &format);
+	bool migrate_from_v3_to_v4(FileAccess &f);
 
 	struct Header {
 		uint8_t version = -1;
@@ -119,25 +144,26 @@ private:
 	};
 
 	Ref<FileAccess> _file_access;
+	// Used instead of `_file_access` when opened with `open_mapped`
+	MemoryMappedFile _mapping;
 	bool _header_modified = false;
 
 	Header _header;
 
-	struct Vector3u16 {
-		uint16_t x;
-		uint16_t y;
-		uint16_t z;
-
-		Vector3u16(Vector3i p) : x(p.x), y(p.y), z(p.z) {}
+	// Range of sectors not used by any block, which can be reused when saving blocks.
+	struct FreeExtent {
+		uint32_t sector_index;
+		uint32_t sector_count;
 	};
 
-	// TODO Is it ever read?
-	// List of sectors in the order they appear in the file,
-	// and which position their block is. The same block can span multiple sectors.
-	// This is essentially a reverse table of `Header::blocks`.
-	std::vector<Vector3u16> _sectors;
+	// Sectors after this index are not in use. New sectors are appended there when no free extent is large enough.
+	uint32_t _sector_count = 0;
+	// Sorted by sector index. Adjacent extents are always merged, and none of them touches the end.
+	std::vector<FreeExtent> _free_extents;
 	uint32_t _blocks_begin_offset;
 	String _file_path;
+
+	CompressedData::Settings _compression_settings;
 };
 
 } // namespace zylann::voxel
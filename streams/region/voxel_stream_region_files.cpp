@@ -1,5 +1,6 @@
 #include "voxel_stream_region_files.h"
 #include "../../engine/voxel_engine.h"
+#include "../../storage/voxel_buffer_gd.h"
 #include "../../util/godot/classes/directory.h"
 #include "../../util/godot/classes/json.h"
 #include "../../util/godot/classes/time.h"
@@ -7,10 +8,15 @@
 #include "../../util/godot/core/string.h"
 #include "../../util/log.h"
 #include "../../util/math/box3i.h"
+#include "../../util/memory.h"
 #include "../../util/profiling.h"
 #include "../../util/string_funcs.h"
+#include "../../util/tasks/threaded_task.h"
+#include "../../util/thread/semaphore.h"
+#include "../voxel_block_serializer.h"
 
 #include <algorithm>
+#include <atomic>
 
 namespace zylann::voxel {
 
@@ -22,6 +28,9 @@ const uint8_t FORMAT_VERSION_LEGACY_2 = 2;
 
 const uint8_t FORMAT_VERSION_LEGACY_1 = 1;
 const char *META_FILE_NAME = "meta.vxrm";
+const char *DICTIONARY_FILE_NAME = "dictionary.vxrd";
+// Maximum amount of tasks sent to the thread pool to help loading blocks from different regions in one batch
+const unsigned int MAX_LOAD_HELPER_TASKS = 3;
 
 } // namespace
 
@@ -73,6 +82,17 @@ void VoxelStreamRegionFiles::save_voxel_block(VoxelStream::VoxelQueryData &query
 void VoxelStreamRegionFiles::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) {
 	ZN_PROFILE_SCOPE();
 
+	{
+		MutexLock lock(_mutex);
+		if (_directory_path.is_empty() || (!_meta_loaded && load_meta() != FILE_OK)) {
+			// No block was ever saved
+			for (VoxelStream::VoxelQueryData &q : p_blocks) {
+				q.result = RESULT_BLOCK_NOT_FOUND;
+			}
+			return;
+		}
+	}
+
 	// In order to minimize opening/closing files, requests are grouped according to their region.
 
 	// Had to copy input to sort it, as some areas in the module break if they get responses in different order
@@ -81,40 +101,110 @@ void VoxelStreamRegionFiles::load_voxel_blocks(Span<VoxelStream::VoxelQueryData>
 	comparator.self = this;
 	get_sorted_indices(p_blocks, comparator, sorted_block_indices);
 
-	for (unsigned int i = 0; i < sorted_block_indices.size(); ++i) {
-		const unsigned int bi = sorted_block_indices[i];
-		VoxelStream::VoxelQueryData &q = p_blocks[bi];
-		const EmergeResult result = _load_block(q.voxel_buffer, q.origin_in_voxels, q.lod);
-		switch (result) {
-			case EMERGE_OK:
-				q.result = RESULT_BLOCK_FOUND;
-				break;
-			case EMERGE_OK_FALLBACK:
-				q.result = RESULT_BLOCK_NOT_FOUND;
-				break;
-			case EMERGE_FAILED:
-				q.result = RESULT_ERROR;
-				break;
-			default:
-				CRASH_NOW();
-				break;
+	std::vector<Span<const unsigned int>> groups;
+	get_region_groups(p_blocks, to_span_const(sorted_block_indices), groups);
+
+	if (groups.size() <= 1) {
+		for (const Span<const unsigned int> group : groups) {
+			load_region_blocks(p_blocks, group);
 		}
+		return;
 	}
+
+	// Regions have their own locks, so they can be loaded in parallel. Instead of starting threads, tasks are sent to
+	// the thread pool, and the calling thread takes part too. This is usually called from the same thread pool, so the
+	// calling thread only waits for regions other threads have started loading. Tasks running after that find nothing
+	// left to do.
+	struct Context {
+		VoxelStreamRegionFiles *self;
+		Span<VoxelStream::VoxelQueryData> blocks;
+		Span<const Span<const unsigned int>> groups;
+		std::atomic_uint next_group_index;
+		std::atomic_uint loaded_group_count;
+		Semaphore all_loaded;
+
+		void run() {
+			while (true) {
+				const unsigned int group_index = next_group_index++;
+				if (group_index >= groups.size()) {
+					break;
+				}
+				self->load_region_blocks(blocks, groups[group_index]);
+				if (++loaded_group_count == groups.size()) {
+					all_loaded.post();
+				}
+			}
+		}
+	};
+
+	class LoadRegionsTask : public IThreadedTask {
+	public:
+		std::shared_ptr<Context> context;
+
+		void run(ThreadedTaskContext ctx) override {
+			context->run();
+		}
+
+		const char *get_debug_name() const override {
+			return "VoxelStreamRegionFilesLoad";
+		}
+	};
+
+	std::shared_ptr<Context> context = make_shared_instance<Context>();
+	context->self = this;
+	context->blocks = p_blocks;
+	context->groups = to_span_const(groups);
+	context->next_group_index = 0;
+	context->loaded_group_count = 0;
+
+	const unsigned int helper_task_count =
+			math::min(static_cast<unsigned int>(groups.size()) - 1, MAX_LOAD_HELPER_TASKS);
+	FixedArray<IThreadedTask *, MAX_LOAD_HELPER_TASKS> helper_tasks;
+	for (unsigned int i = 0; i < helper_task_count; ++i) {
+		LoadRegionsTask *task = ZN_NEW(LoadRegionsTask);
+		task->context = context;
+		helper_tasks[i] = task;
+	}
+	VoxelEngine::get_singleton().push_async_tasks(to_span(helper_tasks, helper_task_count));
+
+	context->run();
+	context->all_loaded.wait();
 }
 
 void VoxelStreamRegionFiles::save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) {
 	ZN_PROFILE_SCOPE();
 
+	{
+		MutexLock lock(_mutex);
+
+		ERR_FAIL_COND(_directory_path.is_empty());
+
+		if (!_meta_loaded) {
+			// If it's not loaded, always try to load meta file first if it exists already,
+			// because we could want to save blocks without reading any.
+			// This must be done before sorting, because it can change the size of blocks and regions.
+			FileResult load_res = load_meta();
+			if (load_res != FILE_OK && load_res != FILE_CANT_OPEN) {
+				// The file is present but there is a problem with it
+				String meta_path = _directory_path.path_join(META_FILE_NAME);
+				ERR_PRINT(String("Could not read {0}: error {1}")
+								  .format(varray(meta_path, zylann::to_string(load_res))));
+				return;
+			}
+		}
+	}
+
 	// Had to copy input to sort it, as some areas in the module break if they get responses in different order
 	std::vector<unsigned int> sorted_block_indices;
 	BlockQueryComparator comparator;
 	comparator.self = this;
 	get_sorted_indices(p_blocks, comparator, sorted_block_indices);
 
-	for (unsigned int i = 0; i < sorted_block_indices.size(); ++i) {
-		const unsigned int bi = sorted_block_indices[i];
-		VoxelStream::VoxelQueryData &q = p_blocks[bi];
-		_save_block(q.voxel_buffer, q.origin_in_voxels, q.lod);
+	std::vector<Span<const unsigned int>> groups;
+	get_region_groups(p_blocks, to_span_const(sorted_block_indices), groups);
+
+	for (const Span<const unsigned int> group : groups) {
+		save_region_blocks(p_blocks, group);
 	}
 }
 
@@ -123,103 +213,213 @@ int VoxelStreamRegionFiles::get_used_channels_mask() const {
 	return VoxelBufferInternal::ALL_CHANNELS_MASK;
 }
 
-VoxelStreamRegionFiles::EmergeResult VoxelStreamRegionFiles::_load_block(
-		VoxelBufferInternal &out_buffer, Vector3i origin_in_voxels, int lod) {
+void VoxelStreamRegionFiles::get_region_groups(Span<const VoxelStream::VoxelQueryData> p_blocks,
+		Span<const unsigned int> sorted_indices, std::vector<Span<const unsigned int>> &out_groups) const {
+	unsigned int group_begin = 0;
+	for (unsigned int i = 1; i <= sorted_indices.size(); ++i) {
+		if (i < sorted_indices.size()) {
+			const VoxelStream::VoxelQueryData &a = p_blocks[sorted_indices[group_begin]];
+			const VoxelStream::VoxelQueryData &b = p_blocks[sorted_indices[i]];
+			if (a.lod == b.lod &&
+					get_region_position_from_voxels(a.origin_in_voxels, a.lod) ==
+							get_region_position_from_voxels(b.origin_in_voxels, b.lod)) {
+				continue;
+			}
+		}
+		out_groups.push_back(sorted_indices.sub(group_begin, i - group_begin));
+		group_begin = i;
+	}
+}
+
+void VoxelStreamRegionFiles::load_region_blocks(
+		Span<VoxelStream::VoxelQueryData> p_blocks, Span<const unsigned int> indices) {
 	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(indices.size() > 0);
 
-	MutexLock lock(_mutex);
+	// All blocks are in the same region
+	const int lod = p_blocks[indices[0]].lod;
 
-	if (_directory_path.is_empty()) {
-		return EMERGE_OK_FALLBACK;
-	}
+	std::shared_ptr<MappedRegion> mapped_region;
+	std::shared_ptr<CachedRegion> cached_region;
+	RegionFormat region_format;
+	CompressedData::Settings compression_settings;
+	Vector3i region_size;
 
-	if (!_meta_loaded) {
-		const FileResult load_res = load_meta();
-		if (load_res != FILE_OK) {
-			// No block was ever saved
-			return EMERGE_OK_FALLBACK;
+	{
+		MutexLock lock(_mutex);
+
+		if (!_meta_loaded) {
+			// The directory changed meanwhile
+			for (const unsigned int bi : indices) {
+				p_blocks[bi].result = RESULT_BLOCK_NOT_FOUND;
+			}
+			return;
 		}
-	}
 
-	const Vector3i block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
-	const Vector3i region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+		if (lod >= _meta.lod_count) {
+			ZN_PRINT_ERROR(format("LOD index {} is out of range", lod));
+			for (const unsigned int bi : indices) {
+				p_blocks[bi].result = RESULT_ERROR;
+			}
+			return;
+		}
+
+		const Vector3i region_pos = get_region_position_from_voxels(p_blocks[indices[0]].origin_in_voxels, lod);
+		region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+		region_format = get_region_format();
+		compression_settings = get_compression_settings();
+
+		// Configure depths, as they might not be specified in old block data.
+		// Regions are expected to contain such depths, and use those in the buffer to know how much data to read.
+		for (const unsigned int bi : indices) {
+			VoxelBufferInternal &out_buffer = p_blocks[bi].voxel_buffer;
+			for (unsigned int channel_index = 0; channel_index < _meta.channel_depths.size(); ++channel_index) {
+				out_buffer.set_channel_depth(channel_index, _meta.channel_depths[channel_index]);
+			}
+		}
 
-	CRASH_COND(!_meta_loaded);
-	ERR_FAIL_COND_V(lod >= _meta.lod_count, EMERGE_FAILED);
-	ERR_FAIL_COND_V(block_size != out_buffer.get_size(), EMERGE_FAILED);
+		if (_memory_mapping_enabled) {
+			mapped_region = get_or_map_region(region_pos, lod);
+		}
 
-	// Configure depths, as they might not be specified in old block data.
-	// Regions are expected to contain such depths, and use those in the buffer to know how much data to read.
-	for (unsigned int channel_index = 0; channel_index < _meta.channel_depths.size(); ++channel_index) {
-		out_buffer.set_channel_depth(channel_index, _meta.channel_depths[channel_index]);
+		if (mapped_region == nullptr) {
+			// Holding a reference prevents the region from being closed when other regions get opened
+			cached_region = get_or_create_cached_region(region_pos, lod);
+		} else {
+			// Locked before releasing the main mutex, so the region can't get modified until blocks are read
+			mapped_region->lock.read_lock();
+		}
 	}
 
-	const Vector3i block_pos = get_block_position_from_voxels(origin_in_voxels) >> lod;
-	const Vector3i region_pos = get_region_position_from_blocks(block_pos);
-
-	CachedRegion *cache = open_region(region_pos, lod, false);
-	if (cache == nullptr || !cache->file_exists) {
-		return EMERGE_OK_FALLBACK;
+	// Other threads can load blocks meanwhile, from other regions, or from the same region if it is mapped
+	RegionFile *region = nullptr;
+	if (mapped_region != nullptr) {
+		region = &mapped_region->region;
+	} else {
+		// Not locked while holding the main mutex, because another thread could be doing slow file operations with it
+		cached_region->mutex.lock();
+		if (open_cached_region(*cached_region, region_format, compression_settings, false)) {
+			region = &cached_region->region;
+		}
 	}
 
-	const Vector3i block_rpos = math::wrap(block_pos, region_size);
+	for (const unsigned int bi : indices) {
+		VoxelStream::VoxelQueryData &q = p_blocks[bi];
 
-	const Error err = cache->region.load_block(block_rpos, out_buffer);
-	switch (err) {
-		case OK:
-			return EMERGE_OK;
+		if (q.voxel_buffer.get_size() != Vector3iUtil::create(1 << region_format.block_size_po2)) {
+			ZN_PRINT_ERROR("Block size mismatch");
+			q.result = RESULT_ERROR;
+			continue;
+		}
+		if (region == nullptr) {
+			q.result = RESULT_BLOCK_NOT_FOUND;
+			continue;
+		}
 
-		case ERR_DOES_NOT_EXIST:
-			return EMERGE_OK_FALLBACK;
+		const Vector3i block_pos = (q.origin_in_voxels >> region_format.block_size_po2) >> lod;
+		const Vector3i block_rpos = math::wrap(block_pos, region_size);
 
-		default:
-			return EMERGE_FAILED;
+		const Error err = region->load_block(block_rpos, q.voxel_buffer);
+		switch (err) {
+			case OK:
+				q.result = RESULT_BLOCK_FOUND;
+				break;
+			case ERR_DOES_NOT_EXIST:
+				q.result = RESULT_BLOCK_NOT_FOUND;
+				break;
+			default:
+				q.result = RESULT_ERROR;
+				break;
+		}
+	}
+
+	if (mapped_region != nullptr) {
+		mapped_region->lock.read_unlock();
+	} else {
+		cached_region->mutex.unlock();
 	}
 }
 
-void VoxelStreamRegionFiles::_save_block(VoxelBufferInternal &voxel_buffer, Vector3i origin_in_voxels, int lod) {
+void VoxelStreamRegionFiles::save_region_blocks(
+		Span<VoxelStream::VoxelQueryData> p_blocks, Span<const unsigned int> indices) {
 	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(indices.size() > 0);
 
-	MutexLock lock(_mutex);
+	// All blocks are in the same region
+	const int lod = p_blocks[indices[0]].lod;
 
-	ERR_FAIL_COND(_directory_path.is_empty());
+	std::shared_ptr<CachedRegion> cached_region;
+	RegionFormat region_format;
+	CompressedData::Settings compression_settings;
+	Vector3i region_size;
 
-	if (!_meta_loaded) {
-		// If it's not loaded, always try to load meta file first if it exists already,
-		// because we could want to save blocks without reading any
-		FileResult load_res = load_meta();
-		if (load_res != FILE_OK && load_res != FILE_CANT_OPEN) {
-			// The file is present but there is a problem with it
-			String meta_path = _directory_path.path_join(META_FILE_NAME);
-			ERR_PRINT(String("Could not read {0}: error {1}").format(varray(meta_path, zylann::to_string(load_res))));
-			return;
-		}
-	}
+	{
+		MutexLock lock(_mutex);
+
+		// The directory may have changed meanwhile
+		ERR_FAIL_COND(_directory_path.is_empty());
 
-	if (!_meta_saved) {
-		// First time we save the meta file, initialize it from the first block format
-		for (unsigned int i = 0; i < _meta.channel_depths.size(); ++i) {
-			_meta.channel_depths[i] = voxel_buffer.get_channel_depth(i);
+		if (!_meta_saved) {
+			// First time we save the meta file, initialize it from the first block format
+			const VoxelBufferInternal &voxel_buffer = p_blocks[indices[0]].voxel_buffer;
+			for (unsigned int i = 0; i < _meta.channel_depths.size(); ++i) {
+				_meta.channel_depths[i] = voxel_buffer.get_channel_depth(i);
+			}
+			FileResult err = save_meta();
+			ERR_FAIL_COND(err != FILE_OK);
 		}
-		FileResult err = save_meta();
-		ERR_FAIL_COND(err != FILE_OK);
+
+		ERR_FAIL_COND(lod >= _meta.lod_count);
+
+		const Vector3i region_pos = get_region_position_from_voxels(p_blocks[indices[0]].origin_in_voxels, lod);
+		region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+		region_format = get_region_format();
+		compression_settings = get_compression_settings();
+
+		// The region is about to be modified, so it must not be read from a mapping anymore
+		unmap_region(region_pos, lod);
+
+		// Holding a reference prevents the region from being closed when other regions get opened
+		cached_region = get_or_create_cached_region(region_pos, lod);
 	}
 
-	// Verify format
-	const Vector3i block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
-	ERR_FAIL_COND(voxel_buffer.get_size() != block_size);
-	for (unsigned int i = 0; i < VoxelBufferInternal::MAX_CHANNELS; ++i) {
-		ERR_FAIL_COND(voxel_buffer.get_channel_depth(i) != _meta.channel_depths[i]);
+	cached_region->mutex.lock();
+
+	if (!open_cached_region(*cached_region, region_format, compression_settings, true)) {
+		cached_region->mutex.unlock();
+		ERR_FAIL_MSG("Could not save region file data");
 	}
 
-	const Vector3i region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
-	Vector3i block_pos = get_block_position_from_voxels(origin_in_voxels) >> lod;
-	Vector3i region_pos = get_region_position_from_blocks(block_pos);
-	Vector3i block_rpos = math::wrap(block_pos, region_size);
+	for (const unsigned int bi : indices) {
+		VoxelStream::VoxelQueryData &q = p_blocks[bi];
+		VoxelBufferInternal &voxel_buffer = q.voxel_buffer;
+
+		// Verify format
+		if (voxel_buffer.get_size() != Vector3iUtil::create(1 << region_format.block_size_po2)) {
+			ZN_PRINT_ERROR("Block size mismatch");
+			continue;
+		}
+		bool depths_match = true;
+		for (unsigned int i = 0; i < VoxelBufferInternal::MAX_CHANNELS; ++i) {
+			if (voxel_buffer.get_channel_depth(i) != region_format.channel_depths[i]) {
+				depths_match = false;
+				break;
+			}
+		}
+		if (!depths_match) {
+			ZN_PRINT_ERROR("Block channel depths mismatch");
+			continue;
+		}
+
+		const Vector3i block_pos = (q.origin_in_voxels >> region_format.block_size_po2) >> lod;
+		const Vector3i block_rpos = math::wrap(block_pos, region_size);
 
-	CachedRegion *cache = open_region(region_pos, lod, true);
-	ERR_FAIL_COND_MSG(cache == nullptr, "Could not save region file data");
-	ERR_FAIL_COND(cache->region.save_block(block_rpos, voxel_buffer) != OK);
+		if (cached_region->region.save_block(block_rpos, voxel_buffer) != OK) {
+			ZN_PRINT_ERROR("Could not save block");
+		}
+	}
+
+	cached_region->mutex.unlock();
 }
 
 String VoxelStreamRegionFiles::get_directory() const {
@@ -234,6 +434,8 @@ void VoxelStreamRegionFiles::set_directory(String dirpath) {
 		_directory_path = dirpath.strip_edges();
 		_meta_loaded = false;
 		_meta_saved = false;
+		_meta.zstd_dictionary_id = 0;
+		_zstd_dictionary.reset();
 		load_meta();
 		notify_property_list_changed();
 	}
@@ -272,6 +474,7 @@ FileResult VoxelStreamRegionFiles::save_meta() {
 	d["region_size_po2"] = _meta.region_size_po2;
 	d["lod_count"] = _meta.lod_count;
 	d["sector_size"] = _meta.sector_size;
+	d["zstd_dictionary_id"] = _meta.zstd_dictionary_id;
 
 	Array channel_depths;
 	channel_depths.resize(_meta.channel_depths.size());
@@ -374,6 +577,10 @@ FileResult VoxelStreamRegionFiles::load_meta() {
 	ERR_FAIL_COND_V(!u8_from_json_variant(d["region_size_po2"], meta.region_size_po2), FILE_INVALID_DATA);
 	ERR_FAIL_COND_V(!u8_from_json_variant(d["lod_count"], meta.lod_count), FILE_INVALID_DATA);
 	ERR_FAIL_COND_V(!u32_from_json_variant(d["sector_size"], meta.sector_size), FILE_INVALID_DATA);
+	// Not present in files saved before dictionaries were supported
+	if (d.has("zstd_dictionary_id")) {
+		ERR_FAIL_COND_V(!u32_from_json_variant(d["zstd_dictionary_id"], meta.zstd_dictionary_id), FILE_INVALID_DATA);
+	}
 
 	ERR_FAIL_COND_V(meta.version < 0, FILE_INVALID_DATA);
 
@@ -385,6 +592,15 @@ FileResult VoxelStreamRegionFiles::load_meta() {
 
 	ERR_FAIL_COND_V(!check_meta(meta), FILE_INVALID_DATA);
 
+	if (meta.zstd_dictionary_id != 0) {
+		const FileResult dictionary_res = load_dictionary(meta.zstd_dictionary_id);
+		if (dictionary_res != FILE_OK) {
+			return dictionary_res;
+		}
+	} else {
+		_zstd_dictionary.reset();
+	}
+
 	_meta = meta;
 	_meta_loaded = true;
 	_meta_saved = true;
@@ -392,6 +608,63 @@ FileResult VoxelStreamRegionFiles::load_meta() {
 	return FILE_OK;
 }
 
+FileResult VoxelStreamRegionFiles::save_dictionary(Span<const uint8_t> data) {
+	ERR_FAIL_COND_V(_directory_path == "", FILE_CANT_OPEN);
+
+	{
+		const CharString directory_path_utf8 = _directory_path.utf8();
+		const Error err = check_directory_created_using_file_locker(directory_path_utf8.get_data());
+		if (err != OK) {
+			ERR_PRINT("Could not save dictionary");
+			return FILE_CANT_OPEN;
+		}
+	}
+
+	const String dictionary_path = _directory_path.path_join(DICTIONARY_FILE_NAME);
+	const CharString dictionary_path_utf8 = dictionary_path.utf8();
+
+	Error err;
+	VoxelFileLockerWrite file_wlock(dictionary_path_utf8.get_data());
+	Ref<FileAccess> f = open_file(dictionary_path, FileAccess::WRITE, err);
+	if (f.is_null()) {
+		ERR_PRINT(String("Could not save {0}").format(varray(dictionary_path)));
+		return FILE_CANT_OPEN;
+	}
+
+	store_buffer(**f, data);
+
+	return FILE_OK;
+}
+
+FileResult VoxelStreamRegionFiles::load_dictionary(uint32_t expected_id) {
+	const String dictionary_path = _directory_path.path_join(DICTIONARY_FILE_NAME);
+	std::vector<uint8_t> data;
+
+	{
+		Error err;
+		const CharString dictionary_path_utf8 = dictionary_path.utf8();
+		VoxelFileLockerRead file_rlock(dictionary_path_utf8.get_data());
+		Ref<FileAccess> f = open_file(dictionary_path, FileAccess::READ, err);
+		if (f.is_null()) {
+			ERR_PRINT(String("Could not open {0}, blocks compressed with it can't be loaded")
+							  .format(varray(dictionary_path)));
+			return FILE_CANT_OPEN;
+		}
+		data.resize(f->get_length());
+		ERR_FAIL_COND_V(data.size() == 0, FILE_INVALID_DATA);
+		ERR_FAIL_COND_V(get_buffer(**f, to_span(data)) != data.size(), FILE_UNEXPECTED_EOF);
+	}
+
+	std::shared_ptr<CompressedData::ZstdDictionary> dictionary =
+			make_shared_instance<CompressedData::ZstdDictionary>(to_span_const(data), _block_compression_level);
+
+	ERR_FAIL_COND_V_MSG(dictionary->get_id() != expected_id, FILE_INVALID_DATA,
+			String("{0} doesn't match the meta file").format(varray(dictionary_path)));
+
+	_zstd_dictionary = dictionary;
+	return FILE_OK;
+}
+
 bool VoxelStreamRegionFiles::check_meta(const Meta &meta) {
 	ERR_FAIL_COND_V(meta.block_size_po2 < 1 || meta.block_size_po2 > 8, false);
 	ERR_FAIL_COND_V(meta.region_size_po2 < 1 || meta.region_size_po2 > 8, false);
@@ -408,13 +681,20 @@ Vector3i VoxelStreamRegionFiles::get_region_position_from_blocks(const Vector3i
 	return block_position >> _meta.region_size_po2;
 }
 
+Vector3i VoxelStreamRegionFiles::get_region_position_from_voxels(const Vector3i &origin_in_voxels, int lod) const {
+	return get_region_position_from_blocks(get_block_position_from_voxels(origin_in_voxels) >> lod);
+}
+
 void VoxelStreamRegionFiles::close_all_regions() {
-	for (unsigned int i = 0; i < _region_cache.size(); ++i) {
-		CachedRegion *cache = _region_cache[i];
-		close_region(cache);
-		memdelete(cache);
+	for (const std::shared_ptr<CachedRegion> &cached_region : _region_lru) {
+		// Wait until threads using the region are done
+		MutexLock rlock(cached_region->mutex);
+		cached_region->region.close();
+		cached_region->state = CachedRegion::STATE_CLOSED;
 	}
 	_region_cache.clear();
+	_region_lru.clear();
+	unmap_all_regions();
 }
 
 String VoxelStreamRegionFiles::get_region_file_path(const Vector3i &region_pos, unsigned int lod) const {
@@ -428,123 +708,325 @@ String VoxelStreamRegionFiles::get_region_file_path(const Vector3i &region_pos,
 	return _directory_path.path_join(String("regions/lod{0}/r.{1}.{2}.{3}.{4}").format(a));
 }
 
-VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::get_region_from_cache(const Vector3i pos, int lod) const {
-	// A linear search might be better than a Map data structure,
-	// because it's unlikely to have more than about 10 regions cached at a time
-	for (unsigned int i = 0; i < _region_cache.size(); ++i) {
-		CachedRegion *r = _region_cache[i];
-		if (r->position == pos && r->lod == lod) {
-			return r;
-		}
+// Only meant to be used by one thread, which must not hold the mutex of the region while using it.
+std::shared_ptr<VoxelStreamRegionFiles::CachedRegion> VoxelStreamRegionFiles::open_region(
+		const Vector3i region_pos, unsigned int lod, bool create_if_not_found) {
+	std::shared_ptr<CachedRegion> cached_region;
+	RegionFormat region_format;
+	CompressedData::Settings compression_settings;
+	{
+		MutexLock lock(_mutex);
+		ERR_FAIL_COND_V(!_meta_loaded, nullptr);
+		cached_region = get_or_create_cached_region(region_pos, lod);
+		region_format = get_region_format();
+		compression_settings = get_compression_settings();
+	}
+	MutexLock rlock(cached_region->mutex);
+	if (!open_cached_region(*cached_region, region_format, compression_settings, create_if_not_found)) {
+		return nullptr;
 	}
-	return nullptr;
+	return cached_region;
 }
 
-VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::open_region(
-		const Vector3i region_pos, unsigned int lod, bool create_if_not_found) {
-	ZN_PROFILE_SCOPE();
-	ERR_FAIL_COND_V(!_meta_loaded, nullptr);
-	ERR_FAIL_COND_V(lod < 0, nullptr);
+std::shared_ptr<VoxelStreamRegionFiles::CachedRegion> VoxelStreamRegionFiles::get_or_create_cached_region(
+		const Vector3i region_pos, unsigned int lod) {
+	// The main mutex must be locked
+	const RegionKey key{ region_pos, lod };
 
-	CachedRegion *cached_region = get_region_from_cache(region_pos, lod);
-	if (cached_region != nullptr) {
-		return cached_region;
+	auto it = _region_cache.find(key);
+	if (it != _region_cache.end()) {
+		// Move to the front of the LRU list
+		_region_lru.splice(_region_lru.begin(), _region_lru, it->second);
+		return *it->second;
 	}
 
-	while (_region_cache.size() > _max_open_regions - 1) {
-		close_oldest_region();
-	}
-	// Not in cache, we'll have to open or create it
+	close_unused_regions(_max_open_regions - 1);
 
-	String fpath = get_region_file_path(region_pos, lod);
+	// The file is not opened here, so other threads don't have to wait for it
+	std::shared_ptr<CachedRegion> cached_region = make_shared_instance<CachedRegion>();
+	cached_region->position = region_pos;
+	cached_region->lod = lod;
+	cached_region->file_path = get_region_file_path(region_pos, lod);
 
-	cached_region = memnew(CachedRegion);
+	_region_lru.push_front(cached_region);
+	_region_cache.insert({ key, _region_lru.begin() });
 
-	// Configure format because we might have to create the file, and some old file versions don't embed format
-	{
-		RegionFormat format;
-		format.block_size_po2 = _meta.block_size_po2;
-		format.channel_depths = _meta.channel_depths;
-		// TODO Palette support
-		format.has_palette = false;
-		format.region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
-		format.sector_size = _meta.sector_size;
+	return cached_region;
+}
 
-		cached_region->region.set_format(format);
-		cached_region->position = region_pos;
-		cached_region->lod = lod;
+bool VoxelStreamRegionFiles::open_cached_region(CachedRegion &cache, const RegionFormat &region_format,
+		const CompressedData::Settings &compression_settings, bool create_if_not_found) {
+	ZN_PROFILE_SCOPE();
+	// The mutex of the region must be locked
+
+	// Settings can change while the region is open
+	cache.region.set_compression_settings(compression_settings);
+
+	switch (cache.state) {
+		case CachedRegion::STATE_OPEN:
+			return true;
+		case CachedRegion::STATE_CLOSED:
+			return false;
+		case CachedRegion::STATE_MISSING:
+			// No need to check the file system again, we assume no other process creates region files
+			if (!create_if_not_found) {
+				return false;
+			}
+			break;
+		default:
+			break;
 	}
 
-	const Error err = cached_region->region.open(fpath, create_if_not_found);
+	// Configure format because we might have to create the file, and some old file versions don't embed format
+	cache.region.set_format(region_format);
 
-	// Things we could do for optimization:
-	// - Cache the fact the file doesnt exist, so we won't need to do a system call to actually check it every time
-	// - No need to read the header again when it has been read once,
-	//   we assume no other process will modify region files
+	const Error err = cache.region.open(cache.file_path, create_if_not_found);
 
 	if (err != OK) {
-		memdelete(cached_region);
 		if (create_if_not_found) {
 			// Could not create it apparently
-			ERR_PRINT(String("Could not open or create region file {0}, error: {1}").format(varray(fpath, err)));
-			return nullptr;
+			ERR_PRINT(String("Could not open or create region file {0}, error: {1}")
+							  .format(varray(cache.file_path, err)));
 		} else {
 			// Does not exist, it was probably expected
-			return nullptr;
+			cache.state = CachedRegion::STATE_MISSING;
 		}
+		return false;
 	}
 
 	// Make sure it has correct format
 	{
-		const RegionFormat &format = cached_region->region.get_format();
-		if (format.block_size_po2 != _meta.block_size_po2 //
-				|| format.channel_depths != _meta.channel_depths //
-				|| format.region_size != Vector3iUtil::create(1 << _meta.region_size_po2) //
-				|| format.sector_size != _meta.sector_size) {
+		const RegionFormat &format = cache.region.get_format();
+		if (format.block_size_po2 != region_format.block_size_po2 //
+				|| format.channel_depths != region_format.channel_depths //
+				|| format.region_size != region_format.region_size //
+				|| format.sector_size != region_format.sector_size) {
 			ERR_PRINT("Region file has unexpected format");
-			memdelete(cached_region);
-			return nullptr;
+			cache.region.close();
+			return false;
 		}
 	}
 
-	// TODO Debug check to make sure we did not already cache it
-	_region_cache.push_back(cached_region);
+	cache.state = CachedRegion::STATE_OPEN;
+	return true;
+}
 
-	cached_region->file_exists = true;
-	cached_region->last_opened = Time::get_singleton()->get_ticks_usec();
+void VoxelStreamRegionFiles::close_unused_regions(unsigned int max_count) {
+	// The main mutex must be locked.
+	// Closes least recently used regions. Regions still referenced by other threads are skipped, so the cache can
+	// temporarily hold more regions than the limit. No thread can get a new reference to a region without the main
+	// mutex, so a region with no other reference can be closed without waiting.
+	auto it = _region_lru.end();
+	while (_region_lru.size() > max_count && it != _region_lru.begin()) {
+		--it;
+		const std::shared_ptr<CachedRegion> &cached_region = *it;
+		if (cached_region.use_count() > 1) {
+			continue;
+		}
+		_region_cache.erase(RegionKey{ cached_region->position, static_cast<uint32_t>(cached_region->lod) });
+		{
+			// Not expected to be contended, but makes sure changes done by the last thread using it are visible
+			MutexLock rlock(cached_region->mutex);
+			cached_region->region.close();
+		}
+		it = _region_lru.erase(it);
+	}
+}
 
-	return cached_region;
+CompressedData::Settings VoxelStreamRegionFiles::get_compression_settings() const {
+	CompressedData::Settings settings;
+	settings.compression = _block_compression == BLOCK_COMPRESSION_ZSTD ? CompressedData::COMPRESSION_ZSTD
+																		 : CompressedData::COMPRESSION_LZ4;
+	settings.zstd_level = _block_compression_level;
+	// Also needed with LZ4, to load blocks that were saved with Zstandard
+	settings.zstd_dictionary = _zstd_dictionary;
+	return settings;
 }
 
-// TODO Get rid of to simplify?
-void VoxelStreamRegionFiles::close_region(CachedRegion *region) {
-	region->region.close();
+RegionFormat VoxelStreamRegionFiles::get_region_format() const {
+	RegionFormat format;
+	format.block_size_po2 = _meta.block_size_po2;
+	format.channel_depths = _meta.channel_depths;
+	// TODO Palette support
+	format.has_palette = false;
+	format.region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+	format.sector_size = _meta.sector_size;
+	return format;
 }
 
-void VoxelStreamRegionFiles::close_oldest_region() {
-	// Close region assumed to be the least recently used
+std::shared_ptr<VoxelStreamRegionFiles::MappedRegion> VoxelStreamRegionFiles::get_or_map_region(
+		const Vector3i region_pos, unsigned int lod) {
+	ZN_PROFILE_SCOPE();
 
-	if (_region_cache.size() == 0) {
-		return;
+	const RegionKey key{ region_pos, lod };
+
+	if (_region_cache.find(key) != _region_cache.end()) {
+		// Opened with regular file access, which might have written changes that are not flushed yet
+		return nullptr;
 	}
 
-	int oldest_index = -1;
-	uint64_t oldest_time = 0;
 	const uint64_t now = Time::get_singleton()->get_ticks_usec();
 
-	for (unsigned int i = 0; i < _region_cache.size(); ++i) {
-		const CachedRegion *r = _region_cache[i];
-		const uint64_t time = now - r->last_opened;
-		if (time >= oldest_time) {
-			oldest_index = i;
+	auto it = _mapped_regions.find(key);
+	if (it != _mapped_regions.end()) {
+		it->second->last_used = now;
+		return it->second;
+	}
+
+	if (_mapped_regions.size() >= _max_mapped_regions) {
+		// Unmap the least recently used. Threads still reading from it keep it alive until they are done.
+		// This only happens when mapping a new region, which is much more expensive than going through the list.
+		auto oldest_it = _mapped_regions.begin();
+		for (auto candidate_it = _mapped_regions.begin(); candidate_it != _mapped_regions.end(); ++candidate_it) {
+			if (candidate_it->second->last_used < oldest_it->second->last_used) {
+				oldest_it = candidate_it;
+			}
+		}
+		_mapped_regions.erase(oldest_it);
+	}
+
+	std::shared_ptr<MappedRegion> mapped_region = make_shared_instance<MappedRegion>();
+	mapped_region->position = region_pos;
+	mapped_region->lod = lod;
+	mapped_region->last_used = now;
+
+	// Some old file versions don't embed format
+	mapped_region->region.set_format(get_region_format());
+	mapped_region->region.set_compression_settings(get_compression_settings());
+
+	const Error err = mapped_region->region.open_mapped(get_region_file_path(region_pos, lod));
+	if (err != OK) {
+		// The file might not exist, or can't be mapped. Regular file access will be used instead.
+		return nullptr;
+	}
+
+	// Make sure it has correct format
+	const RegionFormat &format = mapped_region->region.get_format();
+	if (format.block_size_po2 != _meta.block_size_po2 //
+			|| format.channel_depths != _meta.channel_depths //
+			|| format.region_size != Vector3iUtil::create(1 << _meta.region_size_po2) //
+			|| format.sector_size != _meta.sector_size) {
+		// Regular file access will report the error
+		return nullptr;
+	}
+
+	_mapped_regions.insert({ key, mapped_region });
+	return mapped_region;
+}
+
+void VoxelStreamRegionFiles::unmap_region(const Vector3i region_pos, unsigned int lod) {
+	auto it = _mapped_regions.find(RegionKey{ region_pos, lod });
+	if (it == _mapped_regions.end()) {
+		return;
+	}
+	std::shared_ptr<MappedRegion> mapped_region = it->second;
+	_mapped_regions.erase(it);
+	// Wait until threads loading blocks from it are done. No other thread can start reading it, because that
+	// requires the main mutex.
+	RWLockWrite wlock(mapped_region->lock);
+}
+
+void VoxelStreamRegionFiles::unmap_all_regions() {
+	for (auto it = _mapped_regions.begin(); it != _mapped_regions.end(); ++it) {
+		RWLockWrite wlock(it->second->lock);
+	}
+	_mapped_regions.clear();
+}
+
+void VoxelStreamRegionFiles::get_region_keys_from_files(
+		const String &directory_path, unsigned int lod_count, std::vector<RegionKey> &out_keys) {
+	for (unsigned int lod = 0; lod < lod_count; ++lod) {
+		const String lod_folder = directory_path.path_join("regions").path_join("lod") + String::num_int64(lod);
+		const String ext = String(".") + RegionFormat::FILE_EXTENSION;
+
+		Ref<DirAccess> da = open_directory(lod_folder);
+		if (da.is_null()) {
+			continue;
+		}
+
+		da->list_dir_begin();
+
+		while (true) {
+			String fname = da->get_next();
+			if (fname == "") {
+				break;
+			}
+			if (da->current_is_dir()) {
+				continue;
+			}
+			if (fname.ends_with(ext)) {
+				PackedStringArray parts = fname.split(".");
+				// r.x.y.z.ext
+				if (parts.size() < 4) {
+					ERR_PRINT(String("Found invalid region file: '{0}'").format(varray(fname)));
+					continue;
+				}
+				RegionKey key;
+				key.position.x = parts[1].to_int();
+				key.position.y = parts[2].to_int();
+				key.position.z = parts[3].to_int();
+				key.lod = lod;
+				out_keys.push_back(key);
+			}
+		}
+
+		da->list_dir_end();
+	}
+}
+
+int VoxelStreamRegionFiles::compact() {
+	ZN_PROFILE_SCOPE();
+
+	std::vector<RegionKey> region_keys;
+	{
+		MutexLock lock(_mutex);
+		if (_directory_path.is_empty() || (!_meta_loaded && load_meta() != FILE_OK)) {
+			// No block was ever saved
+			return 0;
 		}
+		// Regions that are open exist on disk too, blocks are written as soon as they are saved
+		get_region_keys_from_files(_directory_path, _meta.lod_count, region_keys);
 	}
 
-	CachedRegion *region = _region_cache[oldest_index];
-	_region_cache.erase(_region_cache.begin() + oldest_index);
+	int compacted_count = 0;
+
+	for (const RegionKey &key : region_keys) {
+		std::shared_ptr<CachedRegion> cached_region;
+		RegionFormat region_format;
+		CompressedData::Settings compression_settings;
+		{
+			MutexLock lock(_mutex);
+			if (!_meta_loaded || key.lod >= _meta.lod_count) {
+				// The directory changed meanwhile
+				break;
+			}
+			region_format = get_region_format();
+			compression_settings = get_compression_settings();
+
+			// The file is going to be replaced, so it must not be read from a mapping anymore
+			unmap_region(key.position, key.lod);
+
+			// Holding a reference prevents the region from being closed, and from being mapped again
+			cached_region = get_or_create_cached_region(key.position, key.lod);
+		}
+
+		// Other threads using this region wait until it's compacted
+		MutexLock rlock(cached_region->mutex);
+		if (!open_cached_region(*cached_region, region_format, compression_settings, false)) {
+			continue;
+		}
+		ZN_PRINT_VERBOSE(format("Compacting region lod{}/{}", key.lod, key.position));
+		if (cached_region->region.compact() != OK) {
+			ZN_PRINT_ERROR(format("Failed to compact region file {}", cached_region->file_path));
+			if (!cached_region->region.is_open()) {
+				cached_region->state = CachedRegion::STATE_CLOSED;
+			}
+			continue;
+		}
+		++compacted_count;
+	}
 
-	close_region(region);
-	memdelete(region);
+	return compacted_count;
 }
 
 static inline int convert_block_coordinate(int p_x, int old_size, int new_size) {
@@ -602,54 +1084,18 @@ void VoxelStreamRegionFiles::_convert_files(Meta new_meta) {
 		ZN_PRINT_VERBOSE(format("Data backed up as {}", old_dir));
 	}
 
-	struct PositionAndLod {
-		Vector3i position;
-		int lod;
-	};
-
 	ERR_FAIL_COND(old_stream->load_meta() != FILE_OK);
 
-	std::vector<PositionAndLod> old_region_list;
 	Meta old_meta = old_stream->_meta;
 
 	// Get list of all regions from the old stream
-	{
-		for (int lod = 0; lod < old_meta.lod_count; ++lod) {
-			const String lod_folder =
-					old_stream->_directory_path.path_join("regions").path_join("lod") + String::num_int64(lod);
-			const String ext = String(".") + RegionFormat::FILE_EXTENSION;
-
-			Ref<DirAccess> da = open_directory(lod_folder);
-			if (da.is_null()) {
-				continue;
-			}
+	std::vector<RegionKey> old_region_list;
+	get_region_keys_from_files(old_stream->_directory_path, old_meta.lod_count, old_region_list);
 
-			da->list_dir_begin();
-
-			while (true) {
-				String fname = da->get_next();
-				if (fname == "") {
-					break;
-				}
-				if (da->current_is_dir()) {
-					continue;
-				}
-				if (fname.ends_with(ext)) {
-					PackedStringArray parts = fname.split(".");
-					// r.x.y.z.ext
-					ERR_FAIL_COND_MSG(
-							parts.size() < 4, String("Found invalid region file: '{0}'").format(varray(fname)));
-					PositionAndLod p;
-					p.position.x = parts[1].to_int();
-					p.position.y = parts[2].to_int();
-					p.position.z = parts[3].to_int();
-					p.lod = lod;
-					old_region_list.push_back(p);
-				}
-			}
-
-			da->list_dir_end();
-		}
+	// The dictionary is kept, so blocks can be compressed with it again
+	new_meta.zstd_dictionary_id = old_meta.zstd_dictionary_id;
+	if (_zstd_dictionary != nullptr) {
+		ERR_FAIL_COND(save_dictionary(_zstd_dictionary->get_data()) != FILE_OK);
 	}
 
 	_meta = new_meta;
@@ -663,9 +1109,10 @@ void VoxelStreamRegionFiles::_convert_files(Meta new_meta) {
 	// Read all blocks from the old stream and write them into the new one
 
 	for (unsigned int i = 0; i < old_region_list.size(); ++i) {
-		PositionAndLod region_info = old_region_list[i];
+		const RegionKey region_info = old_region_list[i];
 
-		const CachedRegion *old_region = old_stream->open_region(region_info.position, region_info.lod, false);
+		std::shared_ptr<CachedRegion> old_region =
+				old_stream->open_region(region_info.position, region_info.lod, false);
 		if (old_region == nullptr) {
 			continue;
 		}
@@ -868,6 +1315,120 @@ void VoxelStreamRegionFiles::set_lod_count(int p_lod_count) {
 	emit_changed();
 }
 
+void VoxelStreamRegionFiles::set_memory_mapping_enabled(bool enabled) {
+	MutexLock lock(_mutex);
+	if (_memory_mapping_enabled == enabled) {
+		return;
+	}
+	_memory_mapping_enabled = enabled;
+	if (!enabled) {
+		unmap_all_regions();
+	}
+}
+
+bool VoxelStreamRegionFiles::is_memory_mapping_enabled() const {
+	MutexLock lock(_mutex);
+	return _memory_mapping_enabled;
+}
+
+void VoxelStreamRegionFiles::set_max_open_regions(int count) {
+	ERR_FAIL_COND(count < 1 || count > static_cast<int>(MAX_OPEN_REGIONS_LIMIT));
+	MutexLock lock(_mutex);
+	_max_open_regions = count;
+	close_unused_regions(_max_open_regions);
+}
+
+int VoxelStreamRegionFiles::get_max_open_regions() const {
+	MutexLock lock(_mutex);
+	return _max_open_regions;
+}
+
+void VoxelStreamRegionFiles::set_block_compression(BlockCompression compression) {
+	ERR_FAIL_INDEX(compression, _BLOCK_COMPRESSION_COUNT);
+	MutexLock lock(_mutex);
+	// Regions get the new settings next time they are used
+	_block_compression = compression;
+}
+
+VoxelStream::BlockCompression VoxelStreamRegionFiles::get_block_compression() const {
+	MutexLock lock(_mutex);
+	return _block_compression;
+}
+
+void VoxelStreamRegionFiles::set_block_compression_level(int level) {
+	ERR_FAIL_COND(level < CompressedData::ZSTD_MIN_LEVEL || level > CompressedData::ZSTD_MAX_LEVEL);
+	MutexLock lock(_mutex);
+	if (_block_compression_level == level) {
+		return;
+	}
+	_block_compression_level = level;
+	if (_zstd_dictionary != nullptr) {
+		// The level of a dictionary can't change. The data remains the same, so its ID doesn't change.
+		_zstd_dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+				_zstd_dictionary->get_data(), _block_compression_level);
+		unmap_all_regions();
+	}
+}
+
+int VoxelStreamRegionFiles::get_block_compression_level() const {
+	MutexLock lock(_mutex);
+	return _block_compression_level;
+}
+
+bool VoxelStreamRegionFiles::train_block_compression_dictionary(
+		Span<const VoxelBufferInternal *const> samples, unsigned int max_size) {
+	ZN_PROFILE_SCOPE();
+
+	std::vector<uint8_t> dictionary_data;
+	ERR_FAIL_COND_V_MSG(!BlockSerializer::train_zstd_dictionary(samples, max_size, dictionary_data), false,
+			"Could not build a dictionary from the provided blocks");
+
+	MutexLock lock(_mutex);
+
+	ERR_FAIL_COND_V(_directory_path.is_empty(), false);
+
+	if (!_meta_loaded) {
+		const FileResult load_res = load_meta();
+		ERR_FAIL_COND_V(load_res != FILE_OK && load_res != FILE_CANT_OPEN, false);
+	}
+
+	ERR_FAIL_COND_V_MSG(_meta.zstd_dictionary_id != 0, false,
+			"The stream already has a dictionary. Blocks saved with it could no longer be loaded.");
+
+	ERR_FAIL_COND_V(save_dictionary(to_span_const(dictionary_data)) != FILE_OK, false);
+
+	std::shared_ptr<CompressedData::ZstdDictionary> dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+			to_span_const(dictionary_data), _block_compression_level);
+	_meta.zstd_dictionary_id = dictionary->get_id();
+	_zstd_dictionary = dictionary;
+
+	if (_meta_saved) {
+		ERR_FAIL_COND_V(save_meta() != FILE_OK, false);
+	}
+	// Otherwise, the meta file will be saved with the first block
+
+	unmap_all_regions();
+
+	return true;
+}
+
+bool VoxelStreamRegionFiles::has_block_compression_dictionary() const {
+	MutexLock lock(_mutex);
+	return _zstd_dictionary != nullptr;
+}
+
+bool VoxelStreamRegionFiles::_b_train_block_compression_dictionary(Array voxel_buffers, int max_size) {
+	ERR_FAIL_COND_V(max_size <= 0, false);
+	std::vector<const VoxelBufferInternal *> samples;
+	samples.reserve(voxel_buffers.size());
+	for (int i = 0; i < voxel_buffers.size(); ++i) {
+		Ref<gd::VoxelBuffer> voxel_buffer = voxel_buffers[i];
+		ERR_FAIL_COND_V(voxel_buffer.is_null(), false);
+		samples.push_back(&voxel_buffer->get_buffer());
+	}
+	return train_block_compression_dictionary(to_span_const(samples), max_size);
+}
+
 void VoxelStreamRegionFiles::convert_files(Dictionary d) {
 	Meta meta;
 	meta.version = _meta.version;
@@ -915,9 +1476,42 @@ void VoxelStreamRegionFiles::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_region_size_po2"), &VoxelStreamRegionFiles::set_region_size_po2);
 	ClassDB::bind_method(D_METHOD("set_sector_size"), &VoxelStreamRegionFiles::set_sector_size);
 
+	ClassDB::bind_method(D_METHOD("set_memory_mapping_enabled", "enabled"),
+			&VoxelStreamRegionFiles::set_memory_mapping_enabled);
+	ClassDB::bind_method(D_METHOD("is_memory_mapping_enabled"), &VoxelStreamRegionFiles::is_memory_mapping_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_max_open_regions", "count"), &VoxelStreamRegionFiles::set_max_open_regions);
+	ClassDB::bind_method(D_METHOD("get_max_open_regions"), &VoxelStreamRegionFiles::get_max_open_regions);
+
+	ClassDB::bind_method(
+			D_METHOD("set_block_compression", "compression"), &VoxelStreamRegionFiles::set_block_compression);
+	ClassDB::bind_method(D_METHOD("get_block_compression"), &VoxelStreamRegionFiles::get_block_compression);
+
+	ClassDB::bind_method(
+			D_METHOD("set_block_compression_level", "level"), &VoxelStreamRegionFiles::set_block_compression_level);
+	ClassDB::bind_method(
+			D_METHOD("get_block_compression_level"), &VoxelStreamRegionFiles::get_block_compression_level);
+
+	ClassDB::bind_method(D_METHOD("train_block_compression_dictionary", "voxel_buffers", "max_size"),
+			&VoxelStreamRegionFiles::_b_train_block_compression_dictionary,
+			DEFVAL(static_cast<int>(DEFAULT_DICTIONARY_SIZE)));
+	ClassDB::bind_method(
+			D_METHOD("has_block_compression_dictionary"), &VoxelStreamRegionFiles::has_block_compression_dictionary);
+
 	ClassDB::bind_method(D_METHOD("convert_files", "new_settings"), &VoxelStreamRegionFiles::convert_files);
+	ClassDB::bind_method(D_METHOD("compact"), &VoxelStreamRegionFiles::compact);
 
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "directory", PROPERTY_HINT_DIR), "set_directory", "get_directory");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "memory_mapping_enabled"), "set_memory_mapping_enabled",
+			"is_memory_mapping_enabled");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_open_regions", PROPERTY_HINT_RANGE, "1,4096,1"),
+			"set_max_open_regions", "get_max_open_regions");
+
+	ADD_GROUP("Compression", "");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "block_compression", PROPERTY_HINT_ENUM, "LZ4,Zstandard"),
+			"set_block_compression", "get_block_compression");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "block_compression_level", PROPERTY_HINT_RANGE, "1,19,1"),
+			"set_block_compression_level", "get_block_compression_level");
 
 	ADD_GROUP("Dimensions", "");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "lod_count"), "set_lod_count", "get_lod_count");
@@ -2,11 +2,17 @@
 #define VOXEL_STREAM_REGION_H
 
 #include "../../util/fixed_array.h"
+#include "../../util/hash_funcs.h"
 #include "../../util/thread/mutex.h"
+#include "../../util/thread/rw_lock.h"
 #include "../file_utils.h"
 #include "../voxel_stream.h"
 #include "region_file.h"
 
+#include <list>
+#include <memory>
+#include <unordered_map>
+
 namespace zylann::voxel {
 
 // TODO Rename VoxelStreamRegionForest
@@ -16,7 +22,10 @@ namespace zylann::voxel {
 // because it allows to keep using the same file handles and avoid switching.
 // Inspired by https://www.seedofandromeda.com/blogs/1-creating-a-region-file-system-for-a-voxel-game
 //
-// Region files are not thread-safe. Because of this, internal mutexing may often constrain the use by one thread only.
+// Region files are not thread-safe, so each open region has its own mutex. The main mutex is only held briefly to find
+// regions, so threads accessing different regions don't block each other.
+// If memory mapping is enabled, loading threads read blocks from mapped regions instead, which can be done by several
+// threads at once even within the same region.
 //
 class VoxelStreamRegionFiles : public VoxelStream {
 	GDCLASS(VoxelStreamRegionFiles, VoxelStream)
@@ -49,34 +58,68 @@ public:
 	void set_sector_size(int p_sector_size);
 	void set_lod_count(int p_lod_count);
 
+	void set_memory_mapping_enabled(bool enabled);
+	bool is_memory_mapping_enabled() const;
+
+	void set_max_open_regions(int count);
+	int get_max_open_regions() const;
+
+	void set_block_compression(BlockCompression compression);
+	BlockCompression get_block_compression() const;
+
+	void set_block_compression_level(int level);
+	int get_block_compression_level() const;
+
+	// Builds a Zstandard dictionary from blocks representative of those that will be saved, and stores it in the
+	// directory. Blocks saved with `BLOCK_COMPRESSION_ZSTD` afterward will use it. It can only be done once per
+	// directory, because blocks saved with a dictionary can't be loaded without it.
+	bool train_block_compression_dictionary(Span<const VoxelBufferInternal *const> samples, unsigned int max_size);
+	bool has_block_compression_dictionary() const;
+
 	void convert_files(Dictionary d);
 
+	// Rewrites all region files so their blocks are contiguous, removing free sectors left by blocks that changed size.
+	// This can take a while, so it is better done when few blocks are being loaded or saved. Threads accessing a region
+	// wait while it gets compacted. Returns how many regions were compacted.
+	int compact();
+
+	static const unsigned int DEFAULT_MAX_OPEN_REGIONS = 128;
+	static const unsigned int MAX_OPEN_REGIONS_LIMIT = 4096;
+	static const unsigned int DEFAULT_DICTIONARY_SIZE = 16384;
+
 protected:
 	static void _bind_methods();
 
 private:
 	struct CachedRegion;
+	struct MappedRegion;
 
-	// TODO Redundant with VoxelStream::Result. May be replaced
-	enum EmergeResult { //
-		EMERGE_OK,
-		EMERGE_OK_FALLBACK,
-		EMERGE_FAILED
-	};
-
-	EmergeResult _load_block(VoxelBufferInternal &out_buffer, Vector3i origin_in_voxels, int lod);
-	void _save_block(VoxelBufferInternal &voxel_buffer, Vector3i origin_in_voxels, int lod);
+	void load_region_blocks(Span<VoxelStream::VoxelQueryData> p_blocks, Span<const unsigned int> indices);
+	void save_region_blocks(Span<VoxelStream::VoxelQueryData> p_blocks, Span<const unsigned int> indices);
+	void get_region_groups(Span<const VoxelStream::VoxelQueryData> p_blocks, Span<const unsigned int> sorted_indices,
+			std::vector<Span<const unsigned int>> &out_groups) const;
 
 	FileResult save_meta();
 	FileResult load_meta();
+	FileResult save_dictionary(Span<const uint8_t> data);
+	FileResult load_dictionary(uint32_t expected_id);
 	Vector3i get_block_position_from_voxels(const Vector3i &origin_in_voxels) const;
 	Vector3i get_region_position_from_blocks(const Vector3i &block_position) const;
+	Vector3i get_region_position_from_voxels(const Vector3i &origin_in_voxels, int lod) const;
 	void close_all_regions();
 	String get_region_file_path(const Vector3i &region_pos, unsigned int lod) const;
-	CachedRegion *open_region(const Vector3i region_pos, unsigned int lod, bool create_if_not_found);
-	void close_region(CachedRegion *cache);
-	CachedRegion *get_region_from_cache(const Vector3i pos, int lod) const;
-	void close_oldest_region();
+	std::shared_ptr<CachedRegion> open_region(const Vector3i region_pos, unsigned int lod, bool create_if_not_found);
+	std::shared_ptr<CachedRegion> get_or_create_cached_region(const Vector3i region_pos, unsigned int lod);
+	bool open_cached_region(CachedRegion &cache, const RegionFormat &format,
+			const CompressedData::Settings &compression_settings, bool create_if_not_found);
+	void close_unused_regions(unsigned int max_count);
+	RegionFormat get_region_format() const;
+	CompressedData::Settings get_compression_settings() const;
+	std::shared_ptr<MappedRegion> get_or_map_region(const Vector3i region_pos, unsigned int lod);
+	void unmap_region(const Vector3i region_pos, unsigned int lod);
+	void unmap_all_regions();
+
+	bool _b_train_block_compression_dictionary(Array voxel_buffers, int max_size);
 
 	struct Meta {
 		uint8_t version = -1;
@@ -85,14 +128,20 @@ private:
 		uint8_t region_size_po2 = 0; // How many blocks in one cubic region
 		FixedArray<VoxelBufferInternal::Depth, VoxelBufferInternal::MAX_CHANNELS> channel_depths;
 		uint32_t sector_size = 0; // Blocks are stored at offsets multiple of that size
+		// ID of the Zstandard dictionary stored next to the meta file, or 0 if there is none
+		uint32_t zstd_dictionary_id = 0;
 	};
 
 	static bool check_meta(const Meta &meta);
 	void _convert_files(Meta new_meta);
 
+	struct RegionKey;
+	static void get_region_keys_from_files(
+			const String &directory_path, unsigned int lod_count, std::vector<RegionKey> &out_keys);
+
 	// Orders block requests so those querying the same regions get grouped together
 	struct BlockQueryComparator {
-		VoxelStreamRegionFiles *self = nullptr;
+		const VoxelStreamRegionFiles *self = nullptr;
 
 		// operator<
 		_FORCE_INLINE_ bool operator()(
@@ -102,34 +151,77 @@ private:
 			} else if (a.lod > b.lod) {
 				return false;
 			}
-			Vector3i bpos_a = self->get_block_position_from_voxels(a.origin_in_voxels);
-			Vector3i bpos_b = self->get_block_position_from_voxels(b.origin_in_voxels);
-			Vector3i rpos_a = self->get_region_position_from_blocks(bpos_a);
-			Vector3i rpos_b = self->get_region_position_from_blocks(bpos_b);
+			const Vector3i rpos_a = self->get_region_position_from_voxels(a.origin_in_voxels, a.lod);
+			const Vector3i rpos_b = self->get_region_position_from_voxels(b.origin_in_voxels, b.lod);
 			return rpos_a < rpos_b;
 		}
 	};
 
-	// TODO This is not thread-friendly.
-	// `VoxelRegionFile` is not thread-safe so we have to limit the usage to one thread at once, blocking the others.
-	// A refactoring should be done to allow better threading.
+	struct RegionKey {
+		Vector3i position;
+		uint32_t lod = 0;
+
+		inline bool operator==(const RegionKey &other) const {
+			return position == other.position && lod == other.lod;
+		}
+	};
+
+	struct RegionKeyHasher {
+		inline size_t operator()(const RegionKey &key) const {
+			return hash_djb2_one_32(key.lod, Vector3iHasher::hash(key.position));
+		}
+	};
 
 	struct CachedRegion {
+		enum State {
+			// The file was not opened yet
+			STATE_NOT_OPENED,
+			STATE_OPEN,
+			// The file was not found, so it will be created only if a block gets saved in it
+			STATE_MISSING,
+			// The stream closed it while a thread was about to use it
+			STATE_CLOSED
+		};
+
+		Vector3i position;
+		int lod = 0;
+		String file_path;
+		// Must be locked to access the fields below. Regions are opened after being added to the cache, while this is
+		// locked, so the main mutex isn't held during file operations.
+		BinaryMutex mutex;
+		State state = STATE_NOT_OPENED;
+		RegionFile region;
+	};
+
+	// Region mapped in memory for reading only. It can be used by multiple threads without locking the main mutex.
+	// Regions are not mapped while they are open in `_region_cache`, because they could have pending changes.
+	struct MappedRegion {
 		Vector3i position;
 		int lod = 0;
-		bool file_exists = false;
 		RegionFile region;
-		uint64_t last_opened = 0;
-		//uint64_t last_accessed;
+		// Locked for reading while blocks are loaded from the region, so writers can wait until it's no longer used
+		RWLock lock;
+		uint64_t last_used = 0;
 	};
 
 	String _directory_path;
 	Meta _meta;
 	bool _meta_loaded = false;
 	bool _meta_saved = false;
-	std::vector<CachedRegion *> _region_cache;
-	// TODO Add memory caches to increase capacity.
-	unsigned int _max_open_regions = MIN(8, FOPEN_MAX);
+	// Regions ordered from most to least recently used. Threads hold a reference while they use a region, which
+	// prevents it from being closed.
+	std::list<std::shared_ptr<CachedRegion>> _region_lru;
+	std::unordered_map<RegionKey, std::list<std::shared_ptr<CachedRegion>>::iterator, RegionKeyHasher> _region_cache;
+	unsigned int _max_open_regions = DEFAULT_MAX_OPEN_REGIONS;
+	// Mappings don't keep files open, so there can be more of them
+	std::unordered_map<RegionKey, std::shared_ptr<MappedRegion>, RegionKeyHasher> _mapped_regions;
+	unsigned int _max_mapped_regions = 64;
+	bool _memory_mapping_enabled = false;
+
+	BlockCompression _block_compression = BLOCK_COMPRESSION_LZ4;
+	int _block_compression_level = CompressedData::ZSTD_DEFAULT_LEVEL;
+	// Loaded with the meta file. Shared with regions, which may still use it after it gets replaced.
+	std::shared_ptr<const CompressedData::ZstdDictionary> _zstd_dictionary;
 
 	Mutex _mutex;
 };
@@ -1,14 +1,18 @@
 #include "voxel_stream_sqlite.h"
 #include "../../thirdparty/sqlite/sqlite3.h"
+#include "../../storage/voxel_buffer_gd.h"
 #include "../../util/errors.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/funcs.h"
 #include "../../util/log.h"
 #include "../../util/math/conv.h"
+#include "../../util/math/funcs.h"
 #include "../../util/profiling.h"
 #include "../../util/string_funcs.h"
 #include "../compressed_data.h"
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <string>
 #include <unordered_set>
@@ -34,6 +38,15 @@ struct BlockLocation {
 				((static_cast<uint64_t>(y) & 0xffff) << 16) | (static_cast<uint64_t>(z) & 0xffff);
 	}
 
+	static BlockLocation from_position(Vector3i pos, uint8_t lod) {
+		BlockLocation loc;
+		loc.x = pos.x;
+		loc.y = pos.y;
+		loc.z = pos.z;
+		loc.lod = lod;
+		return loc;
+	}
+
 	static BlockLocation decode(uint64_t id) {
 		BlockLocation b;
 		b.z = (id & 0xffff);
@@ -42,6 +55,48 @@ struct BlockLocation {
 		b.lod = ((id >> 48) & 0xff);
 		return b;
 	}
+
+	// Interleaves bits of coordinates (Z-order curve), so blocks close to each other in space tend to have close keys,
+	// and get stored close to each other in the database.
+	// 0l zyxzyx...zyx
+	uint64_t encode_morton() const {
+		// Flipping the sign bit keeps the order of negative coordinates
+		return (static_cast<uint64_t>(lod) << 48) | spread_bits(static_cast<uint16_t>(x) ^ 0x8000) |
+				(spread_bits(static_cast<uint16_t>(y) ^ 0x8000) << 1) |
+				(spread_bits(static_cast<uint16_t>(z) ^ 0x8000) << 2);
+	}
+
+	static BlockLocation decode_morton(uint64_t id) {
+		const uint64_t coords = id & 0xffff'ffff'ffffull;
+		BlockLocation b;
+		b.x = static_cast<uint16_t>(compact_bits(coords) ^ 0x8000);
+		b.y = static_cast<uint16_t>(compact_bits(coords >> 1) ^ 0x8000);
+		b.z = static_cast<uint16_t>(compact_bits(coords >> 2) ^ 0x8000);
+		b.lod = ((id >> 48) & 0xff);
+		return b;
+	}
+
+private:
+	// Inserts two zero bits after each bit of the value (up to 21 bits)
+	static inline uint64_t spread_bits(uint64_t i) {
+		i = (i | (i << 32)) & 0x1f00000000ffffull;
+		i = (i | (i << 16)) & 0x1f0000ff0000ffull;
+		i = (i | (i << 8)) & 0x100f00f00f00f00full;
+		i = (i | (i << 4)) & 0x10c30c30c30c30c3ull;
+		i = (i | (i << 2)) & 0x1249249249249249ull;
+		return i;
+	}
+
+	// Inverse of `spread_bits`, taking every third bit
+	static inline uint64_t compact_bits(uint64_t i) {
+		i &= 0x1249249249249249ull;
+		i = (i ^ (i >> 2)) & 0x10c30c30c30c30c3ull;
+		i = (i ^ (i >> 4)) & 0x100f00f00f00f00full;
+		i = (i ^ (i >> 8)) & 0x1f0000ff0000ffull;
+		i = (i ^ (i >> 16)) & 0x1f00000000ffffull;
+		i = (i ^ (i >> 32)) & 0x1fffffull;
+		return i;
+	}
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -49,7 +104,18 @@ struct BlockLocation {
 // One connection to the database, with our prepared statements
 class VoxelStreamSQLiteInternal {
 public:
-	static const int VERSION = 0;
+	// Block locations are encoded with `BlockLocation::encode`
+	static const int VERSION_LEGACY_KEYS = 0;
+	// Block locations are encoded with `BlockLocation::encode_morton`
+	static const int VERSION_MORTON_KEYS = 1;
+	// How many blocks are queried at once by `load_blocks`
+	static const unsigned int LOAD_BATCH_SIZE = 64;
+	// With Morton keys, sorted keys closer than this are loaded with a range scan. Rows in the gaps are skipped.
+	static const uint64_t MAX_RANGE_SCAN_GAP = 8;
+	// Fewer keys are cheaper to look up one by one
+	static const unsigned int MIN_RANGE_SCAN_KEYS = 8;
+	// Writing locks the whole database for a short time, so connections wait for each other instead of failing
+	static const int BUSY_TIMEOUT_MS = 5000;
 
 	struct Meta {
 		int version = -1;
@@ -71,7 +137,7 @@ public:
 	VoxelStreamSQLiteInternal();
 	~VoxelStreamSQLiteInternal();
 
-	bool open(const char *fpath);
+	bool open(const char *fpath, const VoxelStreamSQLite::ConnectionOptions &options);
 	void close();
 
 	bool is_open() const {
@@ -87,12 +153,31 @@ public:
 		return _opened_path.c_str();
 	}
 
+	const VoxelStreamSQLite::ConnectionOptions &get_options() const {
+		return _options;
+	}
+
+	// Keys of blocks in the database. Their encoding depends on the version of the database.
+	uint64_t encode_location(BlockLocation loc) const {
+		return _morton_keys ? loc.encode_morton() : loc.encode();
+	}
+
+	BlockLocation decode_location(uint64_t key) const {
+		return _morton_keys ? BlockLocation::decode_morton(key) : BlockLocation::decode(key);
+	}
+
 	bool begin_transaction();
 	bool end_transaction();
+	void rollback_transaction();
 
 	bool save_block(BlockLocation loc, const std::vector<uint8_t> &block_data, BlockType type);
 	VoxelStream::ResultCode load_block(BlockLocation loc, std::vector<uint8_t> &out_block_data, BlockType type);
 
+	// Loads many blocks with a few queries instead of one per block. Blocks with no data are not reported.
+	// Keys are obtained with `encode_location`, and must be sorted.
+	bool load_blocks(Span<const uint64_t> location_keys, BlockType type, void *callback_data,
+			void (*process_block_func)(void *callback_data, uint64_t location_key, Span<const uint8_t> block_data));
+
 	bool load_all_blocks(void *callback_data,
 			void (*process_block_func)(void *callback_data, BlockLocation location, Span<const uint8_t> voxel_data,
 					Span<const uint8_t> instances_data));
@@ -103,7 +188,15 @@ public:
 	Meta load_meta();
 	void save_meta(Meta meta);
 
+	// Zstandard dictionary used to compress blocks. Returns false if there is none.
+	bool load_dictionary(std::vector<uint8_t> &out_data);
+	bool save_dictionary(Span<const uint8_t> data);
+
 private:
+	bool migrate_to_morton_keys();
+	bool load_block_rows(sqlite3_stmt *statement, Span<const uint64_t> requested_keys, void *callback_data,
+			void (*process_block_func)(void *callback_data, uint64_t location_key, Span<const uint8_t> block_data));
+
 	struct TransactionScope {
 		VoxelStreamSQLiteInternal &db;
 		TransactionScope(VoxelStreamSQLiteInternal &p_db) : db(p_db) {
@@ -123,6 +216,17 @@ private:
 		return true;
 	}
 
+	static bool exec(sqlite3 *db, const char *sql) {
+		char *error_message = nullptr;
+		const int rc = sqlite3_exec(db, sql, nullptr, nullptr, &error_message);
+		if (rc != SQLITE_OK) {
+			ERR_PRINT(String("Executing \"{0}\" failed: {1}").format(varray(sql, error_message)));
+			sqlite3_free(error_message);
+			return false;
+		}
+		return true;
+	}
+
 	static void finalize(sqlite3_stmt *&s) {
 		if (s != nullptr) {
 			sqlite3_finalize(s);
@@ -131,19 +235,27 @@ private:
 	}
 
 	std::string _opened_path;
+	VoxelStreamSQLite::ConnectionOptions _options;
+	bool _morton_keys = false;
 	sqlite3 *_db = nullptr;
 	sqlite3_stmt *_begin_statement = nullptr;
 	sqlite3_stmt *_end_statement = nullptr;
 	sqlite3_stmt *_update_voxel_block_statement = nullptr;
 	sqlite3_stmt *_get_voxel_block_statement = nullptr;
+	sqlite3_stmt *_get_voxel_blocks_statement = nullptr;
+	sqlite3_stmt *_get_voxel_block_range_statement = nullptr;
 	sqlite3_stmt *_update_instance_block_statement = nullptr;
 	sqlite3_stmt *_get_instance_block_statement = nullptr;
+	sqlite3_stmt *_get_instance_blocks_statement = nullptr;
+	sqlite3_stmt *_get_instance_block_range_statement = nullptr;
 	sqlite3_stmt *_load_meta_statement = nullptr;
 	sqlite3_stmt *_save_meta_statement = nullptr;
 	sqlite3_stmt *_load_channels_statement = nullptr;
 	sqlite3_stmt *_save_channel_statement = nullptr;
 	sqlite3_stmt *_load_all_blocks_statement = nullptr;
 	sqlite3_stmt *_load_all_block_keys_statement = nullptr;
+	sqlite3_stmt *_load_dictionary_statement = nullptr;
+	sqlite3_stmt *_save_dictionary_statement = nullptr;
 };
 
 VoxelStreamSQLiteInternal::VoxelStreamSQLiteInternal() {}
@@ -152,7 +264,7 @@ VoxelStreamSQLiteInternal::~VoxelStreamSQLiteInternal() {
 	close();
 }
 
-bool VoxelStreamSQLiteInternal::open(const char *fpath) {
+bool VoxelStreamSQLiteInternal::open(const char *fpath, const VoxelStreamSQLite::ConnectionOptions &options) {
 	ZN_PROFILE_SCOPE();
 	close();
 
@@ -166,11 +278,47 @@ bool VoxelStreamSQLiteInternal::open(const char *fpath) {
 	sqlite3 *db = _db;
 	char *error_message = nullptr;
 
+	sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
+
+	// With write-ahead logging, connections can keep reading while another is writing, and transactions only append
+	// to the log, so flushing saved blocks doesn't stall loading threads. The mode is stored in the database file.
+	{
+		sqlite3_stmt *journal_mode_statement = nullptr;
+		if (!prepare(db, &journal_mode_statement, "PRAGMA journal_mode=WAL")) {
+			close();
+			return false;
+		}
+		if (sqlite3_step(journal_mode_statement) == SQLITE_ROW) {
+			const char *journal_mode =
+					reinterpret_cast<const char *>(sqlite3_column_text(journal_mode_statement, 0));
+			if (journal_mode == nullptr || strcmp(journal_mode, "wal") != 0) {
+				// Some platforms or file systems don't support it. SQLite keeps using its previous mode.
+				ZN_PRINT_VERBOSE(format("SQLite: could not use WAL journal mode, got {}",
+						journal_mode != nullptr ? journal_mode : "null"));
+			}
+		}
+		finalize(journal_mode_statement);
+	}
+
+	// Those are not stored in the database, they have to be set for every connection
+	const std::string pragmas = //
+			"PRAGMA synchronous=" + std::to_string(options.synchronous_mode) + ";" +
+			"PRAGMA mmap_size=" + std::to_string(int64_t(options.mmap_size_mb) * 1024 * 1024) + ";" +
+			// Negative values are in kibibytes instead of pages
+			"PRAGMA cache_size=-" + std::to_string(options.page_cache_size_kb) + ";";
+	if (!exec(db, pragmas.c_str())) {
+		close();
+		return false;
+	}
+	_options = options;
+
 	// Create tables if they dont exist
-	const char *tables[3] = { "CREATE TABLE IF NOT EXISTS meta (version INTEGER, block_size_po2 INTEGER)",
+	const char *tables[4] = { "CREATE TABLE IF NOT EXISTS meta (version INTEGER, block_size_po2 INTEGER)",
 		"CREATE TABLE IF NOT EXISTS blocks (loc INTEGER PRIMARY KEY, vb BLOB, instances BLOB)",
-		"CREATE TABLE IF NOT EXISTS channels (idx INTEGER PRIMARY KEY, depth INTEGER)" };
-	for (size_t i = 0; i < 3; ++i) {
+		"CREATE TABLE IF NOT EXISTS channels (idx INTEGER PRIMARY KEY, depth INTEGER)",
+		// Only one row is used. Added later, so databases without it get it when opened.
+		"CREATE TABLE IF NOT EXISTS dictionaries (idx INTEGER PRIMARY KEY, data BLOB)" };
+	for (size_t i = 0; i < 4; ++i) {
 		rc = sqlite3_exec(db, tables[i], nullptr, nullptr, &error_message);
 		if (rc != SQLITE_OK) {
 			ERR_PRINT(String("Failed to create table: {0}").format(varray(error_message)));
@@ -189,6 +337,21 @@ bool VoxelStreamSQLiteInternal::open(const char *fpath) {
 	if (!prepare(db, &_get_voxel_block_statement, "SELECT vb FROM blocks WHERE loc=:loc")) {
 		return false;
 	}
+	{
+		// SELECT loc, vb FROM blocks WHERE loc IN (?,?,?...)
+		std::string sql = "SELECT loc, vb FROM blocks WHERE loc IN (?";
+		for (unsigned int i = 1; i < LOAD_BATCH_SIZE; ++i) {
+			sql += ",?";
+		}
+		sql += ")";
+		if (!prepare(db, &_get_voxel_blocks_statement, sql.c_str())) {
+			return false;
+		}
+	}
+	if (!prepare(db, &_get_voxel_block_range_statement,
+				"SELECT loc, vb FROM blocks WHERE loc BETWEEN :min_loc AND :max_loc")) {
+		return false;
+	}
 	if (!prepare(db, &_update_instance_block_statement,
 				"INSERT INTO blocks VALUES (:loc, null, :instances) "
 				"ON CONFLICT(loc) DO UPDATE SET instances=excluded.instances")) {
@@ -197,6 +360,20 @@ bool VoxelStreamSQLiteInternal::open(const char *fpath) {
 	if (!prepare(db, &_get_instance_block_statement, "SELECT instances FROM blocks WHERE loc=:loc")) {
 		return false;
 	}
+	{
+		std::string sql = "SELECT loc, instances FROM blocks WHERE loc IN (?";
+		for (unsigned int i = 1; i < LOAD_BATCH_SIZE; ++i) {
+			sql += ",?";
+		}
+		sql += ")";
+		if (!prepare(db, &_get_instance_blocks_statement, sql.c_str())) {
+			return false;
+		}
+	}
+	if (!prepare(db, &_get_instance_block_range_statement,
+				"SELECT loc, instances FROM blocks WHERE loc BETWEEN :min_loc AND :max_loc")) {
+		return false;
+	}
 	if (!prepare(db, &_begin_statement, "BEGIN")) {
 		return false;
 	}
@@ -223,12 +400,18 @@ bool VoxelStreamSQLiteInternal::open(const char *fpath) {
 	if (!prepare(db, &_load_all_block_keys_statement, "SELECT loc FROM blocks")) {
 		return false;
 	}
+	if (!prepare(db, &_load_dictionary_statement, "SELECT data FROM dictionaries WHERE idx=0")) {
+		return false;
+	}
+	if (!prepare(db, &_save_dictionary_statement, "INSERT INTO dictionaries VALUES (0, :data)")) {
+		return false;
+	}
 
 	// Is the database setup?
 	Meta meta = load_meta();
 	if (meta.version == -1) {
 		// Setup database
-		meta.version = VERSION;
+		meta.version = options.morton_keys ? VERSION_MORTON_KEYS : VERSION_LEGACY_KEYS;
 		// Defaults
 		meta.block_size_po2 = constants::DEFAULT_BLOCK_SIZE_PO2;
 		for (unsigned int i = 0; i < meta.channels.size(); ++i) {
@@ -237,12 +420,87 @@ bool VoxelStreamSQLiteInternal::open(const char *fpath) {
 			channel.depth = VoxelBufferInternal::DEPTH_16_BIT;
 		}
 		save_meta(meta);
+
+	} else if (meta.version == VERSION_LEGACY_KEYS && options.morton_keys) {
+		if (!migrate_to_morton_keys()) {
+			close();
+			return false;
+		}
+		meta.version = VERSION_MORTON_KEYS;
+
+	} else if (meta.version > VERSION_MORTON_KEYS) {
+		ERR_PRINT(String("Database version {0} is not supported").format(varray(meta.version)));
+		close();
+		return false;
 	}
 
+	_morton_keys = meta.version == VERSION_MORTON_KEYS;
 	_opened_path = fpath;
 	return true;
 }
 
+namespace {
+void morton_key_from_legacy_key_sql_function(sqlite3_context *context, int argc, sqlite3_value **argv) {
+	const uint64_t legacy_key = sqlite3_value_int64(argv[0]);
+	sqlite3_result_int64(context, BlockLocation::decode(legacy_key).encode_morton());
+}
+} // namespace
+
+// Re-inserts all blocks with Morton keys. Other connections might be doing the same, so it's done in a transaction
+// that locks the database for writing, and checks the version again.
+bool VoxelStreamSQLiteInternal::migrate_to_morton_keys() {
+	ZN_PROFILE_SCOPE();
+	sqlite3 *db = _db;
+
+	int rc = sqlite3_create_function(db, "voxel_morton_key_from_legacy_key", 1,
+			SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, morton_key_from_legacy_key_sql_function, nullptr, nullptr);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	if (!exec(db, "BEGIN IMMEDIATE")) {
+		return false;
+	}
+
+	int version = -1;
+	{
+		sqlite3_stmt *version_statement = nullptr;
+		if (!prepare(db, &version_statement, "SELECT version FROM meta")) {
+			exec(db, "ROLLBACK");
+			return false;
+		}
+		if (sqlite3_step(version_statement) == SQLITE_ROW) {
+			version = sqlite3_column_int(version_statement, 0);
+		}
+		finalize(version_statement);
+	}
+
+	if (version != VERSION_LEGACY_KEYS) {
+		// Already migrated by another connection
+		return exec(db, "COMMIT");
+	}
+
+	ZN_PRINT_VERBOSE("VoxelStreamSQLite: migrating block keys to Morton order");
+
+	// Keys change, so rows are copied into a new table instead of being updated in place, where new keys could
+	// collide with old keys not updated yet
+	const bool success = //
+			exec(db, "CREATE TABLE blocks_morton (loc INTEGER PRIMARY KEY, vb BLOB, instances BLOB)") &&
+			exec(db,
+					"INSERT INTO blocks_morton "
+					"SELECT voxel_morton_key_from_legacy_key(loc), vb, instances FROM blocks") &&
+			exec(db, "DROP TABLE blocks") && //
+			exec(db, "ALTER TABLE blocks_morton RENAME TO blocks") &&
+			exec(db, ("UPDATE meta SET version=" + std::to_string(VERSION_MORTON_KEYS)).c_str());
+
+	if (!success) {
+		exec(db, "ROLLBACK");
+		return false;
+	}
+	return exec(db, "COMMIT");
+}
+
 void VoxelStreamSQLiteInternal::close() {
 	if (_db == nullptr) {
 		return;
@@ -251,17 +509,24 @@ void VoxelStreamSQLiteInternal::close() {
 	finalize(_end_statement);
 	finalize(_update_voxel_block_statement);
 	finalize(_get_voxel_block_statement);
+	finalize(_get_voxel_blocks_statement);
+	finalize(_get_voxel_block_range_statement);
 	finalize(_update_instance_block_statement);
 	finalize(_get_instance_block_statement);
+	finalize(_get_instance_blocks_statement);
+	finalize(_get_instance_block_range_statement);
 	finalize(_load_meta_statement);
 	finalize(_save_meta_statement);
 	finalize(_load_channels_statement);
 	finalize(_save_channel_statement);
 	finalize(_load_all_blocks_statement);
 	finalize(_load_all_block_keys_statement);
+	finalize(_load_dictionary_statement);
+	finalize(_save_dictionary_statement);
 	sqlite3_close(_db);
 	_db = nullptr;
 	_opened_path.clear();
+	_morton_keys = false;
 }
 
 const char *VoxelStreamSQLiteInternal::get_file_path() const {
@@ -299,6 +564,13 @@ bool VoxelStreamSQLiteInternal::end_transaction() {
 	return true;
 }
 
+void VoxelStreamSQLiteInternal::rollback_transaction() {
+	// SQLite already rolled back the transaction after some errors
+	if (sqlite3_get_autocommit(_db) == 0) {
+		exec(_db, "ROLLBACK");
+	}
+}
+
 bool VoxelStreamSQLiteInternal::save_block(BlockLocation loc, const std::vector<uint8_t> &block_data, BlockType type) {
 	ZN_PROFILE_SCOPE();
 
@@ -322,7 +594,7 @@ bool VoxelStreamSQLiteInternal::save_block(BlockLocation loc, const std::vector<
 		return false;
 	}
 
-	const uint64_t eloc = loc.encode();
+	const uint64_t eloc = encode_location(loc);
 
 	rc = sqlite3_bind_int64(update_block_statement, 1, eloc);
 	if (rc != SQLITE_OK) {
@@ -374,7 +646,7 @@ VoxelStream::ResultCode VoxelStreamSQLiteInternal::load_block(
 		return VoxelStream::RESULT_ERROR;
 	}
 
-	const uint64_t eloc = loc.encode();
+	const uint64_t eloc = encode_location(loc);
 
 	rc = sqlite3_bind_int64(get_block_statement, 1, eloc);
 	if (rc != SQLITE_OK) {
@@ -408,6 +680,135 @@ VoxelStream::ResultCode VoxelStreamSQLiteInternal::load_block(
 	return result;
 }
 
+bool VoxelStreamSQLiteInternal::load_blocks(Span<const uint64_t> location_keys, BlockType type, void *callback_data,
+		void (*process_block_func)(void *callback_data, uint64_t location_key, Span<const uint8_t> block_data)) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(process_block_func != nullptr);
+
+	sqlite3 *db = _db;
+
+	sqlite3_stmt *get_blocks_statement;
+	sqlite3_stmt *get_block_range_statement;
+	switch (type) {
+		case VOXELS:
+			get_blocks_statement = _get_voxel_blocks_statement;
+			get_block_range_statement = _get_voxel_block_range_statement;
+			break;
+		case INSTANCES:
+			get_blocks_statement = _get_instance_blocks_statement;
+			get_block_range_statement = _get_instance_block_range_statement;
+			break;
+		default:
+			CRASH_NOW();
+	}
+
+	// Keys to look up individually
+	Span<const uint64_t> lookup_keys = location_keys;
+	std::vector<uint64_t> remaining_keys;
+
+	if (_morton_keys) {
+		// Blocks close to each other in space mostly have close keys, so a box of blocks is mostly made of runs of
+		// close keys. Each run is loaded with one range scan, which reads contiguous pages of the table.
+		size_t run_begin = 0;
+		for (size_t i = 1; i <= location_keys.size(); ++i) {
+			if (i < location_keys.size() && location_keys[i] - location_keys[i - 1] <= MAX_RANGE_SCAN_GAP) {
+				continue;
+			}
+			const Span<const uint64_t> run = location_keys.sub(run_begin, i - run_begin);
+			run_begin = i;
+
+			if (run.size() < MIN_RANGE_SCAN_KEYS) {
+				for (const uint64_t location_key : run) {
+					remaining_keys.push_back(location_key);
+				}
+				continue;
+			}
+
+			int rc = sqlite3_reset(get_block_range_statement);
+			if (rc != SQLITE_OK) {
+				ERR_PRINT(sqlite3_errmsg(db));
+				return false;
+			}
+			rc = sqlite3_bind_int64(get_block_range_statement, 1, run[0]);
+			if (rc != SQLITE_OK) {
+				ERR_PRINT(sqlite3_errmsg(db));
+				return false;
+			}
+			rc = sqlite3_bind_int64(get_block_range_statement, 2, run[run.size() - 1]);
+			if (rc != SQLITE_OK) {
+				ERR_PRINT(sqlite3_errmsg(db));
+				return false;
+			}
+			if (!load_block_rows(get_block_range_statement, run, callback_data, process_block_func)) {
+				return false;
+			}
+		}
+		lookup_keys = to_span_const(remaining_keys);
+	}
+
+	for (size_t batch_begin = 0; batch_begin < lookup_keys.size(); batch_begin += LOAD_BATCH_SIZE) {
+		const size_t batch_size = math::min(size_t(LOAD_BATCH_SIZE), lookup_keys.size() - batch_begin);
+
+		int rc = sqlite3_reset(get_blocks_statement);
+		if (rc != SQLITE_OK) {
+			ERR_PRINT(sqlite3_errmsg(db));
+			return false;
+		}
+
+		for (unsigned int i = 0; i < LOAD_BATCH_SIZE; ++i) {
+			// The last batch can be smaller. Remaining parameters repeat its last key, which doesn't add rows.
+			const uint64_t location_key = lookup_keys[batch_begin + math::min(size_t(i), batch_size - 1)];
+			rc = sqlite3_bind_int64(get_blocks_statement, i + 1, location_key);
+			if (rc != SQLITE_OK) {
+				ERR_PRINT(sqlite3_errmsg(db));
+				return false;
+			}
+		}
+
+		if (!load_block_rows(get_blocks_statement, Span<const uint64_t>(), callback_data, process_block_func)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Steps a statement returning (loc, blob) rows. If `requested_keys` is not empty, rows with other keys are skipped.
+bool VoxelStreamSQLiteInternal::load_block_rows(sqlite3_stmt *statement, Span<const uint64_t> requested_keys,
+		void *callback_data,
+		void (*process_block_func)(void *callback_data, uint64_t location_key, Span<const uint8_t> block_data)) {
+	sqlite3 *db = _db;
+
+	while (true) {
+		const int rc = sqlite3_step(statement);
+
+		if (rc == SQLITE_ROW) {
+			const uint64_t location_key = sqlite3_column_int64(statement, 0);
+			if (requested_keys.size() > 0 &&
+					!std::binary_search(
+							requested_keys.data(), requested_keys.data() + requested_keys.size(), location_key)) {
+				continue;
+			}
+			const void *blob = sqlite3_column_blob(statement, 1);
+			const size_t blob_size = sqlite3_column_bytes(statement, 1);
+			if (blob_size != 0) {
+				process_block_func(callback_data, location_key,
+						Span<const uint8_t>(reinterpret_cast<const uint8_t *>(blob), blob_size));
+			}
+
+		} else if (rc == SQLITE_DONE) {
+			break;
+
+		} else {
+			ERR_PRINT(String("Unexpected SQLite return code: {0}; errmsg: {1}")
+							  .format(varray(rc, sqlite3_errmsg(db))));
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool VoxelStreamSQLiteInternal::load_all_blocks(void *callback_data,
 		void (*process_block_func)(void *callback_data, BlockLocation location, Span<const uint8_t> voxel_data,
 				Span<const uint8_t> instances_data)) {
@@ -432,7 +833,7 @@ bool VoxelStreamSQLiteInternal::load_all_blocks(void *callback_data,
 			ZN_PROFILE_SCOPE_NAMED("Row");
 
 			const uint64_t eloc = sqlite3_column_int64(load_all_blocks_statement, 0);
-			const BlockLocation loc = BlockLocation::decode(eloc);
+			const BlockLocation loc = decode_location(eloc);
 
 			const void *voxels_blob = sqlite3_column_blob(load_all_blocks_statement, 1);
 			const size_t voxels_blob_size = sqlite3_column_bytes(load_all_blocks_statement, 1);
@@ -481,7 +882,7 @@ bool VoxelStreamSQLiteInternal::load_all_block_keys(
 			ZN_PROFILE_SCOPE_NAMED("Row");
 
 			const uint64_t eloc = sqlite3_column_int64(load_all_block_keys_statement, 0);
-			const BlockLocation loc = BlockLocation::decode(eloc);
+			const BlockLocation loc = decode_location(eloc);
 
 			// Using a function pointer because returning a big list of a copy of all the blobs can
 			// waste a lot of temporary memory
@@ -626,6 +1027,66 @@ void VoxelStreamSQLiteInternal::save_meta(Meta meta) {
 	}
 }
 
+bool VoxelStreamSQLiteInternal::load_dictionary(std::vector<uint8_t> &out_data) {
+	sqlite3 *db = _db;
+	sqlite3_stmt *load_dictionary_statement = _load_dictionary_statement;
+
+	int rc = sqlite3_reset(load_dictionary_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	bool found = false;
+
+	while (true) {
+		rc = sqlite3_step(load_dictionary_statement);
+		if (rc == SQLITE_ROW) {
+			const void *blob = sqlite3_column_blob(load_dictionary_statement, 0);
+			const size_t blob_size = sqlite3_column_bytes(load_dictionary_statement, 0);
+			if (blob_size != 0) {
+				found = true;
+				out_data.resize(blob_size);
+				memcpy(out_data.data(), blob, blob_size);
+			}
+			continue;
+		}
+		if (rc != SQLITE_DONE) {
+			ERR_PRINT(sqlite3_errmsg(db));
+			return false;
+		}
+		break;
+	}
+
+	return found;
+}
+
+bool VoxelStreamSQLiteInternal::save_dictionary(Span<const uint8_t> data) {
+	sqlite3 *db = _db;
+	sqlite3_stmt *save_dictionary_statement = _save_dictionary_statement;
+
+	int rc = sqlite3_reset(save_dictionary_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_bind_blob(save_dictionary_statement, 1, data.data(), data.size(), SQLITE_TRANSIENT);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	// Fails if there is already a dictionary, which is intended
+	rc = sqlite3_step(save_dictionary_statement);
+	if (rc != SQLITE_DONE) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 namespace {
@@ -637,13 +1098,64 @@ std::vector<uint8_t> &get_tls_temp_compressed_block_data() {
 	thread_local std::vector<uint8_t> tls_temp_compressed_block_data;
 	return tls_temp_compressed_block_data;
 }
+
+struct BlockToLoad {
+	uint64_t location_key;
+	// Index of the block in the query
+	unsigned int query_index;
+};
+
+std::vector<BlockToLoad> &get_tls_sorted_blocks_to_load() {
+	thread_local std::vector<BlockToLoad> tls_sorted_blocks_to_load;
+	return tls_sorted_blocks_to_load;
+}
+std::vector<uint64_t> &get_tls_location_keys() {
+	thread_local std::vector<uint64_t> tls_location_keys;
+	return tls_location_keys;
+}
+
+// Sorts blocks by location key, so the database visits them in order, and results can be found with a binary
+// search. Also outputs the keys to query, without duplicates.
+// uint64_t get_location_key(unsigned int query_index)
+template <typename F>
+void sort_blocks_to_load(Span<const unsigned int> query_indices, F get_location_key,
+		std::vector<BlockToLoad> &out_sorted_blocks, std::vector<uint64_t> &out_location_keys) {
+	out_sorted_blocks.clear();
+	for (const unsigned int query_index : query_indices) {
+		out_sorted_blocks.push_back(BlockToLoad{ get_location_key(query_index), query_index });
+	}
+	std::sort(out_sorted_blocks.begin(), out_sorted_blocks.end(),
+			[](const BlockToLoad &a, const BlockToLoad &b) { return a.location_key < b.location_key; });
+
+	out_location_keys.clear();
+	for (const BlockToLoad &b : out_sorted_blocks) {
+		if (out_location_keys.size() == 0 || out_location_keys.back() != b.location_key) {
+			out_location_keys.push_back(b.location_key);
+		}
+	}
+}
+
+// Gets blocks having the given key. There can be more than one if the same block was requested multiple times.
+Span<const BlockToLoad> find_blocks_to_load(Span<const BlockToLoad> sorted_blocks, uint64_t location_key) {
+	const BlockToLoad *begin_ptr = sorted_blocks.data();
+	const BlockToLoad *it = std::lower_bound(begin_ptr, begin_ptr + sorted_blocks.size(), location_key,
+			[](const BlockToLoad &b, uint64_t key) { return b.location_key < key; });
+	const size_t begin = it - begin_ptr;
+	size_t end = begin;
+	while (end < sorted_blocks.size() && sorted_blocks[end].location_key == location_key) {
+		++end;
+	}
+	return sorted_blocks.sub(begin, end - begin);
+}
+
 } // namespace
 
 VoxelStreamSQLite::VoxelStreamSQLite() {}
 
 VoxelStreamSQLite::~VoxelStreamSQLite() {
 	ZN_PRINT_VERBOSE("~VoxelStreamSQLite");
-	if (!_connection_path.is_empty() && _cache.get_indicative_block_count() > 0) {
+	stop_flusher_thread();
+	if (!_connection_path.is_empty() && _write_cache.pending.size() > 0) {
 		ZN_PRINT_VERBOSE("~VoxelStreamSQLite flushy flushy");
 		flush_cache();
 		ZN_PRINT_VERBOSE("~VoxelStreamSQLite flushy done");
@@ -660,7 +1172,12 @@ void VoxelStreamSQLite::set_database_path(String path) {
 	if (path == _connection_path) {
 		return;
 	}
-	if (!_connection_path.is_empty() && _cache.get_indicative_block_count() > 0) {
+	bool has_pending_writes;
+	{
+		MutexLock wc_lock(_write_cache.mutex);
+		has_pending_writes = _write_cache.pending.size() > 0;
+	}
+	if (!_connection_path.is_empty() && has_pending_writes) {
 		// Save cached data before changing the path.
 		// Not using get_connection() because it locks.
 		VoxelStreamSQLiteInternal con;
@@ -668,7 +1185,7 @@ void VoxelStreamSQLite::set_database_path(String path) {
 		// Note, the path could be invalid,
 		// Since Godot helpfully sets the property for every character typed in the inspector.
 		// So there can be lots of errors in the editor if you type it.
-		if (con.open(cpath.get_data())) {
+		if (con.open(cpath.get_data(), _connection_options)) {
 			flush_cache_to_connection(&con);
 		}
 	}
@@ -678,6 +1195,8 @@ void VoxelStreamSQLite::set_database_path(String path) {
 	_block_keys_cache.clear();
 	_connection_pool.clear();
 	_connection_path = path;
+	_zstd_dictionary.reset();
+	_zstd_dictionary_loaded = false;
 	// Don't actually open anything here. We'll do it only when necessary
 }
 
@@ -700,6 +1219,10 @@ void VoxelStreamSQLite::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 	// TODO Get block size from database
 	const int bs_po2 = constants::DEFAULT_BLOCK_SIZE_PO2;
 
+	// Cached blocks were compressed after the dictionary was loaded, if any
+	std::shared_ptr<const CompressedData::ZstdDictionary> zstd_dictionary =
+			get_compression_settings().zstd_dictionary;
+
 	// Check the cache first
 	std::vector<unsigned int> blocks_to_load;
 	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
@@ -713,8 +1236,12 @@ void VoxelStreamSQLite::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 			continue;
 		}
 
-		if (_cache.load_voxel_block(pos, q.lod, q.voxel_buffer)) {
-			q.result = RESULT_BLOCK_FOUND;
+		std::vector<uint8_t> &temp_block_data = get_tls_temp_block_data();
+		const uint64_t location_key = BlockLocation::from_position(pos, q.lod).encode();
+		if (get_from_write_cache(location_key, BLOCK_PART_VOXELS, temp_block_data)) {
+			const bool success = BlockSerializer::decompress_and_deserialize(
+					to_span_const(temp_block_data), q.voxel_buffer, zstd_dictionary.get());
+			q.result = success ? RESULT_BLOCK_FOUND : RESULT_ERROR;
 
 		} else {
 			blocks_to_load.push_back(i);
@@ -729,20 +1256,16 @@ void VoxelStreamSQLite::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 	VoxelStreamSQLiteInternal *con = get_connection();
 	ERR_FAIL_COND(con == nullptr);
 
+	// Obtained again after getting a connection, because the dictionary is loaded with the first one
+	zstd_dictionary = get_compression_settings().zstd_dictionary;
+
 	// TODO We should handle busy return codes
 	ERR_FAIL_COND(con->begin_transaction() == false);
 
-	for (unsigned int i = 0; i < blocks_to_load.size(); ++i) {
-		const unsigned int ri = blocks_to_load[i];
-		VoxelStream::VoxelQueryData &q = p_blocks[ri];
-
-		const unsigned int po2 = bs_po2 + q.lod;
-
-		BlockLocation loc;
-		loc.x = q.origin_in_voxels.x >> po2;
-		loc.y = q.origin_in_voxels.y >> po2;
-		loc.z = q.origin_in_voxels.z >> po2;
-		loc.lod = q.lod;
+	if (blocks_to_load.size() == 1) {
+		// Querying a single key is cheaper than a batch
+		VoxelStream::VoxelQueryData &q = p_blocks[blocks_to_load[0]];
+		const BlockLocation loc = BlockLocation::from_position(q.origin_in_voxels >> (bs_po2 + q.lod), q.lod);
 
 		std::vector<uint8_t> &temp_block_data = get_tls_temp_block_data();
 
@@ -750,10 +1273,58 @@ void VoxelStreamSQLite::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 
 		if (res == RESULT_BLOCK_FOUND) {
 			// TODO Not sure if we should actually expect non-null. There can be legit not found blocks.
-			BlockSerializer::decompress_and_deserialize(to_span_const(temp_block_data), q.voxel_buffer);
+			BlockSerializer::decompress_and_deserialize(
+					to_span_const(temp_block_data), q.voxel_buffer, zstd_dictionary.get());
 		}
 
 		q.result = res;
+
+	} else {
+		std::vector<BlockToLoad> &sorted_blocks = get_tls_sorted_blocks_to_load();
+		std::vector<uint64_t> &location_keys = get_tls_location_keys();
+		sort_blocks_to_load(
+				to_span_const(blocks_to_load),
+				[p_blocks, bs_po2, con](unsigned int i) {
+					const VoxelStream::VoxelQueryData &q = p_blocks[i];
+					return con->encode_location(
+							BlockLocation::from_position(q.origin_in_voxels >> (bs_po2 + q.lod), q.lod));
+				},
+				sorted_blocks, location_keys);
+
+		for (const BlockToLoad &b : sorted_blocks) {
+			p_blocks[b.query_index].result = RESULT_BLOCK_NOT_FOUND;
+		}
+
+		struct Context {
+			Span<VoxelStream::VoxelQueryData> blocks;
+			Span<const BlockToLoad> sorted_blocks;
+			const CompressedData::ZstdDictionary *zstd_dictionary;
+		};
+
+		struct L {
+			static void process_block_func(void *callback_data, uint64_t location_key, Span<const uint8_t> data) {
+				Context *ctx = static_cast<Context *>(callback_data);
+				// The same block can be requested more than once
+				for (const BlockToLoad &b : find_blocks_to_load(ctx->sorted_blocks, location_key)) {
+					VoxelStream::VoxelQueryData &q = ctx->blocks[b.query_index];
+					const bool success =
+							BlockSerializer::decompress_and_deserialize(data, q.voxel_buffer, ctx->zstd_dictionary);
+					q.result = success ? VoxelStream::RESULT_BLOCK_FOUND : VoxelStream::RESULT_ERROR;
+				}
+			}
+		};
+
+		Context ctx{ p_blocks, to_span_const(sorted_blocks), zstd_dictionary.get() };
+		if (!con->load_blocks(to_span_const(location_keys), VoxelStreamSQLiteInternal::VOXELS, &ctx,
+					L::process_block_func)) {
+			// We can't tell which blocks were not loaded because of the error
+			for (const BlockToLoad &b : sorted_blocks) {
+				VoxelStream::VoxelQueryData &q = p_blocks[b.query_index];
+				if (q.result == RESULT_BLOCK_NOT_FOUND) {
+					q.result = RESULT_ERROR;
+				}
+			}
+		}
 	}
 
 	ERR_FAIL_COND(con->end_transaction() == false);
@@ -765,7 +1336,10 @@ void VoxelStreamSQLite::save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 	// TODO Get block size from database
 	const int bs_po2 = constants::DEFAULT_BLOCK_SIZE_PO2;
 
-	// First put in cache
+	ensure_dictionary_loaded();
+	const CompressedData::Settings compression_settings = get_compression_settings();
+
+	// First put in cache. Blocks are serialized now, so the cache doesn't need to keep or copy buffers.
 	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
 		VoxelStream::VoxelQueryData &q = p_blocks[i];
 		const Vector3i pos = q.origin_in_voxels >> (bs_po2 + q.lod);
@@ -775,16 +1349,18 @@ void VoxelStreamSQLite::save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 			continue;
 		}
 
-		_cache.save_voxel_block(pos, q.lod, q.voxel_buffer);
+		BlockSerializer::SerializeResult res =
+				BlockSerializer::serialize_and_compress(q.voxel_buffer, compression_settings);
+		ERR_CONTINUE(!res.success);
+		put_in_write_cache(
+				BlockLocation::from_position(pos, q.lod).encode(), BLOCK_PART_VOXELS, to_span_const(res.data));
+
 		if (_block_keys_cache_enabled) {
 			_block_keys_cache.add(to_vec3i16(pos), q.lod);
 		}
 	}
 
-	// TODO We should consider using a serialized cache, and measure the threshold in bytes
-	if (_cache.get_indicative_block_count() >= CACHE_SIZE) {
-		flush_cache();
-	}
+	start_flusher_thread();
 }
 
 bool VoxelStreamSQLite::supports_instance_blocks() const {
@@ -802,9 +1378,28 @@ void VoxelStreamSQLite::load_instance_blocks(Span<VoxelStream::InstancesQueryDat
 	for (size_t i = 0; i < out_blocks.size(); ++i) {
 		VoxelStream::InstancesQueryData &q = out_blocks[i];
 
-		if (_cache.load_instance_block(q.position, q.lod, q.data)) {
+		ZN_ASSERT_CONTINUE(BlockLocation::validate(q.position, q.lod));
+
+		std::vector<uint8_t> &temp_compressed_block_data = get_tls_temp_compressed_block_data();
+		if (get_from_write_cache(BlockLocation::from_position(q.position, q.lod).encode(), BLOCK_PART_INSTANCES,
+					temp_compressed_block_data)) {
 			q.result = RESULT_BLOCK_FOUND;
 
+			if (temp_compressed_block_data.size() == 0) {
+				// Saved as null
+				q.data = nullptr;
+				continue;
+			}
+
+			std::vector<uint8_t> &temp_block_data = get_tls_temp_block_data();
+			q.data = make_unique_instance<InstanceBlockData>();
+			if (!CompressedData::decompress(to_span_const(temp_compressed_block_data), temp_block_data) ||
+					!deserialize_instance_block_data(*q.data, to_span_const(temp_block_data))) {
+				ERR_PRINT("Failed to load cached instance block");
+				q.data = nullptr;
+				q.result = RESULT_ERROR;
+			}
+
 		} else {
 			blocks_to_load.push_back(i);
 		}
@@ -822,37 +1417,62 @@ void VoxelStreamSQLite::load_instance_blocks(Span<VoxelStream::InstancesQueryDat
 	// TODO recycle on error
 	ERR_FAIL_COND(con->begin_transaction() == false);
 
-	for (unsigned int i = 0; i < blocks_to_load.size(); ++i) {
-		const unsigned int ri = blocks_to_load[i];
-		VoxelStream::InstancesQueryData &q = out_blocks[ri];
-
-		BlockLocation loc;
-		loc.x = q.position.x;
-		loc.y = q.position.y;
-		loc.z = q.position.z;
-		loc.lod = q.lod;
+	std::vector<BlockToLoad> &sorted_blocks = get_tls_sorted_blocks_to_load();
+	std::vector<uint64_t> &location_keys = get_tls_location_keys();
+	sort_blocks_to_load(
+			to_span_const(blocks_to_load),
+			[out_blocks, con](unsigned int i) {
+				const VoxelStream::InstancesQueryData &q = out_blocks[i];
+				return con->encode_location(BlockLocation::from_position(q.position, q.lod));
+			},
+			sorted_blocks, location_keys);
 
-		std::vector<uint8_t> &temp_compressed_block_data = get_tls_temp_compressed_block_data();
+	for (const BlockToLoad &b : sorted_blocks) {
+		out_blocks[b.query_index].result = RESULT_BLOCK_NOT_FOUND;
+	}
 
-		const ResultCode res = con->load_block(loc, temp_compressed_block_data, VoxelStreamSQLiteInternal::INSTANCES);
+	struct Context {
+		Span<VoxelStream::InstancesQueryData> blocks;
+		Span<const BlockToLoad> sorted_blocks;
+	};
 
-		if (res == RESULT_BLOCK_FOUND) {
+	struct L {
+		static void process_block_func(void *callback_data, uint64_t location_key, Span<const uint8_t> data) {
+			Context *ctx = static_cast<Context *>(callback_data);
 			std::vector<uint8_t> &temp_block_data = get_tls_temp_block_data();
 
-			if (!CompressedData::decompress(to_span_const(temp_compressed_block_data), temp_block_data)) {
+			if (!CompressedData::decompress(data, temp_block_data)) {
 				ERR_PRINT("Failed to decompress instance block");
-				q.result = RESULT_ERROR;
-				continue;
+				for (const BlockToLoad &b : find_blocks_to_load(ctx->sorted_blocks, location_key)) {
+					ctx->blocks[b.query_index].result = VoxelStream::RESULT_ERROR;
+				}
+				return;
 			}
-			q.data = make_unique_instance<InstanceBlockData>();
-			if (!deserialize_instance_block_data(*q.data, to_span_const(temp_block_data))) {
-				ERR_PRINT("Failed to deserialize instance block");
-				q.result = RESULT_ERROR;
-				continue;
+
+			for (const BlockToLoad &b : find_blocks_to_load(ctx->sorted_blocks, location_key)) {
+				VoxelStream::InstancesQueryData &q = ctx->blocks[b.query_index];
+				q.data = make_unique_instance<InstanceBlockData>();
+				if (!deserialize_instance_block_data(*q.data, to_span_const(temp_block_data))) {
+					ERR_PRINT("Failed to deserialize instance block");
+					q.data = nullptr;
+					q.result = VoxelStream::RESULT_ERROR;
+					continue;
+				}
+				q.result = VoxelStream::RESULT_BLOCK_FOUND;
 			}
 		}
+	};
 
-		q.result = res;
+	Context ctx{ out_blocks, to_span_const(sorted_blocks) };
+	if (!con->load_blocks(to_span_const(location_keys), VoxelStreamSQLiteInternal::INSTANCES, &ctx,
+				L::process_block_func)) {
+		// We can't tell which blocks were not loaded because of the error
+		for (const BlockToLoad &b : sorted_blocks) {
+			VoxelStream::InstancesQueryData &q = out_blocks[b.query_index];
+			if (q.result == RESULT_BLOCK_NOT_FOUND) {
+				q.result = RESULT_ERROR;
+			}
+		}
 	}
 
 	ERR_FAIL_COND(con->end_transaction() == false);
@@ -864,6 +1484,9 @@ void VoxelStreamSQLite::save_instance_blocks(Span<VoxelStream::InstancesQueryDat
 	// TODO Get block size from database
 	// const int bs_po2 = constants::DEFAULT_BLOCK_SIZE_PO2;
 
+	std::vector<uint8_t> &temp_data = get_tls_temp_block_data();
+	std::vector<uint8_t> &temp_compressed_data = get_tls_temp_compressed_block_data();
+
 	// First put in cache
 	for (size_t i = 0; i < p_blocks.size(); ++i) {
 		VoxelStream::InstancesQueryData &q = p_blocks[i];
@@ -873,16 +1496,23 @@ void VoxelStreamSQLite::save_instance_blocks(Span<VoxelStream::InstancesQueryDat
 			continue;
 		}
 
-		_cache.save_instance_block(q.position, q.lod, std::move(q.data));
+		// If the provided data is null, it is saved as null
+		temp_compressed_data.clear();
+		if (q.data != nullptr) {
+			temp_data.clear();
+			ERR_CONTINUE(!serialize_instance_block_data(*q.data, temp_data));
+			ERR_CONTINUE(!CompressedData::compress(
+					to_span_const(temp_data), temp_compressed_data, CompressedData::COMPRESSION_NONE));
+		}
+		put_in_write_cache(BlockLocation::from_position(q.position, q.lod).encode(), BLOCK_PART_INSTANCES,
+				to_span_const(temp_compressed_data));
+
 		if (_block_keys_cache_enabled) {
 			_block_keys_cache.add(to_vec3i16(q.position), q.lod);
 		}
 	}
 
-	// TODO Optimization: we should consider using a serialized cache, and measure the threshold in bytes
-	if (_cache.get_indicative_block_count() >= CACHE_SIZE) {
-		flush_cache();
-	}
+	start_flusher_thread();
 }
 
 void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
@@ -891,8 +1521,12 @@ void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
 	VoxelStreamSQLiteInternal *con = get_connection();
 	ERR_FAIL_COND(con == nullptr);
 
+	// Otherwise blocks that are only in the cache would be missing
+	flush_cache_to_connection(con);
+
 	struct Context {
 		FullLoadingResult &result;
+		const CompressedData::ZstdDictionary *zstd_dictionary;
 	};
 
 	// Using local function instead of a lambda for quite stupid reason admittedly:
@@ -915,7 +1549,7 @@ void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
 
 			if (voxel_data.size() > 0) {
 				std::shared_ptr<VoxelBufferInternal> voxels = make_shared_instance<VoxelBufferInternal>();
-				ERR_FAIL_COND(!BlockSerializer::decompress_and_deserialize(voxel_data, *voxels));
+				ERR_FAIL_COND(!BlockSerializer::decompress_and_deserialize(voxel_data, *voxels, ctx->zstd_dictionary));
 				result_block.voxels = voxels;
 			}
 
@@ -938,7 +1572,9 @@ void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
 
 	// Had to suffix `_outer`,
 	// because otherwise GCC thinks it shadows a variable inside the local function/captureless lambda
-	Context ctx_outer{ result };
+	const std::shared_ptr<const CompressedData::ZstdDictionary> zstd_dictionary =
+			get_compression_settings().zstd_dictionary;
+	Context ctx_outer{ result, zstd_dictionary.get() };
 	const bool request_result = con->load_all_blocks(&ctx_outer, L::process_block_func);
 	ERR_FAIL_COND(request_result == false);
 }
@@ -955,55 +1591,201 @@ void VoxelStreamSQLite::flush_cache() {
 	recycle_connection(con);
 }
 
-// This function does not lock any mutex for internal use.
+// Writes all blocks saved so far. Blocks saved meanwhile will be written by the next flush.
+// This function must not lock `_connection_mutex`.
 void VoxelStreamSQLite::flush_cache_to_connection(VoxelStreamSQLiteInternal *p_connection) {
 	ZN_PROFILE_SCOPE();
-	ZN_PRINT_VERBOSE(format("VoxelStreamSQLite: Flushing cache ({} elements)", _cache.get_indicative_block_count()));
-
 	ERR_FAIL_COND(p_connection == nullptr);
+
+	MutexLock flush_lock(_flush_mutex);
+
+	{
+		MutexLock lock(_write_cache.mutex);
+		if (_write_cache.pending.size() == 0) {
+			return;
+		}
+	}
+
+	// Begin before taking blocks from the cache, so they are not lost if it fails
 	ERR_FAIL_COND(p_connection->begin_transaction() == false);
 
-	std::vector<uint8_t> &temp_data = get_tls_temp_block_data();
-	std::vector<uint8_t> &temp_compressed_data = get_tls_temp_compressed_block_data();
+	{
+		MutexLock lock(_write_cache.mutex);
+		ZN_ASSERT(_write_cache.flushing.size() == 0);
+		_write_cache.flushing.swap(_write_cache.pending);
+		_write_cache.pending_size_in_bytes = 0;
+	}
 
-	// TODO Needs better error rollback handling
-	_cache.flush([p_connection, &temp_data, &temp_compressed_data](VoxelStreamCache::Block &block) {
-		ERR_FAIL_COND(!BlockLocation::validate(block.position, block.lod));
+	ZN_PRINT_VERBOSE(format("VoxelStreamSQLite: Flushing cache ({} elements)", _write_cache.flushing.size()));
 
-		BlockLocation loc;
-		loc.x = block.position.x;
-		loc.y = block.position.y;
-		loc.z = block.position.z;
-		loc.lod = block.lod;
+	// Blocks being flushed are only modified by flushes, so they can be read without locking
+	bool saved = true;
+	for (auto it = _write_cache.flushing.begin(); it != _write_cache.flushing.end() && saved; ++it) {
+		const BlockLocation loc = BlockLocation::decode(it->first);
+		const WriteCache::Block &block = it->second;
 
-		// Save voxels
+		// TODO Optimization: add a version of the query that can update both at once
 		if (block.has_voxels) {
-			if (block.voxels_deleted) {
-				const std::vector<uint8_t> empty;
-				p_connection->save_block(loc, empty, VoxelStreamSQLiteInternal::VOXELS);
+			saved = p_connection->save_block(loc, block.voxels, VoxelStreamSQLiteInternal::VOXELS);
+		}
+		if (block.has_instances && saved) {
+			saved = p_connection->save_block(loc, block.instances, VoxelStreamSQLiteInternal::INSTANCES);
+		}
+	}
+
+	const bool committed = saved && p_connection->end_transaction();
+	if (!committed) {
+		p_connection->rollback_transaction();
+	}
+
+	{
+		MutexLock lock(_write_cache.mutex);
+		if (!committed) {
+			// Nothing was written, so blocks go back to the cache and will be written by the next flush. Blocks saved
+			// while flushing are newer, they are kept.
+			for (auto it = _write_cache.flushing.begin(); it != _write_cache.flushing.end(); ++it) {
+				WriteCache::Block &src = it->second;
+				WriteCache::Block &dst = _write_cache.pending[it->first];
+				if (src.has_voxels && !dst.has_voxels) {
+					dst.voxels = std::move(src.voxels);
+					dst.has_voxels = true;
+					_write_cache.pending_size_in_bytes += dst.voxels.size();
+				}
+				if (src.has_instances && !dst.has_instances) {
+					dst.instances = std::move(src.instances);
+					dst.has_instances = true;
+					_write_cache.pending_size_in_bytes += dst.instances.size();
+				}
+			}
+		}
+		_write_cache.flushing.clear();
+	}
+
+	ERR_FAIL_COND_MSG(committed == false, "Failed to write saved blocks to the database, they will be written later");
+}
+
+void VoxelStreamSQLite::put_in_write_cache(uint64_t location_key, BlockPart part, Span<const uint8_t> data) {
+	// Copy outside of the lock
+	std::vector<uint8_t> data_copy(data.data(), data.data() + data.size());
+
+	const size_t budget = static_cast<size_t>(_write_cache_budget_kb) * 1024;
+	size_t prev_size_in_bytes;
+	size_t size_in_bytes;
+	{
+		MutexLock lock(_write_cache.mutex);
+		prev_size_in_bytes = _write_cache.pending_size_in_bytes;
+
+		WriteCache::Block &block = _write_cache.pending[location_key];
+		std::vector<uint8_t> &dst = part == BLOCK_PART_VOXELS ? block.voxels : block.instances;
+		_write_cache.pending_size_in_bytes -= dst.size();
+		_write_cache.pending_size_in_bytes += data_copy.size();
+		dst.swap(data_copy);
+		if (part == BLOCK_PART_VOXELS) {
+			block.has_voxels = true;
+		} else {
+			block.has_instances = true;
+		}
+
+		size_in_bytes = _write_cache.pending_size_in_bytes;
+	}
+
+	if (size_in_bytes >= budget * 4) {
+		// The background thread can't keep up, make saving threads wait for the database
+		flush_cache();
+
+	} else if (size_in_bytes >= budget && prev_size_in_bytes < budget) {
+		// Wake up the background thread
+		_flusher_semaphore.post();
+	}
+}
+
+bool VoxelStreamSQLite::get_from_write_cache(
+		uint64_t location_key, BlockPart part, std::vector<uint8_t> &out_data) const {
+	struct L {
+		static const std::vector<uint8_t> *find(
+				const std::unordered_map<uint64_t, WriteCache::Block> &blocks, uint64_t key, BlockPart part) {
+			auto it = blocks.find(key);
+			if (it == blocks.end()) {
+				return nullptr;
+			}
+			const WriteCache::Block &block = it->second;
+			if (part == BLOCK_PART_VOXELS) {
+				return block.has_voxels ? &block.voxels : nullptr;
 			} else {
-				BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block.voxels);
-				ERR_FAIL_COND(!res.success);
-				p_connection->save_block(loc, res.data, VoxelStreamSQLiteInternal::VOXELS);
+				return block.has_instances ? &block.instances : nullptr;
 			}
 		}
+	};
 
-		// Save instances
-		temp_compressed_data.clear();
-		if (block.instances != nullptr) {
-			temp_data.clear();
+	MutexLock lock(_write_cache.mutex);
 
-			ERR_FAIL_COND(!serialize_instance_block_data(*block.instances, temp_data));
+	// Most recent first
+	const std::vector<uint8_t> *data = L::find(_write_cache.pending, location_key, part);
+	if (data == nullptr) {
+		data = L::find(_write_cache.flushing, location_key, part);
+		if (data == nullptr) {
+			return false;
+		}
+	}
 
-			ERR_FAIL_COND(!CompressedData::compress(
-					to_span_const(temp_data), temp_compressed_data, CompressedData::COMPRESSION_NONE));
+	// Blocks are small once compressed, copying them is shorter than decompressing them inside the lock
+	out_data = *data;
+	return true;
+}
+
+size_t VoxelStreamSQLite::get_write_cache_size_in_bytes() const {
+	MutexLock lock(_write_cache.mutex);
+	return _write_cache.pending_size_in_bytes;
+}
+
+void VoxelStreamSQLite::start_flusher_thread() {
+	MutexLock lock(_connection_mutex);
+	if (_flusher_thread_started) {
+		return;
+	}
+	_flusher_thread_quit = false;
+	_flusher_thread.start(flusher_thread_func, this, Thread::PRIORITY_LOW);
+	_flusher_thread_started = true;
+}
+
+void VoxelStreamSQLite::stop_flusher_thread() {
+	{
+		MutexLock lock(_connection_mutex);
+		if (!_flusher_thread_started) {
+			return;
 		}
-		p_connection->save_block(loc, temp_compressed_data, VoxelStreamSQLiteInternal::INSTANCES);
+		_flusher_thread_started = false;
+	}
+	_flusher_thread_quit = true;
+	_flusher_semaphore.post();
+	_flusher_thread.wait_to_finish();
+}
 
-		// TODO Optimization: add a version of the query that can update both at once
-	});
+void VoxelStreamSQLite::flusher_thread_func(void *p_stream) {
+	Thread::set_name("VoxelStreamSQLite flush");
+	VoxelStreamSQLite *stream = static_cast<VoxelStreamSQLite *>(p_stream);
+
+	while (!stream->_flusher_thread_quit) {
+		// Woken up earlier when the cache goes above budget
+		stream->_flusher_semaphore.wait_for_usec(static_cast<uint64_t>(stream->_write_cache_flush_interval_ms) * 1000);
+
+		if (stream->_flusher_thread_quit) {
+			break;
+		}
 
-	ERR_FAIL_COND(p_connection->end_transaction() == false);
+		{
+			MutexLock lock(stream->_write_cache.mutex);
+			if (stream->_write_cache.pending.size() == 0) {
+				continue;
+			}
+		}
+
+		VoxelStreamSQLiteInternal *con = stream->get_connection();
+		if (con != nullptr) {
+			stream->flush_cache_to_connection(con);
+			stream->recycle_connection(con);
+		}
+	}
 }
 
 VoxelStreamSQLiteInternal *VoxelStreamSQLite::get_connection() {
@@ -1021,6 +1803,7 @@ VoxelStreamSQLiteInternal *VoxelStreamSQLite::get_connection() {
 	// First connection we get since we set the database path
 
 	String fpath = _connection_path;
+	const ConnectionOptions options = _connection_options;
 	_connection_mutex.unlock();
 
 	if (fpath.is_empty()) {
@@ -1028,10 +1811,13 @@ VoxelStreamSQLiteInternal *VoxelStreamSQLite::get_connection() {
 	}
 	VoxelStreamSQLiteInternal *con = new VoxelStreamSQLiteInternal();
 	const CharString fpath_utf8 = fpath.utf8();
-	if (!con->open(fpath_utf8.get_data())) {
+	if (!con->open(fpath_utf8.get_data(), options)) {
 		delete con;
 		con = nullptr;
 	}
+	if (con != nullptr) {
+		load_dictionary(*con);
+	}
 	if (_block_keys_cache_enabled) {
 		RWLockWrite wlock(_block_keys_cache.rw_lock);
 		con->load_all_block_keys(&_block_keys_cache, [](void *ctx, BlockLocation loc) {
@@ -1045,8 +1831,8 @@ VoxelStreamSQLiteInternal *VoxelStreamSQLite::get_connection() {
 void VoxelStreamSQLite::recycle_connection(VoxelStreamSQLiteInternal *con) {
 	String con_path = con->get_opened_file_path();
 	_connection_mutex.lock();
-	// If path differs, delete this connection
-	if (_connection_path != con_path) {
+	// If path or options differ, delete this connection
+	if (_connection_path != con_path || _connection_options != con->get_options()) {
 		_connection_mutex.unlock();
 		delete con;
 	} else {
@@ -1055,6 +1841,129 @@ void VoxelStreamSQLite::recycle_connection(VoxelStreamSQLiteInternal *con) {
 	}
 }
 
+// Loads the dictionary if it wasn't already, since the database path was set.
+void VoxelStreamSQLite::load_dictionary(VoxelStreamSQLiteInternal &con) {
+	{
+		MutexLock lock(_connection_mutex);
+		if (_zstd_dictionary_loaded) {
+			return;
+		}
+	}
+
+	std::vector<uint8_t> dictionary_data;
+	const bool found = con.load_dictionary(dictionary_data);
+
+	MutexLock lock(_connection_mutex);
+	if (_zstd_dictionary_loaded) {
+		// Another connection loaded it meanwhile
+		return;
+	}
+	if (found) {
+		_zstd_dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+				to_span_const(dictionary_data), _block_compression_level);
+	}
+	_zstd_dictionary_loaded = true;
+}
+
+// Blocks are compressed when they are saved, so the dictionary has to be loaded before
+void VoxelStreamSQLite::ensure_dictionary_loaded() {
+	{
+		MutexLock lock(_connection_mutex);
+		if (_zstd_dictionary_loaded) {
+			return;
+		}
+	}
+	// The dictionary is loaded when a new connection is opened
+	VoxelStreamSQLiteInternal *con = get_connection();
+	if (con != nullptr) {
+		recycle_connection(con);
+	}
+}
+
+CompressedData::Settings VoxelStreamSQLite::get_compression_settings() const {
+	MutexLock lock(_connection_mutex);
+	CompressedData::Settings settings;
+	settings.compression = _block_compression == BLOCK_COMPRESSION_ZSTD ? CompressedData::COMPRESSION_ZSTD
+																		 : CompressedData::COMPRESSION_LZ4;
+	settings.zstd_level = _block_compression_level;
+	settings.zstd_dictionary = _zstd_dictionary;
+	return settings;
+}
+
+void VoxelStreamSQLite::set_block_compression(BlockCompression compression) {
+	ERR_FAIL_INDEX(compression, _BLOCK_COMPRESSION_COUNT);
+	MutexLock lock(_connection_mutex);
+	_block_compression = compression;
+}
+
+VoxelStream::BlockCompression VoxelStreamSQLite::get_block_compression() const {
+	MutexLock lock(_connection_mutex);
+	return _block_compression;
+}
+
+void VoxelStreamSQLite::set_block_compression_level(int level) {
+	ERR_FAIL_COND(level < CompressedData::ZSTD_MIN_LEVEL || level > CompressedData::ZSTD_MAX_LEVEL);
+	MutexLock lock(_connection_mutex);
+	if (_block_compression_level == level) {
+		return;
+	}
+	_block_compression_level = level;
+	if (_zstd_dictionary != nullptr) {
+		// The level of a dictionary can't change
+		_zstd_dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+				_zstd_dictionary->get_data(), _block_compression_level);
+	}
+}
+
+int VoxelStreamSQLite::get_block_compression_level() const {
+	MutexLock lock(_connection_mutex);
+	return _block_compression_level;
+}
+
+bool VoxelStreamSQLite::train_block_compression_dictionary(
+		Span<const VoxelBufferInternal *const> samples, unsigned int max_size) {
+	ZN_PROFILE_SCOPE();
+
+	std::vector<uint8_t> dictionary_data;
+	ERR_FAIL_COND_V_MSG(!BlockSerializer::train_zstd_dictionary(samples, max_size, dictionary_data), false,
+			"Could not build a dictionary from the provided blocks");
+
+	VoxelStreamSQLiteInternal *con = get_connection();
+	ERR_FAIL_COND_V(con == nullptr, false);
+
+	bool success = false;
+	{
+		MutexLock lock(_connection_mutex);
+		if (_zstd_dictionary != nullptr) {
+			ERR_PRINT("The database already has a dictionary. Blocks saved with it could no longer be loaded.");
+		} else if (con->save_dictionary(to_span_const(dictionary_data))) {
+			_zstd_dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+					to_span_const(dictionary_data), _block_compression_level);
+			success = true;
+		}
+	}
+
+	recycle_connection(con);
+	return success;
+}
+
+bool VoxelStreamSQLite::has_block_compression_dictionary() const {
+	MutexLock lock(_connection_mutex);
+	return _zstd_dictionary != nullptr;
+}
+
+bool VoxelStreamSQLite::_b_train_block_compression_dictionary(Array voxel_buffers, int max_size) {
+	ERR_FAIL_COND_V(max_size <= 0, false);
+	std::vector<const VoxelBufferInternal *> samples;
+	samples.reserve(voxel_buffers.size());
+	for (int i = 0; i < voxel_buffers.size(); ++i) {
+		Ref<gd::VoxelBuffer> voxel_buffer = voxel_buffers[i];
+		ERR_FAIL_COND_V(voxel_buffer.is_null(), false);
+		samples.push_back(&voxel_buffer->get_buffer());
+	}
+	return train_block_compression_dictionary(to_span_const(samples), max_size);
+}
+
 void VoxelStreamSQLite::set_key_cache_enabled(bool enable) {
 	_block_keys_cache_enabled = enable;
 }
@@ -1063,6 +1972,85 @@ bool VoxelStreamSQLite::is_key_cache_enabled() const {
 	return _block_keys_cache_enabled;
 }
 
+void VoxelStreamSQLite::set_write_cache_budget_kb(int kb) {
+	ERR_FAIL_COND(kb < 0);
+	_write_cache_budget_kb = kb;
+}
+
+int VoxelStreamSQLite::get_write_cache_budget_kb() const {
+	return _write_cache_budget_kb;
+}
+
+void VoxelStreamSQLite::set_write_cache_flush_interval_ms(int ms) {
+	ERR_FAIL_COND(ms <= 0);
+	_write_cache_flush_interval_ms = ms;
+}
+
+int VoxelStreamSQLite::get_write_cache_flush_interval_ms() const {
+	return _write_cache_flush_interval_ms;
+}
+
+void VoxelStreamSQLite::set_connection_options(ConnectionOptions options) {
+	MutexLock lock(_connection_mutex);
+	if (_connection_options == options) {
+		return;
+	}
+	_connection_options = options;
+	// Connections will be opened again with the new options when needed. Those in use are deleted when recycled.
+	for (auto it = _connection_pool.begin(); it != _connection_pool.end(); ++it) {
+		delete *it;
+	}
+	_connection_pool.clear();
+}
+
+VoxelStreamSQLite::ConnectionOptions VoxelStreamSQLite::get_connection_options() const {
+	MutexLock lock(_connection_mutex);
+	return _connection_options;
+}
+
+void VoxelStreamSQLite::set_synchronous_mode(SynchronousMode mode) {
+	ERR_FAIL_INDEX(mode, _SYNCHRONOUS_COUNT);
+	ConnectionOptions options = get_connection_options();
+	options.synchronous_mode = mode;
+	set_connection_options(options);
+}
+
+VoxelStreamSQLite::SynchronousMode VoxelStreamSQLite::get_synchronous_mode() const {
+	return get_connection_options().synchronous_mode;
+}
+
+void VoxelStreamSQLite::set_mmap_size_mb(int mb) {
+	ERR_FAIL_COND(mb < 0);
+	ConnectionOptions options = get_connection_options();
+	options.mmap_size_mb = mb;
+	set_connection_options(options);
+}
+
+int VoxelStreamSQLite::get_mmap_size_mb() const {
+	return get_connection_options().mmap_size_mb;
+}
+
+void VoxelStreamSQLite::set_page_cache_size_kb(int kb) {
+	ERR_FAIL_COND(kb < 0);
+	ConnectionOptions options = get_connection_options();
+	options.page_cache_size_kb = kb;
+	set_connection_options(options);
+}
+
+int VoxelStreamSQLite::get_page_cache_size_kb() const {
+	return get_connection_options().page_cache_size_kb;
+}
+
+void VoxelStreamSQLite::set_morton_keys_enabled(bool enabled) {
+	ConnectionOptions options = get_connection_options();
+	options.morton_keys = enabled;
+	set_connection_options(options);
+}
+
+bool VoxelStreamSQLite::is_morton_keys_enabled() const {
+	return get_connection_options().morton_keys;
+}
+
 void VoxelStreamSQLite::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_database_path", "path"), &VoxelStreamSQLite::set_database_path);
 	ClassDB::bind_method(D_METHOD("get_database_path"), &VoxelStreamSQLite::get_database_path);
@@ -1070,8 +2058,71 @@ void VoxelStreamSQLite::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_key_cache_enabled", "enabled"), &VoxelStreamSQLite::set_key_cache_enabled);
 	ClassDB::bind_method(D_METHOD("is_key_cache_enabled"), &VoxelStreamSQLite::is_key_cache_enabled);
 
+	ClassDB::bind_method(D_METHOD("set_block_compression", "compression"), &VoxelStreamSQLite::set_block_compression);
+	ClassDB::bind_method(D_METHOD("get_block_compression"), &VoxelStreamSQLite::get_block_compression);
+
+	ClassDB::bind_method(
+			D_METHOD("set_block_compression_level", "level"), &VoxelStreamSQLite::set_block_compression_level);
+	ClassDB::bind_method(D_METHOD("get_block_compression_level"), &VoxelStreamSQLite::get_block_compression_level);
+
+	ClassDB::bind_method(D_METHOD("train_block_compression_dictionary", "voxel_buffers", "max_size"),
+			&VoxelStreamSQLite::_b_train_block_compression_dictionary,
+			DEFVAL(static_cast<int>(DEFAULT_DICTIONARY_SIZE)));
+	ClassDB::bind_method(
+			D_METHOD("has_block_compression_dictionary"), &VoxelStreamSQLite::has_block_compression_dictionary);
+
+	ClassDB::bind_method(D_METHOD("flush_cache"), &VoxelStreamSQLite::flush_cache);
+
+	ClassDB::bind_method(
+			D_METHOD("set_write_cache_budget_kb", "kb"), &VoxelStreamSQLite::set_write_cache_budget_kb);
+	ClassDB::bind_method(D_METHOD("get_write_cache_budget_kb"), &VoxelStreamSQLite::get_write_cache_budget_kb);
+
+	ClassDB::bind_method(D_METHOD("set_write_cache_flush_interval_ms", "ms"),
+			&VoxelStreamSQLite::set_write_cache_flush_interval_ms);
+	ClassDB::bind_method(
+			D_METHOD("get_write_cache_flush_interval_ms"), &VoxelStreamSQLite::get_write_cache_flush_interval_ms);
+
+	ClassDB::bind_method(D_METHOD("set_synchronous_mode", "mode"), &VoxelStreamSQLite::set_synchronous_mode);
+	ClassDB::bind_method(D_METHOD("get_synchronous_mode"), &VoxelStreamSQLite::get_synchronous_mode);
+
+	ClassDB::bind_method(D_METHOD("set_mmap_size_mb", "mb"), &VoxelStreamSQLite::set_mmap_size_mb);
+	ClassDB::bind_method(D_METHOD("get_mmap_size_mb"), &VoxelStreamSQLite::get_mmap_size_mb);
+
+	ClassDB::bind_method(D_METHOD("set_page_cache_size_kb", "kb"), &VoxelStreamSQLite::set_page_cache_size_kb);
+	ClassDB::bind_method(D_METHOD("get_page_cache_size_kb"), &VoxelStreamSQLite::get_page_cache_size_kb);
+
+	ClassDB::bind_method(D_METHOD("set_morton_keys_enabled", "enabled"), &VoxelStreamSQLite::set_morton_keys_enabled);
+	ClassDB::bind_method(D_METHOD("is_morton_keys_enabled"), &VoxelStreamSQLite::is_morton_keys_enabled);
+
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "database_path", PROPERTY_HINT_FILE), "set_database_path",
 			"get_database_path");
+
+	ADD_GROUP("Compression", "");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "block_compression", PROPERTY_HINT_ENUM, "LZ4,Zstandard"),
+			"set_block_compression", "get_block_compression");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "block_compression_level", PROPERTY_HINT_RANGE, "1,19,1"),
+			"set_block_compression_level", "get_block_compression_level");
+
+	ADD_GROUP("Write cache", "");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "write_cache_budget_kb", PROPERTY_HINT_RANGE, "0,65536,1,or_greater"),
+			"set_write_cache_budget_kb", "get_write_cache_budget_kb");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "write_cache_flush_interval_ms", PROPERTY_HINT_RANGE,
+						 "1,60000,1,or_greater"),
+			"set_write_cache_flush_interval_ms", "get_write_cache_flush_interval_ms");
+
+	ADD_GROUP("Database", "");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "synchronous_mode", PROPERTY_HINT_ENUM, "Off,Normal,Full"),
+			"set_synchronous_mode", "get_synchronous_mode");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "mmap_size_mb", PROPERTY_HINT_RANGE, "0,4096,1,or_greater"),
+			"set_mmap_size_mb", "get_mmap_size_mb");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "page_cache_size_kb", PROPERTY_HINT_RANGE, "0,262144,1,or_greater"),
+			"set_page_cache_size_kb", "get_page_cache_size_kb");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "morton_keys_enabled"), "set_morton_keys_enabled",
+			"is_morton_keys_enabled");
+
+	BIND_ENUM_CONSTANT(SYNCHRONOUS_OFF);
+	BIND_ENUM_CONSTANT(SYNCHRONOUS_NORMAL);
+	BIND_ENUM_CONSTANT(SYNCHRONOUS_FULL);
 }
 
 } // namespace zylann::voxel
@@ -3,10 +3,13 @@
 
 #include "../../util/math/vector3i16.h"
 #include "../../util/thread/mutex.h"
+#include "../../util/thread/semaphore.h"
+#include "../../util/thread/thread.h"
 #include "../voxel_block_serializer.h"
 #include "../voxel_stream.h"
-#include "../voxel_stream_cache.h"
 
+#include <atomic>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -18,7 +21,40 @@ class VoxelStreamSQLiteInternal;
 class VoxelStreamSQLite : public VoxelStream {
 	GDCLASS(VoxelStreamSQLite, VoxelStream)
 public:
-	static const unsigned int CACHE_SIZE = 64;
+	static const unsigned int DEFAULT_DICTIONARY_SIZE = 16384;
+	static const int DEFAULT_WRITE_CACHE_BUDGET_KB = 4096;
+	static const int DEFAULT_WRITE_CACHE_FLUSH_INTERVAL_MS = 2000;
+	static const int DEFAULT_MMAP_SIZE_MB = 256;
+	static const int DEFAULT_PAGE_CACHE_SIZE_KB = 4096;
+
+	// How much SQLite waits for data to reach the disk when writing. Values match SQLite's `synchronous` pragma.
+	enum SynchronousMode {
+		// Fastest. The database can get corrupted if the OS crashes or the power goes off while writing.
+		SYNCHRONOUS_OFF = 0,
+		// The last saved blocks can be lost if the OS crashes, but the database remains consistent.
+		SYNCHRONOUS_NORMAL = 1,
+		// Slowest. Blocks are on disk as soon as they are written.
+		SYNCHRONOUS_FULL = 2,
+
+		_SYNCHRONOUS_COUNT
+	};
+
+	// Settings applied to each connection when it is opened
+	struct ConnectionOptions {
+		SynchronousMode synchronous_mode = SYNCHRONOUS_NORMAL;
+		int mmap_size_mb = DEFAULT_MMAP_SIZE_MB;
+		int page_cache_size_kb = DEFAULT_PAGE_CACHE_SIZE_KB;
+		bool morton_keys = false;
+
+		inline bool operator==(const ConnectionOptions &other) const {
+			return synchronous_mode == other.synchronous_mode && mmap_size_mb == other.mmap_size_mb &&
+					page_cache_size_kb == other.page_cache_size_kb && morton_keys == other.morton_keys;
+		}
+
+		inline bool operator!=(const ConnectionOptions &other) const {
+			return !(*this == other);
+		}
+	};
 
 	VoxelStreamSQLite();
 	~VoxelStreamSQLite();
@@ -47,15 +83,90 @@ public:
 
 	int get_used_channels_mask() const override;
 
+	// Writes all saved blocks to the database now, instead of waiting for the background flush.
 	void flush_cache();
 
+	// Saved blocks are kept in memory, serialized, until they get written to the database by a background thread.
+	// That thread writes them when they take more than this amount of memory.
+	void set_write_cache_budget_kb(int kb);
+	int get_write_cache_budget_kb() const;
+
+	// The background thread also writes saved blocks after this amount of time, so they don't stay only in memory.
+	void set_write_cache_flush_interval_ms(int ms);
+	int get_write_cache_flush_interval_ms() const;
+
+	// Total size of saved blocks not yet written to the database
+	size_t get_write_cache_size_in_bytes() const;
+
+	void set_synchronous_mode(SynchronousMode mode);
+	SynchronousMode get_synchronous_mode() const;
+
+	// Size of the database file that can be mapped in memory, so reading blocks doesn't need to copy them from the
+	// OS cache. 0 turns it off.
+	void set_mmap_size_mb(int mb);
+	int get_mmap_size_mb() const;
+
+	// Memory each connection can use to keep pages of the database file.
+	void set_page_cache_size_kb(int kb);
+	int get_page_cache_size_kb() const;
+
+	// When enabled, new databases identify blocks with Morton keys, so blocks close to each other in space are stored
+	// close to each other in the file, and loading an area needs fewer disk reads. Existing databases are converted
+	// when opened, which can take some time if they are large. They can no longer be opened by older versions.
+	// Databases already using Morton keys keep using them when this is disabled.
+	// Should be set before the stream is used.
+	void set_morton_keys_enabled(bool enabled);
+	bool is_morton_keys_enabled() const;
+
 	// Might improve query performance if saved data is very sparse (like when only edited blocks are saved).
 	void set_key_cache_enabled(bool enable);
 	bool is_key_cache_enabled() const;
 
+	void set_block_compression(BlockCompression compression);
+	BlockCompression get_block_compression() const;
+
+	void set_block_compression_level(int level);
+	int get_block_compression_level() const;
+
+	// Builds a Zstandard dictionary from blocks representative of those that will be saved, and stores it in the
+	// database. It can only be done once per database.
+	bool train_block_compression_dictionary(Span<const VoxelBufferInternal *const> samples, unsigned int max_size);
+	bool has_block_compression_dictionary() const;
+
 private:
 	void rebuild_key_cache();
 
+	// Blocks that were saved but not written to the database yet. They are stored serialized and compressed, the
+	// way they will be written, so their size is known and flushing them only costs queries.
+	struct WriteCache {
+		struct Block {
+			std::vector<uint8_t> voxels;
+			std::vector<uint8_t> instances;
+			bool has_voxels = false;
+			bool has_instances = false;
+		};
+
+		// Blocks saved since the last flush began. Keys are encoded block locations.
+		std::unordered_map<uint64_t, Block> pending;
+		// Blocks being written by the current flush. They can still be loaded until the transaction is over.
+		// Only modified while holding both `mutex` and `_flush_mutex`.
+		std::unordered_map<uint64_t, Block> flushing;
+		size_t pending_size_in_bytes = 0;
+		BinaryMutex mutex;
+	};
+
+	enum BlockPart { //
+		BLOCK_PART_VOXELS,
+		BLOCK_PART_INSTANCES
+	};
+
+	void put_in_write_cache(uint64_t location_key, BlockPart part, Span<const uint8_t> data);
+	bool get_from_write_cache(uint64_t location_key, BlockPart part, std::vector<uint8_t> &out_data) const;
+	void ensure_dictionary_loaded();
+	void start_flusher_thread();
+	void stop_flusher_thread();
+	static void flusher_thread_func(void *p_stream);
+
 	struct BlockKeysCache {
 		FixedArray<std::unordered_set<Vector3i16>, constants::MAX_LOD> lods;
 		RWLock rw_lock;
@@ -109,16 +220,35 @@ private:
 	VoxelStreamSQLiteInternal *get_connection();
 	void recycle_connection(VoxelStreamSQLiteInternal *con);
 	void flush_cache_to_connection(VoxelStreamSQLiteInternal *p_connection);
+	void load_dictionary(VoxelStreamSQLiteInternal &con);
+	CompressedData::Settings get_compression_settings() const;
+	void set_connection_options(ConnectionOptions options);
+	ConnectionOptions get_connection_options() const;
+
+	bool _b_train_block_compression_dictionary(Array voxel_buffers, int max_size);
 
 	static void _bind_methods();
 
 	String _connection_path;
+	// Connections opened with different options are not put back in the pool
+	ConnectionOptions _connection_options;
 	std::vector<VoxelStreamSQLiteInternal *> _connection_pool;
 	Mutex _connection_mutex;
-	// This cache stores blocks in memory, and gets flushed to the database when big enough.
-	// This is because save queries are more expensive.
+	// This cache stores blocks in memory, and gets flushed to the database when big enough or after some time.
+	// This is because save queries are more expensive, and are cheaper when grouped in large transactions.
 	// It also speeds up queries of blocks that were recently saved.
-	VoxelStreamCache _cache;
+	WriteCache _write_cache;
+	// Only one flush at a time
+	BinaryMutex _flush_mutex;
+	std::atomic_int _write_cache_budget_kb = { DEFAULT_WRITE_CACHE_BUDGET_KB };
+	std::atomic_int _write_cache_flush_interval_ms = { DEFAULT_WRITE_CACHE_FLUSH_INTERVAL_MS };
+
+	// Writes the cache in the background, so threads saving blocks don't have to wait for the database
+	Thread _flusher_thread;
+	Semaphore _flusher_semaphore;
+	std::atomic_bool _flusher_thread_quit = { false };
+	// Protected by `_connection_mutex`
+	bool _flusher_thread_started = false;
 	// The current way we stream data is by querying every block location near each player, to know if there is data.
 	// Therefore testing if a block is present is the beginning of the most frequently executed code path.
 	// In configurations where only edited blocks get saved, very few blocks even get stored in the database,
@@ -127,8 +257,16 @@ private:
 	// such a cache can become quite large. In this case we could either allow turning it off, or use an octree.
 	BlockKeysCache _block_keys_cache;
 	bool _block_keys_cache_enabled = false;
+
+	// Protected by `_connection_mutex`
+	BlockCompression _block_compression = BLOCK_COMPRESSION_LZ4;
+	int _block_compression_level = CompressedData::ZSTD_DEFAULT_LEVEL;
+	std::shared_ptr<const CompressedData::ZstdDictionary> _zstd_dictionary;
+	bool _zstd_dictionary_loaded = false;
 };
 
 } // namespace zylann::voxel
 
+VARIANT_ENUM_CAST(zylann::voxel::VoxelStreamSQLite::SynchronousMode);
+
 #endif // VOXEL_STREAM_SQLITE_H
@@ -233,6 +233,297 @@ bool deserialize_metadata(Span<const uint8_t> p_src, VoxelBufferInternal &buffer
 	return true;
 }
 
+// Since v5, uncompressed channels are stored with a filter byte telling which transforms were applied to them.
+// Transforms make data more compressible. They are chosen for each channel of each block.
+enum ChannelFilter {
+	// Values are stored as-is
+	CHANNEL_FILTER_NONE = 0,
+	// Each value is replaced with its difference with the previous one along the Y axis (first values of columns are
+	// kept as-is). In ZXY order, columns along Y are contiguous. SDF is usually smooth along Y, so differences are
+	// small and repeat a lot.
+	CHANNEL_FILTER_DELTA_Y = 1,
+	// Bytes of values are grouped by significance: all lowest bytes first, then all next bytes etc. Values using only a
+	// small part of their range end up with long runs of identical high bytes. Only used with 16-bit depth and above.
+	CHANNEL_FILTER_BYTE_SHUFFLE = 2,
+	// Values are stored as runs. The number of runs comes first as uint32, then each run is a uint16 count followed by
+	// the value. Never combined with other filters.
+	CHANNEL_FILTER_RLE = 4,
+
+	CHANNEL_FILTER_MASK = CHANNEL_FILTER_DELTA_Y | CHANNEL_FILTER_BYTE_SHUFFLE | CHANNEL_FILTER_RLE
+};
+
+// LZ4 already handles long runs, so RLE is only used when it makes a channel much smaller. Expanding runs is also
+// faster than decompressing them.
+const unsigned int RLE_MIN_RATIO = 4;
+const unsigned int RLE_MAX_RUN_LENGTH = std::numeric_limits<uint16_t>::max();
+
+std::vector<uint8_t> &get_tls_channel_tmp() {
+	thread_local std::vector<uint8_t> tls_channel_tmp;
+	return tls_channel_tmp;
+}
+
+std::vector<uint8_t> &get_tls_filter_tmp() {
+	thread_local std::vector<uint8_t> tls_filter_tmp;
+	return tls_filter_tmp;
+}
+
+struct ChannelFilterChoice {
+	uint8_t filter = CHANNEL_FILTER_NONE;
+	uint32_t run_count = 0;
+};
+
+// Estimates which filters would work best, without actually encoding anything. Counting values repeating the previous
+// one is a cheap approximation of how well LZ4 will find matches.
+template <typename T>
+ChannelFilterChoice choose_channel_filter(Span<const T> values, unsigned int size_y, bool allow_delta) {
+	size_t run_count = 1;
+	unsigned int run_length = 1;
+	size_t raw_repeats = 0;
+	size_t delta_repeats = 0;
+
+	T prev_value = values[0];
+	T prev_delta = values[0];
+	unsigned int y = 1;
+
+	for (size_t i = 1; i < values.size(); ++i) {
+		const T v = values[i];
+
+		if (v == prev_value && run_length < RLE_MAX_RUN_LENGTH) {
+			++run_length;
+		} else {
+			++run_count;
+			run_length = 1;
+		}
+
+		if (y == size_y) {
+			// Beginning of a new column
+			prev_delta = v;
+			y = 1;
+		} else {
+			const T delta = static_cast<T>(v - prev_value);
+			if (v == prev_value) {
+				++raw_repeats;
+			}
+			if (delta == prev_delta) {
+				++delta_repeats;
+			}
+			prev_delta = delta;
+			++y;
+		}
+
+		prev_value = v;
+	}
+
+	ChannelFilterChoice choice;
+
+	const size_t raw_size = values.size() * sizeof(T);
+	const size_t rle_size = sizeof(uint32_t) + run_count * (sizeof(uint16_t) + sizeof(T));
+	if (rle_size * RLE_MIN_RATIO <= raw_size && run_count <= std::numeric_limits<uint32_t>::max()) {
+		choice.filter = CHANNEL_FILTER_RLE;
+		choice.run_count = run_count;
+		return choice;
+	}
+
+	if (allow_delta && delta_repeats > raw_repeats) {
+		choice.filter |= CHANNEL_FILTER_DELTA_Y;
+	}
+	if (sizeof(T) > 1) {
+		choice.filter |= CHANNEL_FILTER_BYTE_SHUFFLE;
+	}
+	return choice;
+}
+
+template <typename T>
+inline void append_value(std::vector<uint8_t> &dst, T v) {
+	const size_t pos = dst.size();
+	dst.resize(pos + sizeof(T));
+	memcpy(dst.data() + pos, &v, sizeof(T));
+}
+
+// Channels are stored in native byte order, like they were before filters were introduced
+template <typename T>
+void write_filtered_channel(Span<const T> values, ChannelFilterChoice choice, unsigned int size_y,
+		std::vector<uint8_t> &dst_data) {
+	if (choice.filter == CHANNEL_FILTER_RLE) {
+		append_value<uint32_t>(dst_data, choice.run_count);
+
+		T run_value = values[0];
+		uint16_t run_length = 1;
+		for (size_t i = 1; i < values.size(); ++i) {
+			const T v = values[i];
+			if (v == run_value && run_length < RLE_MAX_RUN_LENGTH) {
+				++run_length;
+			} else {
+				append_value<uint16_t>(dst_data, run_length);
+				append_value<T>(dst_data, run_value);
+				run_value = v;
+				run_length = 1;
+			}
+		}
+		append_value<uint16_t>(dst_data, run_length);
+		append_value<T>(dst_data, run_value);
+		return;
+	}
+
+	Span<const T> src = values;
+
+	if ((choice.filter & CHANNEL_FILTER_DELTA_Y) != 0) {
+		std::vector<uint8_t> &filter_tmp = get_tls_filter_tmp();
+		filter_tmp.resize(values.size() * sizeof(T));
+		Span<T> deltas = to_span(filter_tmp).reinterpret_cast_to<T>();
+
+		for (size_t column_begin = 0; column_begin < values.size(); column_begin += size_y) {
+			T prev_value = 0;
+			for (size_t i = column_begin; i < column_begin + size_y; ++i) {
+				const T v = values[i];
+				deltas[i] = static_cast<T>(v - prev_value);
+				prev_value = v;
+			}
+		}
+
+		src = deltas;
+	}
+
+	const size_t size_in_bytes = src.size() * sizeof(T);
+	const size_t begin = dst_data.size();
+	dst_data.resize(begin + size_in_bytes);
+	uint8_t *dst = dst_data.data() + begin;
+	const uint8_t *src_bytes = reinterpret_cast<const uint8_t *>(src.data());
+
+	if ((choice.filter & CHANNEL_FILTER_BYTE_SHUFFLE) != 0) {
+		for (unsigned int byte_index = 0; byte_index < sizeof(T); ++byte_index) {
+			uint8_t *dst_plane = dst + byte_index * src.size();
+			for (size_t i = 0; i < src.size(); ++i) {
+				dst_plane[i] = src_bytes[i * sizeof(T) + byte_index];
+			}
+		}
+	} else {
+		memcpy(dst, src_bytes, size_in_bytes);
+	}
+}
+
+template <typename T>
+bool read_filtered_channel(MemoryReader &mr, uint8_t filter, unsigned int size_y, Span<T> dst_values) {
+	if (filter == CHANNEL_FILTER_RLE) {
+		ZN_ASSERT_RETURN_V(mr.pos + sizeof(uint32_t) <= mr.data.size(), false);
+		// Native byte order, like the runs
+		uint32_t run_count;
+		memcpy(&run_count, mr.data.data() + mr.pos, sizeof(uint32_t));
+		mr.pos += sizeof(uint32_t);
+		const size_t run_size = sizeof(uint16_t) + sizeof(T);
+		ZN_ASSERT_RETURN_V_MSG(run_count <= (mr.data.size() - mr.pos) / run_size, false, "Unexpected end of file");
+
+		const uint8_t *src = mr.data.data() + mr.pos;
+		size_t dst_pos = 0;
+		for (uint32_t run_index = 0; run_index < run_count; ++run_index) {
+			uint16_t run_length;
+			T run_value;
+			memcpy(&run_length, src, sizeof(uint16_t));
+			memcpy(&run_value, src + sizeof(uint16_t), sizeof(T));
+			src += run_size;
+			ZN_ASSERT_RETURN_V_MSG(dst_pos + run_length <= dst_values.size(), false, "Run exceeds channel size");
+			std::fill(dst_values.data() + dst_pos, dst_values.data() + dst_pos + run_length, run_value);
+			dst_pos += run_length;
+		}
+		ZN_ASSERT_RETURN_V_MSG(dst_pos == dst_values.size(), false, "Runs don't cover the whole channel");
+
+		mr.pos += run_count * run_size;
+		return true;
+	}
+
+	ZN_ASSERT_RETURN_V_MSG((filter & CHANNEL_FILTER_RLE) == 0, false, "RLE cannot be combined with other filters");
+
+	const size_t size_in_bytes = dst_values.size() * sizeof(T);
+	ZN_ASSERT_RETURN_V_MSG(mr.pos + size_in_bytes <= mr.data.size(), false, "Unexpected end of file");
+	const uint8_t *src = mr.data.data() + mr.pos;
+	uint8_t *dst_bytes = reinterpret_cast<uint8_t *>(dst_values.data());
+
+	if ((filter & CHANNEL_FILTER_BYTE_SHUFFLE) != 0) {
+		for (unsigned int byte_index = 0; byte_index < sizeof(T); ++byte_index) {
+			const uint8_t *src_plane = src + byte_index * dst_values.size();
+			for (size_t i = 0; i < dst_values.size(); ++i) {
+				dst_bytes[i * sizeof(T) + byte_index] = src_plane[i];
+			}
+		}
+	} else {
+		memcpy(dst_bytes, src, size_in_bytes);
+	}
+
+	mr.pos += size_in_bytes;
+
+	if ((filter & CHANNEL_FILTER_DELTA_Y) != 0) {
+		for (size_t column_begin = 0; column_begin < dst_values.size(); column_begin += size_y) {
+			T value = 0;
+			for (size_t i = column_begin; i < column_begin + size_y; ++i) {
+				value = static_cast<T>(value + dst_values[i]);
+				dst_values[i] = value;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Writes the filter byte followed by filtered data
+static void serialize_channel_with_filter(Span<const uint8_t> raw_data, VoxelBufferInternal::Depth depth,
+		unsigned int size_y, bool allow_delta, std::vector<uint8_t> &dst_data) {
+	ChannelFilterChoice choice;
+
+	switch (depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT: {
+			Span<const uint8_t> values = raw_data;
+			choice = choose_channel_filter(values, size_y, allow_delta);
+			dst_data.push_back(choice.filter);
+			write_filtered_channel(values, choice, size_y, dst_data);
+		} break;
+
+		case VoxelBufferInternal::DEPTH_16_BIT: {
+			Span<const uint16_t> values = raw_data.reinterpret_cast_to<const uint16_t>();
+			choice = choose_channel_filter(values, size_y, allow_delta);
+			dst_data.push_back(choice.filter);
+			write_filtered_channel(values, choice, size_y, dst_data);
+		} break;
+
+		case VoxelBufferInternal::DEPTH_32_BIT: {
+			Span<const uint32_t> values = raw_data.reinterpret_cast_to<const uint32_t>();
+			choice = choose_channel_filter(values, size_y, allow_delta);
+			dst_data.push_back(choice.filter);
+			write_filtered_channel(values, choice, size_y, dst_data);
+		} break;
+
+		case VoxelBufferInternal::DEPTH_64_BIT: {
+			Span<const uint64_t> values = raw_data.reinterpret_cast_to<const uint64_t>();
+			choice = choose_channel_filter(values, size_y, allow_delta);
+			dst_data.push_back(choice.filter);
+			write_filtered_channel(values, choice, size_y, dst_data);
+		} break;
+
+		default:
+			CRASH_NOW();
+	}
+}
+
+static bool deserialize_channel_with_filter(
+		MemoryReader &mr, VoxelBufferInternal::Depth depth, unsigned int size_y, Span<uint8_t> dst_data) {
+	ZN_ASSERT_RETURN_V_MSG(mr.pos < mr.data.size(), false, "Unexpected end of file");
+	const uint8_t filter = mr.get_8();
+	ZN_ASSERT_RETURN_V_MSG((filter & ~CHANNEL_FILTER_MASK) == 0, false, format("Unknown channel filter {}", filter));
+
+	switch (depth) {
+		case VoxelBufferInternal::DEPTH_8_BIT:
+			return read_filtered_channel(mr, filter, size_y, dst_data);
+		case VoxelBufferInternal::DEPTH_16_BIT:
+			return read_filtered_channel(mr, filter, size_y, dst_data.reinterpret_cast_to<uint16_t>());
+		case VoxelBufferInternal::DEPTH_32_BIT:
+			return read_filtered_channel(mr, filter, size_y, dst_data.reinterpret_cast_to<uint32_t>());
+		case VoxelBufferInternal::DEPTH_64_BIT:
+			return read_filtered_channel(mr, filter, size_y, dst_data.reinterpret_cast_to<uint64_t>());
+		default:
+			ZN_PRINT_ERROR("Unhandled depth");
+			return false;
+	}
+}
+
 size_t get_size_in_bytes(const VoxelBufferInternal &buffer, size_t &metadata_size) {
 	// Version and size
 	size_t size = 1 * sizeof(uint8_t) + 3 * sizeof(uint16_t);
@@ -247,7 +538,11 @@ size_t get_size_in_bytes(const VoxelBufferInternal &buffer, size_t &metadata_siz
 		size += 1;
 
 		switch (compression) {
-			case VoxelBufferInternal::COMPRESSION_NONE: {
+			case VoxelBufferInternal::COMPRESSION_NONE:
+			case VoxelBufferInternal::COMPRESSION_PALETTE:
+			case VoxelBufferInternal::COMPRESSION_BRICKS: {
+				// Filter byte. Filters never make data bigger than this.
+				size += 1;
 				size += VoxelBufferInternal::get_size_in_bytes_for_volume(size_in_voxels, depth);
 			} break;
 
@@ -255,6 +550,11 @@ size_t get_size_in_bytes(const VoxelBufferInternal &buffer, size_t &metadata_siz
 				size += VoxelBufferInternal::get_depth_bit_count(depth) >> 3;
 			} break;
 
+			case VoxelBufferInternal::COMPRESSION_QUANTIZED: {
+				// Step, then one byte per voxel
+				size += sizeof(uint16_t) + Vector3iUtil::get_volume(size_in_voxels);
+			} break;
+
 			default:
 				ERR_PRINT("Unhandled compression mode");
 				CRASH_NOW();
@@ -263,6 +563,7 @@ size_t get_size_in_bytes(const VoxelBufferInternal &buffer, size_t &metadata_siz
 
 	metadata_size = get_metadata_size_in_bytes(buffer);
 
+	// Note, this is an upper bound when channel filters make data smaller
 	size_t metadata_size_with_header = 0;
 	if (metadata_size > 0) {
 		metadata_size_with_header = metadata_size + BLOCK_METADATA_HEADER_SIZE;
@@ -303,7 +604,12 @@ SerializeResult serialize(const VoxelBufferInternal &voxel_buffer) {
 	f.store_16(voxel_buffer.get_size().z);
 
 	for (unsigned int channel_index = 0; channel_index < VoxelBufferInternal::MAX_CHANNELS; ++channel_index) {
-		const VoxelBufferInternal::Compression compression = voxel_buffer.get_channel_compression(channel_index);
+		VoxelBufferInternal::Compression compression = voxel_buffer.get_channel_compression(channel_index);
+		if (compression == VoxelBufferInternal::COMPRESSION_PALETTE ||
+				compression == VoxelBufferInternal::COMPRESSION_BRICKS) {
+			// Palettes and bricks are only used in memory, such channels are saved uncompressed
+			compression = VoxelBufferInternal::COMPRESSION_NONE;
+		}
 		const VoxelBufferInternal::Depth depth = voxel_buffer.get_channel_depth(channel_index);
 		// Low nibble: compression (up to 16 values allowed)
 		// High nibble: depth (up to 16 values allowed)
@@ -313,8 +619,18 @@ SerializeResult serialize(const VoxelBufferInternal &voxel_buffer) {
 		switch (compression) {
 			case VoxelBufferInternal::COMPRESSION_NONE: {
 				Span<uint8_t> data;
-				ERR_FAIL_COND_V(!voxel_buffer.get_channel_raw(channel_index, data), SerializeResult(dst_data, false));
-				f.store_buffer(data);
+				if (!voxel_buffer.get_channel_raw(channel_index, data)) {
+					// Decompress into a temporary buffer, filters need all values
+					std::vector<uint8_t> &channel_tmp = get_tls_channel_tmp();
+					channel_tmp.resize(
+							VoxelBufferInternal::get_size_in_bytes_for_volume(voxel_buffer.get_size(), depth));
+					data = to_span(channel_tmp);
+					voxel_buffer.copy_channel_raw_to(channel_index, data);
+				}
+				// Differences between floats are not smaller or more regular than the floats themselves
+				const bool allow_delta = !(channel_index == VoxelBufferInternal::CHANNEL_SDF &&
+						depth >= VoxelBufferInternal::DEPTH_32_BIT);
+				serialize_channel_with_filter(data, depth, voxel_buffer.get_size().y, allow_delta, dst_data);
 			} break;
 
 			case VoxelBufferInternal::COMPRESSION_UNIFORM: {
@@ -337,6 +653,14 @@ SerializeResult serialize(const VoxelBufferInternal &voxel_buffer) {
 				}
 			} break;
 
+			case VoxelBufferInternal::COMPRESSION_QUANTIZED: {
+				Span<uint8_t> data;
+				uint16_t step;
+				CRASH_COND(!voxel_buffer.get_channel_quantized_raw(channel_index, data, step));
+				f.store_16(step);
+				f.store_buffer(data);
+			} break;
+
 			default:
 				CRASH_COND("Unhandled compression mode");
 		}
@@ -355,7 +679,7 @@ SerializeResult serialize(const VoxelBufferInternal &voxel_buffer) {
 	f.store_32(BLOCK_TRAILING_MAGIC);
 
 	// Check out of bounds writing
-	CRASH_COND(dst_data.size() != expected_data_size);
+	CRASH_COND(dst_data.size() > expected_data_size);
 
 	return SerializeResult(dst_data, true);
 }
@@ -585,10 +909,16 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buff
 			return deserialize(to_span(migrated_data), out_voxel_buffer);
 		} break;
 
+		case 4:
+			// Same as v5, without channel filters and quantized channels
+			break;
+
 		default:
 			ERR_FAIL_COND_V(format_version != BLOCK_FORMAT_VERSION, false);
 	}
 
+	const bool has_channel_filters = format_version >= 5;
+
 	const unsigned int size_x = f.get_16();
 	const unsigned int size_y = f.get_16();
 	const unsigned int size_z = f.get_16();
@@ -601,6 +931,9 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buff
 		const uint8_t depth_value = (fmt >> 4) & 0xf;
 		ERR_FAIL_COND_V_MSG(compression_value >= VoxelBufferInternal::COMPRESSION_COUNT, false,
 				"At offset 0x" + String::num_int64(f.get_position() - 1, 16));
+		// Quantized channels were added in version 5
+		ERR_FAIL_COND_V_MSG(format_version < 5 && compression_value == VoxelBufferInternal::COMPRESSION_QUANTIZED,
+				false, "At offset 0x" + String::num_int64(f.get_position() - 1, 16));
 		ERR_FAIL_COND_V_MSG(depth_value >= VoxelBufferInternal::DEPTH_COUNT, false,
 				"At offset 0x" + String::num_int64(f.get_position() - 1, 16));
 		VoxelBufferInternal::Compression compression = (VoxelBufferInternal::Compression)compression_value;
@@ -615,10 +948,16 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buff
 				Span<uint8_t> buffer;
 				CRASH_COND(!out_voxel_buffer.get_channel_raw(channel_index, buffer));
 
-				const size_t read_len = f.get_buffer(buffer);
-				if (read_len != buffer.size()) {
-					ERR_PRINT("Unexpected end of file");
-					return false;
+				if (has_channel_filters) {
+					ERR_FAIL_COND_V_MSG(!deserialize_channel_with_filter(f, depth, size_y, buffer), false,
+							"At offset 0x" + String::num_int64(f.get_position(), 16));
+
+				} else {
+					const size_t read_len = f.get_buffer(buffer);
+					if (read_len != buffer.size()) {
+						ERR_PRINT("Unexpected end of file");
+						return false;
+					}
 				}
 
 			} break;
@@ -644,6 +983,23 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buff
 				out_voxel_buffer.clear_channel(channel_index, v);
 			} break;
 
+			case VoxelBufferInternal::COMPRESSION_QUANTIZED: {
+				ERR_FAIL_COND_V_MSG(
+						channel_index != VoxelBufferInternal::CHANNEL_SDF, false, "Only SDF can be quantized");
+				ERR_FAIL_COND_V(depth != VoxelBufferInternal::DEPTH_16_BIT, false);
+				const uint16_t step = f.get_16();
+				ERR_FAIL_COND_V(step == 0, false);
+
+				Span<uint8_t> buffer;
+				ERR_FAIL_COND_V(!out_voxel_buffer.create_quantized_channel(channel_index, step, buffer), false);
+
+				const size_t read_len = f.get_buffer(buffer);
+				if (read_len != buffer.size()) {
+					ERR_PRINT("Unexpected end of file");
+					return false;
+				}
+			} break;
+
 			default:
 				ERR_PRINT("Unhandled compression mode");
 				return false;
@@ -665,6 +1021,13 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buff
 }
 
 SerializeResult serialize_and_compress(const VoxelBufferInternal &voxel_buffer) {
+	CompressedData::Settings compression_settings;
+	compression_settings.compression = CompressedData::COMPRESSION_LZ4;
+	return serialize_and_compress(voxel_buffer, compression_settings);
+}
+
+SerializeResult serialize_and_compress(
+		const VoxelBufferInternal &voxel_buffer, const CompressedData::Settings &compression_settings) {
 	ZN_PROFILE_SCOPE();
 
 	std::vector<uint8_t> &compressed_data = get_tls_compressed_data();
@@ -674,24 +1037,26 @@ SerializeResult serialize_and_compress(const VoxelBufferInternal &voxel_buffer)
 	const std::vector<uint8_t> &data = res.data;
 
 	res.success = CompressedData::compress(
-			Span<const uint8_t>(data.data(), 0, data.size()), compressed_data, CompressedData::COMPRESSION_LZ4);
+			Span<const uint8_t>(data.data(), 0, data.size()), compressed_data, compression_settings);
 	ERR_FAIL_COND_V(!res.success, SerializeResult(compressed_data, false));
 
 	return SerializeResult(compressed_data, true);
 }
 
-bool decompress_and_deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buffer) {
+bool decompress_and_deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buffer,
+		const CompressedData::ZstdDictionary *zstd_dictionary) {
 	ZN_PROFILE_SCOPE();
 
 	std::vector<uint8_t> &data = get_tls_data();
 
-	const bool res = CompressedData::decompress(p_data, data);
+	const bool res = CompressedData::decompress(p_data, data, zstd_dictionary);
 	ERR_FAIL_COND_V(!res, false);
 
 	return deserialize(to_span_const(data), out_voxel_buffer);
 }
 
-bool decompress_and_deserialize(FileAccess &f, unsigned int size_to_read, VoxelBufferInternal &out_voxel_buffer) {
+bool decompress_and_deserialize(FileAccess &f, unsigned int size_to_read, VoxelBufferInternal &out_voxel_buffer,
+		const CompressedData::ZstdDictionary *zstd_dictionary) {
 	ZN_PROFILE_SCOPE();
 
 #if defined(TOOLS_ENABLED) || defined(DEBUG_ENABLED)
@@ -706,7 +1071,30 @@ bool decompress_and_deserialize(FileAccess &f, unsigned int size_to_read, VoxelB
 	const unsigned int read_size = get_buffer(f, to_span(compressed_data));
 	ERR_FAIL_COND_V(read_size != size_to_read, false);
 
-	return decompress_and_deserialize(to_span(compressed_data), out_voxel_buffer);
+	return decompress_and_deserialize(to_span(compressed_data), out_voxel_buffer, zstd_dictionary);
+}
+
+bool train_zstd_dictionary(
+		Span<const VoxelBufferInternal *const> samples, unsigned int max_size, std::vector<uint8_t> &out_dictionary) {
+	ZN_PROFILE_SCOPE();
+
+	// Serialized data is in a thread-local buffer, it has to be copied
+	std::vector<std::vector<uint8_t>> serialized_samples;
+	serialized_samples.reserve(samples.size());
+	for (const VoxelBufferInternal *voxel_buffer : samples) {
+		ZN_ASSERT_CONTINUE(voxel_buffer != nullptr);
+		const SerializeResult res = serialize(*voxel_buffer);
+		ZN_ASSERT_CONTINUE(res.success);
+		serialized_samples.push_back(res.data);
+	}
+
+	std::vector<Span<const uint8_t>> sample_spans;
+	sample_spans.reserve(serialized_samples.size());
+	for (const std::vector<uint8_t> &data : serialized_samples) {
+		sample_spans.push_back(to_span_const(data));
+	}
+
+	return CompressedData::train_zstd_dictionary(to_span_const(sample_spans), max_size, out_dictionary);
 }
 
 } // namespace BlockSerializer
@@ -3,6 +3,7 @@
 
 #include "../util/macros.h"
 #include "../util/span.h"
+#include "compressed_data.h"
 
 #include <cstdint>
 #include <vector>
@@ -20,7 +21,7 @@ class VoxelBufferInternal;
 namespace BlockSerializer {
 
 // Latest version, used when serializing
-static const uint8_t BLOCK_FORMAT_VERSION = 4;
+static const uint8_t BLOCK_FORMAT_VERSION = 5;
 
 struct SerializeResult {
 	// The lifetime of the pointed object is only valid in the calling thread,
@@ -35,8 +36,17 @@ SerializeResult serialize(const VoxelBufferInternal &voxel_buffer);
 bool deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buffer);
 
 SerializeResult serialize_and_compress(const VoxelBufferInternal &voxel_buffer);
-bool decompress_and_deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buffer);
-bool decompress_and_deserialize(FileAccess &f, unsigned int size_to_read, VoxelBufferInternal &out_voxel_buffer);
+SerializeResult serialize_and_compress(
+		const VoxelBufferInternal &voxel_buffer, const CompressedData::Settings &compression_settings);
+// A dictionary must be provided if blocks were compressed with one.
+bool decompress_and_deserialize(Span<const uint8_t> p_data, VoxelBufferInternal &out_voxel_buffer,
+		const CompressedData::ZstdDictionary *zstd_dictionary = nullptr);
+bool decompress_and_deserialize(FileAccess &f, unsigned int size_to_read, VoxelBufferInternal &out_voxel_buffer,
+		const CompressedData::ZstdDictionary *zstd_dictionary = nullptr);
+
+// Builds a Zstandard dictionary from blocks representative of those that will be saved.
+bool train_zstd_dictionary(
+		Span<const VoxelBufferInternal *const> samples, unsigned int max_size, std::vector<uint8_t> &out_dictionary);
 
 // Temporary thread-local buffers for internal use
 std::vector<uint8_t> &get_tls_data();
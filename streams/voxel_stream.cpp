@@ -134,4 +134,7 @@ void VoxelStream::_bind_methods() {
 	BIND_ENUM_CONSTANT(RESULT_ERROR);
 	BIND_ENUM_CONSTANT(RESULT_BLOCK_FOUND);
 	BIND_ENUM_CONSTANT(RESULT_BLOCK_NOT_FOUND);
+
+	BIND_ENUM_CONSTANT(BLOCK_COMPRESSION_LZ4);
+	BIND_ENUM_CONSTANT(BLOCK_COMPRESSION_ZSTD);
 }
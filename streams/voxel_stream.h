@@ -41,6 +41,16 @@ public:
 		_RESULT_COUNT
 	};
 
+	// How streams saving blocks to files compress them, when they support several ways
+	enum BlockCompression {
+		// Fastest to compress and decompress
+		BLOCK_COMPRESSION_LZ4,
+		// Smaller than LZ4, especially with a trained dictionary. Slower to compress, decompression remains fast.
+		BLOCK_COMPRESSION_ZSTD,
+
+		_BLOCK_COMPRESSION_COUNT
+	};
+
 	struct VoxelQueryData {
 		VoxelBufferInternal &voxel_buffer;
 		Vector3i origin_in_voxels;
@@ -136,5 +146,6 @@ private:
 } // namespace zylann::voxel
 
 VARIANT_ENUM_CAST(zylann::voxel::VoxelStream::ResultCode);
+VARIANT_ENUM_CAST(zylann::voxel::VoxelStream::BlockCompression);
 
 #endif // VOXEL_STREAM_H
@@ -33,6 +33,9 @@
 #include "../voxel_save_completion_tracker.h"
 #include "voxel_terrain_multiplayer_synchronizer.h"
 
+#include <algorithm>
+#include <limits>
+
 #ifdef TOOLS_ENABLED
 #include "../../meshers/transvoxel/voxel_mesher_transvoxel.h"
 #endif
@@ -55,6 +58,8 @@ VoxelTerrain::VoxelTerrain() {
 	_streaming_dependency = make_shared_instance<StreamingDependency>();
 	_meshing_dependency = make_shared_instance<MeshingDependency>();
 
+	_prefetch_cache.set_max_blocks(DEFAULT_PREFETCH_CACHE_MAX_BLOCKS);
+
 	struct ApplyMeshUpdateTask : public ITimeSpreadTask {
 		void run(TimeSpreadTaskContext &ctx) override {
 			if (!VoxelEngine::get_singleton().is_volume_valid(volume_id)) {
@@ -393,6 +398,26 @@ bool VoxelTerrain::is_automatic_loading_enabled() const {
 	return _automatic_loading_enabled;
 }
 
+void VoxelTerrain::set_prefetch_time(float seconds) {
+	_prefetch_time = math::max(seconds, 0.f);
+	if (_prefetch_time == 0.f) {
+		clear_prefetch_cache();
+	}
+}
+
+float VoxelTerrain::get_prefetch_time() const {
+	return _prefetch_time;
+}
+
+void VoxelTerrain::set_prefetch_cache_max_blocks(int count) {
+	_prefetch_cache.set_max_blocks(math::max(count, 0));
+	trim_prefetch_cache();
+}
+
+int VoxelTerrain::get_prefetch_cache_max_blocks() const {
+	return _prefetch_cache.get_max_blocks();
+}
+
 void VoxelTerrain::try_schedule_mesh_update(VoxelMeshBlockVT &mesh_block) {
 	if (mesh_block.get_mesh_state() == VoxelMeshBlockVT::MESH_UPDATE_NOT_SENT) {
 		// Already in the list
@@ -568,6 +593,12 @@ Dictionary VoxelTerrain::_b_get_statistics() const {
 	d["dropped_block_meshs"] = _stats.dropped_block_meshs;
 	d["updated_blocks"] = _stats.updated_blocks;
 
+	const VoxelTerrainPrefetchCache::Stats &prefetch_stats = _prefetch_cache.get_stats();
+	d["prefetch_requests"] = prefetch_stats.requests;
+	d["prefetch_hits"] = prefetch_stats.hits;
+	d["prefetch_evictions"] = prefetch_stats.evictions;
+	d["prefetched_blocks"] = static_cast<int>(_prefetch_cache.get_cached_count());
+
 	return d;
 }
 
@@ -655,6 +686,7 @@ void VoxelTerrain::stop_streamer() {
 	// VoxelEngine::get_singleton().set_volume_generator(_volume_id, Ref<VoxelGenerator>());
 	_loading_blocks.clear();
 	_blocks_pending_load.clear();
+	clear_prefetch_cache();
 }
 
 void VoxelTerrain::reset_map() {
@@ -671,6 +703,7 @@ void VoxelTerrain::reset_map() {
 	_blocks_pending_load.clear();
 	_blocks_pending_update.clear();
 	_blocks_to_save.clear();
+	clear_prefetch_cache();
 
 	// No need to care about refcounts, we drop everything anyways. Will pair it back on next process.
 	_paired_viewers.clear();
@@ -816,6 +849,25 @@ static void init_sparse_grid_priority_dependency(PriorityDependency &dep, Vector
 			math::squared(shared_viewers_data->highest_view_distance + 2.f * transformed_block_radius);
 }
 
+static void request_block_generate(VolumeID volume_id, std::shared_ptr<StreamingDependency> stream_dependency,
+		uint32_t data_block_size, Vector3i block_pos,
+		std::shared_ptr<PriorityDependency::ViewersData> &shared_viewers_data, const Transform3D volume_transform) {
+	ZN_ASSERT(stream_dependency != nullptr);
+	ERR_FAIL_COND(stream_dependency->generator.is_null());
+
+	GenerateBlockTask *task = ZN_NEW(GenerateBlockTask);
+	task->volume_id = volume_id;
+	task->position = block_pos;
+	task->lod = 0;
+	task->block_size = data_block_size;
+	task->stream_dependency = stream_dependency;
+
+	init_sparse_grid_priority_dependency(
+			task->priority_dependency, block_pos, data_block_size, shared_viewers_data, volume_transform);
+
+	VoxelEngine::get_singleton().push_async_task(task);
+}
+
 static void request_block_load(VolumeID volume_id, std::shared_ptr<StreamingDependency> stream_dependency,
 		uint32_t data_block_size, Vector3i block_pos,
 		std::shared_ptr<PriorityDependency::ViewersData> &shared_viewers_data, const Transform3D volume_transform,
@@ -834,20 +886,31 @@ static void request_block_load(VolumeID volume_id, std::shared_ptr<StreamingDepe
 
 	} else {
 		// Directly generate the block without checking the stream
-		ERR_FAIL_COND(stream_dependency->generator.is_null());
+		request_block_generate(
+				volume_id, stream_dependency, data_block_size, block_pos, shared_viewers_data, volume_transform);
+	}
+}
 
-		GenerateBlockTask *task = ZN_NEW(GenerateBlockTask);
-		task->volume_id = volume_id;
-		task->position = block_pos;
-		task->lod = 0;
-		task->block_size = data_block_size;
-		task->stream_dependency = stream_dependency;
+static void request_block_prefetch(VolumeID volume_id, std::shared_ptr<StreamingDependency> stream_dependency,
+		uint32_t data_block_size, Vector3i block_pos,
+		std::shared_ptr<PriorityDependency::ViewersData> &shared_viewers_data, const Transform3D volume_transform,
+		bool request_instances) {
+	ZN_ASSERT(stream_dependency != nullptr);
+	ZN_ASSERT_RETURN(stream_dependency->stream.is_valid());
 
-		init_sparse_grid_priority_dependency(
-				task->priority_dependency, block_pos, data_block_size, shared_viewers_data, volume_transform);
+	PriorityDependency priority_dependency;
+	init_sparse_grid_priority_dependency(
+			priority_dependency, block_pos, data_block_size, shared_viewers_data, volume_transform);
+	// Prefetched blocks can be up to one view distance ahead of the range of viewers, so they are only cancelled when
+	// about twice as far as regular blocks
+	priority_dependency.drop_distance_squared *= 4.f;
 
-		VoxelEngine::get_singleton().push_async_task(task);
-	}
+	// Blocks not found are not generated. It will be done if they actually enter the range of a viewer.
+	LoadBlockDataTask *task = ZN_NEW(LoadBlockDataTask(volume_id, block_pos, 0, data_block_size, request_instances,
+			stream_dependency, priority_dependency, false));
+	task->set_prefetch(true);
+
+	VoxelEngine::get_singleton().push_async_io_task(task);
 }
 
 void VoxelTerrain::send_data_load_requests() {
@@ -870,6 +933,163 @@ void VoxelTerrain::send_data_load_requests() {
 	}
 }
 
+void VoxelTerrain::send_prefetch_requests() {
+	ZN_PROFILE_SCOPE();
+
+	trim_prefetch_cache();
+
+	std::shared_ptr<PriorityDependency::ViewersData> shared_viewers_data =
+			VoxelEngine::get_singleton().get_shared_viewers_data_from_default_world();
+	const Transform3D volume_transform = get_global_transform();
+	const uint32_t data_block_size = get_data_block_size();
+
+	for (const PairedViewer &viewer : _paired_viewers) {
+		if (viewer.state.prefetch_box == viewer.prev_state.prefetch_box) {
+			// Requests were already made for this area
+			continue;
+		}
+
+		viewer.state.prefetch_box.difference(viewer.state.data_box, [&](Box3i box_to_prefetch) {
+			box_to_prefetch.for_each_cell([&](Vector3i bpos) {
+				if (!_prefetch_cache.can_request(bpos) || _loading_blocks.find(bpos) != _loading_blocks.end() ||
+						_data->has_block(bpos, 0)) {
+					return;
+				}
+				request_block_prefetch(_volume_id, _streaming_dependency, data_block_size, bpos, shared_viewers_data,
+						volume_transform, _instancer != nullptr);
+				_prefetch_cache.add_request(bpos);
+			});
+		});
+	}
+}
+
+// Returns true if the block doesn't need a loading request because it was prefetched, or is being prefetched.
+bool VoxelTerrain::try_promote_prefetched_block(Vector3i bpos) {
+	switch (_prefetch_cache.promote(bpos)) {
+		case VoxelTerrainPrefetchCache::PROMOTE_CACHED:
+			_blocks_pending_promotion.push_back(bpos);
+			return true;
+		case VoxelTerrainPrefetchCache::PROMOTE_IN_FLIGHT:
+			// Will be applied when the prefetch request completes
+			return true;
+		default:
+			return false;
+	}
+}
+
+void VoxelTerrain::apply_prefetched_block(Vector3i bpos) {
+	if (_loading_blocks.find(bpos) == _loading_blocks.end()) {
+		// Went out of range before being applied, keep it prefetched
+		return;
+	}
+
+	VoxelTerrainPrefetchCache::Block prefetched_block;
+	if (!_prefetch_cache.take(bpos, prefetched_block)) {
+		// Evicted in the meantime
+		_blocks_pending_load.push_back(bpos);
+		return;
+	}
+
+	if (prefetched_block.voxels == nullptr) {
+		// Not in the stream, no need to query it again
+		generate_prefetched_block(bpos);
+		return;
+	}
+
+	VoxelEngine::BlockDataOutput ob;
+	ob.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+	ob.voxels = std::move(prefetched_block.voxels);
+	ob.instances = std::move(prefetched_block.instances);
+	ob.position = bpos;
+	ob.lod = 0;
+	ob.dropped = false;
+	ob.max_lod_hint = false;
+	ob.initial_load = false;
+	apply_data_block_response(ob);
+}
+
+void VoxelTerrain::generate_prefetched_block(Vector3i bpos) {
+	if (get_generator().is_valid()) {
+		std::shared_ptr<PriorityDependency::ViewersData> shared_viewers_data =
+				VoxelEngine::get_singleton().get_shared_viewers_data_from_default_world();
+		request_block_generate(_volume_id, _streaming_dependency, get_data_block_size(), bpos, shared_viewers_data,
+				get_global_transform());
+	} else {
+		// Let the regular loading path decide what to do
+		_blocks_pending_load.push_back(bpos);
+	}
+}
+
+void VoxelTerrain::apply_prefetched_block_response(VoxelEngine::BlockDataOutput &ob) {
+	const Vector3i block_pos = ob.position;
+
+	if (!_prefetch_cache.complete_request(block_pos)) {
+		// The prefetch cache was cleared since the request was made
+		return;
+	}
+
+	if (_loading_blocks.find(block_pos) != _loading_blocks.end()) {
+		// The block entered the range of a viewer while it was being prefetched
+		if (ob.dropped) {
+			_blocks_pending_load.push_back(block_pos);
+		} else if (ob.voxels == nullptr) {
+			generate_prefetched_block(block_pos);
+		} else {
+			ob.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+			apply_data_block_response(ob);
+		}
+		return;
+	}
+
+	if (ob.dropped || _data->has_block(block_pos, 0)) {
+		// Viewers went away, or the block was set by other means in the meantime
+		return;
+	}
+
+	static thread_local std::vector<Box3i> tls_prefetch_boxes;
+	tls_prefetch_boxes.clear();
+	for (const PairedViewer &viewer : _paired_viewers) {
+		tls_prefetch_boxes.push_back(viewer.state.prefetch_box);
+	}
+
+	VoxelTerrainPrefetchCache::Block prefetched_block;
+	prefetched_block.voxels = std::move(ob.voxels);
+	prefetched_block.instances = std::move(ob.instances);
+	_prefetch_cache.store(block_pos, std::move(prefetched_block), to_span(tls_prefetch_boxes));
+}
+
+void VoxelTerrain::trim_prefetch_cache() {
+	if (_prefetch_cache.get_cached_count() <= _prefetch_cache.get_max_blocks()) {
+		return;
+	}
+
+	static thread_local std::vector<Vector3i> tls_viewer_block_positions;
+	tls_viewer_block_positions.clear();
+
+	const int data_block_size = get_data_block_size();
+	for (const PairedViewer &viewer : _paired_viewers) {
+		tls_viewer_block_positions.push_back(math::floordiv(viewer.state.local_position_voxels, data_block_size));
+	}
+
+	_prefetch_cache.trim(to_span(tls_viewer_block_positions));
+}
+
+void VoxelTerrain::clear_prefetch_cache() {
+	// Blocks that entered the range of a viewer still need to be loaded
+	for (const Vector3i bpos : _blocks_pending_promotion) {
+		if (_loading_blocks.find(bpos) != _loading_blocks.end()) {
+			_blocks_pending_load.push_back(bpos);
+		}
+	}
+	_prefetch_cache.for_each_request([this](Vector3i bpos) {
+		if (_loading_blocks.find(bpos) != _loading_blocks.end()) {
+			_blocks_pending_load.push_back(bpos);
+		}
+	});
+	_blocks_pending_promotion.clear();
+	_prefetch_cache.clear();
+}
+
 void VoxelTerrain::consume_block_data_save_requests(
 		BufferedTaskScheduler &task_scheduler, std::shared_ptr<AsyncDependencyTracker> saving_tracker) {
 	ZN_PROFILE_SCOPE();
@@ -1008,21 +1228,26 @@ void VoxelTerrain::process_viewers() {
 		const Box3i bounds_in_data_blocks = bounds_in_voxels.downscaled(get_data_block_size());
 		const Box3i bounds_in_mesh_blocks = bounds_in_voxels.downscaled(get_mesh_block_size());
 
+		const float delta_time = get_process_delta_time();
+
 		struct UpdatePairedViewer {
 			VoxelTerrain &self;
 			const Box3i bounds_in_data_blocks;
 			const Box3i bounds_in_mesh_blocks;
 			const Transform3D world_to_local_transform;
 			const float view_distance_scale;
+			const float delta_time;
 
 			inline void operator()(ViewerID viewer_id, const VoxelEngine::Viewer &viewer) {
 				size_t paired_viewer_index;
+				bool new_viewer = false;
 				if (!self.try_get_paired_viewer_index(viewer_id, paired_viewer_index)) {
 					// New viewer
 					PairedViewer p;
 					p.id = viewer_id;
 					paired_viewer_index = self._paired_viewers.size();
 					self._paired_viewers.push_back(p);
+					new_viewer = true;
 					ZN_PRINT_VERBOSE(format("Pairing viewer {} to VoxelTerrain", viewer_id));
 				}
 
@@ -1034,7 +1259,17 @@ void VoxelTerrain::process_viewers() {
 						static_cast<unsigned int>(static_cast<float>(viewer.view_distance) * view_distance_scale);
 				const Vector3 local_position = world_to_local_transform.xform(viewer.world_position);
 
+				if (new_viewer || delta_time <= 0.f) {
+					state.local_velocity = Vector3();
+				} else {
+					const Vector3 instant_velocity = (local_position - state.local_position) / delta_time;
+					// Smoothed so jittery motion doesn't make prefetching erratic
+					const float t = 1.f - Math::exp(-delta_time / constants::VIEWER_VELOCITY_SMOOTHING_TIME);
+					state.local_velocity = state.local_velocity.lerp(instant_velocity, t);
+				}
+
 				state.view_distance_voxels = math::min(view_distance_voxels, self._max_view_distance_voxels);
+				state.local_position = local_position;
 				state.local_position_voxels = math::floor_to_int(local_position);
 				state.requires_collisions = VoxelEngine::get_singleton().is_viewer_requiring_collisions(viewer_id);
 				state.requires_meshes =
@@ -1071,12 +1306,15 @@ void VoxelTerrain::process_viewers() {
 				state.data_box =
 						Box3i::from_center_extents(data_block_pos, Vector3iUtil::create(view_distance_data_blocks))
 								.clipped(bounds_in_data_blocks);
+
+				state.prefetch_box = VoxelTerrainPrefetchCache::get_prefetch_box(state.data_box, state.local_velocity,
+						self._prefetch_time, state.view_distance_voxels, data_block_size, bounds_in_data_blocks);
 			}
 		};
 
 		// New viewers and updates. Removed viewers won't be iterated but are still paired until later.
 		UpdatePairedViewer u{ *this, bounds_in_data_blocks, bounds_in_mesh_blocks, world_to_local_transform,
-			view_distance_scale };
+			view_distance_scale, delta_time };
 		VoxelEngine::get_singleton().for_each_viewer(u);
 	}
 
@@ -1178,10 +1416,21 @@ void VoxelTerrain::process_viewers() {
 
 	// It's possible the user didn't set a stream yet, or it is turned off
 	if (can_load_blocks) {
+		// Blocks that entered the range of viewers and were already prefetched
+		for (const Vector3i bpos : _blocks_pending_promotion) {
+			apply_prefetched_block(bpos);
+		}
+		_blocks_pending_promotion.clear();
+
 		send_data_load_requests();
 		BufferedTaskScheduler &task_scheduler = BufferedTaskScheduler::get_for_current_thread();
 		consume_block_data_save_requests(task_scheduler, nullptr);
 		task_scheduler.flush();
+
+		// After saves, so blocks that were just unloaded are not read back before being written
+		if (_prefetch_time > 0.f && get_stream().is_valid()) {
+			send_prefetch_requests();
+		}
 	}
 
 	_stats.time_request_blocks_to_load = profiling_clock.restart();
@@ -1279,9 +1528,11 @@ void VoxelTerrain::process_viewer_data_box_change(
 					new_loading_block.viewers_to_notify.push_back(viewer_id);
 				}
 
-				// Schedule a loading request
+				// Schedule a loading request, unless it was prefetched
 				_loading_blocks.insert({ missing_bpos, new_loading_block });
-				_blocks_pending_load.push_back(missing_bpos);
+				if (!try_promote_prefetched_block(missing_bpos)) {
+					_blocks_pending_load.push_back(missing_bpos);
+				}
 
 			} else {
 				// More viewers
@@ -1324,6 +1575,11 @@ void VoxelTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob) {
 		return;
 	}
 
+	if (ob.type == VoxelEngine::BlockDataOutput::TYPE_PREFETCHED) {
+		apply_prefetched_block_response(ob);
+		return;
+	}
+
 	CRASH_COND(ob.type != VoxelEngine::BlockDataOutput::TYPE_LOADED &&
 			ob.type != VoxelEngine::BlockDataOutput::TYPE_GENERATED);
 
@@ -1436,6 +1692,7 @@ bool VoxelTerrain::try_set_block_data(Vector3i position, std::shared_ptr<VoxelBu
 
 	// Cancel loading version if any
 	_loading_blocks.erase(position);
+	_prefetch_cache.erase(position);
 
 	VoxelDataBlock block(voxel_data, 0);
 	// TODO How to set the `edited` flag? Does it matter in use cases for this function?
@@ -1818,6 +2075,13 @@ void VoxelTerrain::_bind_methods() {
 			D_METHOD("set_automatic_loading_enabled", "enable"), &VoxelTerrain::set_automatic_loading_enabled);
 	ClassDB::bind_method(D_METHOD("is_automatic_loading_enabled"), &VoxelTerrain::is_automatic_loading_enabled);
 
+	ClassDB::bind_method(D_METHOD("set_prefetch_time", "seconds"), &VoxelTerrain::set_prefetch_time);
+	ClassDB::bind_method(D_METHOD("get_prefetch_time"), &VoxelTerrain::get_prefetch_time);
+
+	ClassDB::bind_method(
+			D_METHOD("set_prefetch_cache_max_blocks", "count"), &VoxelTerrain::set_prefetch_cache_max_blocks);
+	ClassDB::bind_method(D_METHOD("get_prefetch_cache_max_blocks"), &VoxelTerrain::get_prefetch_cache_max_blocks);
+
 	// TODO Rename `_voxel_bounds`
 	ClassDB::bind_method(D_METHOD("set_bounds"), &VoxelTerrain::_b_set_bounds);
 	ClassDB::bind_method(D_METHOD("get_bounds"), &VoxelTerrain::_b_get_bounds);
@@ -1868,6 +2132,13 @@ void VoxelTerrain::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "automatic_loading_enabled"), "set_automatic_loading_enabled",
 			"is_automatic_loading_enabled");
 
+	ADD_GROUP("Prefetch", "prefetch_");
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "prefetch_time", PROPERTY_HINT_RANGE, "0.0,10.0,0.1,or_greater"),
+			"set_prefetch_time", "get_prefetch_time");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "prefetch_cache_max_blocks", PROPERTY_HINT_RANGE, "0,8192,1,or_greater"),
+			"set_prefetch_cache_max_blocks", "get_prefetch_cache_max_blocks");
+
 	ADD_GROUP("Advanced", "");
 
 	// TODO Should probably be in the parent class?
@@ -9,9 +9,12 @@
 #include "../voxel_data_block_enter_info.h"
 #include "../voxel_mesh_map.h"
 #include "../voxel_node.h"
+#include "../voxel_terrain_prefetch_cache.h"
 #include "voxel_mesh_block_vt.h"
 #include "voxel_terrain_multiplayer_synchronizer.h"
 
+#include <unordered_set>
+
 namespace zylann {
 
 class AsyncDependencyTracker;
@@ -30,6 +33,8 @@ class VoxelTerrain : public VoxelNode {
 	GDCLASS(VoxelTerrain, VoxelNode)
 public:
 	static const unsigned int MAX_VIEW_DISTANCE_FOR_LARGE_VOLUME = 512;
+	static constexpr float DEFAULT_PREFETCH_TIME = 1.f;
+	static const int DEFAULT_PREFETCH_CACHE_MAX_BLOCKS = 512;
 
 	VoxelTerrain();
 	~VoxelTerrain();
@@ -84,6 +89,15 @@ public:
 	void set_automatic_loading_enabled(bool enable);
 	bool is_automatic_loading_enabled() const;
 
+	// Blocks ahead of moving viewers are loaded from the stream before they enter their range, so fast viewers don't
+	// outrun loading. This is how far in time viewer motion is extrapolated, in seconds. 0 turns it off.
+	void set_prefetch_time(float seconds);
+	float get_prefetch_time() const;
+
+	// Maximum number of blocks that can be prefetched or being prefetched while not in range of any viewer.
+	void set_prefetch_cache_max_blocks(int count);
+	int get_prefetch_cache_max_blocks() const;
+
 	void set_material_override(Ref<Material> material);
 	Ref<Material> get_material_override() const;
 
@@ -170,6 +184,13 @@ private:
 	void process_meshing();
 	void apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob);
 	void apply_data_block_response(VoxelEngine::BlockDataOutput &ob);
+	void apply_prefetched_block_response(VoxelEngine::BlockDataOutput &ob);
+	void send_prefetch_requests();
+	bool try_promote_prefetched_block(Vector3i bpos);
+	void apply_prefetched_block(Vector3i bpos);
+	void generate_prefetched_block(Vector3i bpos);
+	void trim_prefetch_cache();
+	void clear_prefetch_cache();
 
 	void _on_stream_params_changed();
 	// void _set_block_size_po2(int p_block_size_po2);
@@ -236,9 +257,14 @@ private:
 	// Paired viewers are VoxelViewers which intersect with the boundaries of the volume
 	struct PairedViewer {
 		struct State {
+			Vector3 local_position;
 			Vector3i local_position_voxels;
+			// Smoothed, in voxels per second
+			Vector3 local_velocity;
 			Box3i data_box; // In block coordinates
 			Box3i mesh_box;
+			// Where the data box is expected to be after the prefetch time
+			Box3i prefetch_box;
 			int view_distance_voxels = 0;
 			bool requires_collisions = false;
 			bool requires_meshes = false;
@@ -280,6 +306,13 @@ private:
 	// The order in that list does not matter.
 	std::vector<VoxelData::BlockToSave> _blocks_to_save;
 
+	// Blocks loaded or being loaded ahead of viewers, waiting to enter their range. If blocks being loaded enter a
+	// viewer's range in the meantime, they are also in `_loading_blocks` and will be applied directly when they arrive.
+	VoxelTerrainPrefetchCache _prefetch_cache;
+	// Blocks that entered a viewer's range and were found in the prefetch cache, to apply on the next process call.
+	std::vector<Vector3i> _blocks_pending_promotion;
+	float _prefetch_time = DEFAULT_PREFETCH_TIME;
+
 	Ref<VoxelMesher> _mesher;
 
 	// Data stored with a shared pointer so it can be sent to asynchronous tasks, and these tasks can be cancelled by
@@ -112,6 +112,8 @@ VoxelLodTerrain::VoxelLodTerrain() {
 	_data = make_shared_instance<VoxelData>();
 	_update_data = make_shared_instance<VoxelLodTerrainUpdateData>();
 	_update_data->task_is_complete = true;
+	_update_data->settings.prefetch_time = DEFAULT_PREFETCH_TIME;
+	_update_data->state.prefetch_cache.set_max_blocks(DEFAULT_PREFETCH_CACHE_MAX_BLOCKS);
 	_streaming_dependency = make_shared_instance<StreamingDependency>();
 	_meshing_dependency = make_shared_instance<MeshingDependency>();
 
@@ -646,6 +648,10 @@ void VoxelLodTerrain::start_streamer() {
 void VoxelLodTerrain::stop_streamer() {
 	_update_data->wait_for_end_of_task();
 
+	clear_prefetch_cache();
+	_has_prev_viewer_pos = false;
+	_viewer_velocity = Vector3();
+
 	for (unsigned int i = 0; i < _update_data->state.lods.size(); ++i) {
 		VoxelLodTerrainUpdateData::Lod &lod = _update_data->state.lods[i];
 		lod.loading_blocks.clear();
@@ -721,6 +727,7 @@ void VoxelLodTerrain::reset_maps() {
 	_update_data->wait_for_end_of_task();
 
 	_data->reset_maps();
+	clear_prefetch_cache();
 
 	abort_async_edits();
 
@@ -1026,6 +1033,8 @@ void VoxelLodTerrain::process(float delta) {
 	_stats.dropped_block_loads = 0;
 	_stats.dropped_block_meshs = 0;
 
+	_time_since_prev_viewer_pos += delta;
+
 	if (get_lod_count() == 0) {
 		// If there isn't a LOD 0, there is nothing to load
 		return;
@@ -1069,11 +1078,12 @@ void VoxelLodTerrain::process(float delta) {
 
 		// Get viewer location in voxel space
 		const Vector3 viewer_pos = get_local_viewer_pos();
+		update_viewer_velocity(viewer_pos);
 
 		// TODO Optimization: pool tasks instead of allocating?
 		VoxelLodTerrainUpdateTask *task = memnew(VoxelLodTerrainUpdateTask(_data, _update_data, _streaming_dependency,
 				_meshing_dependency, VoxelEngine::get_singleton().get_shared_viewers_data_from_default_world(),
-				viewer_pos, _instancer != nullptr, _volume_id, get_global_transform()));
+				viewer_pos, _viewer_velocity, _instancer != nullptr, _volume_id, get_global_transform()));
 
 		_update_data->task_is_complete = false;
 
@@ -1093,6 +1103,22 @@ void VoxelLodTerrain::process(float delta) {
 	process_fading_blocks(delta);
 }
 
+void VoxelLodTerrain::update_viewer_velocity(Vector3 viewer_pos) {
+	// Sampled when update tasks are created, which doesn't necessarily happen every frame
+	const float delta_time = _time_since_prev_viewer_pos;
+
+	if (_has_prev_viewer_pos && delta_time > 0.f) {
+		const Vector3 instant_velocity = (viewer_pos - _prev_viewer_pos) / delta_time;
+		// Smoothed so jittery motion doesn't make prefetching erratic
+		const float t = 1.f - Math::exp(-delta_time / constants::VIEWER_VELOCITY_SMOOTHING_TIME);
+		_viewer_velocity = _viewer_velocity.lerp(instant_velocity, t);
+	}
+
+	_prev_viewer_pos = viewer_pos;
+	_time_since_prev_viewer_pos = 0.f;
+	_has_prev_viewer_pos = true;
+}
+
 void VoxelLodTerrain::apply_main_thread_update_tasks() {
 	ZN_PROFILE_SCOPE();
 	// Dequeue outputs of the threadable part of the update for actions taking place on the main thread
@@ -1266,6 +1292,17 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 		return false;
 	});
 
+	apply_prefetched_blocks();
+
+	{
+		MutexLock mlock(state.prefetch_mutex);
+		const VoxelTerrainPrefetchCache::Stats &prefetch_stats = state.prefetch_cache.get_stats();
+		_stats.prefetch_requests = prefetch_stats.requests;
+		_stats.prefetch_hits = prefetch_stats.hits;
+		_stats.prefetch_evictions = prefetch_stats.evictions;
+		_stats.prefetched_blocks = state.prefetch_cache.get_cached_count();
+	}
+
 	_stats.blocked_lods = state.stats.blocked_lods;
 	_stats.time_detect_required_blocks = state.stats.time_detect_required_blocks;
 	_stats.time_io_requests = state.stats.time_io_requests;
@@ -1292,6 +1329,11 @@ void VoxelLodTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob
 		return;
 	}
 
+	if (ob.type == VoxelEngine::BlockDataOutput::TYPE_PREFETCHED) {
+		apply_prefetched_block_response(ob);
+		return;
+	}
+
 	if (ob.lod >= get_lod_count()) {
 		// That block was requested at a time where LOD was higher... drop it
 		++_stats.dropped_block_loads;
@@ -1352,6 +1394,112 @@ void VoxelLodTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob
 	}
 }
 
+void VoxelLodTerrain::apply_prefetched_block_response(VoxelEngine::BlockDataOutput &ob) {
+	VoxelLodTerrainUpdateData::State &state = _update_data->state;
+	VoxelLodTerrainUpdateData::Lod &lod0 = state.lods[0];
+	const Vector3i block_pos = ob.position;
+
+	{
+		MutexLock mlock(state.prefetch_mutex);
+
+		if (!state.prefetch_cache.complete_request(block_pos)) {
+			// The prefetch cache was cleared since the request was made
+			return;
+		}
+
+		if (!thread_safe_contains(lod0.loading_blocks, block_pos, lod0.loading_blocks_mutex)) {
+			// Not needed yet, keep it for when the viewer gets there.
+			// If it was dropped, the viewer went away. If it is already loaded, it was set by other means.
+			if (!ob.dropped && !_data->has_block(block_pos, 0)) {
+				VoxelTerrainPrefetchCache::Block prefetched_block;
+				prefetched_block.voxels = std::move(ob.voxels);
+				prefetched_block.instances = std::move(ob.instances);
+				state.prefetch_cache.store(
+						block_pos, std::move(prefetched_block), Span<const Box3i>(&state.prefetch_box, 1));
+			}
+			return;
+		}
+	}
+
+	// The block entered the range of the viewer while it was being prefetched
+	if (ob.dropped) {
+		++_stats.dropped_block_loads;
+		// Removing it from loading blocks makes the update task request it again
+		MutexLock mlock(lod0.loading_blocks_mutex);
+		lod0.loading_blocks.erase(block_pos);
+		return;
+	}
+
+	ob.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+	apply_data_block_response(ob);
+}
+
+// Applies blocks that entered the range of the viewer and were found in the prefetch cache.
+void VoxelLodTerrain::apply_prefetched_blocks() {
+	VoxelLodTerrainUpdateData::State &state = _update_data->state;
+	if (state.blocks_pending_promotion.size() == 0) {
+		return;
+	}
+	ZN_PROFILE_SCOPE();
+
+	VoxelLodTerrainUpdateData::Lod &lod0 = state.lods[0];
+
+	for (const Vector3i bpos : state.blocks_pending_promotion) {
+		if (!thread_safe_contains(lod0.loading_blocks, bpos, lod0.loading_blocks_mutex)) {
+			// Went out of range before being applied, keep it prefetched
+			continue;
+		}
+
+		VoxelTerrainPrefetchCache::Block prefetched_block;
+		bool found;
+		{
+			MutexLock mlock(state.prefetch_mutex);
+			found = state.prefetch_cache.take(bpos, prefetched_block);
+		}
+		if (!found) {
+			// Evicted in the meantime. Removing it from loading blocks makes the update task request it again.
+			MutexLock mlock(lod0.loading_blocks_mutex);
+			lod0.loading_blocks.erase(bpos);
+			continue;
+		}
+
+		VoxelEngine::BlockDataOutput ob;
+		ob.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+		ob.voxels = std::move(prefetched_block.voxels);
+		ob.instances = std::move(prefetched_block.instances);
+		ob.position = bpos;
+		ob.lod = 0;
+		ob.dropped = false;
+		ob.max_lod_hint = false;
+		ob.initial_load = false;
+		apply_data_block_response(ob);
+	}
+
+	state.blocks_pending_promotion.clear();
+}
+
+// Must not be called while the update task runs.
+void VoxelLodTerrain::clear_prefetch_cache() {
+	VoxelLodTerrainUpdateData::State &state = _update_data->state;
+	VoxelLodTerrainUpdateData::Lod &lod0 = state.lods[0];
+
+	{
+		MutexLock mlock(state.prefetch_mutex);
+		MutexLock loading_lock(lod0.loading_blocks_mutex);
+
+		// Blocks that entered the range of the viewer still need to be loaded. Removing them from loading blocks makes
+		// the update task request them again.
+		for (const Vector3i bpos : state.blocks_pending_promotion) {
+			lod0.loading_blocks.erase(bpos);
+		}
+		state.prefetch_cache.for_each_request([&lod0](Vector3i bpos) { lod0.loading_blocks.erase(bpos); });
+
+		state.blocks_pending_promotion.clear();
+		state.prefetch_cache.clear();
+		state.prefetch_box = Box3i();
+	}
+}
+
 void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 	// The following is done on the main thread because Godot doesn't really support everything done here.
 	// Building meshes can be done in the threaded task when using Vulkan, but not OpenGL.
@@ -1984,6 +2132,10 @@ Dictionary VoxelLodTerrain::_b_get_statistics() const {
 	d["time_mesh_requests"] = _stats.time_mesh_requests;
 	d["time_update_task"] = _stats.time_update_task;
 	d["blocked_lods"] = _stats.blocked_lods;
+	d["prefetch_requests"] = _stats.prefetch_requests;
+	d["prefetch_hits"] = _stats.prefetch_hits;
+	d["prefetch_evictions"] = _stats.prefetch_evictions;
+	d["prefetched_blocks"] = _stats.prefetched_blocks;
 
 	// Process
 	d["dropped_block_loads"] = _stats.dropped_block_loads;
@@ -2064,6 +2216,28 @@ float VoxelLodTerrain::get_lod_fade_duration() const {
 	return _lod_fade_duration;
 }
 
+void VoxelLodTerrain::set_prefetch_time(float seconds) {
+	_update_data->wait_for_end_of_task();
+	_update_data->settings.prefetch_time = math::max(seconds, 0.f);
+	if (_update_data->settings.prefetch_time == 0.f) {
+		clear_prefetch_cache();
+	}
+}
+
+float VoxelLodTerrain::get_prefetch_time() const {
+	return _update_data->settings.prefetch_time;
+}
+
+void VoxelLodTerrain::set_prefetch_cache_max_blocks(int count) {
+	_update_data->wait_for_end_of_task();
+	// Excess blocks are evicted in the next update
+	_update_data->state.prefetch_cache.set_max_blocks(math::max(count, 0));
+}
+
+int VoxelLodTerrain::get_prefetch_cache_max_blocks() const {
+	return _update_data->state.prefetch_cache.get_max_blocks();
+}
+
 void VoxelLodTerrain::set_normalmap_enabled(bool enable) {
 	_update_data->settings.detail_texture_settings.enabled = enable;
 }
@@ -2780,6 +2954,13 @@ void VoxelLodTerrain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_lod_fade_duration"), &VoxelLodTerrain::get_lod_fade_duration);
 	ClassDB::bind_method(D_METHOD("set_lod_fade_duration", "seconds"), &VoxelLodTerrain::set_lod_fade_duration);
 
+	ClassDB::bind_method(D_METHOD("set_prefetch_time", "seconds"), &VoxelLodTerrain::set_prefetch_time);
+	ClassDB::bind_method(D_METHOD("get_prefetch_time"), &VoxelLodTerrain::get_prefetch_time);
+
+	ClassDB::bind_method(
+			D_METHOD("set_prefetch_cache_max_blocks", "count"), &VoxelLodTerrain::set_prefetch_cache_max_blocks);
+	ClassDB::bind_method(D_METHOD("get_prefetch_cache_max_blocks"), &VoxelLodTerrain::get_prefetch_cache_max_blocks);
+
 	ClassDB::bind_method(D_METHOD("set_lod_count", "lod_count"), &VoxelLodTerrain::set_lod_count);
 	ClassDB::bind_method(D_METHOD("get_lod_count"), &VoxelLodTerrain::get_lod_count);
 
@@ -2941,6 +3122,13 @@ void VoxelLodTerrain::_bind_methods() {
 			"get_collision_update_delay");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "collision_margin"), "set_collision_margin", "get_collision_margin");
 
+	ADD_GROUP("Prefetch", "prefetch_");
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "prefetch_time", PROPERTY_HINT_RANGE, "0.0,10.0,0.1,or_greater"),
+			"set_prefetch_time", "get_prefetch_time");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "prefetch_cache_max_blocks", PROPERTY_HINT_RANGE, "0,8192,1,or_greater"),
+			"set_prefetch_cache_max_blocks", "get_prefetch_cache_max_blocks");
+
 	ADD_GROUP("Advanced", "");
 
 	// TODO Probably should be in parent class?
@@ -36,6 +36,9 @@ public:
 class VoxelLodTerrain : public VoxelNode {
 	GDCLASS(VoxelLodTerrain, VoxelNode)
 public:
+	static constexpr float DEFAULT_PREFETCH_TIME = 1.f;
+	static const int DEFAULT_PREFETCH_CACHE_MAX_BLOCKS = 512;
+
 	VoxelLodTerrain();
 	~VoxelLodTerrain();
 
@@ -144,6 +147,15 @@ public:
 	void set_lod_fade_duration(float seconds);
 	float get_lod_fade_duration() const;
 
+	// LOD0 blocks ahead of the moving viewer are loaded from the stream before they enter its range, so fast viewers
+	// don't outrun loading. This is how far in time viewer motion is extrapolated, in seconds. 0 turns it off.
+	void set_prefetch_time(float seconds);
+	float get_prefetch_time() const;
+
+	// Maximum number of blocks that can be prefetched or being prefetched while not in range of the viewer.
+	void set_prefetch_cache_max_blocks(int count);
+	int get_prefetch_cache_max_blocks() const;
+
 	enum ProcessCallback { //
 		PROCESS_CALLBACK_IDLE = 0,
 		PROCESS_CALLBACK_PHYSICS,
@@ -178,6 +190,12 @@ public:
 		// Total time spent in the last update task, in microseconds.
 		// This only includes the threadable part, not the whole `process` function.
 		uint32_t time_update_task = 0;
+		// Prefetching of LOD0 blocks, accumulated since the stream started
+		uint32_t prefetch_requests = 0;
+		uint32_t prefetch_hits = 0;
+		uint32_t prefetch_evictions = 0;
+		// How many blocks are currently in the prefetch cache
+		uint32_t prefetched_blocks = 0;
 	};
 
 	const Stats &get_stats() const;
@@ -255,6 +273,9 @@ private:
 
 	void apply_mesh_update(VoxelEngine::BlockMeshOutput &ob);
 	void apply_data_block_response(VoxelEngine::BlockDataOutput &ob);
+	void apply_prefetched_block_response(VoxelEngine::BlockDataOutput &ob);
+	void apply_prefetched_blocks();
+	void clear_prefetch_cache();
 	void apply_detail_texture_update(VoxelEngine::BlockDetailTextureOutput &ob);
 	void apply_detail_texture_update_to_block(
 			VoxelMeshBlockVLT &block, DetailTextureOutput &ob, unsigned int lod_index);
@@ -268,6 +289,7 @@ private:
 	void reset_mesh_maps();
 
 	Vector3 get_local_viewer_pos() const;
+	void update_viewer_velocity(Vector3 viewer_pos);
 	void _set_lod_count(int p_lod_count);
 	void set_mesh_block_active(VoxelMeshBlockVLT &block, bool active, bool with_fading);
 
@@ -349,6 +371,12 @@ private:
 	FixedArray<std::vector<Vector3i>, constants::MAX_LOD> _deferred_collision_updates_per_lod;
 
 	float _lod_fade_duration = 0.f;
+
+	// Used to extrapolate where the viewer goes, for prefetching
+	Vector3 _viewer_velocity;
+	Vector3 _prev_viewer_pos;
+	float _time_since_prev_viewer_pos = 0.f;
+	bool _has_prev_viewer_pos = false;
 	// Note, direct pointers to mesh blocks should be safe because these blocks are always destroyed from the same
 	// thread that updates fading blocks. If a mesh block is destroyed, these maps should be updated at the same time.
 	// TODO Optimization: use FlatMap? Need to check how many blocks get in there, probably not many
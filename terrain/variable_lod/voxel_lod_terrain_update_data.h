@@ -8,6 +8,7 @@
 #include "../../streams/voxel_stream.h"
 #include "../../util/fixed_array.h"
 #include "../voxel_mesh_map.h"
+#include "../voxel_terrain_prefetch_cache.h"
 #include "lod_octree.h"
 
 #include <map>
@@ -59,6 +60,8 @@ struct VoxelLodTerrainUpdateData {
 		// If false, everything will generate non-edited voxels on the fly instead.
 		// Not really exposed for now, will wait for it to be really needed. It might never be.
 		bool cache_generated_blocks = false;
+		// How far ahead of the viewer LOD0 blocks are loaded, in seconds of its current velocity. 0 disables it.
+		float prefetch_time = 0.f;
 		bool collision_enabled = true;
 		bool virtual_textures_use_gpu = false;
 		uint8_t virtual_texture_generator_override_begin_lod_index = 0;
@@ -184,6 +187,16 @@ struct VoxelLodTerrainUpdateData {
 		std::vector<Box3i> changed_generated_areas;
 		BinaryMutex changed_generated_areas_mutex;
 
+		// LOD0 blocks loaded ahead of the viewer. Also accessed by the main thread when prefetch responses arrive.
+		// If `loading_blocks_mutex` also has to be locked, lock this one first.
+		VoxelTerrainPrefetchCache prefetch_cache;
+		// Where the LOD0 data box is expected to be after the prefetch time
+		Box3i prefetch_box;
+		BinaryMutex prefetch_mutex;
+		// Blocks that entered the range of the viewer and were found in the prefetch cache, to apply on the main
+		// thread.
+		std::vector<Vector3i> blocks_pending_promotion;
+
 		Stats stats;
 	};
 
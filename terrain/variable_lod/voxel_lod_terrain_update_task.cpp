@@ -115,6 +115,9 @@ static void process_unload_data_blocks_sliding_box(VoxelLodTerrainUpdateData::St
 			for (const Box3i bbox : tls_to_remove) {
 				data.unload_blocks(bbox, lod_index, &blocks_to_save);
 			}
+
+			// Most accesses happen around the viewer
+			data.set_block_window(lod_index, new_box);
 		}
 
 		{
@@ -918,6 +921,106 @@ static void send_block_data_requests(VolumeID volume_id,
 	}
 }
 
+static void request_block_prefetch(VolumeID volume_id, unsigned int data_block_size,
+		std::shared_ptr<StreamingDependency> &stream_dependency, Vector3i block_pos, bool request_instances,
+		std::shared_ptr<PriorityDependency::ViewersData> &shared_viewers_data, const Transform3D &volume_transform,
+		float lod_distance, BufferedTaskScheduler &task_scheduler) {
+	//
+	CRASH_COND(data_block_size > 255);
+	CRASH_COND(stream_dependency == nullptr);
+	ERR_FAIL_COND(stream_dependency->stream.is_null());
+
+	PriorityDependency priority_dependency;
+	init_sparse_octree_priority_dependency(priority_dependency, block_pos, 0, data_block_size, shared_viewers_data,
+			volume_transform, lod_distance);
+	// Prefetched blocks can be up to one LOD0 region ahead of the viewer, so they are only cancelled when about twice
+	// as far as regular blocks
+	priority_dependency.drop_distance_squared *= 4.f;
+
+	// Blocks not found are left empty, like regular loads do when generated blocks are not cached
+	LoadBlockDataTask *task = memnew(LoadBlockDataTask(volume_id, block_pos, 0, data_block_size, request_instances,
+			stream_dependency, priority_dependency, false));
+	task->set_prefetch(true);
+
+	task_scheduler.push_io_task(task);
+}
+
+// Removes LOD0 blocks that were prefetched or are being prefetched from the blocks to load.
+static void promote_prefetched_blocks(VoxelLodTerrainUpdateData::State &state,
+		std::vector<VoxelLodTerrainUpdateData::BlockLocation> &blocks_to_load) {
+	ZN_PROFILE_SCOPE();
+
+	MutexLock mlock(state.prefetch_mutex);
+
+	unordered_remove_if(blocks_to_load, [&state](const VoxelLodTerrainUpdateData::BlockLocation &loc) {
+		if (loc.lod != 0) {
+			return false;
+		}
+		switch (state.prefetch_cache.promote(loc.position)) {
+			case VoxelTerrainPrefetchCache::PROMOTE_CACHED:
+				state.blocks_pending_promotion.push_back(loc.position);
+				return true;
+			case VoxelTerrainPrefetchCache::PROMOTE_IN_FLIGHT:
+				// Will be applied when the prefetch request completes
+				return true;
+			default:
+				return false;
+		}
+	});
+}
+
+// Loads LOD0 blocks where the data box of the viewer is expected to be after the prefetch time, so they are ready
+// when the viewer gets there.
+static void send_prefetch_requests(VoxelLodTerrainUpdateData::State &state, const VoxelData &data,
+		Vector3 viewer_pos, Vector3 viewer_velocity, VolumeID volume_id,
+		std::shared_ptr<StreamingDependency> &stream_dependency,
+		std::shared_ptr<PriorityDependency::ViewersData> &shared_viewers_data, bool request_instances,
+		const Transform3D &volume_transform, const VoxelLodTerrainUpdateData::Settings &settings,
+		BufferedTaskScheduler &task_scheduler) {
+	ZN_PROFILE_SCOPE();
+
+	const int data_block_size = data.get_block_size();
+	const int data_block_size_po2 = data.get_block_size_po2();
+	const int data_block_region_extent =
+			VoxelEngine::get_octree_lod_block_region_extent(settings.lod_distance, data_block_size);
+	const Box3i bounds_in_voxels = data.get_bounds();
+
+	const Box3i bounds_in_blocks = Box3i( //
+			bounds_in_voxels.pos >> data_block_size_po2, //
+			bounds_in_voxels.size >> data_block_size_po2);
+
+	const Vector3i viewer_block_pos =
+			VoxelDataMap::voxel_to_block_b(math::floor_to_int(viewer_pos), data_block_size_po2);
+	const Box3i data_box =
+			Box3i::from_center_extents(viewer_block_pos, Vector3iUtil::create(data_block_region_extent));
+	const Box3i prefetch_box = VoxelTerrainPrefetchCache::get_prefetch_box(data_box, viewer_velocity,
+			settings.prefetch_time, data_block_region_extent * data_block_size, data_block_size, bounds_in_blocks);
+
+	MutexLock mlock(state.prefetch_mutex);
+
+	state.prefetch_cache.trim(Span<const Vector3i>(&viewer_block_pos, 1));
+
+	if (prefetch_box == state.prefetch_box) {
+		// Requests were already made for this area
+		return;
+	}
+	state.prefetch_box = prefetch_box;
+
+	VoxelLodTerrainUpdateData::Lod &lod0 = state.lods[0];
+	MutexLock loading_lock(lod0.loading_blocks_mutex);
+
+	prefetch_box.difference(data_box, [&](Box3i box_to_prefetch) {
+		box_to_prefetch.for_each_cell([&](Vector3i bpos) {
+			if (!state.prefetch_cache.can_request(bpos) || lod0.has_loading_block(bpos) || data.has_block(bpos, 0)) {
+				return;
+			}
+			request_block_prefetch(volume_id, data_block_size, stream_dependency, bpos, request_instances,
+					shared_viewers_data, volume_transform, settings.lod_distance, task_scheduler);
+			state.prefetch_cache.add_request(bpos);
+		});
+	});
+}
+
 static void apply_block_data_requests_as_empty(Span<const VoxelLodTerrainUpdateData::BlockLocation> blocks_to_load,
 		VoxelData &data, VoxelLodTerrainUpdateData::State &state) {
 	for (unsigned int i = 0; i < blocks_to_load.size(); ++i) {
@@ -1300,6 +1403,10 @@ void VoxelLodTerrainUpdateTask::run(ThreadedTaskContext ctx) {
 		// It's possible the user didn't set a stream yet, or it is turned off
 		if (stream_enabled) {
 			const unsigned int data_block_size = data.get_block_size();
+			// Blocks missing from the stream are not generated when prefetched, so caching generated blocks is not
+			// supported
+			const bool prefetch_enabled = settings.prefetch_time > 0.f && stream.is_valid() &&
+					!settings.cache_generated_blocks && data.is_streaming_enabled();
 
 			if (stream.is_null() && !settings.cache_generated_blocks) {
 				// TODO Optimization: not ideal because a bit delayed. It requires a second update cycle for meshes to
@@ -1308,6 +1415,10 @@ void VoxelLodTerrainUpdateTask::run(ThreadedTaskContext ctx) {
 				apply_block_data_requests_as_empty(to_span(data_blocks_to_load), data, state);
 
 			} else {
+				if (prefetch_enabled) {
+					promote_prefetched_blocks(state, data_blocks_to_load);
+				}
+
 				send_block_data_requests(_volume_id, to_span(data_blocks_to_load), _streaming_dependency, _data,
 						_shared_viewers_data, data_block_size, _request_instances, _volume_transform, settings,
 						task_scheduler);
@@ -1315,6 +1426,12 @@ void VoxelLodTerrainUpdateTask::run(ThreadedTaskContext ctx) {
 
 			send_block_save_requests(
 					_volume_id, to_span(data_blocks_to_save), _streaming_dependency, data_block_size, task_scheduler);
+
+			// After other requests, since prefetching is only useful if what viewers need now is loaded first
+			if (prefetch_enabled) {
+				send_prefetch_requests(state, data, _viewer_pos, _viewer_velocity, _volume_id, _streaming_dependency,
+						_shared_viewers_data, _request_instances, _volume_transform, settings, task_scheduler);
+			}
 		}
 		data_blocks_to_load.clear();
 		data_blocks_to_save.clear();
@@ -2,9 +2,9 @@
 #define VOXEL_MESH_MAP_H
 
 #include "../engine/voxel_engine.h"
+#include "../util/block_hash_map.h"
 #include "../util/macros.h"
 
-#include <unordered_map>
 #include <vector>
 
 namespace zylann::voxel {
@@ -28,9 +28,9 @@ public:
 		if (_last_accessed_block && _last_accessed_block->position == bpos) {
 			_last_accessed_block = nullptr;
 		}
-		auto it = _blocks_map.find(bpos);
-		if (it != _blocks_map.end()) {
-			const unsigned int i = it->second.index;
+		const MapItem *item = _blocks_map.find(bpos);
+		if (item != nullptr) {
+			const unsigned int i = item->index;
 #ifdef DEBUG_ENABLED
 			CRASH_COND(i >= _blocks.size());
 #endif
@@ -38,7 +38,7 @@ public:
 			ERR_FAIL_COND(block == nullptr);
 			pre_delete(*block);
 			queue_free_mesh_block(block);
-			remove_block_internal(it, i);
+			remove_block_internal(bpos, i);
 		}
 	}
 
@@ -46,16 +46,16 @@ public:
 		if (_last_accessed_block && _last_accessed_block->position == bpos) {
 			return _last_accessed_block;
 		}
-		auto it = _blocks_map.find(bpos);
-		if (it != _blocks_map.end()) {
+		const MapItem *item = _blocks_map.find(bpos);
+		if (item != nullptr) {
 #ifdef DEBUG_ENABLED
-			const unsigned int i = it->second.index;
+			const unsigned int i = item->index;
 			CRASH_COND(i >= _blocks.size());
 			MeshBlock_T *block = _blocks[i];
 			CRASH_COND(block == nullptr); // The map should not contain null blocks
-			CRASH_COND(it->second.block == nullptr);
+			CRASH_COND(item->block == nullptr);
 #endif
-			_last_accessed_block = it->second.block;
+			_last_accessed_block = item->block;
 			return _last_accessed_block;
 		}
 		return nullptr;
@@ -65,18 +65,18 @@ public:
 		if (_last_accessed_block != nullptr && _last_accessed_block->position == bpos) {
 			return _last_accessed_block;
 		}
-		auto it = _blocks_map.find(bpos);
-		if (it != _blocks_map.end()) {
+		const MapItem *item = _blocks_map.find(bpos);
+		if (item != nullptr) {
 #ifdef DEBUG_ENABLED
-			const unsigned int i = it->second.index;
+			const unsigned int i = item->index;
 			CRASH_COND(i >= _blocks.size());
 			MeshBlock_T *block = _blocks[i];
 			CRASH_COND(block == nullptr); // The map should not contain null blocks
-			CRASH_COND(it->second.block == nullptr);
+			CRASH_COND(item->block == nullptr);
 #endif
 			// This function can't cache _last_accessed_block, because it's const, so repeated accesses are hashing
 			// again...
-			return it->second.block;
+			return item->block;
 		}
 		return nullptr;
 	}
@@ -92,12 +92,12 @@ public:
 #endif
 		unsigned int i = _blocks.size();
 		_blocks.push_back(block);
-		_blocks_map.insert({ bpos, { block, i } });
+		_blocks_map.get_or_insert(bpos) = MapItem{ block, i };
 	}
 
 	bool has_block(Vector3i pos) const {
 		//(_last_accessed_block != nullptr && _last_accessed_block->pos == pos) ||
-		return _blocks_map.find(pos) != _blocks_map.end();
+		return _blocks_map.has(pos);
 	}
 
 	void clear() {
@@ -151,13 +151,9 @@ private:
 		unsigned int index;
 	};
 
-	void remove_block_internal(typename std::unordered_map<Vector3i, MapItem>::iterator rm_it, unsigned int index) {
-		// TODO `erase` can occasionally be very slow (milliseconds) if the map contains lots of items.
-		// This might be caused by internal rehashing/resizing.
-		// We should look for a faster container, or reduce the number of entries.
-
+	void remove_block_internal(Vector3i bpos, unsigned int index) {
 		// This function assumes the block is already freed
-		_blocks_map.erase(rm_it);
+		_blocks_map.erase(bpos);
 
 		MeshBlock_T *moved_block = _blocks.back();
 #ifdef DEBUG_ENABLED
@@ -167,9 +163,9 @@ private:
 		_blocks.pop_back();
 
 		if (index < _blocks.size()) {
-			auto moved_block_index_it = _blocks_map.find(moved_block->position);
-			CRASH_COND(moved_block_index_it == _blocks_map.end());
-			moved_block_index_it->second.index = index;
+			MapItem *moved_item = _blocks_map.find(moved_block->position);
+			CRASH_COND(moved_item == nullptr);
+			moved_item->index = index;
 		}
 	}
 
@@ -190,7 +186,7 @@ private:
 
 private:
 	// Blocks stored with a spatial hash in all 3D directions.
-	std::unordered_map<Vector3i, MapItem> _blocks_map;
+	BlockHashMap<MapItem> _blocks_map;
 	// Blocks are stored in a vector to allow faster iteration over all of them.
 	// Use cases for this include updating the transform of the meshes
 	std::vector<MeshBlock_T *> _blocks;
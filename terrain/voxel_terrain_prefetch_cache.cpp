@@ -0,0 +1,118 @@
+#include "voxel_terrain_prefetch_cache.h"
+#include "../util/math/conv.h"
+#include "../util/profiling.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace zylann::voxel {
+
+bool VoxelTerrainPrefetchCache::can_request(Vector3i bpos) const {
+	return _blocks.size() + _requested_blocks.size() < _max_blocks && _blocks.find(bpos) == _blocks.end() &&
+			_requested_blocks.find(bpos) == _requested_blocks.end();
+}
+
+void VoxelTerrainPrefetchCache::add_request(Vector3i bpos) {
+	_requested_blocks.insert(bpos);
+	++_stats.requests;
+}
+
+VoxelTerrainPrefetchCache::PromoteResult VoxelTerrainPrefetchCache::promote(Vector3i bpos) {
+	if (_blocks.find(bpos) != _blocks.end()) {
+		++_stats.hits;
+		return PROMOTE_CACHED;
+	}
+	if (_requested_blocks.find(bpos) != _requested_blocks.end()) {
+		++_stats.hits;
+		return PROMOTE_IN_FLIGHT;
+	}
+	return PROMOTE_NOT_FOUND;
+}
+
+bool VoxelTerrainPrefetchCache::take(Vector3i bpos, Block &out_block) {
+	auto it = _blocks.find(bpos);
+	if (it == _blocks.end()) {
+		return false;
+	}
+	out_block = std::move(it->second);
+	_blocks.erase(it);
+	return true;
+}
+
+bool VoxelTerrainPrefetchCache::complete_request(Vector3i bpos) {
+	return _requested_blocks.erase(bpos) != 0;
+}
+
+bool VoxelTerrainPrefetchCache::store(Vector3i bpos, Block block, Span<const Box3i> prefetch_boxes) {
+	bool in_prefetch_box = false;
+	for (const Box3i &box : prefetch_boxes) {
+		if (box.contains(bpos)) {
+			in_prefetch_box = true;
+			break;
+		}
+	}
+	if (!in_prefetch_box) {
+		return false;
+	}
+	_blocks[bpos] = std::move(block);
+	return true;
+}
+
+void VoxelTerrainPrefetchCache::erase(Vector3i bpos) {
+	_blocks.erase(bpos);
+}
+
+void VoxelTerrainPrefetchCache::trim(Span<const Vector3i> viewer_block_positions) {
+	if (_blocks.size() <= _max_blocks) {
+		return;
+	}
+	ZN_PROFILE_SCOPE();
+
+	struct BlockDistance {
+		Vector3i position;
+		int64_t distance_squared;
+	};
+
+	static thread_local std::vector<BlockDistance> tls_blocks;
+	tls_blocks.clear();
+
+	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
+		const Vector3i bpos = it->first;
+		int64_t closest_distance_squared = std::numeric_limits<int64_t>::max();
+		for (const Vector3i viewer_bpos : viewer_block_positions) {
+			closest_distance_squared = math::min(closest_distance_squared, (bpos - viewer_bpos).length_squared());
+		}
+		tls_blocks.push_back(BlockDistance{ bpos, closest_distance_squared });
+	}
+
+	// Evict blocks furthest from viewers first
+	const size_t eviction_count = _blocks.size() - _max_blocks;
+	std::nth_element(tls_blocks.begin(), tls_blocks.begin() + eviction_count, tls_blocks.end(),
+			[](const BlockDistance &a, const BlockDistance &b) { return a.distance_squared > b.distance_squared; });
+
+	for (size_t i = 0; i < eviction_count; ++i) {
+		_blocks.erase(tls_blocks[i].position);
+	}
+	_stats.evictions += static_cast<int>(eviction_count);
+}
+
+void VoxelTerrainPrefetchCache::clear() {
+	_requested_blocks.clear();
+	_blocks.clear();
+}
+
+Box3i VoxelTerrainPrefetchCache::get_prefetch_box(Box3i data_box, Vector3 velocity, float prefetch_time,
+		unsigned int view_distance_voxels, int block_size, Box3i bounds_in_blocks) {
+	Vector3 lookahead = velocity * prefetch_time;
+	const float lookahead_length = lookahead.length();
+	if (lookahead_length > view_distance_voxels) {
+		lookahead *= view_distance_voxels / lookahead_length;
+	}
+	const Vector3i lookahead_blocks = to_vec3i(lookahead / block_size);
+	if (lookahead_blocks == Vector3i()) {
+		return Box3i();
+	}
+	return Box3i(data_box.pos + lookahead_blocks, data_box.size).clipped(bounds_in_blocks);
+}
+
+} // namespace zylann::voxel
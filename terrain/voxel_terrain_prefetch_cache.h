@@ -0,0 +1,111 @@
+#ifndef VOXEL_TERRAIN_PREFETCH_CACHE_H
+#define VOXEL_TERRAIN_PREFETCH_CACHE_H
+
+#include "../storage/voxel_buffer_internal.h"
+#include "../streams/instance_data.h"
+#include "../util/math/box3i.h"
+#include "../util/math/vector3.h"
+#include "../util/memory.h"
+#include "../util/span.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace zylann::voxel {
+
+// Keeps track of blocks loaded ahead of the viewers of a terrain, until they enter their range.
+// Blocks still being loaded count toward the limit, so the memory used by prefetching remains bounded.
+class VoxelTerrainPrefetchCache {
+public:
+	struct Block {
+		// Null if the block was not found in the stream
+		std::shared_ptr<VoxelBufferInternal> voxels;
+		UniquePtr<InstanceBlockData> instances;
+	};
+
+	enum PromoteResult {
+		// Not prefetched, it has to be loaded normally
+		PROMOTE_NOT_FOUND,
+		// In the cache, it can be taken
+		PROMOTE_CACHED,
+		// Still being loaded, it will be applied when it arrives
+		PROMOTE_IN_FLIGHT
+	};
+
+	struct Stats {
+		int requests = 0;
+		// Blocks that entered the range of a viewer after being prefetched
+		int hits = 0;
+		int evictions = 0;
+	};
+
+	void set_max_blocks(unsigned int count) {
+		_max_blocks = count;
+	}
+
+	unsigned int get_max_blocks() const {
+		return _max_blocks;
+	}
+
+	// Returns true if a prefetch request can be sent for the block: it was not prefetched or requested already, and
+	// the limit is not reached.
+	bool can_request(Vector3i bpos) const;
+	void add_request(Vector3i bpos);
+
+	// Called when a block enters the range of a viewer.
+	PromoteResult promote(Vector3i bpos);
+
+	// Removes a block from the cache so it can be applied. Returns false if it's not there.
+	bool take(Vector3i bpos, Block &out_block);
+
+	// Called when the response to a prefetch request arrives. Returns false if the block was not being requested,
+	// which happens when the cache was cleared since the request was made.
+	bool complete_request(Vector3i bpos);
+
+	// Stores a block after its request completed. The block is dropped if it's not in any of the given prefetch boxes,
+	// because viewers went another way while it was loading. Returns true if the block was stored.
+	bool store(Vector3i bpos, Block block, Span<const Box3i> prefetch_boxes);
+
+	void erase(Vector3i bpos);
+
+	// Evicts blocks furthest from viewers until the cache is within its limit. Requests in flight are not evicted.
+	void trim(Span<const Vector3i> viewer_block_positions);
+
+	void clear();
+
+	template <typename F>
+	void for_each_request(F f) const {
+		for (const Vector3i bpos : _requested_blocks) {
+			f(bpos);
+		}
+	}
+
+	unsigned int get_cached_count() const {
+		return _blocks.size();
+	}
+
+	unsigned int get_request_count() const {
+		return _requested_blocks.size();
+	}
+
+	const Stats &get_stats() const {
+		return _stats;
+	}
+
+	// Extrapolates where a viewer's data box will be after the prefetch time. It gets no further than the view
+	// distance, so it remains next to the current one. This also limits the effect of large velocities caused by
+	// teleports. Returns an empty box if the viewer doesn't move enough to enter other blocks.
+	static Box3i get_prefetch_box(Box3i data_box, Vector3 velocity, float prefetch_time,
+			unsigned int view_distance_voxels, int block_size, Box3i bounds_in_blocks);
+
+private:
+	std::unordered_map<Vector3i, Block> _blocks;
+	std::unordered_set<Vector3i> _requested_blocks;
+	unsigned int _max_blocks = 0;
+	Stats _stats;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_TERRAIN_PREFETCH_CACHE_H
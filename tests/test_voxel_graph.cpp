@@ -1,8 +1,11 @@
 #include "test_voxel_graph.h"
+#include "../generators/graph/node_kernels.h"
 #include "../generators/graph/node_type_db.h"
 #include "../generators/graph/voxel_generator_graph.h"
+#include "../generators/graph/voxel_graph_column_cache.h"
 #include "../storage/voxel_buffer_internal.h"
 #include "../util/container_funcs.h"
+#include "../util/godot/classes/time.h"
 #include "../util/math/conv.h"
 #include "../util/math/sdf.h"
 #include "../util/noise/fast_noise_lite/fast_noise_lite.h"
@@ -17,6 +20,10 @@
 #include <core/io/resource_loader.h>
 #include <modules/noise/fastnoise_lite.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace zylann::voxel::tests {
 
 using namespace pg;
@@ -1779,4 +1786,570 @@ void test_voxel_graph_unused_inner_output() {
 	ZN_TEST_ASSERT(result_ndebug.success);
 }
 
+namespace {
+
+struct NodeKernelInputs {
+	std::vector<float> a;
+	std::vector<float> b;
+	std::vector<float> c;
+	std::vector<float> d;
+	std::vector<float> e;
+	std::vector<float> f;
+	uint32_t count = 0;
+
+	void create(uint32_t p_count) {
+		count = p_count;
+		std::vector<float> *buffers[] = { &a, &b, &c, &d, &e, &f };
+		uint32_t rng = 1;
+		for (std::vector<float> *buffer : buffers) {
+			buffer->resize(count);
+			for (uint32_t i = 0; i < count; ++i) {
+				rng = rng * 1664525u + 1013904223u;
+				(*buffer)[i] = static_cast<float>(static_cast<int>(rng >> 8) % 2000 - 1000) / 37.f;
+			}
+		}
+		// Test divisions by zero
+		for (uint32_t i = 0; i < count; i += 7) {
+			b[i] = 0.f;
+		}
+	}
+};
+
+struct NodeKernelCase {
+	const char *name;
+	void (*run)(const NodeKernels &k, const NodeKernelInputs &in, float *out);
+};
+
+const NodeKernelCase g_node_kernel_cases[] = {
+	{ "Add",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.add.buffer_buffer(in.a.data(), in.b.data(), out, in.count);
+			} },
+	{ "AddConstant",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.add.buffer_constant(in.a.data(), 2.5f, out, in.count);
+			} },
+	{ "Subtract",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.subtract.constant_buffer(2.5f, in.b.data(), out, in.count);
+			} },
+	{ "Multiply",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.multiply.buffer_buffer(in.a.data(), in.b.data(), out, in.count);
+			} },
+	{ "Divide",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.divide.buffer_buffer(in.a.data(), in.b.data(), out, in.count);
+			} },
+	{ "DivideConstant",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.divide.constant_buffer(2.5f, in.b.data(), out, in.count);
+			} },
+	{ "Min",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.min.buffer_buffer(in.a.data(), in.b.data(), out, in.count);
+			} },
+	{ "Max",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.max.buffer_constant(in.a.data(), 0.f, out, in.count);
+			} },
+	{ "Clamp",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.clamp(in.a.data(), in.b.data(), in.c.data(), out, in.count);
+			} },
+	{ "ClampC",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.clamp_constant(in.a.data(), -1.f, 1.f, out, in.count);
+			} },
+	{ "Mix",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.mix(in.a.data(), in.b.data(), in.c.data(), out, in.count);
+			} },
+	{ "Remap",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.linear(in.a.data(), 1.3f, 0.2f, out, in.count);
+			} },
+	{ "Smoothstep",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.smoothstep(in.a.data(), -3.f, 5.f, out, in.count);
+			} },
+	{ "Select",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.select(in.a.data(), in.b.data(), in.c.data(), 0.5f, out, in.count);
+			} },
+	{ "Distance2D",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.distance_2d(in.a.data(), in.b.data(), in.c.data(), in.d.data(), out, in.count);
+			} },
+	{ "Distance3D",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.distance_3d(in.a.data(), in.b.data(), in.c.data(), in.d.data(), in.e.data(), in.f.data(), out,
+						in.count);
+			} },
+	{ "SdfBox",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.sdf_box(in.a.data(), in.b.data(), in.c.data(), 3.f, 4.f, 5.f, out, in.count);
+			} },
+	{ "SdfSphere",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.sdf_sphere(in.a.data(), in.b.data(), in.c.data(), 3.f, out, in.count);
+			} },
+	{ "SdfTorus",
+			[](const NodeKernels &k, const NodeKernelInputs &in, float *out) {
+				k.sdf_torus(in.a.data(), in.b.data(), in.c.data(), 3.f, 1.f, out, in.count);
+			} },
+};
+
+} // namespace
+
+void test_voxel_graph_node_kernels() {
+	// Vectorized kernels must give exactly the same results as scalar ones, so terrain doesn't depend on the CPU.
+	// Use a count that isn't a multiple of vector sizes, so remaining values are tested too.
+	NodeKernelInputs inputs;
+	inputs.create(1003);
+	inputs.a[5] = std::numeric_limits<float>::quiet_NaN();
+	inputs.b[9] = std::numeric_limits<float>::quiet_NaN();
+
+	const NodeKernels *scalar_kernels = get_node_kernels(SIMD_NONE);
+	ZN_TEST_ASSERT(scalar_kernels != nullptr);
+	ZN_TEST_ASSERT(&get_node_kernels() == get_node_kernels(get_node_kernels_simd_level()));
+
+	std::vector<float> expected;
+	expected.resize(inputs.count);
+	std::vector<float> actual;
+	actual.resize(inputs.count);
+
+	for (unsigned int level = SIMD_NONE + 1; level < SIMD_LEVEL_COUNT; ++level) {
+		const NodeKernels *kernels = get_node_kernels(SimdLevel(level));
+		if (kernels == nullptr) {
+			continue;
+		}
+		for (const NodeKernelCase &kernel_case : g_node_kernel_cases) {
+			kernel_case.run(*scalar_kernels, inputs, expected.data());
+			kernel_case.run(*kernels, inputs, actual.data());
+			// Compare bits, so NaNs are compared too
+			const bool same = memcmp(expected.data(), actual.data(), inputs.count * sizeof(float)) == 0;
+			if (!same) {
+				ZN_PRINT_ERROR(format("{} with {} differs from scalar", kernel_case.name,
+						get_simd_level_name(SimdLevel(level))));
+			}
+			ZN_TEST_ASSERT(same);
+		}
+	}
+}
+
+void test_voxel_graph_node_kernels_benchmark() {
+	// Compares throughput of each node kernel with every instruction set the CPU supports.
+	// The count is about what a graph processes in one batch.
+	NodeKernelInputs inputs;
+	inputs.create(4096);
+	std::vector<float> output;
+	output.resize(inputs.count);
+	const unsigned int iterations = 200;
+
+	print_line(String("Node kernels using {0} by default").format(
+			varray(get_simd_level_name(get_node_kernels_simd_level()))));
+
+	for (const NodeKernelCase &kernel_case : g_node_kernel_cases) {
+		String line = String("{0}:").format(varray(kernel_case.name));
+		for (unsigned int level = SIMD_NONE; level < SIMD_LEVEL_COUNT; ++level) {
+			const NodeKernels *kernels = get_node_kernels(SimdLevel(level));
+			if (kernels == nullptr) {
+				continue;
+			}
+			const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+			for (unsigned int i = 0; i < iterations; ++i) {
+				kernel_case.run(*kernels, inputs, output.data());
+			}
+			const uint64_t time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
+			// Millions of values per second
+			const double throughput = double(inputs.count) * iterations / math::max(time_spent, uint64_t(1));
+			line += String(" {0} {1} M/s").format(
+					varray(get_simd_level_name(SimdLevel(level)), Math::snapped(throughput, 0.1)));
+		}
+		print_line(line);
+	}
+}
+
+namespace {
+
+// Runs a compiled graph on a list of positions, with or without range analysis, and returns values of its first output
+void run_graph_runtime(const pg::Runtime &runtime, const VoxelGraphFunction &func, const std::vector<float> &xs,
+		const std::vector<float> &ys, const std::vector<float> &zs, bool optimize, std::vector<float> &out_values) {
+	pg::Runtime::State state;
+	runtime.prepare_state(state, xs.size(), false);
+
+	std::vector<float> x_buffer = xs;
+	std::vector<float> y_buffer = ys;
+	std::vector<float> z_buffer = zs;
+
+	Span<const VoxelGraphFunction::Port> input_defs = func.get_input_definitions();
+	FixedArray<Span<float>, pg::Runtime::MAX_INPUTS> inputs;
+	FixedArray<math::Interval, pg::Runtime::MAX_INPUTS> input_ranges;
+	ZN_TEST_ASSERT(input_defs.size() <= inputs.size());
+
+	for (unsigned int i = 0; i < input_defs.size(); ++i) {
+		std::vector<float> *buffer = nullptr;
+		switch (input_defs[i].type) {
+			case VoxelGraphFunction::NODE_INPUT_X:
+				buffer = &x_buffer;
+				break;
+			case VoxelGraphFunction::NODE_INPUT_Y:
+				buffer = &y_buffer;
+				break;
+			case VoxelGraphFunction::NODE_INPUT_Z:
+				buffer = &z_buffer;
+				break;
+			default:
+				ZN_TEST_ASSERT(false);
+				break;
+		}
+		inputs[i] = to_span(*buffer);
+		input_ranges[i] = math::Interval(*std::min_element(buffer->begin(), buffer->end()),
+				*std::max_element(buffer->begin(), buffer->end()));
+	}
+
+	pg::Runtime::ExecutionMap execution_map;
+	if (optimize) {
+		runtime.analyze_range(state, to_span(input_ranges, input_defs.size()));
+		runtime.generate_optimized_execution_map(state, execution_map, false);
+	}
+
+	runtime.generate_set(state, to_span(inputs, input_defs.size()), false, optimize ? &execution_map : nullptr);
+
+	const pg::Runtime::Buffer &out_buffer = state.get_buffer(runtime.get_output_info(0).buffer_address);
+	out_values.resize(xs.size());
+	memcpy(out_values.data(), out_buffer.data, xs.size() * sizeof(float));
+}
+
+void load_graph_with_heightmap_and_cave(VoxelGraphFunction &g) {
+	//   X --- *0.1 --- Sin --- *10
+	//                           |
+	//   Z --- *0.2 ------------ + ---.
+	//                                |
+	//   Y -------------------------- - --- Max --- OutputSDF
+	//                                       |
+	//   X, Y, Z --- SdfSphere --- *(-1) ----'
+
+	const uint32_t n_x = g.create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+	const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+	const uint32_t n_z = g.create_node(VoxelGraphFunction::NODE_INPUT_Z, Vector2());
+	const uint32_t n_mul_x = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+	const uint32_t n_sin = g.create_node(VoxelGraphFunction::NODE_SIN, Vector2());
+	const uint32_t n_mul_sin = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+	const uint32_t n_mul_z = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+	const uint32_t n_height = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+	const uint32_t n_ground = g.create_node(VoxelGraphFunction::NODE_SUBTRACT, Vector2());
+	const uint32_t n_sphere = g.create_node(VoxelGraphFunction::NODE_SDF_SPHERE, Vector2());
+	const uint32_t n_negate = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+	const uint32_t n_max = g.create_node(VoxelGraphFunction::NODE_MAX, Vector2());
+	const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+
+	g.set_node_default_input(n_mul_x, 1, 0.1f);
+	g.set_node_default_input(n_mul_sin, 1, 10.f);
+	g.set_node_default_input(n_mul_z, 1, 0.2f);
+	g.set_node_default_input(n_negate, 1, -1.f);
+	g.set_node_param(n_sphere, 0, 6.f);
+
+	g.add_connection(n_x, 0, n_mul_x, 0);
+	g.add_connection(n_mul_x, 0, n_sin, 0);
+	g.add_connection(n_sin, 0, n_mul_sin, 0);
+	g.add_connection(n_z, 0, n_mul_z, 0);
+	g.add_connection(n_mul_sin, 0, n_height, 0);
+	g.add_connection(n_mul_z, 0, n_height, 1);
+	g.add_connection(n_y, 0, n_ground, 0);
+	g.add_connection(n_height, 0, n_ground, 1);
+	g.add_connection(n_x, 0, n_sphere, 0);
+	g.add_connection(n_y, 0, n_sphere, 1);
+	g.add_connection(n_z, 0, n_sphere, 2);
+	g.add_connection(n_sphere, 0, n_negate, 0);
+	g.add_connection(n_ground, 0, n_max, 0);
+	g.add_connection(n_negate, 0, n_max, 1);
+	g.add_connection(n_max, 0, n_out, 0);
+
+	g.auto_pick_inputs_and_outputs();
+}
+
+} // namespace
+
+void test_voxel_graph_fused_operations() {
+	// Chains of elementwise nodes are fused in non-debug compilation. Results must be exactly the same as running each
+	// node separately, which is what happens in debug compilation.
+	Ref<VoxelGraphFunction> func;
+	func.instantiate();
+	{
+		//   X --- *2.5                      X  Y  Z
+		//           \                       \ | /
+		//   Y ------- + --- *0.3 --- ClampC  SdfSphere
+		//                                \     |
+		//                                 \    |
+		//   Z --- Remap ----------------- Mix(a, b, ratio) --- /3 --- OutputSDF
+
+		VoxelGraphFunction &g = **func;
+
+		const uint32_t n_x = g.create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+		const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+		const uint32_t n_z = g.create_node(VoxelGraphFunction::NODE_INPUT_Z, Vector2());
+		const uint32_t n_mul1 = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+		const uint32_t n_add = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+		const uint32_t n_mul2 = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+		const uint32_t n_clamp = g.create_node(VoxelGraphFunction::NODE_CLAMP_C, Vector2());
+		const uint32_t n_sphere = g.create_node(VoxelGraphFunction::NODE_SDF_SPHERE, Vector2());
+		const uint32_t n_remap = g.create_node(VoxelGraphFunction::NODE_REMAP, Vector2());
+		const uint32_t n_mix = g.create_node(VoxelGraphFunction::NODE_MIX, Vector2());
+		const uint32_t n_div = g.create_node(VoxelGraphFunction::NODE_DIVIDE, Vector2());
+		const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+
+		g.set_node_default_input(n_mul1, 1, 2.5f);
+		g.set_node_default_input(n_mul2, 1, 0.3f);
+		g.set_node_default_input(n_div, 1, 3.f);
+		g.set_node_param(n_clamp, 0, -5.f);
+		g.set_node_param(n_clamp, 1, 5.f);
+		g.set_node_param(n_sphere, 0, 20.f);
+		g.set_node_param(n_remap, 0, -50.f);
+		g.set_node_param(n_remap, 1, 50.f);
+		g.set_node_param(n_remap, 2, 0.f);
+		g.set_node_param(n_remap, 3, 1.f);
+
+		g.add_connection(n_x, 0, n_mul1, 0);
+		g.add_connection(n_mul1, 0, n_add, 0);
+		g.add_connection(n_y, 0, n_add, 1);
+		g.add_connection(n_add, 0, n_mul2, 0);
+		g.add_connection(n_mul2, 0, n_clamp, 0);
+		g.add_connection(n_x, 0, n_sphere, 0);
+		g.add_connection(n_y, 0, n_sphere, 1);
+		g.add_connection(n_z, 0, n_sphere, 2);
+		g.add_connection(n_z, 0, n_remap, 0);
+		g.add_connection(n_clamp, 0, n_mix, 0);
+		g.add_connection(n_sphere, 0, n_mix, 1);
+		g.add_connection(n_remap, 0, n_mix, 2);
+		g.add_connection(n_mix, 0, n_div, 0);
+		g.add_connection(n_div, 0, n_out, 0);
+
+		g.auto_pick_inputs_and_outputs();
+	}
+
+	pg::Runtime runtime_debug;
+	ZN_TEST_ASSERT(runtime_debug.compile(**func, true).success);
+	ZN_TEST_ASSERT(runtime_debug.get_fused_operation_count() == 0);
+
+	pg::Runtime runtime;
+	ZN_TEST_ASSERT(runtime.compile(**func, false).success);
+	ZN_TEST_ASSERT(runtime.get_fused_operation_count() > 0);
+
+	struct Area {
+		Vector3f origin;
+		Vector3f step;
+	};
+	const Area areas[] = {
+		// General case, every operation runs
+		{ Vector3f(-60.f, -30.f, -40.f), Vector3f(0.12f, 0.06f, 0.08f) },
+		// ClampC is constant there, so the optimized execution map skips it and the chain can't run fused
+		{ Vector3f(100.f, 100.f, 0.f), Vector3f(0.01f, 0.01f, 0.01f) },
+	};
+
+	// Use a count that isn't a multiple of tile and vector sizes
+	const unsigned int count = 1003;
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> zs;
+	xs.resize(count);
+	ys.resize(count);
+	zs.resize(count);
+
+	std::vector<float> expected;
+	std::vector<float> actual;
+
+	for (const Area &area : areas) {
+		for (unsigned int i = 0; i < count; ++i) {
+			xs[i] = area.origin.x + area.step.x * i;
+			ys[i] = area.origin.y + area.step.y * ((i * 7) % count);
+			zs[i] = area.origin.z + area.step.z * ((i * 13) % count);
+		}
+		for (const bool optimize : { false, true }) {
+			run_graph_runtime(runtime_debug, **func, xs, ys, zs, optimize, expected);
+			run_graph_runtime(runtime, **func, xs, ys, zs, optimize, actual);
+			// Compare bits, results must not just be approximately equal
+			ZN_TEST_ASSERT(memcmp(expected.data(), actual.data(), count * sizeof(float)) == 0);
+		}
+	}
+}
+
+void test_voxel_graph_buffer_data_sharing() {
+	// Buffers of a chain of elementwise nodes can all share the same data, because each node can write its output
+	// where its input was.
+	Ref<VoxelGraphFunction> func;
+	func.instantiate();
+	{
+		//   X --- *2 --- + --- Sin --- Abs --- OutputSDF
+		//               /
+		//   Y ---------
+
+		VoxelGraphFunction &g = **func;
+
+		const uint32_t n_x = g.create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+		const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+		const uint32_t n_mul = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+		const uint32_t n_add = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+		const uint32_t n_sin = g.create_node(VoxelGraphFunction::NODE_SIN, Vector2());
+		const uint32_t n_abs = g.create_node(VoxelGraphFunction::NODE_ABS, Vector2());
+		const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+
+		g.set_node_default_input(n_mul, 1, 2.f);
+
+		g.add_connection(n_x, 0, n_mul, 0);
+		g.add_connection(n_mul, 0, n_add, 0);
+		g.add_connection(n_y, 0, n_add, 1);
+		g.add_connection(n_add, 0, n_sin, 0);
+		g.add_connection(n_sin, 0, n_abs, 0);
+		g.add_connection(n_abs, 0, n_out, 0);
+
+		g.auto_pick_inputs_and_outputs();
+	}
+
+	pg::Runtime runtime_debug;
+	ZN_TEST_ASSERT(runtime_debug.compile(**func, true).success);
+
+	pg::Runtime runtime;
+	ZN_TEST_ASSERT(runtime.compile(**func, false).success);
+	const pg::Runtime::BufferDataStats stats = runtime.get_buffer_data_stats();
+	ZN_TEST_ASSERT(stats.unshared_count == 5);
+	ZN_TEST_ASSERT(stats.count == 1);
+	ZN_TEST_ASSERT(stats.peak_live_count == 1);
+	// Without writing outputs over inputs, each node of the chain needs its input and its output at the same time
+	ZN_TEST_ASSERT(stats.peak_live_count_without_in_place == 2);
+
+	// In debug, every buffer has its own data
+	const pg::Runtime::BufferDataStats debug_stats = runtime_debug.get_buffer_data_stats();
+	ZN_TEST_ASSERT(debug_stats.peak_live_count == debug_stats.unshared_count);
+
+	const unsigned int count = 100;
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> zs;
+	xs.resize(count);
+	ys.resize(count);
+	zs.resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		xs[i] = -10.f + 0.2f * i;
+		ys[i] = 5.f - 0.1f * i;
+		zs[i] = 0.f;
+	}
+
+	std::vector<float> expected;
+	std::vector<float> actual;
+	run_graph_runtime(runtime_debug, **func, xs, ys, zs, false, expected);
+	run_graph_runtime(runtime, **func, xs, ys, zs, false, actual);
+	ZN_TEST_ASSERT(memcmp(expected.data(), actual.data(), count * sizeof(float)) == 0);
+}
+
+void test_voxel_graph_xz_caching() {
+	// Nodes that don't depend on Y run once per section of block instead of once per slice. Results must be the same
+	// as running every node for every slice.
+
+	{
+		Ref<VoxelGraphFunction> func;
+		func.instantiate();
+		load_graph_with_heightmap_and_cave(**func);
+		pg::Runtime runtime;
+		ZN_TEST_ASSERT(runtime.compile(**func, false).success);
+		// The 5 operations of the heightmap
+		ZN_TEST_ASSERT(runtime.get_outer_group_operation_count() == 5);
+		// Only the height is needed by the rest of the graph
+		ZN_TEST_ASSERT(runtime.get_outer_group_result_count() == 1);
+	}
+
+	// The column cache would skip the outer group in every slice, this is tested separately
+	pg::ColumnCache &column_cache = pg::ColumnCache::get_singleton();
+	const size_t column_cache_budget = column_cache.get_memory_budget();
+	column_cache.set_memory_budget(0);
+
+	for (const bool optimize : { false, true }) {
+		Ref<VoxelGeneratorGraph> generator_cached;
+		generator_cached.instantiate();
+		load_graph_with_heightmap_and_cave(**generator_cached->get_main_function());
+		generator_cached->set_use_xz_caching(true);
+		generator_cached->set_use_optimized_execution_map(optimize);
+		ZN_TEST_ASSERT(generator_cached->compile(false).success);
+
+		Ref<VoxelGeneratorGraph> generator_uncached;
+		generator_uncached.instantiate();
+		load_graph_with_heightmap_and_cave(**generator_uncached->get_main_function());
+		generator_uncached->set_use_xz_caching(false);
+		generator_uncached->set_use_optimized_execution_map(optimize);
+		ZN_TEST_ASSERT(generator_uncached->compile(false).success);
+
+		ZN_TEST_ASSERT(check_graph_results_are_equal(**generator_cached, **generator_uncached));
+	}
+
+	column_cache.set_memory_budget(column_cache_budget);
+}
+
+void test_voxel_graph_column_cache() {
+	{
+		// Least recently used columns are removed when going over budget
+		pg::ColumnCache cache;
+		std::vector<float> column_data;
+		column_data.resize(256, 1.f);
+		const pg::ColumnCache::Key key0{ 42, Vector2i(0, 0), Vector2i(16, 16), 0 };
+		const pg::ColumnCache::Key key1{ 42, Vector2i(16, 0), Vector2i(16, 16), 0 };
+		const pg::ColumnCache::Key key2{ 42, Vector2i(32, 0), Vector2i(16, 16), 0 };
+		const pg::ColumnCache::Key key2_lod1{ 42, Vector2i(32, 0), Vector2i(16, 16), 1 };
+
+		// Room for 2 columns
+		cache.set_memory_budget(2 * (column_data.size() * sizeof(float) + 256));
+
+		cache.store(key0, to_span(column_data));
+		column_data[0] = 2.f;
+		cache.store(key1, to_span(column_data));
+
+		std::vector<float> loaded_data;
+		loaded_data.resize(column_data.size());
+		ZN_TEST_ASSERT(cache.load(key0, to_span(loaded_data)));
+		ZN_TEST_ASSERT(loaded_data[0] == 1.f);
+		ZN_TEST_ASSERT(!cache.load(key2_lod1, to_span(loaded_data)));
+
+		// `key1` is now the least recently used
+		cache.store(key2, to_span(column_data));
+		ZN_TEST_ASSERT(!cache.load(key1, to_span(loaded_data)));
+		ZN_TEST_ASSERT(cache.load(key0, to_span(loaded_data)));
+		ZN_TEST_ASSERT(cache.load(key2, to_span(loaded_data)));
+		ZN_TEST_ASSERT(loaded_data[0] == 2.f);
+
+		const pg::ColumnCache::Stats stats = cache.get_stats();
+		ZN_TEST_ASSERT(stats.hits == 3);
+		ZN_TEST_ASSERT(stats.misses == 2);
+		ZN_TEST_ASSERT(stats.column_count == 2);
+		ZN_TEST_ASSERT(stats.memory_usage <= stats.memory_budget);
+
+		cache.set_memory_budget(0);
+		ZN_TEST_ASSERT(cache.get_stats().column_count == 0);
+	}
+	{
+		// Blocks stacked along Y re-use results of the heightmap part of the graph, and give the same results as if
+		// nothing was cached
+		Ref<VoxelGeneratorGraph> generator_cached;
+		generator_cached.instantiate();
+		load_graph_with_heightmap_and_cave(**generator_cached->get_main_function());
+		ZN_TEST_ASSERT(generator_cached->compile(false).success);
+
+		Ref<VoxelGeneratorGraph> generator_uncached;
+		generator_uncached.instantiate();
+		load_graph_with_heightmap_and_cave(**generator_uncached->get_main_function());
+		generator_uncached->set_use_xz_caching(false);
+		ZN_TEST_ASSERT(generator_uncached->compile(false).success);
+
+		const pg::ColumnCache::Stats stats_before = pg::ColumnCache::get_singleton().get_stats();
+
+		for (int y = -16; y < 16; y += 16) {
+			ZN_TEST_ASSERT(check_graph_results_are_equal(**generator_cached, **generator_uncached, Vector3i(0, y, 0)));
+		}
+
+		const pg::ColumnCache::Stats stats_after = pg::ColumnCache::get_singleton().get_stats();
+		if (pg::ColumnCache::get_singleton().get_memory_budget() > 0) {
+			ZN_TEST_ASSERT(stats_after.hits > stats_before.hits);
+		}
+	}
+}
+
 } // namespace zylann::voxel::tests
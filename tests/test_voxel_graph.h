@@ -29,6 +29,12 @@ void test_voxel_graph_issue471();
 void test_voxel_graph_unused_single_texture_output();
 void test_voxel_graph_spots2d_optimized_execution_map();
 void test_voxel_graph_unused_inner_output();
+void test_voxel_graph_node_kernels();
+void test_voxel_graph_node_kernels_benchmark();
+void test_voxel_graph_fused_operations();
+void test_voxel_graph_xz_caching();
+void test_voxel_graph_column_cache();
+void test_voxel_graph_buffer_data_sharing();
 
 } // namespace zylann::voxel::tests
 
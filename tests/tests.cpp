@@ -8,19 +8,26 @@
 #include "../storage/voxel_buffer_gd.h"
 #include "../storage/voxel_data.h"
 #include "../storage/voxel_data_map.h"
+#include "../storage/voxel_memory_pool.h"
 #include "../storage/voxel_metadata_variant.h"
 #include "../streams/instance_data.h"
 #include "../streams/region/region_file.h"
 #include "../streams/region/voxel_stream_region_files.h"
+#include "../streams/sqlite/voxel_stream_sqlite.h"
 #include "../streams/voxel_block_serializer.h"
 #include "../streams/voxel_block_serializer_gd.h"
+#include "../terrain/voxel_terrain_prefetch_cache.h"
+#include "../util/block_hash_map.h"
 #include "../util/container_funcs.h"
 #include "../util/flat_map.h"
 #include "../util/godot/classes/box_shape_3d.h"
+#include "../util/godot/classes/file.h"
 #include "../util/godot/classes/time.h"
 #include "../util/godot/funcs.h"
 #include "../util/island_finder.h"
+#include "../util/memory_mapped_file.h"
 #include "../util/math/box3i.h"
+#include "../util/serialization.h"
 #include "../util/slot_map.h"
 #include "../util/string_funcs.h"
 #include "../util/tasks/threaded_task_runner.h"
@@ -852,6 +859,323 @@ void test_voxel_buffer_create() {
 	generated_voxels.create(Vector3i(1, 16, 18));
 }
 
+// Checks voxels of a channel against reference values indexed like the buffer, regardless of how the channel is stored
+static bool check_channel_values(
+		const VoxelBufferInternal &vb, unsigned int channel_index, const std::vector<uint64_t> &expected_values) {
+	Vector3i pos;
+	for (pos.z = 0; pos.z < vb.get_size().z; ++pos.z) {
+		for (pos.x = 0; pos.x < vb.get_size().x; ++pos.x) {
+			for (pos.y = 0; pos.y < vb.get_size().y; ++pos.y) {
+				if (vb.get_voxel(pos, channel_index) != expected_values[vb.get_index(pos.x, pos.y, pos.z)]) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void test_voxel_buffer_palette_compression() {
+	const unsigned int channel_index = VoxelBufferInternal::CHANNEL_TYPE;
+	const Vector3i block_size(16, 16, 16);
+
+	// Reference values, indexed like the buffer
+	std::vector<uint64_t> expected_values;
+	expected_values.resize(Vector3iUtil::get_volume(block_size));
+
+	VoxelBufferInternal vb;
+	vb.create(block_size);
+
+	// A few layers like a blocky terrain would have
+	Vector3i pos;
+	for (pos.z = 0; pos.z < block_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < block_size.x; ++pos.x) {
+			for (pos.y = 0; pos.y < block_size.y; ++pos.y) {
+				const uint64_t v = pos.y < 5 ? 1 : (pos.y < 8 ? (pos.x % 2 == 0 ? 2 : 3) : 0);
+				vb.set_voxel(v, pos, channel_index);
+				expected_values[vb.get_index(pos.x, pos.y, pos.z)] = v;
+			}
+		}
+	}
+
+	VoxelBufferInternal raw_vb;
+	raw_vb.create(block_size);
+	raw_vb.copy_from(vb);
+
+	ZN_TEST_ASSERT(vb.compress_channel_with_palette(channel_index));
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_PALETTE);
+	ZN_TEST_ASSERT(vb.equals(raw_vb));
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	// Adding new values grows the palette
+	for (int i = 0; i < 20; ++i) {
+		const Vector3i p(i % 16, 15, i / 16);
+		vb.set_voxel(100 + i, p, channel_index);
+		expected_values[vb.get_index(p.x, p.y, p.z)] = 100 + i;
+	}
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_PALETTE);
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	const Box3i fill_box = Box3i::from_min_max(Vector3i(2, 2, 2), Vector3i(10, 12, 9));
+	vb.fill_area(7, fill_box.pos, fill_box.pos + fill_box.size, channel_index);
+	fill_box.for_each_cell([&vb, &expected_values](Vector3i p) { //
+		expected_values[vb.get_index(p.x, p.y, p.z)] = 7;
+	});
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	// Copying a region out of a palette channel, like when gathering voxels for meshing
+	{
+		VoxelBufferInternal padded_vb;
+		padded_vb.create(block_size + Vector3i(2, 2, 2));
+		padded_vb.copy_from(vb, Vector3i(), block_size, Vector3i(1, 1, 1), channel_index);
+		for (pos.z = 0; pos.z < block_size.z; ++pos.z) {
+			for (pos.x = 0; pos.x < block_size.x; ++pos.x) {
+				for (pos.y = 0; pos.y < block_size.y; ++pos.y) {
+					ZN_TEST_ASSERT(padded_vb.get_voxel(pos + Vector3i(1, 1, 1), channel_index) ==
+							expected_values[vb.get_index(pos.x, pos.y, pos.z)]);
+				}
+			}
+		}
+	}
+
+	// Copying the whole buffer keeps the palette
+	{
+		VoxelBufferInternal vb2;
+		vb2.create(block_size);
+		vb2.copy_from(vb);
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_PALETTE);
+		ZN_TEST_ASSERT(vb2.equals(vb));
+	}
+
+	// Palette channels are saved like raw channels
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(vb);
+		ZN_TEST_ASSERT(result.success);
+		VoxelBufferInternal deserialized_vb;
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(result.data), deserialized_vb));
+		ZN_TEST_ASSERT(check_channel_values(deserialized_vb, channel_index, expected_values));
+	}
+
+	// Too many different values turns the channel back into raw data
+	for (int i = 0; i < 300; ++i) {
+		const Vector3i p(i % 16, 0, (i / 16) % 16);
+		vb.set_voxel(1000 + i, p, channel_index);
+		expected_values[vb.get_index(p.x, p.y, p.z)] = 1000 + i;
+	}
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_NONE);
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+}
+
+void test_voxel_buffer_brick_compression() {
+	const unsigned int channel_index = VoxelBufferInternal::CHANNEL_SDF;
+	const Vector3i block_size(32, 32, 32);
+
+	VoxelBufferInternal vb;
+	vb.create(block_size);
+
+	// Reference values, indexed like the buffer
+	std::vector<uint64_t> expected_values;
+	expected_values.resize(Vector3iUtil::get_volume(block_size), vb.get_voxel(Vector3i(), channel_index));
+
+	// Varying values in a small area, like around a surface
+	unsigned int counter = 0;
+	Box3i(Vector3i(3, 10, 4), Vector3i(10, 4, 8)).for_each_cell_zxy([&vb, &expected_values, &counter](Vector3i p) {
+		const uint64_t v = 1000 + (counter % 50);
+		vb.set_voxel(v, p, channel_index);
+		expected_values[vb.get_index(p.x, p.y, p.z)] = v;
+		++counter;
+	});
+
+	VoxelBufferInternal raw_vb;
+	raw_vb.create(block_size);
+	raw_vb.copy_from(vb);
+
+	ZN_TEST_ASSERT(vb.compress_channel_with_bricks(channel_index));
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_BRICKS);
+	ZN_TEST_ASSERT(vb.equals(raw_vb));
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	// Setting a voxel in a uniform brick
+	vb.set_voxel(7, Vector3i(30, 30, 30), channel_index);
+	expected_values[vb.get_index(30, 30, 30)] = 7;
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	// Filling an area covering some bricks entirely and others partially
+	const Box3i fill_box = Box3i::from_min_max(Vector3i(5, 5, 5), Vector3i(27, 20, 18));
+	vb.fill_area(9, fill_box.pos, fill_box.pos + fill_box.size, channel_index);
+	fill_box.for_each_cell([&vb, &expected_values](Vector3i p) { //
+		expected_values[vb.get_index(p.x, p.y, p.z)] = 9;
+	});
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_BRICKS);
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	// Writing with a function, like edits do
+	const Box3i write_box(Vector3i(1, 2, 3), Vector3i(20, 9, 14));
+	vb.write_box(
+			write_box, channel_index, [](Vector3i pos, uint64_t v) { return v + pos.x; }, Vector3i(100, 0, 0));
+	write_box.for_each_cell([&vb, &expected_values](Vector3i p) { //
+		expected_values[vb.get_index(p.x, p.y, p.z)] += p.x + 100;
+	});
+	ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+
+	// Copying a region out of bricks, like when gathering voxels for meshing
+	{
+		VoxelBufferInternal padded_vb;
+		padded_vb.create(block_size + Vector3i(2, 2, 2));
+		padded_vb.copy_from(vb, Vector3i(), block_size, Vector3i(1, 1, 1), channel_index);
+		Vector3i pos;
+		for (pos.z = 0; pos.z < block_size.z; ++pos.z) {
+			for (pos.x = 0; pos.x < block_size.x; ++pos.x) {
+				for (pos.y = 0; pos.y < block_size.y; ++pos.y) {
+					ZN_TEST_ASSERT(padded_vb.get_voxel(pos + Vector3i(1, 1, 1), channel_index) ==
+							expected_values[vb.get_index(pos.x, pos.y, pos.z)]);
+				}
+			}
+		}
+	}
+
+	// Copying a region into bricks
+	{
+		VoxelBufferInternal src_vb;
+		src_vb.create(10, 10, 10);
+		src_vb.fill(55, channel_index);
+		src_vb.set_voxel(66, Vector3i(2, 2, 2), channel_index);
+		const Vector3i dst_min(20, 20, 20);
+		vb.copy_from(src_vb, Vector3i(), src_vb.get_size(), dst_min, channel_index);
+		Box3i(Vector3i(), src_vb.get_size()).for_each_cell([&vb, &src_vb, &expected_values, dst_min](Vector3i p) {
+			const Vector3i dp = p + dst_min;
+			expected_values[vb.get_index(dp.x, dp.y, dp.z)] = src_vb.get_voxel(p, channel_index);
+		});
+		ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_BRICKS);
+		ZN_TEST_ASSERT(check_channel_values(vb, channel_index, expected_values));
+	}
+
+	// Copying the whole buffer keeps bricks
+	{
+		VoxelBufferInternal vb2;
+		vb2.create(block_size);
+		vb2.copy_from(vb);
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_BRICKS);
+		ZN_TEST_ASSERT(vb2.equals(vb));
+		vb2.decompress_channel(channel_index);
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_NONE);
+		ZN_TEST_ASSERT(check_channel_values(vb2, channel_index, expected_values));
+	}
+
+	// Bricked channels are saved like raw channels
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(vb);
+		ZN_TEST_ASSERT(result.success);
+		VoxelBufferInternal deserialized_vb;
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(result.data), deserialized_vb));
+		ZN_TEST_ASSERT(check_channel_values(deserialized_vb, channel_index, expected_values));
+	}
+
+	// Filling everything with the same value can turn the channel uniform
+	vb.fill_area(3, Vector3i(), block_size, channel_index);
+	vb.compress_uniform_channels();
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_UNIFORM);
+
+	// Sizes must be multiples of the brick size
+	{
+		VoxelBufferInternal padded_vb;
+		padded_vb.create(18, 18, 18);
+		padded_vb.set_voxel(5, Vector3i(1, 1, 1), channel_index);
+		ZN_TEST_ASSERT(!padded_vb.compress_channel_with_bricks(channel_index));
+	}
+}
+
+void test_voxel_buffer_sdf_quantization() {
+	const unsigned int channel_index = VoxelBufferInternal::CHANNEL_SDF;
+	const Vector3i block_size(16, 16, 16);
+
+	VoxelBufferInternal vb;
+	vb.create(block_size);
+	ZN_TEST_ASSERT(vb.get_channel_depth(channel_index) == VoxelBufferInternal::DEPTH_16_BIT);
+
+	// Sphere, with values getting large far from the surface
+	const Vector3f center(8.3f, 7.6f, 8.1f);
+	const float radius = 5.f;
+	Box3i(Vector3i(), block_size).for_each_cell([&vb, center, radius](Vector3i pos) {
+		const float sd = math::length(to_vec3f(pos) - center) - radius;
+		vb.set_voxel_f(sd * 0.1f, pos, channel_index);
+	});
+
+	VoxelBufferInternal raw_vb;
+	raw_vb.create(block_size);
+	raw_vb.copy_from(vb);
+
+	ZN_TEST_ASSERT(vb.quantize_sdf_channel());
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_QUANTIZED);
+
+	Span<uint8_t> quantized_data;
+	uint16_t step;
+	ZN_TEST_ASSERT(vb.get_channel_quantized_raw(channel_index, quantized_data, step));
+	ZN_TEST_ASSERT(quantized_data.size() == Vector3iUtil::get_volume(block_size));
+	ZN_TEST_ASSERT(step > 0);
+
+	// Values close to the surface must stay precise, and signs must not flip
+	Box3i(Vector3i(), block_size).for_each_cell([&vb, &raw_vb, center, radius, step](Vector3i pos) {
+		const int16_t expected = raw_vb.get_voxel(pos, channel_index);
+		const int16_t actual = vb.get_voxel(pos, channel_index);
+		ZN_TEST_ASSERT(expected >= 0 ? actual >= 0 : actual < 0);
+		if (Math::abs(math::length(to_vec3f(pos) - center) - radius) < 1.5f) {
+			ZN_TEST_ASSERT(Math::abs(expected - actual) <= step);
+		}
+	});
+
+	// Copying a region decodes values, like when gathering voxels for meshing
+	{
+		VoxelBufferInternal padded_vb;
+		padded_vb.create(block_size + Vector3i(2, 2, 2));
+		padded_vb.copy_from(vb, Vector3i(), block_size, Vector3i(1, 1, 1), channel_index);
+		ZN_TEST_ASSERT(padded_vb.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_NONE);
+		Box3i(Vector3i(), block_size).for_each_cell([&vb, &padded_vb](Vector3i pos) {
+			ZN_TEST_ASSERT(padded_vb.get_voxel(pos + Vector3i(1, 1, 1), channel_index) ==
+					vb.get_voxel(pos, channel_index));
+		});
+	}
+
+	// Quantized channels are saved quantized
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(vb);
+		ZN_TEST_ASSERT(result.success);
+		VoxelBufferInternal deserialized_vb;
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(result.data), deserialized_vb));
+		ZN_TEST_ASSERT(deserialized_vb.get_channel_compression(channel_index) ==
+				VoxelBufferInternal::COMPRESSION_QUANTIZED);
+		ZN_TEST_ASSERT(deserialized_vb.equals(vb));
+
+		// Quantized channels don't exist in version 4
+		std::vector<uint8_t> v4_data = result.data;
+		v4_data[0] = 4;
+		ZN_TEST_ASSERT(!BlockSerializer::deserialize(to_span_const(v4_data), deserialized_vb));
+	}
+
+	// Edits are exact, so they turn the channel back to 16 bits
+	{
+		VoxelBufferInternal vb2;
+		vb2.create(block_size);
+		vb2.copy_from(vb);
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_QUANTIZED);
+		vb2.set_voxel(12345, Vector3i(4, 5, 6), channel_index);
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_NONE);
+		ZN_TEST_ASSERT(vb2.get_voxel(Vector3i(4, 5, 6), channel_index) == 12345);
+		ZN_TEST_ASSERT(
+				vb2.get_voxel(Vector3i(1, 2, 3), channel_index) == vb.get_voxel(Vector3i(1, 2, 3), channel_index));
+	}
+
+	// Only 16-bit SDF is supported
+	{
+		VoxelBufferInternal vb2;
+		vb2.create(block_size);
+		vb2.set_channel_depth(channel_index, VoxelBufferInternal::DEPTH_32_BIT);
+		vb2.set_voxel_f(0.5f, Vector3i(1, 2, 3), channel_index);
+		ZN_TEST_ASSERT(!vb2.quantize_sdf_channel());
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_NONE);
+	}
+}
+
 void test_block_serializer() {
 	// Create an example buffer
 	const Vector3i block_size(8, 9, 10);
@@ -926,6 +1250,271 @@ void test_block_serializer_stream_peer() {
 	ZN_TEST_ASSERT(voxel_buffer2->get_buffer().equals(voxel_buffer->get_buffer()));
 }
 
+// Makes blocks of smooth terrain, similar to what a generator outputs
+static void generate_terrain_block(VoxelBufferInternal &buffer, Vector3i origin_in_voxels, int block_size) {
+	buffer.create(Vector3iUtil::create(block_size));
+	for (int z = 0; z < block_size; ++z) {
+		for (int x = 0; x < block_size; ++x) {
+			const float gx = origin_in_voxels.x + x;
+			const float gz = origin_in_voxels.z + z;
+			const float height =
+					6.f * Math::sin(0.07f * gx) * Math::cos(0.05f * gz) + 2.f * Math::sin(0.31f * gx + 0.17f * gz);
+			for (int y = 0; y < block_size; ++y) {
+				const float sd = origin_in_voxels.y + y - height;
+				buffer.set_voxel_f(
+						sd * constants::QUANTIZED_SDF_16_BITS_SCALE, x, y, z, VoxelBufferInternal::CHANNEL_SDF);
+			}
+		}
+	}
+	buffer.compress_uniform_channels();
+}
+
+static void generate_terrain_blocks(std::vector<VoxelBufferInternal> &buffers, Box3i blocks_box, int block_size) {
+	blocks_box.for_each_cell_zxy([&buffers, block_size](Vector3i bpos) {
+		buffers.emplace_back();
+		generate_terrain_block(buffers.back(), bpos * block_size, block_size);
+	});
+}
+
+void test_block_serializer_zstd() {
+	const int block_size = 16;
+	std::vector<VoxelBufferInternal> buffers;
+	generate_terrain_blocks(buffers, Box3i(Vector3i(0, -1, 0), Vector3i(8, 2, 8)), block_size);
+
+	std::vector<const VoxelBufferInternal *> samples;
+	for (const VoxelBufferInternal &buffer : buffers) {
+		samples.push_back(&buffer);
+	}
+	std::vector<uint8_t> dictionary_data;
+	ZN_TEST_ASSERT(BlockSerializer::train_zstd_dictionary(to_span_const(samples), 8192, dictionary_data));
+	ZN_TEST_ASSERT(dictionary_data.size() > 0 && dictionary_data.size() <= 8192);
+	std::shared_ptr<CompressedData::ZstdDictionary> dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+			to_span_const(dictionary_data), CompressedData::ZSTD_DEFAULT_LEVEL);
+
+	// A block that was not part of training
+	VoxelBufferInternal voxel_buffer;
+	generate_terrain_block(voxel_buffer, Vector3i(1000, 0, -500), block_size);
+
+	CompressedData::Settings settings;
+	settings.compression = CompressedData::COMPRESSION_ZSTD;
+	{
+		// Without dictionary
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(voxel_buffer, settings);
+		ZN_TEST_ASSERT(result.success);
+		std::vector<uint8_t> data = result.data;
+		ZN_TEST_ASSERT(data[0] == CompressedData::COMPRESSION_ZSTD);
+
+		VoxelBufferInternal deserialized_voxel_buffer;
+		ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(to_span_const(data), deserialized_voxel_buffer));
+		ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+	}
+	{
+		// With dictionary
+		settings.zstd_dictionary = dictionary;
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(voxel_buffer, settings);
+		ZN_TEST_ASSERT(result.success);
+		std::vector<uint8_t> data = result.data;
+
+		VoxelBufferInternal deserialized_voxel_buffer;
+		ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(
+				to_span_const(data), deserialized_voxel_buffer, dictionary.get()));
+		ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+
+		// Can't be decompressed without the dictionary, or with a different one
+		ZN_TEST_ASSERT(!BlockSerializer::decompress_and_deserialize(to_span_const(data), deserialized_voxel_buffer));
+		dictionary_data[0] += 1;
+		CompressedData::ZstdDictionary other_dictionary(
+				to_span_const(dictionary_data), CompressedData::ZSTD_DEFAULT_LEVEL);
+		ZN_TEST_ASSERT(other_dictionary.get_id() != dictionary->get_id());
+		ZN_TEST_ASSERT(!BlockSerializer::decompress_and_deserialize(
+				to_span_const(data), deserialized_voxel_buffer, &other_dictionary));
+	}
+}
+
+void test_block_serializer_zstd_benchmark() {
+	// Compares sizes and speed of compression formats on generated terrain
+	const int block_size = 16;
+	std::vector<VoxelBufferInternal> training_buffers;
+	generate_terrain_blocks(training_buffers, Box3i(Vector3i(0, -1, 0), Vector3i(8, 2, 8)), block_size);
+	std::vector<VoxelBufferInternal> buffers;
+	generate_terrain_blocks(buffers, Box3i(Vector3i(20, -1, 20), Vector3i(16, 2, 16)), block_size);
+
+	std::vector<const VoxelBufferInternal *> samples;
+	for (const VoxelBufferInternal &buffer : training_buffers) {
+		samples.push_back(&buffer);
+	}
+	std::vector<uint8_t> dictionary_data;
+	ZN_TEST_ASSERT(BlockSerializer::train_zstd_dictionary(to_span_const(samples), 16384, dictionary_data));
+
+	struct Config {
+		const char *name;
+		CompressedData::Settings settings;
+	};
+	Config configs[3];
+	configs[0].name = "LZ4";
+	configs[0].settings.compression = CompressedData::COMPRESSION_LZ4;
+	configs[1].name = "Zstd";
+	configs[1].settings.compression = CompressedData::COMPRESSION_ZSTD;
+	configs[2].name = "Zstd+dictionary";
+	configs[2].settings.compression = CompressedData::COMPRESSION_ZSTD;
+	configs[2].settings.zstd_dictionary = make_shared_instance<CompressedData::ZstdDictionary>(
+			to_span_const(dictionary_data), CompressedData::ZSTD_DEFAULT_LEVEL);
+
+	size_t sizes[3];
+
+	for (unsigned int config_index = 0; config_index < 3; ++config_index) {
+		const Config &config = configs[config_index];
+		std::vector<std::vector<uint8_t>> compressed_blocks;
+		compressed_blocks.resize(buffers.size());
+		size_t total_size = 0;
+		size_t total_serialized_size = 0;
+
+		const uint64_t time_before_compression = Time::get_singleton()->get_ticks_usec();
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			BlockSerializer::SerializeResult result =
+					BlockSerializer::serialize_and_compress(buffers[i], config.settings);
+			ZN_TEST_ASSERT(result.success);
+			compressed_blocks[i] = result.data;
+			total_size += result.data.size();
+		}
+		const uint64_t compression_time = Time::get_singleton()->get_ticks_usec() - time_before_compression;
+
+		const uint64_t time_before_decompression = Time::get_singleton()->get_ticks_usec();
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelBufferInternal deserialized_voxel_buffer;
+			ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(to_span_const(compressed_blocks[i]),
+					deserialized_voxel_buffer, config.settings.zstd_dictionary.get()));
+		}
+		const uint64_t decompression_time = Time::get_singleton()->get_ticks_usec() - time_before_decompression;
+
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			total_serialized_size += BlockSerializer::serialize(buffers[i]).data.size();
+		}
+
+		sizes[config_index] = total_size;
+
+		print_line(String("{0}: {1} blocks, {2} bytes (ratio {3}), compressed in {4} us, decompressed in {5} us")
+						   .format(varray(config.name, int64_t(buffers.size()), int64_t(total_size),
+								   double(total_serialized_size) / double(total_size), int64_t(compression_time),
+								   int64_t(decompression_time))));
+	}
+
+	// The dictionary is the point of using Zstandard with small blocks
+	ZN_TEST_ASSERT(sizes[2] < sizes[0]);
+}
+
+// Serializes a block the way version 4 did, before channel filters were introduced. Doesn't support metadata.
+static void serialize_block_v4(const VoxelBufferInternal &buffer, std::vector<uint8_t> &dst) {
+	MemoryWriter mw(dst, ENDIANESS_LITTLE_ENDIAN);
+	mw.store_8(4);
+	mw.store_16(buffer.get_size().x);
+	mw.store_16(buffer.get_size().y);
+	mw.store_16(buffer.get_size().z);
+	for (unsigned int channel_index = 0; channel_index < VoxelBufferInternal::MAX_CHANNELS; ++channel_index) {
+		const VoxelBufferInternal::Depth depth = buffer.get_channel_depth(channel_index);
+		if (buffer.get_channel_compression(channel_index) == VoxelBufferInternal::COMPRESSION_UNIFORM) {
+			mw.store_8(VoxelBufferInternal::COMPRESSION_UNIFORM | (depth << 4));
+			const uint64_t v = buffer.get_voxel(Vector3i(), channel_index);
+			for (unsigned int i = 0; i < VoxelBufferInternal::get_depth_byte_count(depth); ++i) {
+				mw.store_8(v >> (i * 8));
+			}
+		} else {
+			mw.store_8(VoxelBufferInternal::COMPRESSION_NONE | (depth << 4));
+			const size_t begin = dst.size();
+			dst.resize(begin + VoxelBufferInternal::get_size_in_bytes_for_volume(buffer.get_size(), depth));
+			buffer.copy_channel_raw_to(channel_index, to_span(dst).sub(begin));
+		}
+	}
+	mw.store_32(0x900df00d);
+}
+
+void test_block_serializer_channel_filters() {
+	const int block_size = 16;
+	RandomPCG rng;
+
+	std::vector<VoxelBufferInternal> buffers;
+	generate_terrain_blocks(buffers, Box3i(Vector3i(0, -1, 0), Vector3i(4, 2, 4)), block_size);
+	for (VoxelBufferInternal &buffer : buffers) {
+		// Large areas of the same type, suited for run-length encoding
+		buffer.fill_area(3, Vector3i(0, 0, 0), Vector3i(block_size, block_size / 2, block_size),
+				VoxelBufferInternal::CHANNEL_TYPE);
+		buffer.fill_area(5, Vector3i(2, 0, 3), Vector3i(9, block_size, 12), VoxelBufferInternal::CHANNEL_TYPE);
+	}
+	{
+		// Noise, which no filter can help with
+		buffers.emplace_back();
+		VoxelBufferInternal &buffer = buffers.back();
+		buffer.create(Vector3iUtil::create(block_size));
+		buffer.set_channel_depth(VoxelBufferInternal::CHANNEL_DATA5, VoxelBufferInternal::DEPTH_64_BIT);
+		for (int z = 0; z < block_size; ++z) {
+			for (int x = 0; x < block_size; ++x) {
+				for (int y = 0; y < block_size; ++y) {
+					buffer.set_voxel(rng.rand() % 256, x, y, z, VoxelBufferInternal::CHANNEL_COLOR);
+					const uint64_t v = (uint64_t(rng.rand()) << 32) | rng.rand();
+					buffer.set_voxel(v, x, y, z, VoxelBufferInternal::CHANNEL_DATA5);
+				}
+			}
+		}
+	}
+	{
+		// Float SDF
+		buffers.emplace_back();
+		VoxelBufferInternal &buffer = buffers.back();
+		buffer.create(Vector3i(block_size, block_size + 3, block_size));
+		buffer.set_channel_depth(VoxelBufferInternal::CHANNEL_SDF, VoxelBufferInternal::DEPTH_32_BIT);
+		for (int z = 0; z < buffer.get_size().z; ++z) {
+			for (int x = 0; x < buffer.get_size().x; ++x) {
+				for (int y = 0; y < buffer.get_size().y; ++y) {
+					buffer.set_voxel_f(y - 0.1f * x - 0.3f * z - 4.f, x, y, z, VoxelBufferInternal::CHANNEL_SDF);
+				}
+			}
+		}
+	}
+
+	size_t v4_total_size = 0;
+	size_t v5_total_size = 0;
+
+	for (const VoxelBufferInternal &buffer : buffers) {
+		{
+			BlockSerializer::SerializeResult result = BlockSerializer::serialize(buffer);
+			ZN_TEST_ASSERT(result.success);
+			ZN_TEST_ASSERT(result.data[0] == BlockSerializer::BLOCK_FORMAT_VERSION);
+
+			VoxelBufferInternal deserialized_voxel_buffer;
+			ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(result.data), deserialized_voxel_buffer));
+			ZN_TEST_ASSERT(buffer.equals(deserialized_voxel_buffer));
+		}
+		{
+			BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(buffer);
+			ZN_TEST_ASSERT(result.success);
+			v5_total_size += result.data.size();
+
+			VoxelBufferInternal deserialized_voxel_buffer;
+			ZN_TEST_ASSERT(
+					BlockSerializer::decompress_and_deserialize(to_span_const(result.data), deserialized_voxel_buffer));
+			ZN_TEST_ASSERT(buffer.equals(deserialized_voxel_buffer));
+		}
+		{
+			// Data saved with version 4 must still load
+			std::vector<uint8_t> v4_data;
+			serialize_block_v4(buffer, v4_data);
+
+			VoxelBufferInternal deserialized_voxel_buffer;
+			ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(v4_data), deserialized_voxel_buffer));
+			ZN_TEST_ASSERT(buffer.equals(deserialized_voxel_buffer));
+
+			std::vector<uint8_t> compressed_v4_data;
+			ZN_TEST_ASSERT(CompressedData::compress(
+					to_span_const(v4_data), compressed_v4_data, CompressedData::COMPRESSION_LZ4));
+			v4_total_size += compressed_v4_data.size();
+		}
+	}
+
+	print_line(String("Blocks compressed with LZ4: {0} bytes with v4, {1} bytes with channel filters")
+					   .format(varray(int64_t(v4_total_size), int64_t(v5_total_size))));
+	ZN_TEST_ASSERT(v5_total_size < v4_total_size);
+}
+
 void test_region_file() {
 	const int block_size_po2 = 4;
 	const int block_size = 1 << block_size_po2;
@@ -1055,6 +1644,229 @@ void test_region_file() {
 	}
 }
 
+struct RegionFileTestHelper {
+	static const int block_size_po2 = 4;
+
+	// Makes blocks of varying size once compressed, like blocks getting edited
+	static void generate_block(VoxelBufferInternal &buffer, RandomPCG &rng) {
+		const int block_size = 1 << block_size_po2;
+		buffer.create(Vector3iUtil::create(block_size));
+		buffer.set_channel_depth(0, VoxelBufferInternal::DEPTH_16_BIT);
+		const unsigned int noisy_voxel_count = rng.rand() % Vector3iUtil::get_volume(buffer.get_size());
+		unsigned int i = 0;
+		for (int z = 0; z < buffer.get_size().z; ++z) {
+			for (int x = 0; x < buffer.get_size().x; ++x) {
+				for (int y = 0; y < buffer.get_size().y; ++y) {
+					if (i < noisy_voxel_count) {
+						buffer.set_voxel(rng.rand() % 256, x, y, z, 0);
+					}
+					++i;
+				}
+			}
+		}
+	}
+
+	static bool open(RegionFile &region_file, String path) {
+		RegionFormat region_format = region_file.get_format();
+		region_format.block_size_po2 = block_size_po2;
+		fill(region_format.channel_depths, VoxelBufferInternal::DEPTH_8_BIT);
+		region_format.channel_depths[0] = VoxelBufferInternal::DEPTH_16_BIT;
+		ZN_TEST_ASSERT_V(region_file.set_format(region_format), false);
+		return region_file.open(path, true) == OK;
+	}
+
+	static bool check_blocks(RegionFile &region_file, std::unordered_map<Vector3i, VoxelBufferInternal> &buffers) {
+		for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+			VoxelBufferInternal loaded_voxel_buffer;
+			if (region_file.load_block(it->first, loaded_voxel_buffer) != OK) {
+				return false;
+			}
+			if (!it->second.equals(loaded_voxel_buffer)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Re-saves the same few blocks with different sizes, so they keep moving around and leave free sectors
+	static void save_blocks_with_holes(RegionFile &region_file,
+			std::unordered_map<Vector3i, VoxelBufferInternal> &buffers, RandomPCG &rng, unsigned int count) {
+		for (unsigned int i = 0; i < count; ++i) {
+			const Vector3i pos(rng.rand() % 4, rng.rand() % 4, rng.rand() % 4);
+			VoxelBufferInternal voxel_buffer;
+			generate_block(voxel_buffer, rng);
+			ZN_TEST_ASSERT(region_file.save_block(pos, voxel_buffer) == OK);
+			buffers[pos] = std::move(voxel_buffer);
+		}
+	}
+};
+
+void test_region_file_free_sectors() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String region_file_path = test_dir.get_path().path_join("test_region_file_free_sectors.vxr");
+
+	RandomPCG rng;
+	std::unordered_map<Vector3i, VoxelBufferInternal> buffers;
+
+	unsigned int sector_count_before_compact = 0;
+	{
+		RegionFile region_file;
+		ZN_TEST_ASSERT(RegionFileTestHelper::open(region_file, region_file_path));
+		RegionFileTestHelper::save_blocks_with_holes(region_file, buffers, rng, 2000);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+
+		// Freed sectors must be reused, so the file can't have grown much larger than the blocks it contains
+		const unsigned int used_sector_count = region_file.get_sector_count() - region_file.get_free_sector_count();
+		ZN_TEST_ASSERT(region_file.get_sector_count() < 2 * used_sector_count);
+
+		sector_count_before_compact = region_file.get_sector_count();
+		ZN_TEST_ASSERT(region_file.close() == OK);
+	}
+	{
+		// Free sectors are kept when reopening
+		RegionFile region_file;
+		ZN_TEST_ASSERT(region_file.open(region_file_path, false) == OK);
+		ZN_TEST_ASSERT(region_file.get_sector_count() == sector_count_before_compact);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+
+		const unsigned int used_sector_count = region_file.get_sector_count() - region_file.get_free_sector_count();
+		ZN_TEST_ASSERT(region_file.compact() == OK);
+		ZN_TEST_ASSERT(region_file.is_open());
+		ZN_TEST_ASSERT(region_file.get_free_sector_count() == 0);
+		ZN_TEST_ASSERT(region_file.get_sector_count() == used_sector_count);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+
+		// Still usable after compaction
+		VoxelBufferInternal voxel_buffer;
+		RegionFileTestHelper::generate_block(voxel_buffer, rng);
+		ZN_TEST_ASSERT(region_file.save_block(Vector3i(5, 5, 5), voxel_buffer) == OK);
+		buffers[Vector3i(5, 5, 5)] = std::move(voxel_buffer);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+	}
+}
+
+void test_region_file_migration_from_v3() {
+	// Version 3 did not store free sectors. They must be computed when opening such files, and the file must remain
+	// readable after being migrated to the current version.
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String region_file_path = test_dir.get_path().path_join("test_region_file_migration_from_v3.vxr");
+
+	RandomPCG rng;
+	std::unordered_map<Vector3i, VoxelBufferInternal> buffers;
+
+	unsigned int used_sector_count = 0;
+	unsigned int sector_count = 0;
+	unsigned int sector_size = 0;
+	unsigned int v3_header_size = 0;
+	{
+		RegionFile region_file;
+		ZN_TEST_ASSERT(RegionFileTestHelper::open(region_file, region_file_path));
+		RegionFileTestHelper::save_blocks_with_holes(region_file, buffers, rng, 500);
+		ZN_TEST_ASSERT(region_file.get_free_sector_count() > 0);
+
+		sector_count = region_file.get_sector_count();
+		used_sector_count = sector_count - region_file.get_free_sector_count();
+
+		const RegionFormat &format = region_file.get_format();
+		ZN_TEST_ASSERT(!format.has_palette);
+		sector_size = format.sector_size;
+		// Magic, version, block size, region size, channel depths, sector size, palette flag, block infos
+		v3_header_size = 4 + 1 + 1 + 3 + RegionFormat::CHANNEL_COUNT + 2 + 1 +
+				Vector3iUtil::get_volume(format.region_size) * sizeof(RegionBlockInfo);
+		ZN_TEST_ASSERT(region_file.close() == OK);
+	}
+	{
+		// Turn the file into version 3, which has the same header without sector count and free extent count, and has
+		// nothing after the last sector
+		std::vector<uint8_t> data;
+		{
+			Error err;
+			Ref<FileAccess> f = open_file(region_file_path, FileAccess::READ, err);
+			ZN_TEST_ASSERT(f.is_valid());
+			data.resize(f->get_length());
+			ZN_TEST_ASSERT(get_buffer(**f, to_span(data)) == data.size());
+		}
+		const unsigned int v4_header_size = v3_header_size + 4 + 4;
+		const unsigned int sectors_size = sector_count * sector_size;
+		ZN_TEST_ASSERT(data.size() >= v4_header_size + sectors_size);
+		ZN_TEST_ASSERT(data[4] == 4);
+
+		std::vector<uint8_t> v3_data;
+		v3_data.insert(v3_data.end(), data.begin(), data.begin() + v3_header_size);
+		v3_data.insert(v3_data.end(), data.begin() + v4_header_size, data.begin() + v4_header_size + sectors_size);
+		v3_data[4] = 3;
+		{
+			Error err;
+			Ref<FileAccess> f = open_file(region_file_path, FileAccess::WRITE, err);
+			ZN_TEST_ASSERT(f.is_valid());
+			store_buffer(**f, to_span(v3_data));
+		}
+	}
+	{
+		RegionFile region_file;
+		ZN_TEST_ASSERT(region_file.open(region_file_path, false) == OK);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+
+		// Free sectors were rebuilt from blocks. Trailing free sectors are not counted anymore.
+		ZN_TEST_ASSERT(region_file.get_sector_count() <= sector_count);
+		ZN_TEST_ASSERT(region_file.get_sector_count() - region_file.get_free_sector_count() == used_sector_count);
+
+		// Writing migrates the file
+		RegionFileTestHelper::save_blocks_with_holes(region_file, buffers, rng, 100);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+
+		sector_count = region_file.get_sector_count();
+		used_sector_count = sector_count - region_file.get_free_sector_count();
+		ZN_TEST_ASSERT(region_file.close() == OK);
+	}
+	{
+		// Free sectors were saved
+		RegionFile region_file;
+		ZN_TEST_ASSERT(region_file.open(region_file_path, false) == OK);
+		ZN_TEST_ASSERT(region_file.get_sector_count() == sector_count);
+		ZN_TEST_ASSERT(region_file.get_sector_count() - region_file.get_free_sector_count() == used_sector_count);
+		ZN_TEST_ASSERT(RegionFileTestHelper::check_blocks(region_file, buffers));
+	}
+}
+
+void test_region_file_resave_benchmark() {
+	// Re-saving blocks with a different size used to shift the rest of the file, which got slow with large files
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String region_file_path = test_dir.get_path().path_join("test_region_file_resave_benchmark.vxr");
+
+	RegionFile region_file;
+	ZN_TEST_ASSERT(RegionFileTestHelper::open(region_file, region_file_path));
+	const Vector3i region_size = region_file.get_format().region_size;
+
+	// Pre-generate blocks so the benchmark only measures file operations and serialization
+	RandomPCG rng;
+	std::vector<VoxelBufferInternal> buffers;
+	buffers.resize(64);
+	for (VoxelBufferInternal &buffer : buffers) {
+		RegionFileTestHelper::generate_block(buffer, rng);
+	}
+
+	// Fill the region first
+	Box3i(Vector3i(), region_size).for_each_cell_zxy([&region_file, &buffers, &rng](Vector3i pos) {
+		ZN_TEST_ASSERT(region_file.save_block(pos, buffers[rng.rand() % buffers.size()]) == OK);
+	});
+
+	const unsigned int resave_count = 10'000;
+	const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+	for (unsigned int i = 0; i < resave_count; ++i) {
+		const Vector3i pos(rng.rand() % region_size.x, rng.rand() % region_size.y, rng.rand() % region_size.z);
+		ZN_TEST_ASSERT(region_file.save_block(pos, buffers[rng.rand() % buffers.size()]) == OK);
+	}
+	const uint64_t time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
+
+	print_line(String("Re-saved {0} blocks in {1} ms, {2} sectors, {3} free")
+					   .format(varray(resave_count, int64_t(time_spent / 1000), region_file.get_sector_count(),
+							   region_file.get_free_sector_count())));
+}
+
 // Test based on an issue from `I am the Carl` on Discord. It should only not crash or cause errors.
 void test_voxel_stream_region_files() {
 	const int block_size_po2 = 4;
@@ -1083,10 +1895,671 @@ void test_voxel_stream_region_files() {
 			}
 		}
 
-		// The position isn't a correct use because it's in voxels, not blocks, but it remains a case that should
-		// not cause errors or crash. The same blocks will simply get written to several times.
-		VoxelStream::VoxelQueryData q{ buffer, Vector3(cycle, 0, 0), 0, VoxelStream::RESULT_ERROR };
-		stream->save_voxel_block(q);
+		// The position isn't a correct use because it's in voxels, not blocks, but it remains a case that should
+		// not cause errors or crash. The same blocks will simply get written to several times.
+		VoxelStream::VoxelQueryData q{ buffer, Vector3(cycle, 0, 0), 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+	}
+}
+
+void test_region_file_memory_mapping() {
+	if (!MemoryMappedFile::is_supported()) {
+		return;
+	}
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String region_file_path = test_dir.get_path().path_join("test_region_file_memory_mapping.vxr");
+
+	RandomPCG rng;
+	std::unordered_map<Vector3i, VoxelBufferInternal> buffers;
+	{
+		RegionFile region_file;
+		ZN_TEST_ASSERT(RegionFileTestHelper::open(region_file, region_file_path));
+		for (unsigned int i = 0; i < 200; ++i) {
+			const Vector3i pos(rng.rand() % 8, rng.rand() % 8, rng.rand() % 8);
+			VoxelBufferInternal voxel_buffer;
+			RegionFileTestHelper::generate_block(voxel_buffer, rng);
+			ZN_TEST_ASSERT(region_file.save_block(pos, voxel_buffer) == OK);
+			buffers[pos] = std::move(voxel_buffer);
+		}
+	}
+	{
+		RegionFile region_file;
+		ZN_TEST_ASSERT(region_file.open_mapped(region_file_path) == OK);
+		ZN_TEST_ASSERT(region_file.is_mapped());
+		for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+			VoxelBufferInternal loaded_voxel_buffer;
+			ZN_TEST_ASSERT(region_file.load_block(it->first, loaded_voxel_buffer) == OK);
+			ZN_TEST_ASSERT(it->second.equals(loaded_voxel_buffer));
+		}
+		VoxelBufferInternal loaded_voxel_buffer;
+		ZN_TEST_ASSERT(region_file.load_block(Vector3i(15, 15, 15), loaded_voxel_buffer) == ERR_DOES_NOT_EXIST);
+		// Read-only
+		ZN_TEST_ASSERT(region_file.save_block(Vector3i(15, 15, 15), loaded_voxel_buffer) != OK);
+	}
+}
+
+void test_voxel_stream_region_files_memory_mapping() {
+	// Blocks must be up to date when loading them from a stream using mappings, even after saving them again
+	const int block_size_po2 = RegionFileTestHelper::block_size_po2;
+	const int block_size = 1 << block_size_po2;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	Ref<VoxelStreamRegionFiles> stream;
+	stream.instantiate();
+	stream->set_block_size_po2(block_size_po2);
+	stream->set_directory(test_dir.get_path());
+	stream->set_memory_mapping_enabled(true);
+
+	RandomPCG rng;
+	std::unordered_map<Vector3i, VoxelBufferInternal> buffers;
+
+	for (unsigned int cycle = 0; cycle < 4; ++cycle) {
+		for (unsigned int i = 0; i < 100; ++i) {
+			// Spread over a few regions
+			const Vector3i bpos(rng.rand() % 40, rng.rand() % 4, rng.rand() % 40);
+			VoxelBufferInternal voxel_buffer;
+			RegionFileTestHelper::generate_block(voxel_buffer, rng);
+			VoxelStream::VoxelQueryData q{ voxel_buffer, bpos * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->save_voxel_block(q);
+			buffers[bpos] = std::move(voxel_buffer);
+		}
+
+		// Set the directory again, so regions get closed and can be mapped
+		if (cycle % 2 == 1) {
+			stream->set_directory("");
+			stream->set_directory(test_dir.get_path());
+		}
+
+		for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+			VoxelBufferInternal loaded_voxel_buffer;
+			loaded_voxel_buffer.create(Vector3iUtil::create(block_size));
+			VoxelStream::VoxelQueryData q{ loaded_voxel_buffer, it->first * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->load_voxel_block(q);
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(it->second.equals(loaded_voxel_buffer));
+		}
+	}
+}
+
+void test_voxel_stream_region_files_compact() {
+	const int block_size_po2 = RegionFileTestHelper::block_size_po2;
+	const int block_size = 1 << block_size_po2;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	Ref<VoxelStreamRegionFiles> stream;
+	stream.instantiate();
+	stream->set_block_size_po2(block_size_po2);
+	stream->set_directory(test_dir.get_path());
+
+	// Nothing saved yet
+	ZN_TEST_ASSERT(stream->compact() == 0);
+
+	RandomPCG rng;
+	std::unordered_map<Vector3i, VoxelBufferInternal> buffers;
+
+	// Re-save blocks in two regions, so they leave free sectors
+	const Vector3i region_size = stream->get_region_size();
+	for (unsigned int i = 0; i < 500; ++i) {
+		const Vector3i bpos(rng.rand() % 4 + (rng.rand() % 2) * region_size.x, rng.rand() % 4, rng.rand() % 4);
+		VoxelBufferInternal voxel_buffer;
+		RegionFileTestHelper::generate_block(voxel_buffer, rng);
+		VoxelStream::VoxelQueryData q{ voxel_buffer, bpos * block_size, 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+		buffers[bpos] = std::move(voxel_buffer);
+	}
+
+	// Regions are still open in the stream while they get compacted
+	ZN_TEST_ASSERT(stream->compact() == 2);
+
+	for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+		VoxelBufferInternal loaded_voxel_buffer;
+		loaded_voxel_buffer.create(Vector3iUtil::create(block_size));
+		VoxelStream::VoxelQueryData q{ loaded_voxel_buffer, it->first * block_size, 0, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(it->second.equals(loaded_voxel_buffer));
+	}
+
+	// Close regions
+	stream->set_directory("");
+
+	for (unsigned int rx = 0; rx < 2; ++rx) {
+		const String region_file_path = test_dir.get_path().path_join(
+				String("regions/lod0/r.{0}.0.0.{1}").format(varray(rx, RegionFormat::FILE_EXTENSION)));
+		RegionFile region_file;
+		ZN_TEST_ASSERT(region_file.open(region_file_path, false) == OK);
+		ZN_TEST_ASSERT(region_file.get_free_sector_count() == 0);
+	}
+}
+
+void test_voxel_stream_region_files_multithreaded_benchmark() {
+	// Loads blocks spread over several regions from multiple threads. Threads loading from different regions should
+	// not block each other. Loading all of them with one batch should find the same blocks.
+	const int block_size_po2 = RegionFileTestHelper::block_size_po2;
+	const int block_size = 1 << block_size_po2;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	Ref<VoxelStreamRegionFiles> stream;
+	stream.instantiate();
+	stream->set_block_size_po2(block_size_po2);
+	stream->set_directory(test_dir.get_path());
+
+	RandomPCG rng;
+	std::vector<Vector3i> positions;
+	std::vector<VoxelBufferInternal> buffers;
+
+	// 8 regions of 64 blocks
+	const Vector3i region_size = stream->get_region_size();
+	Box3i(Vector3i(), Vector3i(2, 2, 2)).for_each_cell_zxy([&](Vector3i rpos) {
+		Box3i(Vector3i(), Vector3i(4, 4, 4)).for_each_cell_zxy([&](Vector3i bpos) {
+			positions.push_back(rpos * region_size + bpos);
+		});
+	});
+	buffers.resize(positions.size());
+	for (unsigned int i = 0; i < positions.size(); ++i) {
+		RegionFileTestHelper::generate_block(buffers[i], rng);
+		VoxelStream::VoxelQueryData q{ buffers[i], positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+	}
+
+	class LoadTask : public IThreadedTask {
+	public:
+		VoxelStreamRegionFiles *stream;
+		Span<const Vector3i> positions;
+		Span<const VoxelBufferInternal> expected_buffers;
+		unsigned int first_index;
+		unsigned int step;
+		bool *r_success;
+
+		void run(ThreadedTaskContext ctx) override {
+			const int block_size = 1 << RegionFileTestHelper::block_size_po2;
+			for (unsigned int i = first_index; i < positions.size(); i += step) {
+				VoxelBufferInternal loaded_buffer;
+				loaded_buffer.create(Vector3iUtil::create(block_size));
+				VoxelStream::VoxelQueryData q{ loaded_buffer, positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+				stream->load_voxel_block(q);
+				if (q.result != VoxelStream::RESULT_BLOCK_FOUND || !expected_buffers[i].equals(loaded_buffer)) {
+					*r_success = false;
+				}
+			}
+		}
+	};
+
+	const unsigned int thread_counts[] = { 1, 2, 4, 8 };
+
+	for (const unsigned int thread_count : thread_counts) {
+		// Close regions so each run opens them again
+		stream->set_directory("");
+		stream->set_directory(test_dir.get_path());
+
+		FixedArray<bool, 8> success;
+		fill(success, true);
+
+		ThreadedTaskRunner runner;
+		runner.set_thread_count(thread_count);
+		runner.set_batch_count(1);
+		runner.set_name("Test");
+
+		const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+
+		for (unsigned int i = 0; i < thread_count; ++i) {
+			LoadTask *task = ZN_NEW(LoadTask);
+			task->stream = stream.ptr();
+			task->positions = to_span_const(positions);
+			task->expected_buffers = to_span_const(buffers);
+			task->first_index = i;
+			task->step = thread_count;
+			task->r_success = &success[i];
+			runner.enqueue(task, false);
+		}
+		runner.wait_for_all_tasks();
+
+		const uint64_t elapsed_usec = Time::get_singleton()->get_ticks_usec() - time_before;
+
+		runner.dequeue_completed_tasks([](IThreadedTask *task) { //
+			ZN_DELETE(task);
+		});
+
+		for (unsigned int i = 0; i < thread_count; ++i) {
+			ZN_TEST_ASSERT(success[i]);
+		}
+
+		print_line(String("{0} threads: loaded {1} blocks in {2} us")
+						   .format(varray(thread_count, int64_t(positions.size()), elapsed_usec)));
+	}
+
+	{
+		stream->set_directory("");
+		stream->set_directory(test_dir.get_path());
+
+		// Also query a block that doesn't exist
+		positions.push_back(Vector3i(-100, 0, 0));
+
+		std::vector<VoxelBufferInternal> loaded_buffers;
+		loaded_buffers.resize(positions.size());
+		std::vector<VoxelStream::VoxelQueryData> queries;
+		for (unsigned int i = 0; i < positions.size(); ++i) {
+			loaded_buffers[i].create(Vector3iUtil::create(block_size));
+			queries.push_back(VoxelStream::VoxelQueryData{
+					loaded_buffers[i], positions[i] * block_size, 0, VoxelStream::RESULT_ERROR });
+		}
+
+		const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+		stream->load_voxel_blocks(to_span(queries));
+		const uint64_t elapsed_usec = Time::get_singleton()->get_ticks_usec() - time_before;
+
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			ZN_TEST_ASSERT(queries[i].result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(buffers[i].equals(loaded_buffers[i]));
+		}
+		ZN_TEST_ASSERT(queries.back().result == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+
+		print_line(String("Batch: loaded {0} blocks in {1} us").format(varray(int64_t(buffers.size()), elapsed_usec)));
+	}
+}
+
+void test_voxel_stream_region_files_zstd_dictionary() {
+	// Blocks saved with a dictionary must be loadable by another stream opening the same directory
+	const int block_size_po2 = 4;
+	const int block_size = 1 << block_size_po2;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	std::vector<VoxelBufferInternal> buffers;
+	const Box3i blocks_box(Vector3i(0, -1, 0), Vector3i(4, 2, 4));
+	generate_terrain_blocks(buffers, blocks_box, block_size);
+	std::vector<Vector3i> positions;
+	blocks_box.for_each_cell_zxy([&positions](Vector3i bpos) { positions.push_back(bpos); });
+
+	{
+		Ref<VoxelStreamRegionFiles> stream;
+		stream.instantiate();
+		stream->set_block_size_po2(block_size_po2);
+		stream->set_directory(test_dir.get_path());
+		stream->set_block_compression(VoxelStream::BLOCK_COMPRESSION_ZSTD);
+
+		std::vector<const VoxelBufferInternal *> samples;
+		for (const VoxelBufferInternal &buffer : buffers) {
+			samples.push_back(&buffer);
+		}
+		ZN_TEST_ASSERT(stream->train_block_compression_dictionary(to_span_const(samples), 4096));
+		ZN_TEST_ASSERT(stream->has_block_compression_dictionary());
+		// Only one dictionary can be used
+		ZN_TEST_ASSERT(!stream->train_block_compression_dictionary(to_span_const(samples), 4096));
+
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelStream::VoxelQueryData q{ buffers[i], positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->save_voxel_block(q);
+		}
+	}
+	{
+		Ref<VoxelStreamRegionFiles> stream;
+		stream.instantiate();
+		stream->set_directory(test_dir.get_path());
+		ZN_TEST_ASSERT(stream->has_block_compression_dictionary());
+
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelBufferInternal loaded_buffer;
+			loaded_buffer.create(Vector3iUtil::create(block_size));
+			VoxelStream::VoxelQueryData q{ loaded_buffer, positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->load_voxel_block(q);
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(buffers[i].equals(loaded_buffer));
+		}
+	}
+}
+
+void test_voxel_stream_sqlite_write_cache() {
+	const int block_size = 16;
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String database_path = test_dir.get_path().path_join("test_write_cache.sqlite");
+
+	std::vector<VoxelBufferInternal> buffers;
+	const Box3i blocks_box(Vector3i(0, -1, 0), Vector3i(4, 2, 4));
+	generate_terrain_blocks(buffers, blocks_box, block_size);
+	std::vector<Vector3i> positions;
+	blocks_box.for_each_cell_zxy([&positions](Vector3i bpos) { positions.push_back(bpos); });
+
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		// Large enough so nothing gets written in the background during the test
+		stream->set_write_cache_budget_kb(65536);
+		stream->set_write_cache_flush_interval_ms(60000);
+		stream->set_database_path(database_path);
+
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelStream::VoxelQueryData q{ buffers[i], positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->save_voxel_block(q);
+		}
+		ZN_TEST_ASSERT(stream->get_write_cache_size_in_bytes() > 0);
+
+		// Blocks not written yet are loaded from the cache
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelBufferInternal loaded_buffer;
+			loaded_buffer.create(Vector3iUtil::create(block_size));
+			VoxelStream::VoxelQueryData q{ loaded_buffer, positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->load_voxel_block(q);
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(buffers[i].equals(loaded_buffer));
+		}
+
+		stream->flush_cache();
+		ZN_TEST_ASSERT(stream->get_write_cache_size_in_bytes() == 0);
+
+		// Overwrite one block, which only gets written when the stream is destroyed
+		buffers[0].fill_area(1, Vector3i(), Vector3i(4, 4, 4), VoxelBufferInternal::CHANNEL_TYPE);
+		VoxelStream::VoxelQueryData q{ buffers[0], positions[0] * block_size, 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+		ZN_TEST_ASSERT(stream->get_write_cache_size_in_bytes() > 0);
+	}
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelBufferInternal loaded_buffer;
+			loaded_buffer.create(Vector3iUtil::create(block_size));
+			VoxelStream::VoxelQueryData q{ loaded_buffer, positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->load_voxel_block(q);
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(buffers[i].equals(loaded_buffer));
+		}
+	}
+}
+
+void test_voxel_stream_sqlite_load_benchmark() {
+	// Loading many blocks with one call queries them in batches, which should be faster than one query per block.
+	// With Morton keys, batches of nearby blocks are loaded with range scans.
+	const int block_size = 16;
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	Ref<VoxelStreamSQLite> stream;
+	stream.instantiate();
+	stream->set_database_path(test_dir.get_path().path_join("test_load_benchmark.sqlite"));
+
+	// Few different blocks are needed, the benchmark measures queries
+	std::vector<VoxelBufferInternal> buffers;
+	generate_terrain_blocks(buffers, Box3i(Vector3i(0, -1, 0), Vector3i(4, 2, 4)), block_size);
+
+	// Ordered by areas of 4x4x4 blocks, like blocks around a viewer that get requested together
+	const Box3i blocks_box(Vector3i(-25, -10, -25), Vector3i(50, 20, 50));
+	std::vector<Vector3i> positions;
+	blocks_box.downscaled(4).for_each_cell_zxy([&positions, blocks_box](Vector3i area_pos) {
+		Box3i(area_pos * 4, Vector3i(4, 4, 4)).clipped(blocks_box).for_each_cell_zxy([&positions](Vector3i bpos) {
+			positions.push_back(bpos);
+		});
+	});
+	ZN_TEST_ASSERT(positions.size() == 50'000);
+
+	std::vector<VoxelStream::VoxelQueryData> queries;
+	for (unsigned int i = 0; i < positions.size(); ++i) {
+		queries.push_back(VoxelStream::VoxelQueryData{
+				buffers[i % buffers.size()], positions[i] * block_size, 0, VoxelStream::RESULT_ERROR });
+	}
+	stream->save_voxel_blocks(to_span(queries));
+	stream->flush_cache();
+
+	const unsigned int batch_size = 64;
+	std::vector<VoxelBufferInternal> loaded_buffers;
+	loaded_buffers.resize(batch_size);
+
+	// One query per block
+	uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+	for (unsigned int i = 0; i < positions.size(); ++i) {
+		VoxelBufferInternal &loaded_buffer = loaded_buffers[0];
+		loaded_buffer.create(Vector3iUtil::create(block_size));
+		VoxelStream::VoxelQueryData q{ loaded_buffer, positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+	}
+	const uint64_t single_time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
+
+	// Batches. Returns time spent in microseconds.
+	auto load_in_batches = [&]() {
+		const uint64_t batches_time_before = Time::get_singleton()->get_ticks_usec();
+		for (unsigned int batch_begin = 0; batch_begin < positions.size(); batch_begin += batch_size) {
+			const unsigned int count =
+					math::min(batch_size, static_cast<unsigned int>(positions.size()) - batch_begin);
+			queries.clear();
+			for (unsigned int i = 0; i < count; ++i) {
+				VoxelBufferInternal &loaded_buffer = loaded_buffers[i];
+				loaded_buffer.create(Vector3iUtil::create(block_size));
+				queries.push_back(VoxelStream::VoxelQueryData{
+						loaded_buffer, positions[batch_begin + i] * block_size, 0, VoxelStream::RESULT_ERROR });
+			}
+			stream->load_voxel_blocks(to_span(queries));
+			for (unsigned int i = 0; i < count; ++i) {
+				ZN_TEST_ASSERT(queries[i].result == VoxelStream::RESULT_BLOCK_FOUND);
+				ZN_TEST_ASSERT(loaded_buffers[i].equals(buffers[(batch_begin + i) % buffers.size()]));
+			}
+		}
+		return Time::get_singleton()->get_ticks_usec() - batches_time_before;
+	};
+
+	const uint64_t batch_time_spent = load_in_batches();
+
+	// Converts the database when the next connection opens
+	stream->set_morton_keys_enabled(true);
+	const uint64_t morton_batch_time_spent = load_in_batches();
+
+	print_line(String("Loaded {0} blocks from SQLite one by one in {1} ms, by batches of {2} in {3} ms, "
+					  "by batches with Morton keys in {4} ms")
+					   .format(varray(int64_t(positions.size()), int64_t(single_time_spent / 1000), batch_size,
+							   int64_t(batch_time_spent / 1000), int64_t(morton_batch_time_spent / 1000))));
+}
+
+void test_voxel_stream_sqlite_morton_keys() {
+	// Blocks saved in a database using the legacy key encoding must still be found after it is converted
+	const int block_size = 16;
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String database_path = test_dir.get_path().path_join("test_morton_keys.sqlite");
+
+	std::vector<VoxelBufferInternal> buffers;
+	const Box3i blocks_box(Vector3i(-3, -2, -3), Vector3i(6, 4, 6));
+	generate_terrain_blocks(buffers, blocks_box, block_size);
+	std::vector<Vector3i> positions;
+	blocks_box.for_each_cell_zxy([&positions](Vector3i bpos) { positions.push_back(bpos); });
+
+	// Blocks far from the others and at the limits of the supported range
+	const Vector3i far_positions[] = { Vector3i(-32768, 0, 32767), Vector3i(1000, -1000, 3) };
+	for (const Vector3i far_position : far_positions) {
+		buffers.emplace_back();
+		generate_terrain_block(buffers.back(), Vector3i(), block_size);
+		buffers.back().fill_area(1, Vector3i(), Vector3i(4, 4, 4), VoxelBufferInternal::CHANNEL_TYPE);
+		positions.push_back(far_position);
+	}
+
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelStream::VoxelQueryData q{ buffers[i], positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->save_voxel_block(q);
+		}
+	}
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_morton_keys_enabled(true);
+		stream->set_database_path(database_path);
+
+		// One by one
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			VoxelBufferInternal loaded_buffer;
+			loaded_buffer.create(Vector3iUtil::create(block_size));
+			VoxelStream::VoxelQueryData q{ loaded_buffer, positions[i] * block_size, 0, VoxelStream::RESULT_ERROR };
+			stream->load_voxel_block(q);
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(buffers[i].equals(loaded_buffer));
+		}
+
+		// All at once, with a block that doesn't exist
+		std::vector<VoxelBufferInternal> loaded_buffers;
+		loaded_buffers.resize(buffers.size() + 1);
+		std::vector<VoxelStream::VoxelQueryData> queries;
+		for (unsigned int i = 0; i < loaded_buffers.size(); ++i) {
+			loaded_buffers[i].create(Vector3iUtil::create(block_size));
+			const Vector3i bpos = i < positions.size() ? positions[i] : Vector3i(0, 10, 0);
+			queries.push_back(
+					VoxelStream::VoxelQueryData{ loaded_buffers[i], bpos * block_size, 0, VoxelStream::RESULT_ERROR });
+		}
+		stream->load_voxel_blocks(to_span(queries));
+		for (unsigned int i = 0; i < buffers.size(); ++i) {
+			ZN_TEST_ASSERT(queries[i].result == VoxelStream::RESULT_BLOCK_FOUND);
+			ZN_TEST_ASSERT(buffers[i].equals(loaded_buffers[i]));
+		}
+		ZN_TEST_ASSERT(queries.back().result == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+
+		VoxelStream::FullLoadingResult result;
+		stream->load_all_blocks(result);
+		ZN_TEST_ASSERT(result.blocks.size() == buffers.size());
+		for (const VoxelStream::FullLoadingResult::Block &block : result.blocks) {
+			const auto it = std::find(positions.begin(), positions.end(), block.position);
+			ZN_TEST_ASSERT(it != positions.end());
+			ZN_TEST_ASSERT(block.voxels != nullptr);
+			ZN_TEST_ASSERT(block.voxels->equals(buffers[it - positions.begin()]));
+		}
+	}
+}
+
+void test_voxel_terrain_prefetch_cache() {
+	const Box3i prefetch_box(Vector3i(0, 0, 0), Vector3i(8, 8, 8));
+	const std::vector<Box3i> prefetch_boxes{ prefetch_box };
+
+	struct L {
+		static VoxelTerrainPrefetchCache::Block make_block() {
+			VoxelTerrainPrefetchCache::Block block;
+			block.voxels = make_shared_instance<VoxelBufferInternal>();
+			block.voxels->create(Vector3i(4, 4, 4));
+			return block;
+		}
+	};
+
+	{
+		// Promotion of a block still being loaded
+		VoxelTerrainPrefetchCache cache;
+		cache.set_max_blocks(4);
+		const Vector3i bpos(1, 2, 3);
+		ZN_TEST_ASSERT(cache.can_request(bpos));
+		cache.add_request(bpos);
+		ZN_TEST_ASSERT(!cache.can_request(bpos));
+		ZN_TEST_ASSERT(cache.get_stats().requests == 1);
+
+		ZN_TEST_ASSERT(cache.promote(Vector3i(3, 2, 1)) == VoxelTerrainPrefetchCache::PROMOTE_NOT_FOUND);
+		ZN_TEST_ASSERT(cache.promote(bpos) == VoxelTerrainPrefetchCache::PROMOTE_IN_FLIGHT);
+		ZN_TEST_ASSERT(cache.get_stats().hits == 1);
+
+		// The response is applied directly when it arrives, it doesn't go to the cache
+		ZN_TEST_ASSERT(cache.complete_request(bpos));
+		ZN_TEST_ASSERT(!cache.complete_request(bpos));
+		ZN_TEST_ASSERT(cache.get_request_count() == 0);
+		ZN_TEST_ASSERT(cache.get_cached_count() == 0);
+	}
+	{
+		// Promotion of a cached block
+		VoxelTerrainPrefetchCache cache;
+		cache.set_max_blocks(4);
+		const Vector3i bpos(1, 2, 3);
+		cache.add_request(bpos);
+		ZN_TEST_ASSERT(cache.complete_request(bpos));
+		VoxelTerrainPrefetchCache::Block block = L::make_block();
+		const VoxelBufferInternal *voxels_ptr = block.voxels.get();
+		ZN_TEST_ASSERT(cache.store(bpos, std::move(block), to_span(prefetch_boxes)));
+		ZN_TEST_ASSERT(cache.get_cached_count() == 1);
+		ZN_TEST_ASSERT(!cache.can_request(bpos));
+
+		ZN_TEST_ASSERT(cache.promote(bpos) == VoxelTerrainPrefetchCache::PROMOTE_CACHED);
+		ZN_TEST_ASSERT(cache.get_stats().hits == 1);
+		VoxelTerrainPrefetchCache::Block taken_block;
+		ZN_TEST_ASSERT(cache.take(bpos, taken_block));
+		ZN_TEST_ASSERT(taken_block.voxels.get() == voxels_ptr);
+		ZN_TEST_ASSERT(!cache.take(bpos, taken_block));
+		ZN_TEST_ASSERT(cache.get_cached_count() == 0);
+	}
+	{
+		// Eviction when over the limit, furthest blocks first
+		VoxelTerrainPrefetchCache cache;
+		cache.set_max_blocks(6);
+		for (int x = 0; x < 6; ++x) {
+			const Vector3i bpos(x, 0, 0);
+			ZN_TEST_ASSERT(cache.can_request(bpos));
+			cache.add_request(bpos);
+		}
+		// Requests in flight count toward the limit
+		ZN_TEST_ASSERT(!cache.can_request(Vector3i(7, 0, 0)));
+		for (int x = 0; x < 6; ++x) {
+			const Vector3i bpos(x, 0, 0);
+			ZN_TEST_ASSERT(cache.complete_request(bpos));
+			ZN_TEST_ASSERT(cache.store(bpos, L::make_block(), to_span(prefetch_boxes)));
+		}
+		const std::vector<Vector3i> viewer_positions{ Vector3i(0, 0, 0) };
+		cache.trim(to_span(viewer_positions));
+		ZN_TEST_ASSERT(cache.get_cached_count() == 6);
+		ZN_TEST_ASSERT(cache.get_stats().evictions == 0);
+
+		cache.set_max_blocks(3);
+		cache.trim(to_span(viewer_positions));
+		ZN_TEST_ASSERT(cache.get_cached_count() == 3);
+		ZN_TEST_ASSERT(cache.get_stats().evictions == 3);
+		for (int x = 0; x < 3; ++x) {
+			ZN_TEST_ASSERT(cache.promote(Vector3i(x, 0, 0)) == VoxelTerrainPrefetchCache::PROMOTE_CACHED);
+		}
+		for (int x = 3; x < 6; ++x) {
+			ZN_TEST_ASSERT(cache.promote(Vector3i(x, 0, 0)) == VoxelTerrainPrefetchCache::PROMOTE_NOT_FOUND);
+		}
+	}
+	{
+		// Responses arriving after viewers went another way are dropped
+		VoxelTerrainPrefetchCache cache;
+		cache.set_max_blocks(4);
+		const Vector3i bpos(10, 0, 0);
+		cache.add_request(bpos);
+		ZN_TEST_ASSERT(cache.complete_request(bpos));
+		ZN_TEST_ASSERT(!cache.store(bpos, L::make_block(), to_span(prefetch_boxes)));
+		ZN_TEST_ASSERT(!cache.store(bpos, L::make_block(), Span<const Box3i>()));
+		ZN_TEST_ASSERT(cache.get_cached_count() == 0);
+		ZN_TEST_ASSERT(cache.promote(bpos) == VoxelTerrainPrefetchCache::PROMOTE_NOT_FOUND);
+	}
+	{
+		// Velocity extrapolation
+		const int block_size = 16;
+		const Box3i data_box = Box3i::from_center_extents(Vector3i(), Vector3i(4, 4, 4));
+		const Box3i bounds = Box3i::from_center_extents(Vector3i(), Vector3i(1000, 1000, 1000));
+		const unsigned int view_distance = 72;
+
+		// Too slow to enter other blocks
+		ZN_TEST_ASSERT(VoxelTerrainPrefetchCache::get_prefetch_box(
+							   data_box, Vector3(4, 0, 0), 1.f, view_distance, block_size, bounds)
+							   .is_empty());
+
+		const Box3i box = VoxelTerrainPrefetchCache::get_prefetch_box(
+				data_box, Vector3(0, 0, -40), 1.f, view_distance, block_size, bounds);
+		ZN_TEST_ASSERT(box == Box3i(data_box.pos + Vector3i(0, 0, -2), data_box.size));
+
+		// Capped at the view distance, 72 voxels is 4.5 blocks
+		const Box3i capped_box = VoxelTerrainPrefetchCache::get_prefetch_box(
+				data_box, Vector3(10000, 0, 0), 1.f, view_distance, block_size, bounds);
+		ZN_TEST_ASSERT(capped_box == Box3i(data_box.pos + Vector3i(4, 0, 0), data_box.size));
+
+		// Clipped to the bounds of the volume
+		const Box3i small_bounds(Vector3i(), Vector3i(6, 6, 6));
+		const Box3i clipped_box = VoxelTerrainPrefetchCache::get_prefetch_box(
+				data_box, Vector3(10000, 0, 0), 1.f, view_distance, block_size, small_bounds);
+		ZN_TEST_ASSERT(small_bounds.contains(clipped_box));
 	}
 }
 
@@ -1800,6 +3273,409 @@ void test_threaded_task_runner_debug_names() {
 	print_line(s);
 }
 
+void test_threaded_task_runner_pickup_benchmark() {
+	// Enqueues a large amount of very short tasks with varying priorities, so the time it takes to drain the queue is
+	// dominated by task pickup.
+	static const unsigned int task_count = 100'000;
+
+	class BenchmarkTask : public IThreadedTask {
+	public:
+		std::atomic_uint32_t *counter;
+		TaskPriority priority;
+
+		BenchmarkTask(std::atomic_uint32_t *p_counter, TaskPriority p_priority) :
+				counter(p_counter), priority(p_priority) {}
+
+		void run(ThreadedTaskContext ctx) override {
+			++(*counter);
+		}
+
+		TaskPriority get_priority() override {
+			return priority;
+		}
+	};
+
+	const unsigned int thread_counts[] = { 1, 2, 4, 8 };
+
+	for (const unsigned int thread_count : thread_counts) {
+		std::atomic_uint32_t counter = { 0 };
+
+		std::vector<IThreadedTask *> tasks;
+		tasks.reserve(task_count);
+		for (unsigned int i = 0; i < task_count; ++i) {
+			// Scramble priorities so the order in which tasks are picked differs from the order they were queued
+			const uint32_t h = i * 2654435761u;
+			tasks.push_back(ZN_NEW(BenchmarkTask(&counter, TaskPriority(h, h >> 8, h >> 16, h >> 24))));
+		}
+
+		ThreadedTaskRunner runner;
+		runner.set_thread_count(thread_count);
+		runner.set_batch_count(1);
+		runner.set_name("Test");
+
+		const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+
+		runner.enqueue(to_span(tasks), false);
+		runner.wait_for_all_tasks();
+
+		const uint64_t elapsed_usec = Time::get_singleton()->get_ticks_usec() - time_before;
+
+		unsigned int completed_count = 0;
+		runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+			ZN_DELETE(task);
+			++completed_count;
+		});
+
+		ZN_TEST_ASSERT(completed_count == task_count);
+		ZN_TEST_ASSERT(counter == task_count);
+
+		print_line(String("{0} threads: ran {1} tasks in {2} us, {3} ns per task")
+						   .format(varray(thread_count, task_count, elapsed_usec,
+								   int64_t(elapsed_usec * 1000 / task_count))));
+	}
+}
+
+void test_threaded_task_runner_work_stealing() {
+	// Tasks spawning more tasks from inside the pool, which should go to local queues and get stolen by other threads
+	class SpawningTask : public IThreadedTask {
+	public:
+		ThreadedTaskRunner *runner;
+		std::atomic_uint32_t *counter;
+		unsigned int depth;
+
+		SpawningTask(ThreadedTaskRunner *p_runner, std::atomic_uint32_t *p_counter, unsigned int p_depth) :
+				runner(p_runner), counter(p_counter), depth(p_depth) {}
+
+		void run(ThreadedTaskContext ctx) override {
+			++(*counter);
+			if (depth > 0) {
+				FixedArray<IThreadedTask *, 2> children;
+				children[0] = ZN_NEW(SpawningTask(runner, counter, depth - 1));
+				children[1] = ZN_NEW(SpawningTask(runner, counter, depth - 1));
+				runner->enqueue(to_span(children), false);
+			}
+		}
+	};
+
+	const unsigned int root_count = 8;
+	const unsigned int depth = 10;
+	// Each root produces a full binary tree of tasks
+	const unsigned int expected_count = root_count * ((1 << (depth + 1)) - 1);
+
+	std::atomic_uint32_t counter = { 0 };
+
+	ThreadedTaskRunner runner;
+	runner.set_work_stealing_enabled(true);
+	runner.set_thread_count(4);
+	runner.set_batch_count(1);
+	runner.set_name("Test");
+
+	for (unsigned int i = 0; i < root_count; ++i) {
+		runner.enqueue(ZN_NEW(SpawningTask(&runner, &counter, depth)), false);
+	}
+
+	// Tasks keep getting added while running, so we can't just wait for all tasks right away
+	unsigned int completed_count = 0;
+	const uint64_t time_before = Time::get_singleton()->get_ticks_msec();
+	while (completed_count < expected_count && Time::get_singleton()->get_ticks_msec() - time_before < 10'000) {
+		runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+			ZN_DELETE(task);
+			++completed_count;
+		});
+		Thread::sleep_usec(1000);
+	}
+
+	runner.wait_for_all_tasks();
+	runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+		ZN_DELETE(task);
+		++completed_count;
+	});
+
+	ZN_TEST_ASSERT(completed_count == expected_count);
+	ZN_TEST_ASSERT(counter == expected_count);
+	ZN_TEST_ASSERT(runner.get_debug_remaining_tasks() == 0);
+}
+
+void test_threaded_task_runner_work_stealing_thread_count_change() {
+	// Tasks waiting in local queues of threads that get removed must still run on the remaining threads
+	class SleepingTask : public IThreadedTask {
+	public:
+		std::atomic_uint32_t *counter;
+
+		SleepingTask(std::atomic_uint32_t *p_counter) : counter(p_counter) {}
+
+		void run(ThreadedTaskContext ctx) override {
+			Thread::sleep_usec(1000);
+			++(*counter);
+		}
+	};
+
+	class SpawningTask : public IThreadedTask {
+	public:
+		ThreadedTaskRunner *runner;
+		std::atomic_uint32_t *counter;
+		unsigned int child_count;
+
+		SpawningTask(ThreadedTaskRunner *p_runner, std::atomic_uint32_t *p_counter, unsigned int p_child_count) :
+				runner(p_runner), counter(p_counter), child_count(p_child_count) {}
+
+		void run(ThreadedTaskContext ctx) override {
+			std::vector<IThreadedTask *> children;
+			for (unsigned int i = 0; i < child_count; ++i) {
+				children.push_back(ZN_NEW(SleepingTask(counter)));
+			}
+			// Goes to the local queue of the current thread
+			runner->enqueue(to_span(children), false);
+		}
+	};
+
+	const unsigned int root_count = 4;
+	const unsigned int child_count = 64;
+	const unsigned int expected_count = root_count * (child_count + 1);
+
+	std::atomic_uint32_t counter = { 0 };
+
+	ThreadedTaskRunner runner;
+	runner.set_work_stealing_enabled(true);
+	runner.set_thread_count(4);
+	runner.set_batch_count(1);
+	runner.set_name("Test");
+
+	for (unsigned int i = 0; i < root_count; ++i) {
+		runner.enqueue(ZN_NEW(SpawningTask(&runner, &counter, child_count)), false);
+	}
+
+	unsigned int completed_count = 0;
+	auto dequeue = [&runner, &completed_count]() {
+		runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+			ZN_DELETE(task);
+			++completed_count;
+		});
+	};
+
+	// Let roots spawn their children, then remove all threads while most of them are still in local queues
+	Thread::sleep_usec(5000);
+	runner.set_thread_count(0);
+	runner.set_thread_count(2);
+
+	// Not using `wait_for_all_tasks`, it would block forever if tasks got lost
+	const uint64_t time_before = Time::get_singleton()->get_ticks_msec();
+	while (completed_count < expected_count && Time::get_singleton()->get_ticks_msec() - time_before < 10'000) {
+		dequeue();
+		Thread::sleep_usec(1000);
+	}
+	dequeue();
+
+	ZN_TEST_ASSERT(completed_count == expected_count);
+	ZN_TEST_ASSERT(counter == root_count * child_count);
+	ZN_TEST_ASSERT(runner.get_debug_remaining_tasks() == 0);
+}
+
+void test_threaded_task_runner_serial_lanes() {
+	static const uint32_t task_duration_usec = 20'000;
+
+	struct LaneCounter {
+		std::atomic_uint32_t max_count = { 0 };
+		std::atomic_uint32_t current_count = { 0 };
+		std::atomic_uint32_t completed_count = { 0 };
+
+		void enter() {
+			const unsigned int current_count_after = ++current_count;
+			unsigned int prev_max = max_count;
+			while (prev_max < current_count_after && !max_count.compare_exchange_weak(prev_max, current_count_after)) {
+			}
+		}
+	};
+
+	class LaneTestTask : public IThreadedTask {
+	public:
+		LaneCounter *lane_counter;
+		LaneCounter *global_counter;
+		uint64_t lane;
+
+		LaneTestTask(LaneCounter *p_lane_counter, LaneCounter *p_global_counter, uint64_t p_lane) :
+				lane_counter(p_lane_counter), global_counter(p_global_counter), lane(p_lane) {}
+
+		void run(ThreadedTaskContext ctx) override {
+			lane_counter->enter();
+			global_counter->enter();
+			Thread::sleep_usec(task_duration_usec);
+			--global_counter->current_count;
+			--lane_counter->current_count;
+			++lane_counter->completed_count;
+		}
+
+		uint64_t get_serial_lane() const override {
+			return lane;
+		}
+	};
+
+	const unsigned int lane_count = 3;
+	const unsigned int tasks_per_lane = 8;
+
+	FixedArray<LaneCounter, lane_count> lane_counters;
+	LaneCounter global_counter;
+
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(4);
+	runner.set_batch_count(1);
+	runner.set_name("Test");
+
+	for (unsigned int i = 0; i < lane_count * tasks_per_lane; ++i) {
+		const unsigned int lane_index = i % lane_count;
+		runner.enqueue(ZN_NEW(LaneTestTask(&lane_counters[lane_index], &global_counter, lane_index + 1)), true);
+	}
+
+	runner.wait_for_all_tasks();
+
+	unsigned int completed_count = 0;
+	runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+		ZN_DELETE(task);
+		++completed_count;
+	});
+
+	ZN_TEST_ASSERT(completed_count == lane_count * tasks_per_lane);
+	for (unsigned int i = 0; i < lane_count; ++i) {
+		const LaneCounter &lane_counter = lane_counters[i];
+		// Tasks of the same lane never run at the same time
+		ZN_TEST_ASSERT(lane_counter.max_count == 1);
+		ZN_TEST_ASSERT(lane_counter.current_count == 0);
+		ZN_TEST_ASSERT(lane_counter.completed_count == tasks_per_lane);
+	}
+	// Tasks of different lanes can run at the same time
+	ZN_TEST_ASSERT(global_counter.max_count > 1);
+}
+
+void test_voxel_memory_pool_multithreaded_benchmark() {
+	// Allocates and recycles blocks of typical sizes from multiple threads. Some blocks are recycled by a different
+	// thread than the one that allocated them.
+	static const unsigned int iteration_count = 50'000;
+	static const unsigned int held_block_count = 8;
+
+	struct Allocation {
+		uint8_t *block;
+		size_t size;
+	};
+
+	class AllocateTask : public IThreadedTask {
+	public:
+		std::vector<Allocation> *remaining_allocations;
+		unsigned int seed;
+
+		AllocateTask(std::vector<Allocation> *p_remaining_allocations, unsigned int p_seed) :
+				remaining_allocations(p_remaining_allocations), seed(p_seed) {}
+
+		void run(ThreadedTaskContext ctx) override {
+			VoxelMemoryPool &pool = VoxelMemoryPool::get_singleton();
+			// Full 16-bit block, padded 8-bit block, small block, tiny allocation
+			const size_t sizes[] = { 32 * 32 * 32 * 2, 34 * 34 * 34, 16 * 16 * 16, 100 };
+			std::vector<Allocation> held;
+
+			for (unsigned int i = 0; i < iteration_count; ++i) {
+				const size_t size = sizes[(i * 7 + seed) % 4];
+				uint8_t *block = pool.allocate(size);
+				ZN_ASSERT(block != nullptr);
+				// Touch memory
+				block[0] = 1;
+				block[size - 1] = 2;
+				held.push_back(Allocation{ block, size });
+
+				if (held.size() > held_block_count) {
+					const unsigned int j = (i * 13) % held.size();
+					const Allocation a = held[j];
+					held[j] = held.back();
+					held.pop_back();
+					pool.recycle(a.block, a.size);
+				}
+			}
+
+			*remaining_allocations = std::move(held);
+		}
+	};
+
+	VoxelMemoryPool &pool = VoxelMemoryPool::get_singleton();
+	const unsigned int used_blocks_before = pool.debug_get_used_blocks();
+	const size_t used_memory_before = pool.debug_get_used_memory();
+
+	const unsigned int thread_counts[] = { 1, 2, 4 };
+
+	for (const unsigned int thread_count : thread_counts) {
+		std::vector<std::vector<Allocation>> remaining_allocations;
+		remaining_allocations.resize(thread_count);
+
+		ThreadedTaskRunner runner;
+		runner.set_thread_count(thread_count);
+		runner.set_batch_count(1);
+		runner.set_name("Test");
+
+		const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
+
+		for (unsigned int i = 0; i < thread_count; ++i) {
+			runner.enqueue(ZN_NEW(AllocateTask(&remaining_allocations[i], i)), false);
+		}
+		runner.wait_for_all_tasks();
+
+		const uint64_t elapsed_usec = Time::get_singleton()->get_ticks_usec() - time_before;
+
+		runner.dequeue_completed_tasks([](IThreadedTask *task) { //
+			ZN_DELETE(task);
+		});
+
+		// Recycle what's left from the main thread
+		for (const std::vector<Allocation> &allocations : remaining_allocations) {
+			for (const Allocation &a : allocations) {
+				pool.recycle(a.block, a.size);
+			}
+		}
+
+		ZN_TEST_ASSERT(pool.debug_get_used_blocks() == used_blocks_before);
+		ZN_TEST_ASSERT(pool.debug_get_used_memory() == used_memory_before);
+
+		print_line(String("{0} threads: {1} allocations per thread in {2} us")
+						   .format(varray(thread_count, iteration_count, elapsed_usec)));
+	}
+}
+
+void test_voxel_memory_pool_budget() {
+	VoxelMemoryPool &pool = VoxelMemoryPool::get_singleton();
+	const VoxelMemoryPool::Stats stats_before = pool.get_stats();
+	pool.set_memory_budget(0);
+
+	// Padded 8-bit buffer of a 32x32x32 block, as used by Transvoxel
+	const size_t size = 35 * 35 * 35;
+	std::vector<uint8_t *> blocks;
+	for (unsigned int i = 0; i < 64; ++i) {
+		uint8_t *block = pool.allocate(size);
+		ZN_TEST_ASSERT(block != nullptr);
+		blocks.push_back(block);
+	}
+	{
+		// Not rounded up to a power of two
+		const VoxelMemoryPool::Stats stats = pool.get_stats();
+		ZN_TEST_ASSERT(stats.used_memory - stats_before.used_memory == size * blocks.size());
+	}
+
+	for (uint8_t *block : blocks) {
+		pool.recycle(block, size);
+	}
+	{
+		// Without budget, unused blocks are kept
+		const VoxelMemoryPool::Stats stats = pool.get_stats();
+		ZN_TEST_ASSERT(stats.used_memory == stats_before.used_memory);
+		ZN_TEST_ASSERT(stats.total_memory - stats.used_memory >= size * blocks.size());
+	}
+
+	pool.set_memory_budget(1);
+	pool.trim();
+	{
+		// Blocks cached by the current thread remain, the others must have been freed
+		const VoxelMemoryPool::Stats stats = pool.get_stats();
+		ZN_TEST_ASSERT(stats.used_memory == stats_before.used_memory);
+		ZN_TEST_ASSERT(stats.trimmed_memory - stats_before.trimmed_memory >= size * (blocks.size() - 16));
+	}
+	pool.set_memory_budget(stats_before.memory_budget);
+}
+
 void test_task_priority_values() {
 	ZN_TEST_ASSERT(TaskPriority(0, 0, 0, 0) < TaskPriority(1, 0, 0, 0));
 	ZN_TEST_ASSERT(TaskPriority(0, 0, 0, 0) < TaskPriority(0, 0, 0, 1));
@@ -1871,6 +3747,236 @@ void test_slot_map() {
 	ZN_TEST_ASSERT(map.count() == 0);
 }
 
+void test_block_hash_map() {
+	BlockHashMap<int> map;
+	// Reference
+	std::unordered_map<Vector3i, int> expected;
+
+	struct L {
+		static bool check(const BlockHashMap<int> &map, const std::unordered_map<Vector3i, int> &expected) {
+			if (map.size() != expected.size()) {
+				return false;
+			}
+			for (auto it = expected.begin(); it != expected.end(); ++it) {
+				const int *v = map.find(it->first);
+				if (v == nullptr || *v != it->second) {
+					return false;
+				}
+			}
+			size_t count = 0;
+			map.for_each([&count](Vector3i key, const int &value) { ++count; });
+			return count == expected.size();
+		}
+	};
+
+	// Insert and remove positions from a small area, so probe sequences overlap a lot
+	uint32_t rng = 1;
+	for (unsigned int i = 0; i < 20'000; ++i) {
+		rng = rng * 1664525u + 1013904223u;
+		const Vector3i pos(int(rng >> 8) % 24 - 12, int(rng >> 16) % 8 - 4, int(rng >> 24) % 24 - 12);
+		if ((rng & 3) != 0) {
+			map.get_or_insert(pos) = i;
+			expected[pos] = i;
+		} else {
+			ZN_TEST_ASSERT(map.erase(pos) == (expected.erase(pos) == 1));
+		}
+	}
+	ZN_TEST_ASSERT(L::check(map, expected));
+
+	// Pointers to values must remain valid while other items are inserted or removed
+	int *value_ptr = &map.get_or_insert(Vector3i(1000, 1000, 1000));
+	*value_ptr = 42;
+	for (int i = 0; i < 10'000; ++i) {
+		map.get_or_insert(Vector3i(i, -i, 2000)) = i;
+	}
+	for (int i = 0; i < 10'000; i += 2) {
+		map.erase(Vector3i(i, -i, 2000));
+	}
+	ZN_TEST_ASSERT(map.find(Vector3i(1000, 1000, 1000)) == value_ptr);
+	ZN_TEST_ASSERT(*value_ptr == 42);
+
+	map.clear();
+	ZN_TEST_ASSERT(map.size() == 0);
+	ZN_TEST_ASSERT(map.find(Vector3i(1000, 1000, 1000)) == nullptr);
+	map.for_each([](Vector3i key, int &value) { ZN_TEST_ASSERT(false); });
+}
+
+void test_block_hash_map_benchmark() {
+	// Compares the map used for voxel blocks with `std::unordered_map`, at a scale of large view distances
+	static const int area_size = 100;
+	static const unsigned int block_count = area_size * area_size * area_size;
+
+	std::vector<Vector3i> positions;
+	positions.reserve(block_count);
+	Box3i(Vector3i(-area_size / 2, -area_size / 2, -area_size / 2), Vector3iUtil::create(area_size))
+			.for_each_cell_zxy([&positions](Vector3i pos) { positions.push_back(pos); });
+	// Scramble the order, like blocks getting loaded and unloaded around a moving viewer
+	uint32_t rng = 1;
+	for (size_t i = positions.size() - 1; i > 0; --i) {
+		rng = rng * 1664525u + 1013904223u;
+		std::swap(positions[i], positions[rng % (i + 1)]);
+	}
+
+	struct Timings {
+		uint64_t insert_usec;
+		uint64_t find_usec;
+		uint64_t find_missing_usec;
+		uint64_t erase_usec;
+	};
+
+	struct L {
+		static uint64_t get_time_usec() {
+			return Time::get_singleton()->get_ticks_usec();
+		}
+
+		static void print_timings(const char *name, const Timings &t) {
+			print_line(String("{0}: insert {1} ns, find {2} ns, find missing {3} ns, erase {4} ns")
+							   .format(varray(name, int64_t(t.insert_usec * 1000 / block_count),
+									   int64_t(t.find_usec * 1000 / block_count),
+									   int64_t(t.find_missing_usec * 1000 / block_count),
+									   int64_t(t.erase_usec * 1000 / block_count))));
+		}
+	};
+
+	const Vector3i missing_offset(0, area_size, 0);
+
+	{
+		BlockHashMap<VoxelDataBlock> map;
+		Timings t;
+
+		uint64_t time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			map.get_or_insert(pos) = VoxelDataBlock(0);
+		}
+		t.insert_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(map.size() == block_count);
+
+		unsigned int found_count = 0;
+		time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			found_count += (map.find(pos) != nullptr);
+		}
+		t.find_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(found_count == block_count);
+
+		found_count = 0;
+		time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			found_count += (map.find(pos + missing_offset) != nullptr);
+		}
+		t.find_missing_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(found_count == 0);
+
+		time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			map.erase(pos);
+		}
+		t.erase_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(map.size() == 0);
+
+		L::print_timings("BlockHashMap", t);
+	}
+	{
+		std::unordered_map<Vector3i, VoxelDataBlock> map;
+		Timings t;
+
+		uint64_t time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			map[pos] = VoxelDataBlock(0);
+		}
+		t.insert_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(map.size() == block_count);
+
+		unsigned int found_count = 0;
+		time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			found_count += (map.find(pos) != map.end());
+		}
+		t.find_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(found_count == block_count);
+
+		found_count = 0;
+		time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			found_count += (map.find(pos + missing_offset) != map.end());
+		}
+		t.find_missing_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(found_count == 0);
+
+		time_before = L::get_time_usec();
+		for (const Vector3i pos : positions) {
+			map.erase(pos);
+		}
+		t.erase_usec = L::get_time_usec() - time_before;
+		ZN_TEST_ASSERT(map.size() == 0);
+
+		L::print_timings("std::unordered_map", t);
+	}
+}
+
+void test_voxel_data_map_window() {
+	VoxelDataMap map;
+	map.create(0);
+	// Reference
+	std::unordered_map<Vector3i, const VoxelDataBlock *> expected;
+
+	struct L {
+		static bool check(const VoxelDataMap &map, const std::unordered_map<Vector3i, const VoxelDataBlock *> &expected,
+				Box3i area) {
+			return area.all_cells_match([&map, &expected](Vector3i bpos) {
+				auto it = expected.find(bpos);
+				const VoxelDataBlock *block = map.get_block(bpos);
+				if (it == expected.end()) {
+					return block == nullptr && !map.has_block(bpos);
+				}
+				return block == it->second && map.has_block(bpos);
+			});
+		}
+	};
+
+	const Box3i area(Vector3i(-20, -20, -20), Vector3i(40, 40, 40));
+
+	// Sizes are not powers of two, so the grid is larger than the window
+	map.set_window(Box3i::from_center_extents(Vector3i(), Vector3i(5, 3, 5)));
+	ZN_TEST_ASSERT(map.get_window() == Box3i::from_center_extents(Vector3i(), Vector3i(5, 3, 5)));
+
+	uint32_t rng = 1;
+	Vector3i window_center;
+	for (unsigned int i = 0; i < 20'000; ++i) {
+		rng = rng * 1664525u + 1013904223u;
+		const Vector3i bpos(int(rng >> 8) % 40 - 20, int(rng >> 16) % 40 - 20, int(rng >> 24) % 40 - 20);
+		if ((rng & 3) != 0) {
+			expected[bpos] = map.set_empty_block(bpos, false);
+		} else {
+			map.remove_block(bpos, VoxelDataMap::NoAction());
+			expected.erase(bpos);
+		}
+
+		if ((i % 500) == 0) {
+			// Move the window like a viewer would, including jumps across more than its size
+			window_center += Vector3i(int(rng % 3) - 1, int((rng >> 4) % 3) - 1, int((rng >> 8) % 3) - 1);
+			if ((i % 5000) == 0) {
+				window_center = Vector3i(int(rng % 20) - 10, 0, int((rng >> 8) % 20) - 10);
+			}
+			map.set_window(Box3i::from_center_extents(window_center, Vector3i(5, 3, 5)));
+			ZN_TEST_ASSERT(L::check(map, expected, area));
+		}
+	}
+	ZN_TEST_ASSERT(L::check(map, expected, area));
+
+	// Changing the size of the window rebuilds it
+	map.set_window(Box3i::from_center_extents(window_center, Vector3i(9, 9, 9)));
+	ZN_TEST_ASSERT(L::check(map, expected, area));
+
+	map.clear_window();
+	ZN_TEST_ASSERT(L::check(map, expected, area));
+
+	map.set_window(Box3i::from_center_extents(window_center, Vector3i(6, 6, 6)));
+	map.clear();
+	expected.clear();
+	ZN_TEST_ASSERT(L::check(map, expected, area));
+}
+
 void test_box_blur() {
 	VoxelBufferInternal voxels;
 	voxels.create(64, 64, 64);
@@ -1955,6 +4061,12 @@ void run_voxel_tests() {
 	VOXEL_TEST(test_voxel_graph_unused_single_texture_output);
 	VOXEL_TEST(test_voxel_graph_spots2d_optimized_execution_map);
 	VOXEL_TEST(test_voxel_graph_unused_inner_output);
+	VOXEL_TEST(test_voxel_graph_node_kernels);
+	VOXEL_TEST(test_voxel_graph_node_kernels_benchmark);
+	VOXEL_TEST(test_voxel_graph_fused_operations);
+	VOXEL_TEST(test_voxel_graph_xz_caching);
+	VOXEL_TEST(test_voxel_graph_column_cache);
+	VOXEL_TEST(test_voxel_graph_buffer_data_sharing);
 	VOXEL_TEST(test_island_finder);
 	VOXEL_TEST(test_unordered_remove_if);
 	VOXEL_TEST(test_instance_data_serialization);
@@ -1963,10 +4075,28 @@ void run_voxel_tests() {
 	VOXEL_TEST(test_octree_find_in_box);
 	VOXEL_TEST(test_get_curve_monotonic_sections);
 	VOXEL_TEST(test_voxel_buffer_create);
+	VOXEL_TEST(test_voxel_buffer_palette_compression);
+	VOXEL_TEST(test_voxel_buffer_brick_compression);
+	VOXEL_TEST(test_voxel_buffer_sdf_quantization);
 	VOXEL_TEST(test_block_serializer);
 	VOXEL_TEST(test_block_serializer_stream_peer);
+	VOXEL_TEST(test_block_serializer_zstd);
+	VOXEL_TEST(test_block_serializer_zstd_benchmark);
+	VOXEL_TEST(test_block_serializer_channel_filters);
 	VOXEL_TEST(test_region_file);
+	VOXEL_TEST(test_region_file_free_sectors);
+	VOXEL_TEST(test_region_file_migration_from_v3);
+	VOXEL_TEST(test_region_file_resave_benchmark);
 	VOXEL_TEST(test_voxel_stream_region_files);
+	VOXEL_TEST(test_region_file_memory_mapping);
+	VOXEL_TEST(test_voxel_stream_region_files_memory_mapping);
+	VOXEL_TEST(test_voxel_stream_region_files_compact);
+	VOXEL_TEST(test_voxel_stream_region_files_multithreaded_benchmark);
+	VOXEL_TEST(test_voxel_stream_region_files_zstd_dictionary);
+	VOXEL_TEST(test_voxel_stream_sqlite_write_cache);
+	VOXEL_TEST(test_voxel_stream_sqlite_load_benchmark);
+	VOXEL_TEST(test_voxel_stream_sqlite_morton_keys);
+	VOXEL_TEST(test_voxel_terrain_prefetch_cache);
 #ifdef VOXEL_ENABLE_FAST_NOISE_2
 	VOXEL_TEST(test_fast_noise_2_basic);
 	VOXEL_TEST(test_fast_noise_2_empty_encoded_node_tree);
@@ -1979,11 +4109,20 @@ void run_voxel_tests() {
 	VOXEL_TEST(test_voxel_mesher_cubes);
 	VOXEL_TEST(test_threaded_task_runner_misc);
 	VOXEL_TEST(test_threaded_task_runner_debug_names);
+	VOXEL_TEST(test_threaded_task_runner_pickup_benchmark);
+	VOXEL_TEST(test_threaded_task_runner_work_stealing);
+	VOXEL_TEST(test_threaded_task_runner_work_stealing_thread_count_change);
+	VOXEL_TEST(test_threaded_task_runner_serial_lanes);
 	VOXEL_TEST(test_task_priority_values);
 	VOXEL_TEST(test_issue463);
 	VOXEL_TEST(test_normalmap_render_gpu);
 	VOXEL_TEST(test_slot_map);
+	VOXEL_TEST(test_block_hash_map);
+	VOXEL_TEST(test_block_hash_map_benchmark);
+	VOXEL_TEST(test_voxel_data_map_window);
 	VOXEL_TEST(test_box_blur);
+	VOXEL_TEST(test_voxel_memory_pool_multithreaded_benchmark);
+	VOXEL_TEST(test_voxel_memory_pool_budget);
 
 	print_line("------------ Voxel tests end -------------");
 }
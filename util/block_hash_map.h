@@ -0,0 +1,296 @@
+#ifndef ZN_BLOCK_HASH_MAP_H
+#define ZN_BLOCK_HASH_MAP_H
+
+#include "errors.h"
+#include "math/vector3i.h"
+#include "memory.h"
+#include "non_copyable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace zylann {
+
+// Associative container from 3D grid positions to values, made for sparse grids of chunks (aka blocks).
+//
+// Uses open addressing with linear probing into a flat array of small slots, so a lookup usually reads a single
+// cache line, instead of following a pointer to a node like `std::unordered_map`. Removing an item shifts the next
+// slots back instead of leaving a tombstone, so lookups don't get slower after many insertions and removals.
+//
+// Values are stored in separate pages that never move, so pointers to values remain valid when inserting or
+// removing other items. Memory is only allocated when the slot array or the value storage has to grow.
+//
+// Items must not be inserted or removed while iterating with `for_each`.
+template <typename T>
+class BlockHashMap : public NonCopyable {
+public:
+	BlockHashMap() {}
+
+	~BlockHashMap() {
+		clear();
+		for (T *page : _pages) {
+			ZN_FREE(page);
+		}
+	}
+
+	inline size_t size() const {
+		return _size;
+	}
+
+	T *find(Vector3i key) {
+		const uint32_t slot_index = find_slot(key);
+		if (slot_index == NOT_FOUND) {
+			return nullptr;
+		}
+		return &get_value(_slots[slot_index].value_index);
+	}
+
+	const T *find(Vector3i key) const {
+		const uint32_t slot_index = find_slot(key);
+		if (slot_index == NOT_FOUND) {
+			return nullptr;
+		}
+		return &get_value(_slots[slot_index].value_index);
+	}
+
+	inline bool has(Vector3i key) const {
+		return find_slot(key) != NOT_FOUND;
+	}
+
+	// Gets the value associated to the key. If there is none, inserts a default-constructed value first.
+	T &get_or_insert(Vector3i key) {
+		if ((_size + 1) * MAX_LOAD_DEN > _slots.size() * MAX_LOAD_NUM) {
+			rehash(_slots.size() == 0 ? MIN_CAPACITY : _slots.size() * 2);
+		}
+
+		uint32_t slot_index = get_home_slot(key);
+		while (true) {
+			Slot &slot = _slots[slot_index];
+			if (slot.is_empty()) {
+				break;
+			}
+			if (slot.has_key(key)) {
+				return get_value(slot.value_index);
+			}
+			slot_index = (slot_index + 1) & _slot_mask;
+		}
+
+		const uint32_t value_index = allocate_value();
+		Slot &slot = _slots[slot_index];
+		slot.x = key.x;
+		slot.y = key.y;
+		slot.z = key.z;
+		slot.value_index = value_index;
+		++_size;
+		return get_value(value_index);
+	}
+
+	// Returns true if an item was removed.
+	bool erase(Vector3i key) {
+		uint32_t slot_index = find_slot(key);
+		if (slot_index == NOT_FOUND) {
+			return false;
+		}
+
+		free_value(_slots[slot_index].value_index);
+		--_size;
+
+		// Backward-shift deletion: move back following items that would not be found anymore with a hole in front of
+		// them, until an empty slot or an item already at its home slot is found.
+		uint32_t next_index = (slot_index + 1) & _slot_mask;
+		while (true) {
+			const Slot &next_slot = _slots[next_index];
+			if (next_slot.is_empty()) {
+				break;
+			}
+			const uint32_t home_index = get_home_slot(next_slot.get_key());
+			// Distances are computed modulo the capacity because probing wraps around
+			const uint32_t distance_to_home = (next_index - home_index) & _slot_mask;
+			const uint32_t distance_to_hole = (next_index - slot_index) & _slot_mask;
+			if (distance_to_home >= distance_to_hole) {
+				_slots[slot_index] = next_slot;
+				slot_index = next_index;
+			}
+			next_index = (next_index + 1) & _slot_mask;
+		}
+
+		_slots[slot_index].value_index = EMPTY;
+		return true;
+	}
+
+	void clear() {
+		if (_size > 0) {
+			for (Slot &slot : _slots) {
+				if (!slot.is_empty()) {
+					get_value(slot.value_index).~T();
+					slot.value_index = EMPTY;
+				}
+			}
+		}
+		_size = 0;
+		// Pages are kept for later use
+		_free_values.clear();
+		_used_value_count = 0;
+	}
+
+	// Makes sure the given amount of items can be stored without growing the slot array.
+	void reserve(size_t count) {
+		size_t capacity = MIN_CAPACITY;
+		while (count * MAX_LOAD_DEN > capacity * MAX_LOAD_NUM) {
+			capacity *= 2;
+		}
+		if (capacity > _slots.size()) {
+			rehash(capacity);
+		}
+	}
+
+	// void op(Vector3i key, T &value)
+	template <typename F>
+	inline void for_each(F op) {
+		for (const Slot &slot : _slots) {
+			if (!slot.is_empty()) {
+				op(slot.get_key(), get_value(slot.value_index));
+			}
+		}
+	}
+
+	// void op(Vector3i key, const T &value)
+	template <typename F>
+	inline void for_each(F op) const {
+		for (const Slot &slot : _slots) {
+			if (!slot.is_empty()) {
+				op(slot.get_key(), get_value(slot.value_index));
+			}
+		}
+	}
+
+private:
+	static const uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+	static const uint32_t NOT_FOUND = std::numeric_limits<uint32_t>::max();
+	static const size_t MIN_CAPACITY = 16;
+	// Maximum load factor is 3/4. Linear probing degrades quickly above that.
+	static const size_t MAX_LOAD_NUM = 3;
+	static const size_t MAX_LOAD_DEN = 4;
+	static const unsigned int PAGE_SIZE_PO2 = 8;
+	static const uint32_t PAGE_SIZE = 1 << PAGE_SIZE_PO2;
+	static const uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+	static_assert(alignof(T) <= alignof(std::max_align_t), "Pages don't support over-aligned types");
+
+	// 16 bytes, so 4 slots fit in a cache line
+	struct Slot {
+		int32_t x;
+		int32_t y;
+		int32_t z;
+		// Index of the value in pages, or `EMPTY`
+		uint32_t value_index = EMPTY;
+
+		inline bool is_empty() const {
+			return value_index == EMPTY;
+		}
+
+		inline bool has_key(Vector3i key) const {
+			return x == key.x && y == key.y && z == key.z;
+		}
+
+		inline Vector3i get_key() const {
+			return Vector3i(x, y, z);
+		}
+	};
+
+	inline uint32_t get_home_slot(Vector3i key) const {
+		// Multiply-xorshift mixing. Block positions are often close to each other, so low bits alone would cluster.
+		uint64_t h = uint32_t(key.x);
+		h = (h * 0x9e3779b97f4a7c15ull) ^ uint32_t(key.y);
+		h = (h * 0xc2b2ae3d27d4eb4full) ^ uint32_t(key.z);
+		h *= 0x165667b19e3779f9ull;
+		return uint32_t(h >> 32) & _slot_mask;
+	}
+
+	uint32_t find_slot(Vector3i key) const {
+		if (_size == 0) {
+			return NOT_FOUND;
+		}
+		uint32_t slot_index = get_home_slot(key);
+		while (true) {
+			const Slot &slot = _slots[slot_index];
+			if (slot.is_empty()) {
+				return NOT_FOUND;
+			}
+			if (slot.has_key(key)) {
+				return slot_index;
+			}
+			slot_index = (slot_index + 1) & _slot_mask;
+		}
+	}
+
+	void rehash(size_t new_capacity) {
+		ZN_ASSERT(math::is_power_of_two(new_capacity));
+		ZN_ASSERT_RETURN(new_capacity <= std::numeric_limits<uint32_t>::max());
+		std::vector<Slot> old_slots;
+		old_slots.swap(_slots);
+		_slots.resize(new_capacity);
+		_slot_mask = new_capacity - 1;
+
+		// Values don't move, only slots do
+		for (const Slot &old_slot : old_slots) {
+			if (old_slot.is_empty()) {
+				continue;
+			}
+			uint32_t slot_index = get_home_slot(old_slot.get_key());
+			while (!_slots[slot_index].is_empty()) {
+				slot_index = (slot_index + 1) & _slot_mask;
+			}
+			_slots[slot_index] = old_slot;
+		}
+	}
+
+	inline T &get_value(uint32_t value_index) {
+		return _pages[value_index >> PAGE_SIZE_PO2][value_index & PAGE_MASK];
+	}
+
+	inline const T &get_value(uint32_t value_index) const {
+		return _pages[value_index >> PAGE_SIZE_PO2][value_index & PAGE_MASK];
+	}
+
+	uint32_t allocate_value() {
+		uint32_t value_index;
+		if (_free_values.size() > 0) {
+			value_index = _free_values.back();
+			_free_values.pop_back();
+		} else {
+			value_index = _used_value_count;
+			++_used_value_count;
+			if ((value_index >> PAGE_SIZE_PO2) == _pages.size()) {
+				T *page = static_cast<T *>(ZN_ALLOC(sizeof(T) * PAGE_SIZE));
+				ZN_ASSERT(page != nullptr);
+				_pages.push_back(page);
+			}
+		}
+		new (&get_value(value_index)) T();
+		return value_index;
+	}
+
+	void free_value(uint32_t value_index) {
+		get_value(value_index).~T();
+		_free_values.push_back(value_index);
+	}
+
+	std::vector<Slot> _slots;
+	uint32_t _slot_mask = 0;
+	size_t _size = 0;
+
+	// Fixed-size arrays of values. Unused values are not constructed.
+	std::vector<T *> _pages;
+	// Indices of values that were used and then removed, which can be reused before `_used_value_count`
+	std::vector<uint32_t> _free_values;
+	// Values at this index and above have never been used since the last clear
+	uint32_t _used_value_count = 0;
+};
+
+} // namespace zylann
+
+#endif // ZN_BLOCK_HASH_MAP_H
@@ -0,0 +1,70 @@
+#include "memory_mapped_file.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#define ZN_MEMORY_MAPPED_FILE_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zylann {
+
+MemoryMappedFile::~MemoryMappedFile() {
+	close();
+}
+
+bool MemoryMappedFile::open(const char *os_path) {
+	close();
+
+#ifdef ZN_MEMORY_MAPPED_FILE_POSIX
+	const int fd = ::open(os_path, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+		// Empty files can't be mapped
+		::close(fd);
+		return false;
+	}
+
+	const size_t size = file_stat.st_size;
+	void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping remains valid after closing the file descriptor, so we don't hold it
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	_data = static_cast<const uint8_t *>(data);
+	_size = size;
+	return true;
+
+#else
+	return false;
+#endif
+}
+
+void MemoryMappedFile::close() {
+	if (_data == nullptr) {
+		return;
+	}
+#ifdef ZN_MEMORY_MAPPED_FILE_POSIX
+	munmap(const_cast<uint8_t *>(_data), _size);
+#endif
+	_data = nullptr;
+	_size = 0;
+}
+
+bool MemoryMappedFile::is_supported() {
+#ifdef ZN_MEMORY_MAPPED_FILE_POSIX
+	return true;
+#else
+	return false;
+#endif
+}
+
+} // namespace zylann
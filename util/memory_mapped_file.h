@@ -0,0 +1,40 @@
+#ifndef ZN_MEMORY_MAPPED_FILE_H
+#define ZN_MEMORY_MAPPED_FILE_H
+
+#include "non_copyable.h"
+#include "span.h"
+
+#include <cstdint>
+
+namespace zylann {
+
+// Read-only view over the contents of a whole file, mapped in memory by the OS.
+// Reading it doesn't require system calls or copying into a buffer, and can be done from multiple threads at once.
+// Writes done to the file after it was mapped may or may not be visible, so it should not be modified while mapped.
+// Only supported on Linux and macOS for now. On other platforms, `open` always fails.
+class MemoryMappedFile : public NonCopyable {
+public:
+	~MemoryMappedFile();
+
+	// The path must be an absolute path of the OS filesystem, not a Godot path like `res://` or `user://`.
+	bool open(const char *os_path);
+	void close();
+
+	inline bool is_open() const {
+		return _data != nullptr;
+	}
+
+	inline Span<const uint8_t> get_data() const {
+		return Span<const uint8_t>(_data, _size);
+	}
+
+	static bool is_supported();
+
+private:
+	const uint8_t *_data = nullptr;
+	size_t _size = 0;
+};
+
+} // namespace zylann
+
+#endif // ZN_MEMORY_MAPPED_FILE_H
@@ -36,6 +36,13 @@ public:
 		return false;
 	}
 
+	// Only relevant for tasks scheduled as serial. Serial tasks returning the same lane run one after the other, but
+	// tasks of different lanes can run in parallel. This usually identifies the shared resource they need exclusive
+	// access to. Must not change after the task is scheduled.
+	virtual uint64_t get_serial_lane() const {
+		return 0;
+	}
+
 	// Gets the name of the task for debug purposes. The returned name's lifetime must span the execution of the engine
 	// (usually a string literal).
 	virtual const char *get_debug_name() const {
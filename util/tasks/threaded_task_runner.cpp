@@ -3,6 +3,9 @@
 #include "../profiling.h"
 #include "../string_funcs.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace zylann {
 
 // template <typename T>
@@ -15,15 +18,111 @@ namespace zylann {
 // 	return false;
 // }
 
+void ThreadedTaskRunner::TaskQueue::push(Span<IThreadedTask *> tasks, bool serial) {
+	const size_t dst_begin = _pending_items.size();
+	_pending_items.resize(_pending_items.size() + tasks.size());
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		TaskItem t;
+		t.task = tasks[i];
+		t.is_serial = serial;
+		_pending_items[dst_begin + i] = t;
+	}
+}
+
+void ThreadedTaskRunner::TaskQueue::update(
+		uint64_t now_ms, uint32_t priority_update_period_ms, std::vector<IThreadedTask *> &cancelled_tasks) {
+	if (now_ms - _last_priority_update_time_ms > priority_update_period_ms) {
+		ZN_PROFILE_SCOPE_NAMED("Task re-prioritization");
+
+		// Re-key all tasks at once and rebuild the heap, which is O(n). This only happens once per period, so it is
+		// cheaper than polling priorities on every pick.
+		_heap.insert(_heap.end(), _pending_items.begin(), _pending_items.end());
+		_pending_items.clear();
+
+		for (size_t i = 0; i < _heap.size();) {
+			TaskItem &item = _heap[i];
+			ZN_ASSERT(item.task != nullptr);
+
+			// Calling `get_priority()` first since it can update cancellation
+			// (not clear API tho, might review that in the future)
+			item.cached_priority = item.task->get_priority();
+
+			if (item.task->is_cancelled()) {
+				cancelled_tasks.push_back(item.task);
+				_heap[i] = _heap.back();
+				_heap.pop_back();
+				continue;
+			}
+
+			++i;
+		}
+
+		std::make_heap(_heap.begin(), _heap.end());
+		_last_priority_update_time_ms = now_ms;
+
+	} else if (_pending_items.size() > 0) {
+		for (TaskItem &item : _pending_items) {
+			ZN_ASSERT(item.task != nullptr);
+
+			item.cached_priority = item.task->get_priority();
+
+			if (item.task->is_cancelled()) {
+				cancelled_tasks.push_back(item.task);
+				continue;
+			}
+
+			_heap.push_back(item);
+			std::push_heap(_heap.begin(), _heap.end());
+		}
+		_pending_items.clear();
+	}
+}
+
+ThreadedTaskRunner::TaskItem ThreadedTaskRunner::TaskQueue::pop() {
+	ZN_ASSERT(_heap.size() > 0);
+	std::pop_heap(_heap.begin(), _heap.end());
+	const TaskItem item = _heap.back();
+	_heap.pop_back();
+	return item;
+}
+
+void ThreadedTaskRunner::TaskQueue::move_to(TaskQueue &dst) {
+	dst._pending_items.insert(dst._pending_items.end(), _heap.begin(), _heap.end());
+	dst._pending_items.insert(dst._pending_items.end(), _pending_items.begin(), _pending_items.end());
+	_heap.clear();
+	_pending_items.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+thread_local ThreadedTaskRunner::ThreadData *ThreadedTaskRunner::s_current_thread_data = nullptr;
+
 ThreadedTaskRunner::ThreadedTaskRunner() {}
 
 ThreadedTaskRunner::~ThreadedTaskRunner() {
 	destroy_all_threads();
 
-	if (_completed_tasks.size() != 0) {
+	if (_completed_tasks_head.load() != nullptr) {
 		// We don't have ownership over tasks, so it's an error to destroy the pool without handling them
 		ZN_PRINT_ERROR("There are unhandled completed tasks remaining!");
 	}
+
+	for (ThreadData &d : _threads) {
+		free_completed_task_nodes(d);
+	}
+}
+
+void ThreadedTaskRunner::free_completed_task_nodes(ThreadData &d) {
+	CompletedTaskNode *node = d.free_completed_nodes;
+	d.free_completed_nodes = nullptr;
+	for (unsigned int i = 0; i < 2; ++i) {
+		while (node != nullptr) {
+			CompletedTaskNode *next = node->next;
+			ZN_DELETE(node);
+			node = next;
+		}
+		node = d.recycled_completed_nodes.exchange(nullptr, std::memory_order_acquire);
+	}
 }
 
 void ThreadedTaskRunner::create_thread(ThreadData &d, uint32_t i) {
@@ -65,7 +164,19 @@ void ThreadedTaskRunner::set_thread_count(uint32_t count) {
 		count = MAX_THREADS;
 	}
 	destroy_all_threads();
-	for (uint32_t i = _thread_count; i < count; ++i) {
+
+	// Tasks left in local queues of threads that won't restart would never run, give them to the remaining threads
+	{
+		MutexLock lock(_tasks_mutex);
+		for (uint32_t i = count; i < _thread_count; ++i) {
+			ThreadData &d = _threads[i];
+			MutexLock local_lock(d.local_tasks_mutex);
+			d.local_tasks.move_to(_parallel_tasks);
+		}
+	}
+
+	// All threads were stopped, so all of them have to be started again
+	for (uint32_t i = 0; i < count; ++i) {
 		ThreadData &d = _threads[i];
 		create_thread(d, i);
 	}
@@ -80,18 +191,74 @@ void ThreadedTaskRunner::set_priority_update_period(uint32_t milliseconds) {
 	_priority_update_period_ms = milliseconds;
 }
 
-void ThreadedTaskRunner::enqueue(IThreadedTask *task, bool serial) {
-	ZN_ASSERT(task != nullptr);
-	TaskItem t;
-	t.task = task;
-	t.is_serial = serial;
+void ThreadedTaskRunner::set_work_stealing_enabled(bool enabled) {
+	_work_stealing_enabled = enabled;
+}
+
+bool ThreadedTaskRunner::try_enqueue_local(Span<IThreadedTask *> new_tasks, bool serial) {
+	// Serial tasks always go to the shared queue, they can't run in parallel anyways
+	if (!_work_stealing_enabled || serial) {
+		return false;
+	}
+	ThreadData *data = s_current_thread_data;
+	if (data == nullptr || data->pool != this) {
+		// Not called from one of our threads
+		return false;
+	}
+	_received_task_count += new_tasks.size();
+	{
+		MutexLock lock(data->local_tasks_mutex);
+		data->local_tasks.push(new_tasks, serial);
+	}
+	// Post anyways, so idle threads wake up and can steal these tasks
+	for (size_t i = 0; i < new_tasks.size(); ++i) {
+		_tasks_semaphore.post();
+	}
+	return true;
+}
+
+ThreadedTaskRunner::SerialLane &ThreadedTaskRunner::get_or_create_serial_lane(uint64_t lane_id) {
+	for (SerialLane &lane : _serial_lanes) {
+		if (lane.id == lane_id) {
+			return lane;
+		}
+	}
+	SerialLane &lane = _serial_lanes.emplace_back();
+	lane.id = lane_id;
+	return lane;
+}
+
+void ThreadedTaskRunner::release_serial_lane(uint64_t lane_id) {
+	bool has_remaining_tasks = false;
 	{
 		MutexLock lock(_tasks_mutex);
-		_tasks.push_back(t);
-		++_debug_received_tasks;
+		for (size_t i = 0; i < _serial_lanes.size(); ++i) {
+			SerialLane &lane = _serial_lanes[i];
+			if (lane.id != lane_id) {
+				continue;
+			}
+			ZN_ASSERT(lane.is_running);
+			lane.is_running = false;
+			has_remaining_tasks = lane.tasks.size() > 0;
+			if (!has_remaining_tasks) {
+				// Lanes are usually tied to resources that can come and go, don't keep them around
+				if (i + 1 != _serial_lanes.size()) {
+					_serial_lanes[i] = std::move(_serial_lanes.back());
+				}
+				_serial_lanes.pop_back();
+			}
+			break;
+		}
 	}
-	// TODO Do I need to post a certain amount of times?
-	_tasks_semaphore.post();
+	if (has_remaining_tasks) {
+		// Threads may be waiting because they could only see tasks of this lane
+		_tasks_semaphore.post();
+	}
+}
+
+void ThreadedTaskRunner::enqueue(IThreadedTask *task, bool serial) {
+	ZN_ASSERT(task != nullptr);
+	enqueue(Span<IThreadedTask *>(&task, 1), serial);
 }
 
 void ThreadedTaskRunner::enqueue(Span<IThreadedTask *> new_tasks, bool serial) {
@@ -100,17 +267,23 @@ void ThreadedTaskRunner::enqueue(Span<IThreadedTask *> new_tasks, bool serial) {
 		ZN_ASSERT(new_tasks[i] != nullptr);
 	}
 #endif
+	if (try_enqueue_local(new_tasks, serial)) {
+		return;
+	}
+	_received_task_count += new_tasks.size();
 	{
 		MutexLock lock(_tasks_mutex);
-		const size_t dst_begin = _tasks.size();
-		_tasks.resize(_tasks.size() + new_tasks.size());
-		for (size_t i = 0; i < new_tasks.size(); ++i) {
-			TaskItem t;
-			t.task = new_tasks[i];
-			t.is_serial = serial;
-			_tasks[dst_begin + i] = t;
+		if (serial) {
+			for (IThreadedTask *task : new_tasks) {
+				TaskItem t;
+				t.task = task;
+				t.is_serial = true;
+				SerialLane &lane = get_or_create_serial_lane(task->get_serial_lane());
+				lane.tasks.push(t);
+			}
+		} else {
+			_parallel_tasks.push(new_tasks, serial);
 		}
-		_debug_received_tasks += new_tasks.size();
 	}
 	// TODO Do I need to post a certain amount of times?
 	for (size_t i = 0; i < new_tasks.size(); ++i) {
@@ -130,7 +303,82 @@ void ThreadedTaskRunner::thread_func_static(void *p_data) {
 #endif
 	}
 
+	s_current_thread_data = &data;
 	pool.thread_func(data);
+	s_current_thread_data = nullptr;
+}
+
+void ThreadedTaskRunner::pick_local_tasks(ThreadData &data, uint64_t now, std::vector<TaskItem> &tasks,
+		std::vector<IThreadedTask *> &cancelled_tasks) {
+	MutexLock lock(data.local_tasks_mutex);
+	data.local_tasks.update(now, _priority_update_period_ms, cancelled_tasks);
+	for (uint32_t bi = 0; bi < _batch_count && data.local_tasks.is_top_available(); ++bi) {
+		tasks.push_back(data.local_tasks.pop());
+	}
+}
+
+void ThreadedTaskRunner::steal_tasks(ThreadData &data, uint64_t now, std::vector<TaskItem> &tasks,
+		std::vector<IThreadedTask *> &cancelled_tasks) {
+	// Start from the next thread so victims are spread out when multiple threads are stealing
+	for (uint32_t i = 1; i < _thread_count && tasks.empty(); ++i) {
+		ThreadData &victim = _threads[(data.index + i) % _thread_count];
+
+		MutexLock lock(victim.local_tasks_mutex);
+		victim.local_tasks.update(now, _priority_update_period_ms, cancelled_tasks);
+
+		if (victim.local_tasks.is_top_available()) {
+			// Only steal one task, the owner is likely to pick the others soon
+			tasks.push_back(victim.local_tasks.pop());
+		}
+	}
+}
+
+ThreadedTaskRunner::CompletedTaskNode *ThreadedTaskRunner::allocate_completed_task_node(ThreadData &data) {
+	if (data.free_completed_nodes == nullptr) {
+		data.free_completed_nodes = data.recycled_completed_nodes.exchange(nullptr, std::memory_order_acquire);
+	}
+	CompletedTaskNode *node = data.free_completed_nodes;
+	if (node != nullptr) {
+		data.free_completed_nodes = node->next;
+		node->next = nullptr;
+	} else {
+		node = ZN_NEW(CompletedTaskNode);
+		node->owner = &data;
+	}
+	return node;
+}
+
+void ThreadedTaskRunner::push_completed_tasks(ThreadData &data, Span<IThreadedTask *const> completed_tasks) {
+	if (completed_tasks.size() == 0) {
+		return;
+	}
+
+	// Build the chain locally, most recent task first, then publish it with a single atomic operation
+	CompletedTaskNode *first = nullptr;
+	CompletedTaskNode *last = nullptr;
+	for (size_t i = 0; i < completed_tasks.size(); ++i) {
+		CompletedTaskNode *node = allocate_completed_task_node(data);
+		node->task = completed_tasks[i];
+		node->next = first;
+		if (last == nullptr) {
+			last = node;
+		}
+		first = node;
+	}
+
+	last->next = _completed_tasks_head.load(std::memory_order_relaxed);
+	while (!_completed_tasks_head.compare_exchange_weak(
+			last->next, first, std::memory_order_release, std::memory_order_relaxed)) {
+	}
+
+	const uint32_t completed_count = _completed_task_count += completed_tasks.size();
+
+	if (completed_count == _received_task_count) {
+		// Lock so the notification can't happen between the moment a waiting thread checks the counts and the moment it
+		// starts waiting
+		std::lock_guard<std::mutex> lock(_all_tasks_completed_mutex);
+		_all_tasks_completed_condition.notify_all();
+	}
 }
 
 void ThreadedTaskRunner::thread_func(ThreadData &data) {
@@ -138,120 +386,112 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 
 	std::vector<TaskItem> tasks;
 	std::vector<IThreadedTask *> cancelled_tasks;
+	std::vector<IThreadedTask *> completed_tasks;
 
 	while (!data.stop) {
 		bool is_running_serial_task = false;
-		bool task_queue_was_empty = false;
+		uint64_t serial_lane_id = 0;
 		{
 			ZN_PROFILE_SCOPE_NAMED("Task pickup");
 
 			data.debug_state = STATE_PICKING;
 			const uint64_t now = Time::get_singleton()->get_ticks_msec();
 
-			{
+			if (_work_stealing_enabled) {
+				pick_local_tasks(data, now, tasks, cancelled_tasks);
+			}
+
+			if (tasks.empty()) {
 				MutexLock lock(_tasks_mutex);
 
-				// Pick best tasks
-				for (uint32_t bi = 0; bi < _batch_count && _tasks.size() != 0; ++bi) {
-					size_t best_index = 0; // Take first by default, this is a valid index
-					TaskPriority highest_priority = TaskPriority::min();
-					bool picked_task = false;
-
-					// Find best task to pick
-					// TODO Optimize: this takes a lot of time when there are many queued tasks. Use a better container?
-					for (size_t i = 0; i < _tasks.size();) {
-						TaskItem &item = _tasks[i];
-						ZN_ASSERT(item.task != nullptr);
-
-						// Process priority and cancellation
-						if (now - item.last_priority_update_time_ms > _priority_update_period_ms) {
-							// Calling `get_priority()` first since it can update cancellation
-							// (not clear API tho, might review that in the future)
-							item.cached_priority = item.task->get_priority();
-
-							if (item.task->is_cancelled()) {
-								cancelled_tasks.push_back(item.task);
-								_tasks[i] = _tasks.back();
-								_tasks.pop_back();
-								continue;
+				_parallel_tasks.update(now, _priority_update_period_ms, cancelled_tasks);
+				for (size_t i = 0; i < _serial_lanes.size();) {
+					SerialLane &lane = _serial_lanes[i];
+					if (!lane.is_running) {
+						lane.tasks.update(now, _priority_update_period_ms, cancelled_tasks);
+						if (lane.tasks.size() == 0) {
+							// All its tasks were cancelled. Lanes are otherwise only removed when released, which
+							// won't happen since nothing runs in it.
+							if (i + 1 != _serial_lanes.size()) {
+								_serial_lanes[i] = std::move(_serial_lanes.back());
 							}
-
-							item.last_priority_update_time_ms = now;
+							_serial_lanes.pop_back();
+							continue;
 						}
+					}
+					++i;
+				}
 
-						// Pick item if it has better priority.
-						// If the item is serial, there must not be a serial task already running.
-						if (item.cached_priority > highest_priority && !(item.is_serial && _is_serial_task_running)) {
-							highest_priority = item.cached_priority;
-							// This index should remain valid even if some tasks are removed because the "remove and
-							// swap back" technique only affects items coming after
-							best_index = i;
-							picked_task = true;
-						}
+				// Pick best tasks
+				for (uint32_t bi = 0; bi < _batch_count; ++bi) {
+					TaskQueue *best_queue = nullptr;
+					SerialLane *best_lane = nullptr;
 
-						++i;
+					if (_parallel_tasks.is_top_available()) {
+						best_queue = &_parallel_tasks;
 					}
 
-					if (picked_task) {
-						tasks.push_back(_tasks[best_index]);
-						ZN_ASSERT(best_index < _tasks.size());
-						_tasks[best_index] = _tasks.back();
-						_tasks.pop_back();
+					// Serial tasks can only be picked from lanes that aren't already running in another thread.
+					// More than one serial task of the same lane can be in the list of tasks the current thread picks
+					// up, since they will run one after the other. For simplicity, a thread only picks from one lane
+					// at a time.
+					for (SerialLane &lane : _serial_lanes) {
+						if (is_running_serial_task ? lane.id != serial_lane_id : lane.is_running) {
+							continue;
+						}
+						if (!lane.tasks.is_top_available()) {
+							continue;
+						}
+						if (best_queue == nullptr ||
+								lane.tasks.top().cached_priority > best_queue->top().cached_priority) {
+							best_queue = &lane.tasks;
+							best_lane = &lane;
+						}
 					}
 
-				} // For each task to pick
+					if (best_queue == nullptr) {
+						break;
+					}
 
-				// If we picked up a serial task, we must set the shared boolean to `true`.
-				// More than one serial task can be in the list of tasks the current thread picks up,
-				// so we update the boolean after picking them all.
-				// This must be the only place it can be set to `true`, and is guarded by mutex.
-				if (_is_serial_task_running == false) { // Only an optimization, this doesnt actually do thread-safety
-					for (unsigned int i = 0; i < tasks.size(); ++i) {
-						if (tasks[i].is_serial) {
-							// Write to member var so all threads can check this
-							_is_serial_task_running = true;
-							// Write to thread-local variable so we know it is the current thread
-							is_running_serial_task = true;
-							break;
-						}
+					const TaskItem item = best_queue->pop();
+					tasks.push_back(item);
+
+					if (best_lane != nullptr) {
+						// This must be the only place a lane can be marked running, and is guarded by mutex.
+						best_lane->is_running = true;
+						is_running_serial_task = true;
+						serial_lane_id = best_lane->id;
 					}
-				}
 
-				task_queue_was_empty = _tasks.size() == 0;
+				} // For each task to pick
 
 			} // Tasks queue mutex lock
+
+			if (_work_stealing_enabled && tasks.empty()) {
+				steal_tasks(data, now, tasks, cancelled_tasks);
+			}
 		}
 
 		if (cancelled_tasks.size() > 0) {
-			MutexLock lock(_completed_tasks_mutex);
-			for (size_t i = 0; i < cancelled_tasks.size(); ++i) {
-				_completed_tasks.push_back(cancelled_tasks[i]);
-				++_debug_completed_tasks;
-			}
+			push_completed_tasks(data, to_span(cancelled_tasks));
 			cancelled_tasks.clear();
 		}
 
 		// print_line(String("Processing {0} tasks").format(varray(tasks.size())));
 
 		if (tasks.empty()) {
-			if (task_queue_was_empty) {
-				// The task queue is empty, will wait until more tasks are posted.
-				// If a task is posted between the moment we last checked the queue and now,
-				// the semaphore will have one count to decrement and we'll not stop here.
-
-				data.debug_state = STATE_WAITING;
-
-				// Wait for more tasks
-				data.waiting = true;
-				_tasks_semaphore.wait();
-				data.waiting = false;
-
-			} else {
-				// The current thread was not allowed to pick tasks currently in the queue (they could be serial and one
-				// is already running). So we'll wait for a very short time before retrying.
-				// (alternative would be to post the semaphore after each serial task?)
-				Thread::sleep_usec(1000);
-			}
+			// Either the task queue is empty, or the current thread was not allowed to pick tasks currently in the
+			// queue (they could be serial and their lane is already running). Will wait until more tasks are posted,
+			// or a lane is released.
+			// If a task is posted between the moment we last checked the queue and now,
+			// the semaphore will have one count to decrement and we'll not stop here.
+
+			data.debug_state = STATE_WAITING;
+
+			// Wait for more tasks
+			data.waiting = true;
+			_tasks_semaphore.wait();
+			data.waiting = false;
 
 		} else {
 			data.debug_state = STATE_RUNNING;
@@ -268,24 +508,18 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 				}
 			}
 
-			// If the current thread just ran serial tasks
+			// If the current thread just ran serial tasks, let other threads pick tasks from that lane now.
+			// Done before reporting completion, so the lane is free by the time all tasks are known to be completed.
 			if (is_running_serial_task) {
-				ZN_ASSERT(_is_serial_task_running);
-				// Reset back the boolean so any thread can pick serial tasks now.
-				// This is the only place we set it to `false`, and can only be `true` already when that happens,
-				// so locking the mutex should not be necessary.
-				_is_serial_task_running = false;
+				release_serial_lane(serial_lane_id);
 			}
 
-			{
-				MutexLock lock(_completed_tasks_mutex);
-				for (size_t i = 0; i < tasks.size(); ++i) {
-					TaskItem &item = tasks[i];
-					_completed_tasks.push_back(item.task);
-					++_debug_completed_tasks;
-				}
+			for (const TaskItem &item : tasks) {
+				completed_tasks.push_back(item.task);
 			}
+			push_completed_tasks(data, to_span(completed_tasks));
 
+			completed_tasks.clear();
 			tasks.clear();
 		}
 	}
@@ -296,46 +530,14 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 void ThreadedTaskRunner::wait_for_all_tasks() {
 	const uint32_t suspicious_delay_msec = 10'000;
 
-	uint32_t before = Time::get_singleton()->get_ticks_msec();
-	bool error1_reported = false;
-
-	// Wait until all tasks have been taken
-	while (true) {
-		{
-			MutexLock lock(_tasks_mutex);
-			if (_tasks.size() == 0) {
-				break;
-			}
-		}
-
-		Thread::sleep_usec(2000);
-
-		if (!error1_reported && Time::get_singleton()->get_ticks_msec() - before > suspicious_delay_msec) {
-			ZN_PRINT_WARNING("Waiting for all tasks to be picked is taking a long time");
-			error1_reported = true;
-		}
-	}
-
-	before = Time::get_singleton()->get_ticks_msec();
-	bool error2_reported = false;
-
-	// Wait until all threads have done all their tasks
-	bool any_working_thread = true;
-	while (any_working_thread) {
-		any_working_thread = false;
-		for (size_t i = 0; i < _thread_count; ++i) {
-			const ThreadData &t = _threads[i];
-			if (t.waiting == false) {
-				any_working_thread = true;
-				break;
-			}
-		}
-
-		Thread::sleep_usec(2000);
+	std::unique_lock<std::mutex> lock(_all_tasks_completed_mutex);
+	bool warning_reported = false;
 
-		if (!error2_reported && Time::get_singleton()->get_ticks_msec() - before > suspicious_delay_msec) {
+	while (!_all_tasks_completed_condition.wait_for(lock, std::chrono::milliseconds(suspicious_delay_msec),
+			[this]() { return _received_task_count == _completed_task_count; })) {
+		if (!warning_reported) {
 			ZN_PRINT_WARNING("Waiting for all tasks to be completed is taking a long time");
-			error2_reported = true;
+			warning_reported = true;
 		}
 	}
 }
@@ -353,7 +555,7 @@ const char *ThreadedTaskRunner::get_thread_debug_task_name(unsigned int thread_i
 }
 
 unsigned int ThreadedTaskRunner::get_debug_remaining_tasks() const {
-	return _debug_received_tasks - _debug_completed_tasks;
+	return _received_task_count - _completed_task_count;
 }
 
 } // namespace zylann
@@ -2,6 +2,7 @@
 #define ZYLANN_THREADED_TASK_RUNNER_H
 
 #include "../fixed_array.h"
+#include "../memory.h"
 #include "../span.h"
 #include "../thread/mutex.h"
 #include "../thread/semaphore.h"
@@ -9,7 +10,8 @@
 #include "threaded_task.h"
 
 #include <atomic>
-#include <queue>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 
 namespace zylann {
@@ -51,11 +53,22 @@ public:
 	// Can't be changed after tasks have been queued.
 	void set_priority_update_period(uint32_t milliseconds);
 
+	// When enabled, each thread owns a local task queue. Non-serial tasks enqueued from inside a thread of the pool
+	// (such as follow-up tasks scheduled by a running task) go to the local queue of that thread instead of the shared
+	// one, and threads that run out of work steal tasks from other threads. This reduces contention on the shared queue
+	// when using many threads. Priorities are only honored within each queue.
+	// Can't be changed after tasks have been queued.
+	void set_work_stealing_enabled(bool enabled);
+	bool is_work_stealing_enabled() const {
+		return _work_stealing_enabled;
+	}
+
 	// TODO Expect tasks to be unique ptrs?
 
 	// Schedules a task.
 	// Ownership is NOT passed to the pool, so make sure you get them back when completed if you want to delete them.
-	// All tasks scheduled with `serial=true` will run one after the other, using one thread at a time.
+	// Tasks scheduled with `serial=true` sharing the same lane (see `IThreadedTask::get_serial_lane`) will run one
+	// after the other, using one thread at a time. Serial tasks of different lanes can run in parallel.
 	// Tasks scheduled with `serial=false` can run in parallel using multiple threads.
 	// Serial execution is useful when such tasks cannot run in parallel due to locking a shared resource. This avoids
 	// clogging up all threads with waiting tasks.
@@ -63,19 +76,31 @@ public:
 	// Schedules multiple tasks at once. Involves less internal locking.
 	void enqueue(Span<IThreadedTask *> new_tasks, bool serial);
 
-	// TODO Optimization: lambda might not be the best API. memcpying to a vector would ensure we lock for a shorter
-	// time.
+	// Calls `f` on each completed task, in the order they completed.
+	// This does not lock the pool, so threads can keep completing tasks while this runs.
 	template <typename F>
 	void dequeue_completed_tasks(F f) {
-		MutexLock lock(_completed_tasks_mutex);
-		for (size_t i = 0; i < _completed_tasks.size(); ++i) {
-			IThreadedTask *task = _completed_tasks[i];
-			f(task);
+		CompletedTaskNode *node = _completed_tasks_head.exchange(nullptr, std::memory_order_acquire);
+
+		// Nodes are pushed at the head, so the list is in reverse order of completion
+		CompletedTaskNode *prev = nullptr;
+		while (node != nullptr) {
+			CompletedTaskNode *next = node->next;
+			node->next = prev;
+			prev = node;
+			node = next;
+		}
+
+		node = prev;
+		while (node != nullptr) {
+			CompletedTaskNode *next = node->next;
+			f(node->task);
+			recycle_completed_task_node(node);
+			node = next;
 		}
-		_completed_tasks.clear();
 	}
 
-	// Blocks and wait for all tasks to finish (assuming no more are getting added!)
+	// Blocks and wait for all tasks to finish (assuming no more are getting added, except by tasks themselves)
 	void wait_for_all_tasks();
 
 	State get_thread_debug_state(uint32_t i) const;
@@ -87,9 +112,59 @@ private:
 		IThreadedTask *task = nullptr;
 		TaskPriority cached_priority;
 		bool is_serial = false;
-		uint64_t last_priority_update_time_ms = 0;
+
+		// Used for heap ordering, the item with highest priority being at the top
+		inline bool operator<(const TaskItem &other) const {
+			return cached_priority < other.cached_priority;
+		}
 	};
 
+	// Binary max-heap of tasks ordered by their cached priority, allowing to pick the best task in O(log n).
+	// Priorities are polled once when tasks enter the queue, and then re-polled all at once (along with removal of
+	// cancelled tasks) every time the priority update period elapses, rather than on every pick.
+	// Not thread-safe.
+	class TaskQueue {
+	public:
+		inline void push(TaskItem item) {
+			_pending_items.push_back(item);
+		}
+
+		void push(Span<IThreadedTask *> tasks, bool serial);
+
+		// Integrates pending tasks into the heap and re-prioritizes all tasks if the update period has elapsed.
+		// Cancelled tasks are removed and appended to `cancelled_tasks`.
+		void update(uint64_t now_ms, uint32_t priority_update_period_ms, std::vector<IThreadedTask *> &cancelled_tasks);
+
+		// Must be called after `update`.
+		inline const TaskItem &top() const {
+			ZN_ASSERT(_heap.size() > 0);
+			return _heap[0];
+		}
+
+		// Must be called after `update`.
+		TaskItem pop();
+
+		// Must be called after `update`.
+		inline bool is_top_available() const {
+			return _heap.size() > 0;
+		}
+
+		inline size_t size() const {
+			return _heap.size() + _pending_items.size();
+		}
+
+		// Moves all tasks to another queue, where their priority will be polled again.
+		void move_to(TaskQueue &dst);
+
+	private:
+		std::vector<TaskItem> _heap;
+		// Tasks added since the last update. Their priority has not been polled yet.
+		std::vector<TaskItem> _pending_items;
+		uint64_t _last_priority_update_time_ms = 0;
+	};
+
+	struct CompletedTaskNode;
+
 	struct ThreadData {
 		Thread thread;
 		ThreadedTaskRunner *pool = nullptr;
@@ -100,6 +175,17 @@ private:
 		std::string name;
 		std::atomic<const char *> debug_running_task_name = { nullptr };
 
+		// Only used when work stealing is enabled. Can be accessed by other threads.
+		TaskQueue local_tasks;
+		BinaryMutex local_tasks_mutex;
+
+		// Nodes used to report completed tasks are allocated by each thread and recycled once dequeued, so completing
+		// a task doesn't allocate memory. Only accessed by the thread itself.
+		CompletedTaskNode *free_completed_nodes = nullptr;
+		// Nodes given back after their task was dequeued. The thread takes them all at once when it runs out of free
+		// nodes.
+		std::atomic<CompletedTaskNode *> recycled_completed_nodes = { nullptr };
+
 		void wait_to_finish_and_reset() {
 			thread.wait_to_finish();
 			pool = nullptr;
@@ -111,35 +197,78 @@ private:
 		}
 	};
 
+	// Serial tasks sharing the same lane can't run at the same time
+	struct SerialLane {
+		uint64_t id = 0;
+		TaskQueue tasks;
+		bool is_running = false;
+	};
+
+	struct CompletedTaskNode {
+		IThreadedTask *task = nullptr;
+		CompletedTaskNode *next = nullptr;
+		// Thread that allocated the node, to which it will be given back
+		ThreadData *owner = nullptr;
+	};
+
 	static void thread_func_static(void *p_data);
 	void thread_func(ThreadData &data);
 
+	void pick_local_tasks(ThreadData &data, uint64_t now, std::vector<TaskItem> &tasks,
+			std::vector<IThreadedTask *> &cancelled_tasks);
+	void steal_tasks(ThreadData &data, uint64_t now, std::vector<TaskItem> &tasks,
+			std::vector<IThreadedTask *> &cancelled_tasks);
+	SerialLane &get_or_create_serial_lane(uint64_t lane_id);
+	void release_serial_lane(uint64_t lane_id);
+	bool try_enqueue_local(Span<IThreadedTask *> new_tasks, bool serial);
+	void push_completed_tasks(ThreadData &data, Span<IThreadedTask *const> completed_tasks);
+	static CompletedTaskNode *allocate_completed_task_node(ThreadData &data);
+
+	static inline void recycle_completed_task_node(CompletedTaskNode *node) {
+		std::atomic<CompletedTaskNode *> &recycled_nodes = node->owner->recycled_completed_nodes;
+		node->task = nullptr;
+		node->next = recycled_nodes.load(std::memory_order_relaxed);
+		while (!recycled_nodes.compare_exchange_weak(
+				node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+	}
+
+	// Thread of the pool the current thread belongs to, if any
+	static thread_local ThreadData *s_current_thread_data;
+
 	void create_thread(ThreadData &d, uint32_t i);
 	void destroy_all_threads();
+	static void free_completed_task_nodes(ThreadData &d);
 
 	FixedArray<ThreadData, MAX_THREADS> _threads;
 	uint32_t _thread_count = 0;
 
-	// TODO Optimization: use a less naive design? Maybe moodycamel
-	std::vector<TaskItem> _tasks;
+	// Parallel and serial tasks are kept separate, so picking can skip lanes entirely when one of their tasks is
+	// already running. There are usually very few lanes.
+	TaskQueue _parallel_tasks;
+	std::vector<SerialLane> _serial_lanes;
 	Mutex _tasks_mutex;
+	// Posted once per queued task, and when a serial lane is released while it still has tasks
 	Semaphore _tasks_semaphore;
 
-	std::vector<IThreadedTask *> _completed_tasks;
-	Mutex _completed_tasks_mutex;
+	// Notified when all received tasks have completed
+	std::mutex _all_tasks_completed_mutex;
+	std::condition_variable _all_tasks_completed_condition;
+
+	// Lock-free stack of completed tasks, so the thread dequeuing them never blocks threads of the pool
+	std::atomic<CompletedTaskNode *> _completed_tasks_head = { nullptr };
 
 	// TODO Remove batching, it's not really useful
 	uint32_t _batch_count = 1;
 	uint32_t _priority_update_period_ms = 32;
-
-	// This boolean is also guarded with `_tasks_mutex`.
-	// Tasks marked as "serial" must be executed by only one thread at a time.
-	bool _is_serial_task_running = false;
+	bool _work_stealing_enabled = false;
 
 	std::string _name;
 
-	unsigned int _debug_received_tasks = 0;
-	unsigned int _debug_completed_tasks = 0;
+	// Received is always incremented before tasks become visible to threads, so both are equal only when all tasks
+	// have completed.
+	std::atomic_uint32_t _received_task_count = { 0 };
+	std::atomic_uint32_t _completed_task_count = { 0 };
 };
 
 } // namespace zylann